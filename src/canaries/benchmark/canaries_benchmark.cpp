@@ -35,7 +35,7 @@ using namespace genny::canaries;
  */
 TEST_CASE("Measure Phaseloop Overhead", "[benchmark]") {
     std::vector<std::string> loopNames{
-        "simple", "metrics", "phase", "real", "metrics-ftdc", "real-ftdc"};
+        "simple", "metrics", "phase", "real", "metrics-ftdc", "real-ftdc", "batch"};
 
     auto printRes = [&](std::vector<Nanosecond>& loopTimings, std::string_view name) {
         BOOST_LOG_TRIVIAL(info) << "Total duration for " << name << ":";
@@ -62,6 +62,7 @@ TEST_CASE("Measure Phaseloop Overhead", "[benchmark]") {
         auto r = loopTimings[3];
         auto mf = loopTimings[4];
         auto rf = loopTimings[5];
+        auto b = loopTimings[6];
 
         // Write out all the requires explicitly so it's easy to find the line number.
 
@@ -80,6 +81,9 @@ TEST_CASE("Measure Phaseloop Overhead", "[benchmark]") {
         // Compare FTDC loops with metrics/real loops.
         REQUIRE((mf - m) * threshold < mf);
         REQUIRE((rf - r) * threshold < r);
+
+        // Compare batched phase loops with native loops.
+        REQUIRE((b - s) * threshold < b);
     };
 
     SECTION("nop") {
@@ -97,6 +101,9 @@ TEST_CASE("Measure Phaseloop Overhead", "[benchmark]") {
         // or the machine is broken.
         REQUIRE(nopRes[0] > 1e6);       // Each iteration can't take less than 1ns.
         REQUIRE(nopRes[0] < 50 * 1e6);  // Each iteration can't take more than 50ns.
+
+        // Batching exists to take the per-iteration checks out of cheap loops.
+        REQUIRE(nopRes[6] < nopRes[2]);
     }
 
     SECTION("sleep") {
@@ -39,6 +39,8 @@ using Nanosecond = int64_t;
 template <class Task, class... Args>
 class Loops {
 public:
+    static constexpr int64_t kBatchSize = 256;
+
     explicit Loops(int64_t iterations) : _iterations(iterations){};
 
     /**
@@ -57,6 +59,14 @@ public:
      */
     Nanosecond phaseLoop(Args&&... args);
 
+    /**
+     * Run PhaseLoop in batches of kBatchSize iterations.
+     *
+     * @param args arguments forwarded to the workload being run.
+     * @return the CPU time this function took, in nanoseconds.
+     */
+    Nanosecond batchPhaseLoop(Args&&... args);
+
     /**
      *  Run native for-loop and record one timer metric per iteration.
      *
@@ -117,6 +127,8 @@ std::vector<Nanosecond> runTest(std::vector<std::string>& loopNames,
                 time = loops.simpleLoop(std::forward<Args>(args)...);
             } else if (loopName == "phase") {
                 time = loops.phaseLoop(std::forward<Args>(args)...);
+            } else if (loopName == "batch") {
+                time = loops.batchPhaseLoop(std::forward<Args>(args)...);
             } else if (loopName == "metrics") {
                 time = loops.metricsLoop(std::forward<Args>(args)...);
             } else if (loopName == "metrics-ftdc") {
@@ -174,12 +174,13 @@ class Singleton {
 private:
     static Singleton* instance;
 
+    // Constructed before the PoolManager, which reads its Clients.
+    NodeSource _ns;
     genny::v1::PoolManager _poolManager;
 
     explicit Singleton(std::string mongoUri);
 
 public:
-    NodeSource ns;
     mongocxx::pool::entry client;
     bsoncxx::document::value pingCmd;
 
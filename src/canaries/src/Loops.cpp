@@ -86,6 +86,31 @@ Nanosecond Loops<Task, Args...>::phaseLoop(Args&&... args) {
     return after - before;
 }
 
+template <class Task, class... Args>
+Nanosecond Loops<Task, Args...>::batchPhaseLoop(Args&&... args) {
+
+    // Copy/pasted from phaseLoop()
+    Orchestrator o{};
+    v1::ActorPhase<int> loop{
+        o,
+        std::make_unique<v1::IterationChecker>(std::nullopt,
+                                               std::make_optional(IntegerSpec(_iterations)),
+                                               false,
+                                               0_ts,
+                                               0_ts,
+                                               std::nullopt),
+        1};
+    auto task = Task(std::forward<Args>(args)...);
+
+    int64_t before = now();
+    for (auto&& batch : loop.batches(kBatchSize))
+        for (auto _ : batch)
+            task.run();
+    int64_t after = now();
+
+    return after - before;
+}
+
 template <class Task, class... Args>
 Nanosecond Loops<Task, Args...>::metricsLoop(Args&&... args) {
 
@@ -75,6 +75,7 @@ struct ProgramOptions {
         progDesc << R"(
     simple        Run native for-loop; used as the control group with no Genny code
     phase         Run just the PhaseLoop
+    batch         Run the PhaseLoop in batches of 256 iterations
     metrics       Run native for-loop and record one timer metric per iteration
     metrics-ftdc  Run native for-loop and record one timer metric per iteration, uses FTDC metrics
     real-ftdc     Run PhaseLoop and record one timer metric per iteration; resembles
@@ -141,7 +142,8 @@ struct ProgramOptions {
         if (vm.count("loop-type") >= 1)
             _loopNames = vm["loop-name"].as<std::vector<std::string>>();
         else
-            _loopNames = {"simple", "phase", "metrics", "metrics-ftdc", "real", "real-ftdc"};
+            _loopNames = {
+                "simple", "phase", "batch", "metrics", "metrics-ftdc", "real", "real-ftdc"};
 
         _iterations = vm["iterations"].as<int64_t>();
         _mongoUri = vm["mongo-uri"].as<std::string>();
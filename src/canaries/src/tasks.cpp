@@ -13,8 +13,8 @@ Singleton* Singleton::getInstance(const std::string& mongoUri) {
 }
 
 Singleton::Singleton(std::string mongoUri)
-    : _poolManager{mongoUri, {}},
-      ns{"", ""},
-      client{_poolManager.client("PingTask", 1, ns.root())},
+    : _ns{"", ""},
+      _poolManager{mongoUri, {}, _ns.root()},
+      client{_poolManager.client("PingTask", 1)},
       pingCmd{make_document(kvp("ping", 1))} {};
 }  // namespace genny::canaries::ping_task
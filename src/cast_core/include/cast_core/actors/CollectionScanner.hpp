@@ -35,11 +35,6 @@ namespace genny::actor {
  * Owner: Storage Engines
  */
 class CollectionScanner : public Actor {
-    // Used to assign each CollectionScanner instance an id starting at 0.
-    // The genny::Acttor::id() field is monotonically increasing across all Actors
-    // of all types.
-    struct ActorCounter : genny::WorkloadContext::ShareableState<std::atomic_int> {};
-
 public:
     // Tracks how many instances of this Actor are currently running.
     struct RunningActorCounter : genny::WorkloadContext::ShareableState<std::atomic_int> {};
@@ -56,6 +51,7 @@ private:
     mongocxx::pool::entry _client;
     genny::metrics::Operation _totalInserts;
 
+    // Numbers each CollectionScanner from 0; genny::Actor::id() counts Actors of every type.
     /** @private */
     int _index;
     RunningActorCounter& _runningActorCounter;
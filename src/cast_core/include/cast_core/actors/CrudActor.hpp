@@ -77,6 +77,36 @@ namespace genny::actor {
  *       OperationName: drop
  * ```
  *
+ * By default every operation runs in order on each iteration. If the operations have a
+ * `Weight`, each iteration instead runs one operation chosen at random in proportion to
+ * its weight, so a single Actor can drive a mixed workload. An operation can also have
+ * its own `Rate`, which, like `GlobalRate`, is shared by all threads of the Actor:
+ *
+ * ```yaml
+ * Actors:
+ * - Name: ReadMostly
+ *   Type: CrudActor
+ *   Threads: 32
+ *   Database: testdb
+ *   Phases:
+ *   - Duration: 5 minutes
+ *     Collection: test
+ *     Operations:
+ *     - OperationName: findOne
+ *       Weight: 90
+ *       OperationCommand:
+ *         Filter: { a: { ^RandomInt: { min: 0, max: 1000 } } }
+ *     - OperationName: insertOne
+ *       Weight: 10
+ *       Rate: 500 per 1 second
+ *       OperationCommand:
+ *         Document: { a: { ^RandomInt: { min: 0, max: 1000 } } }
+ * ```
+ *
+ * Either all or none of a phase's operations must have a `Weight`. An operation waits
+ * for its `Rate` before it runs, so a limited operation that is chosen often slows the
+ * whole Actor down rather than skewing the mix.
+ *
  * Owner: STM
  */
 class CrudActor : public Actor {
@@ -96,6 +126,7 @@ public:
 
 private:
     mongocxx::pool::entry _client;
+    DefaultRandom& _rng;
 
     /** @private */
     struct PhaseConfig;
@@ -37,6 +37,10 @@ namespace genny::v1::actor {
  * Reports:
  *   GennyInternal.PhaseTimingRecorder.Phase - Records an event at the end of each phase, with a
  * duration the length of the phase.
+ *   GennyInternal.PhaseTimingRecorder.PhaseStartSkew - Records an event at the start of each
+ * phase, with a duration the time between the first and last Actor thread arriving to start it.
+ *   GennyInternal.PhaseTimingRecorder.PhaseEndSkew - Records an event at the end of each phase,
+ * with a duration the time between the first and last blocking Actor thread finishing it.
  *
  * Owner: 10gen/dev-prod-tips
  */
@@ -53,7 +57,11 @@ public:
     }
 
 private:
+    static void reportSkew(genny::metrics::Operation& op, Duration skew);
+
     genny::metrics::Operation _phaseOp;
+    genny::metrics::Operation _startSkewOp;
+    genny::metrics::Operation _endSkewOp;
 
     /** @private */
     Orchestrator& _orchestrator;
@@ -36,11 +36,6 @@ namespace genny::actor {
  * Owner: Storage Engines
  */
 class RandomSampler : public Actor {
-    // Used to assign each RandomSampler instance an id starting at 0.
-    // The genny::Acttor::id() field is monotonically increasing across all Actors
-    // of all types.
-    struct ActorCounter : genny::WorkloadContext::ShareableState<std::atomic_int> {};
-
 public:
     explicit RandomSampler(ActorContext& context);
     ~RandomSampler() = default;
@@ -54,6 +49,7 @@ private:
     /** @private */
     struct PhaseConfig;
     DefaultRandom& _random;
+    // Numbers each RandomSampler from 0; genny::Actor::id() counts Actors of every type.
     int _index;
     PhaseLoop<PhaseConfig> _loop;
     CollectionScanner::RunningActorCounter& _activeCollectionScannerInstances;
@@ -0,0 +1,97 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_61ED4815_3E25_476F_83B5_A344464CE63F_INCLUDED
+#define HEADER_61ED4815_3E25_476F_83B5_A344464CE63F_INCLUDED
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <mongocxx/database.hpp>
+#include <mongocxx/pool.hpp>
+
+#include <gennylib/Actor.hpp>
+#include <gennylib/PhaseLoop.hpp>
+#include <gennylib/context.hpp>
+#include <gennylib/v1/OperationLog.hpp>
+
+#include <metrics/metrics.hpp>
+
+namespace genny::actor {
+
+/**
+ * Runs the commands `genny run --record <directory>` recorded, so a workload's load
+ * can be repeated byte for byte without the cost, or the variation between runs, of
+ * generating it. There's one Replay thread per Actor thread that was recorded, and
+ * each replays that thread's commands in order on the database each ran on.
+ *
+ * Each iteration replays the whole recording. With `Pace: Original`, the default,
+ * each command is sent as long after the iteration started as it was after the
+ * recording started, divided by `Speedup`. Commands that fall behind are sent
+ * straight away rather than skipped. With `Pace: AsFastAsPossible` each is sent as
+ * soon as the one before it returns. A replay stops early when its phase ends.
+ *
+ * Commands are replayed exactly as recorded, including the `_id`s of inserted
+ * documents, so recreate the collections a recording writes to before replaying it.
+ * Only the first batch of each query's results is fetched. Failures are counted in
+ * each command's metrics and don't stop the replay unless `ThrowOnFailure: true`.
+ *
+ * ```yaml
+ * Actors:
+ * - Name: Replayed
+ *   Type: Replay
+ *   Recording: ./recording
+ *   Phases:
+ *   - Repeat: 1
+ *     Pace: Original
+ *     Speedup: 2
+ *   - Duration: 10 minutes
+ *     Pace: AsFastAsPossible
+ * ```
+ *
+ * Each command's latency is reported as `<ActorName>.<command>`.
+ *
+ * Owner: product-perf
+ */
+class Replay : public Actor {
+public:
+    Replay(ActorContext& context, v1::OperationLogReader log);
+    ~Replay() override = default;
+
+    static std::string_view defaultName() {
+        return "Replay";
+    }
+
+    void run() override;
+
+private:
+    void _replay(PhaseNumber phase, double speedup, bool throwOnFailure);
+    mongocxx::database& _database(std::string_view name);
+
+    Orchestrator& _orchestrator;
+    mongocxx::pool::entry _client;
+    v1::OperationLogReader _log;
+    std::unordered_map<std::string, metrics::Operation> _operations;
+    std::vector<std::pair<std::string, mongocxx::database>> _databases;
+
+    /** @private */
+    struct PhaseConfig;
+    PhaseLoop<PhaseConfig> _loop;
+};
+
+}  // namespace genny::actor
+
+#endif  // HEADER_61ED4815_3E25_476F_83B5_A344464CE63F_INCLUDED
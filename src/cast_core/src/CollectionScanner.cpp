@@ -78,6 +78,7 @@ struct CollectionScanner::PhaseConfig {
     bool aggregate = false;
     std::optional<DocumentGenerator> aggregatePipelineExpr;
     mongocxx::options::aggregate aggregateOptions;
+    GlobalRateLimiter* byteRateLimiter;
 
     PhaseConfig(PhaseContext& context,
                 const CollectionScanner* actor,
@@ -104,7 +105,8 @@ struct CollectionScanner::PhaseConfig {
               context["AggregatePipeline"].maybe<DocumentGenerator>(context, actor->id())},
           aggregateOptions{
               context["AggregateOptions"].maybe<mongocxx::options::aggregate>().value_or(
-                  mongocxx::options::aggregate{})} {
+                  mongocxx::options::aggregate{})},
+          byteRateLimiter{context.getByteRateLimiter()} {
         // The list of databases is comma separated.
         std::vector<std::string> dbnames;
         boost::split(dbnames, databaseNames, boost::is_any_of(","));
@@ -238,7 +240,6 @@ void collectionScan(CollectionScanner::PhaseConfig* config,
      */
     size_t docCount = 0;
     size_t scanSize = 0;
-    size_t scanMegabytes = 0;
     bool scanFinished = false;
     auto statTracker = config->scanOperation.start();
     for (auto& collection : collections) {
@@ -271,10 +272,8 @@ void collectionScan(CollectionScanner::PhaseConfig* config,
                     scanFinished = true;
                     break;
                 }
-                if (rateLimiter && scanSize >= (scanMegabytes + 1) * 1e6) {
-                    // Perform an iteration for each megabyte since our rate will be MB/time.
-                    rateLimiter->simpleLimitRate();
-                    ++scanMegabytes;
+                if (rateLimiter) {
+                    rateLimiter->simpleLimitRate(doc.length());
                 }
             }
             if (scanFinished) {
@@ -448,6 +447,8 @@ void CollectionScanner::run() {
 
 
             const SteadyClock::time_point started = SteadyClock::now();
+            // A phase's byte GlobalRate takes precedence over ScanRateMegabytes.
+            auto rateLimiter = config->byteRateLimiter ? config->byteRateLimiter : _rateLimiter;
 
             // Do each kind of scan.
             if (config->scanType == ScanType::kCount) {
@@ -462,7 +463,7 @@ void CollectionScanner::run() {
                     auto finished = true;
                     do {
                         BOOST_LOG_TRIVIAL(debug) << "Scanner id: " << this->_index << " scanning";
-                        collectionScan(config, collections, _rateLimiter, session);
+                        collectionScan(config, collections, rateLimiter, session);
                         // If a scan duration was specified, we must make the scan
                         // last at least that long.
                         // For non-continuous scans (default behaviour) we'll do this within any
@@ -504,7 +505,7 @@ void CollectionScanner::run() {
                 pointInTimeScan(_client, config, readClusterTime);
             } else {
                 const mongocxx::client_session session = _client->start_session({});
-                collectionScan(config, collections, _rateLimiter, session);
+                collectionScan(config, collections, rateLimiter, session);
             }
 
             _runningActorCounter--;
@@ -517,7 +518,7 @@ CollectionScanner::CollectionScanner(genny::ActorContext& context)
     : Actor{context},
       _totalInserts{context.operation("Insert", CollectionScanner::id())},
       _client{context.client()},
-      _index{WorkloadContext::getActorSharedState<CollectionScanner, ActorCounter>().fetch_add(1)},
+      _index{int(context.workload().actorOrdinal(CollectionScanner::id()))},
       _runningActorCounter{
           WorkloadContext::getActorSharedState<CollectionScanner, RunningActorCounter>()},
       _generateCollectionNames{context["GenerateCollectionNames"].maybe<bool>().value_or(false)},
@@ -530,10 +531,19 @@ CollectionScanner::CollectionScanner(genny::ActorContext& context)
             context["GenerateCollectionNames"].maybe<bool>().value_or(false)} {
     _runningActorCounter.store(0);
 
-    const auto scanRateMegabytes = context["ScanRateMegabytes"].maybe<RateSpec>();
-    _rateLimiter = scanRateMegabytes
-        ? context.workload().getRateLimiter("CollectionScanner", *scanRateMegabytes)
-        : nullptr;
+    // ScanRateMegabytes predates byte GlobalRates: a plain "N per T" means N megabytes.
+    _rateLimiter = nullptr;
+    if (const auto scanRate = context["ScanRateMegabytes"].maybe<RateSpec>()) {
+        auto spec = scanRate->getBaseSpec();
+        if (!spec) {
+            BOOST_THROW_EXCEPTION(InvalidConfigurationException(
+                "ScanRateMegabytes must be given as a number of megabytes per unit of time."));
+        }
+        if (!spec->bytes) {
+            spec = BaseRateSpec{spec->per.count(), spec->operations * 1000 * 1000, true};
+        }
+        _rateLimiter = context.workload().getRateLimiter("CollectionScanner", *spec);
+    }
 }
 
 std::vector<std::string> distributeCollectionNames(size_t collectionCount,
@@ -32,6 +32,8 @@
 #include <gennylib/MongoException.hpp>
 #include <gennylib/context.hpp>
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/AliasTable.hpp>
+#include <gennylib/v1/FiberPool.hpp>
 
 using BsonView = bsoncxx::document::view;
 using CrudActor = genny::actor::CrudActor;
@@ -1164,6 +1166,10 @@ struct CrudActor::CollectionName {
 
 struct CrudActor::PhaseConfig {
     std::vector<std::unique_ptr<BaseOperation>> operations;
+    // Parallel to operations; nullptr if the operation has no Rate.
+    std::vector<GlobalRateLimiter*> rateLimiters;
+    // Set if the operations have a Weight, in which case one is chosen per iteration.
+    std::optional<v1::AliasTable> weights;
     metrics::Operation metrics;
     std::string dbName;
     CrudActor::CollectionName collectionName;
@@ -1173,12 +1179,19 @@ struct CrudActor::PhaseConfig {
           metrics{phaseContext.actor().operation("Crud", id)},
           collectionName{phaseContext} {
         auto name = collectionName.generateName(id);
+        std::vector<double> opWeights;
         auto addOperation = [&](const Node& node) -> std::unique_ptr<BaseOperation> {
             auto collection = (*client)[dbName][name];
             auto& yamlCommand = node["OperationCommand"];
             auto opName = node["OperationName"].to<std::string>();
             auto onSession = yamlCommand["OnSession"].maybe<bool>().value_or(false);
 
+            if (auto weight = node["Weight"].maybe<double>()) {
+                opWeights.push_back(*weight);
+            }
+            rateLimiters.push_back(getOperationRateLimiter(
+                phaseContext, node, opName + "." + std::to_string(rateLimiters.size())));
+
             auto opConstructors = getOpConstructors();
             // Grab the appropriate Operation struct defined by 'OperationName'.
             auto op = opConstructors.find(opName);
@@ -1208,20 +1221,75 @@ struct CrudActor::PhaseConfig {
 
         operations = phaseContext.getPlural<std::unique_ptr<BaseOperation>>(
             "Operation", "Operations", addOperation);
+
+        if (!opWeights.empty()) {
+            if (opWeights.size() != operations.size()) {
+                BOOST_THROW_EXCEPTION(InvalidConfigurationException(
+                    "Either all or none of the Operations must have a Weight in Crud Actor."));
+            }
+            try {
+                weights.emplace(opWeights);
+            } catch (const std::invalid_argument& ex) {
+                BOOST_THROW_EXCEPTION(InvalidConfigurationException(
+                    std::string{"Invalid Weight in Crud Actor: "} + ex.what()));
+            }
+        }
+    }
+
+    void runOperation(size_t index, mongocxx::client_session& session) {
+        // Lets other Actors run while this one waits on the server under `genny run --fibers`.
+        v1::runBlocking([&]() { operations[index]->run(session); });
+    }
+
+private:
+    // Like GlobalRate, the limiter is shared by all threads of the Actor.
+    static GlobalRateLimiter* getOperationRateLimiter(PhaseContext& phaseContext,
+                                                      const Node& node,
+                                                      const std::string& suffix) {
+        auto rateSpec = node["Rate"].maybe<RateSpec>();
+        if (!rateSpec) {
+            return nullptr;
+        }
+        if (!rateSpec->getBaseSpec() || rateSpec->getBaseSpec()->bytes) {
+            BOOST_THROW_EXCEPTION(InvalidConfigurationException(
+                "Operation Rate must be given as 'n per duration' in Crud Actor."));
+        }
+        return phaseContext.workload().getRateLimiter(
+            phaseContext.rateLimiterName() + "." + suffix, *rateSpec);
     }
 };
 
 void CrudActor::run() {
     for (auto&& config : _loop) {
         auto session = _client->start_session();
+        // Operation Rates are waited for before the iteration is timed.
+        auto withinRate = [&](size_t index) {
+            auto rateLimiter = config->rateLimiters[index];
+            return !rateLimiter || config.limitRate(*rateLimiter);
+        };
         for (const auto&& _ : config) {
-            auto metricsContext = config->metrics.start();
-
-            for (auto&& op : config->operations) {
-                op->run(session);
+            if (config->weights) {
+                const auto index = config->weights->sample(_rng);
+                if (!withinRate(index)) {
+                    continue;
+                }
+                auto metricsContext = config->metrics.start();
+                config->runOperation(index, session);
+                metricsContext.success();
+            } else {
+                bool ready = true;
+                for (size_t i = 0; ready && i < config->operations.size(); ++i) {
+                    ready = withinRate(i);
+                }
+                if (!ready) {
+                    continue;
+                }
+                auto metricsContext = config->metrics.start();
+                for (size_t i = 0; i < config->operations.size(); ++i) {
+                    config->runOperation(i, session);
+                }
+                metricsContext.success();
             }
-
-            metricsContext.success();
         }
     }
 }
@@ -1230,6 +1298,7 @@ CrudActor::CrudActor(genny::ActorContext& context)
     : Actor(context),
       _client{std::move(
           context.client(context.get("ClientName").maybe<std::string>().value_or("Default")))},
+      _rng{context.workload().getRNGForThread(CrudActor::id())},
       _loop{context, _client, CrudActor::id()} {}
 
 namespace {
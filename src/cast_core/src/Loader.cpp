@@ -46,7 +46,8 @@ struct Loader::PhaseConfig {
           numDocuments{context["DocumentCount"].to<IntegerSpec>()},
           batchSize{context["BatchSize"].to<IntegerSpec>()},
           documentExpr{context["Document"].to<DocumentGenerator>(context, id)},
-          collectionOffset{numCollections * thread} {
+          collectionOffset{numCollections * thread},
+          byteRateLimiter{context.getByteRateLimiter()} {
         auto& indexNodes = context["Indexes"];
         for (auto [k, indexNode] : indexNodes) {
             indexes.emplace_back(indexNode["keys"].to<DocumentGenerator>(context, id),
@@ -65,6 +66,7 @@ struct Loader::PhaseConfig {
     DocumentGenerator documentExpr;
     std::vector<index_type> indexes;
     int64_t collectionOffset;
+    GlobalRateLimiter* byteRateLimiter;
 };
 
 void genny::actor::Loader::run() {
@@ -85,10 +87,15 @@ void genny::actor::Loader::run() {
                             std::min<int64_t>(config->batchSize, remainingInserts);
                         auto docs = std::vector<bsoncxx::document::view_or_value>{};
                         docs.reserve(remainingInserts);
+                        int64_t numBytes = 0;
                         for (uint j = 0; j < numberToInsert; j++) {
                             auto newDoc = config->documentExpr();
+                            numBytes += newDoc.view().length();
                             docs.push_back(std::move(newDoc));
                         }
+                        if (config->byteRateLimiter) {
+                            config->byteRateLimiter->simpleLimitRate(numBytes);
+                        }
                         {
                             auto individualOpCtx = _individualBulkLoad.start();
                             auto result = collection.insert_many(std::move(docs));
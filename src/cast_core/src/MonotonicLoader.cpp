@@ -51,7 +51,8 @@ struct MonotonicLoader::PhaseConfig {
           numDocuments{context["DocumentCount"].to<IntegerSpec>()},
           batchSize{context["BatchSize"].to<IntegerSpec>()},
           documentExpr{context["Document"].to<DocumentGenerator>(context, id)},
-          collectionOffset{numCollections * thread} {
+          collectionOffset{numCollections * thread},
+          byteRateLimiter{context.getByteRateLimiter()} {
         auto& indexNodes = context["Indexes"];
         for (auto [k, indexNode] : indexNodes) {
             indexes.emplace_back(indexNode["keys"].to<DocumentGenerator>(context, id),
@@ -70,6 +71,7 @@ struct MonotonicLoader::PhaseConfig {
     DocumentGenerator documentExpr;
     std::vector<index_type> indexes;
     int64_t collectionOffset;
+    GlobalRateLimiter* byteRateLimiter;
 };
 
 void genny::actor::MonotonicLoader::run() {
@@ -91,6 +93,7 @@ void genny::actor::MonotonicLoader::run() {
                             std::min<int64_t>(config->batchSize, remainingInserts);
                         auto docs = std::vector<bsoncxx::document::view_or_value>{};
                         docs.reserve(remainingInserts);
+                        int64_t numBytes = 0;
                         for (uint j = 0; j < numberToInsert; j++) {
                             auto tmpDoc = config->documentExpr();
                             auto builder = bsoncxx::builder::stream::document();
@@ -98,8 +101,12 @@ void genny::actor::MonotonicLoader::run() {
                             builder << bsoncxx::builder::concatenate(tmpDoc.view());
                             bsoncxx::document::value newDoc = builder
                                 << bsoncxx::builder::stream::finalize;
+                            numBytes += newDoc.view().length();
                             docs.push_back(std::move(newDoc));
                         }
+                        if (config->byteRateLimiter) {
+                            config->byteRateLimiter->simpleLimitRate(numBytes);
+                        }
                         {
                             auto individualOpCtx = _individualBulkLoad.start();
                             auto result = collection.insert_many(std::move(docs));
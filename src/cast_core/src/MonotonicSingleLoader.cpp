@@ -39,6 +39,7 @@ struct MonotonicSingleLoader::PhaseConfig {
     int64_t batchSize;
     int64_t numDocuments;
     DocumentGenerator documentExpr;
+    GlobalRateLimiter* byteRateLimiter;
 };
 
 MonotonicSingleLoader::PhaseConfig::PhaseConfig(PhaseContext& phaseContext,
@@ -51,7 +52,8 @@ MonotonicSingleLoader::PhaseConfig::PhaseConfig(PhaseContext& phaseContext,
           db.collection(phaseContext["Collection"].maybe<std::string>().value_or("Collection0"))},
       batchSize{phaseContext["BatchSize"].to<IntegerSpec>()},
       numDocuments{phaseContext["DocumentCount"].to<IntegerSpec>()},
-      documentExpr{phaseContext["Document"].to<DocumentGenerator>(phaseContext, id)} {}
+      documentExpr{phaseContext["Document"].to<DocumentGenerator>(phaseContext, id)},
+      byteRateLimiter{phaseContext.getByteRateLimiter()} {}
 
 void MonotonicSingleLoader::run() {
     for (auto&& config : _loop) {
@@ -76,6 +78,10 @@ void MonotonicSingleLoader::run() {
                     docs.push_back(std::move(doc));
                 }
 
+                if (config->byteRateLimiter) {
+                    config->byteRateLimiter->simpleLimitRate(numBytes);
+                }
+
                 {
                     auto individualOpCtx = _individualBulkLoad.start();
 
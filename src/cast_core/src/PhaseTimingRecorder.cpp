@@ -14,6 +14,7 @@
 
 #include <cast_core/actors/PhaseTimingRecorder.hpp>
 
+#include <chrono>
 #include <memory>
 
 #include <yaml-cpp/yaml.h>
@@ -40,17 +41,30 @@ void PhaseTimingRecorder::run() {
     // We don't use PhaseLoop because we want this actor to be usable
     // in any workload regardless of number of phases defined.
     while (_orchestrator.morePhases()) {
-        _orchestrator.awaitPhaseStart();
+        const auto phase = _orchestrator.awaitPhaseStart();
         auto phaseCtx = _phaseOp.start();
+        reportSkew(_startSkewOp, _orchestrator.lastPhaseStartSkew());
 
-        _orchestrator.awaitPhaseEnd();
+        // Don't block in awaitPhaseEnd() so our own (immediate) arrival doesn't count
+        // toward the phase's end skew; wait for the other Actors instead.
+        _orchestrator.awaitPhaseEnd(false);
+        while (_orchestrator.currentPhase() == phase && _orchestrator.continueRunning()) {
+            _orchestrator.sleepToPhaseEnd(std::chrono::seconds{1}, phase);
+        }
         phaseCtx.success();
+        reportSkew(_endSkewOp, _orchestrator.lastPhaseEndSkew());
     }
 }
 
+void PhaseTimingRecorder::reportSkew(genny::metrics::Operation& op, Duration skew) {
+    op.report(metrics::clock::now(), std::chrono::duration_cast<std::chrono::microseconds>(skew));
+}
+
 PhaseTimingRecorder::PhaseTimingRecorder(genny::ActorContext& context)
     : Actor{context},
       _phaseOp{context.operation("Phase", PhaseTimingRecorder::id(), true)},
+      _startSkewOp{context.operation("PhaseStartSkew", PhaseTimingRecorder::id(), true)},
+      _endSkewOp{context.operation("PhaseEndSkew", PhaseTimingRecorder::id(), true)},
       _orchestrator{context.orchestrator()} {}
 
 namespace {
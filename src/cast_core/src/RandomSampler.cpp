@@ -88,7 +88,7 @@ void RandomSampler::run() {
 RandomSampler::RandomSampler(genny::ActorContext& context)
     : Actor{context},
       _client{context.client()},
-      _index{WorkloadContext::getActorSharedState<RandomSampler, ActorCounter>().fetch_add(1)},
+      _index{int(context.workload().actorOrdinal(RandomSampler::id()))},
       _activeCollectionScannerInstances{
           WorkloadContext::getActorSharedState<CollectionScanner,
                                                CollectionScanner::RunningActorCounter>()},
@@ -0,0 +1,188 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cast_core/actors/Replay.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/log/trivial.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <bsoncxx/document/view.hpp>
+
+#include <mongocxx/client.hpp>
+#include <mongocxx/exception/operation_exception.hpp>
+
+#include <gennylib/Cast.hpp>
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/MongoException.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/OperationRecorder.hpp>
+
+namespace genny::actor {
+namespace {
+
+// The longest a replay waits for its next command before checking whether its phase
+// has ended.
+constexpr auto kMaxWait = std::chrono::milliseconds{100};
+
+bsoncxx::document::view bsonOf(const v1::LoggedOperation& operation) {
+    return {reinterpret_cast<const uint8_t*>(operation.command.data()),
+            operation.command.size()};
+}
+
+std::string commandName(bsoncxx::document::view command) {
+    if (command.empty()) {
+        return "";
+    }
+    const auto key = command.begin()->key();
+    return {key.data(), key.size()};
+}
+
+}  // namespace
+
+/** @private */
+struct Replay::PhaseConfig {
+    explicit PhaseConfig(PhaseContext& context)
+        : throwOnFailure{context["ThrowOnFailure"].maybe<bool>().value_or(false)} {
+        const auto pace = context["Pace"].maybe<std::string>().value_or("Original");
+        const auto configuredSpeedup = context["Speedup"].maybe<double>();
+        if (pace == "Original") {
+            speedup = configuredSpeedup.value_or(1.0);
+            if (speedup <= 0) {
+                throw InvalidConfigurationException("Replay Speedup must be positive.");
+            }
+        } else if (pace == "AsFastAsPossible") {
+            if (configuredSpeedup) {
+                throw InvalidConfigurationException(
+                    "Replay Speedup only applies to Pace: Original.");
+            }
+        } else {
+            throw InvalidConfigurationException("Replay has unknown Pace '" + pace +
+                                                "'. Use Original or AsFastAsPossible.");
+        }
+    }
+
+    // 0 to replay as fast as possible.
+    double speedup = 0;
+    bool throwOnFailure;
+};
+
+void Replay::run() {
+    for (auto&& config : _loop) {
+        for (const auto&& _ : config) {
+            this->_replay(config.phaseNumber(), config->speedup, config->throwOnFailure);
+        }
+    }
+}
+
+void Replay::_replay(PhaseNumber phase, double speedup, bool throwOnFailure) {
+    const auto phaseGoing = [&]() {
+        return _orchestrator.currentPhase() == phase && !_orchestrator.phaseEndRequested(phase);
+    };
+
+    _log.rewind();
+    const auto started = std::chrono::steady_clock::now();
+    v1::LoggedOperation operation;
+    while (_log.next(operation) && phaseGoing()) {
+        if (speedup > 0) {
+            const auto due = started +
+                std::chrono::duration_cast<std::chrono::nanoseconds>(operation.offset / speedup);
+            for (auto now = std::chrono::steady_clock::now(); now < due && phaseGoing();
+                 now = std::chrono::steady_clock::now()) {
+                v1::sleepFor(std::min<Duration>(due - now, kMaxWait));
+            }
+            if (!phaseGoing()) {
+                break;
+            }
+        }
+
+        const auto command = bsonOf(operation);
+        auto ctx = _operations.at(commandName(command)).start();
+        try {
+            this->_database(operation.database).run_command(command);
+            ctx.success();
+        } catch (mongocxx::operation_exception& e) {
+            ctx.failure();
+            if (throwOnFailure) {
+                BOOST_THROW_EXCEPTION(MongoException(e, command));
+            }
+        }
+    }
+}
+
+mongocxx::database& Replay::_database(std::string_view name) {
+    auto it = std::find_if(_databases.begin(), _databases.end(), [&](const auto& database) {
+        return database.first == name;
+    });
+    if (it == _databases.end()) {
+        const std::string database{name};
+        it = _databases.emplace(_databases.end(), database, (*_client)[database]);
+    }
+    return it->second;
+}
+
+Replay::Replay(ActorContext& context, v1::OperationLogReader log)
+    : Actor(context),
+      _orchestrator{context.orchestrator()},
+      _client{context.client()},
+      _log{std::move(log)},
+      _loop{context} {
+    // Reading the log through once finds a corrupt one before the workload starts.
+    size_t commands = 0;
+    v1::LoggedOperation operation;
+    while (_log.next(operation)) {
+        const auto name = commandName(bsonOf(operation));
+        if (_operations.find(name) == _operations.end()) {
+            _operations.emplace(name, context.operation(name, Replay::id()));
+        }
+        ++commands;
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Replaying " << commands << " commands recorded from "
+                             << _log.actorName() << " " << _log.actorId();
+}
+
+namespace {
+
+class ReplayProducer : public ActorProducer {
+public:
+    using ActorProducer::ActorProducer;
+
+    ActorVector produce(ActorContext& context) override {
+        const auto recording = context["Recording"].to<std::string>();
+        const auto logs = v1::OperationRecorder::logs(recording);
+        if (logs.empty()) {
+            throw InvalidConfigurationException("Replay Recording '" + recording +
+                                                "' has no operation logs.");
+        }
+        const auto threads = context["Threads"].maybe<int>();
+        if (threads && size_t(*threads) != logs.size()) {
+            throw InvalidConfigurationException(
+                "Replay Threads must match the " + std::to_string(logs.size()) +
+                " threads recorded in '" + recording + "', or be left out.");
+        }
+
+        ActorVector out;
+        for (const auto& log : logs) {
+            out.emplace_back(std::make_unique<Replay>(context, v1::OperationLogReader{log}));
+        }
+        return out;
+    }
+};
+
+auto registerReplay = Cast::registerCustom(std::make_shared<ReplayProducer>("Replay"));
+
+}  // namespace
+}  // namespace genny::actor
@@ -0,0 +1,117 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_351E5CA2_B4AD_42BE_AEA5_06DD72AAC3FC_INCLUDED
+#define HEADER_351E5CA2_B4AD_42BE_AEA5_06DD72AAC3FC_INCLUDED
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gennylib/Actor.hpp>
+#include <gennylib/Orchestrator.hpp>
+#include <gennylib/context.hpp>
+#include <gennylib/v1/ActorStatus.hpp>
+
+#include <metrics/metrics.hpp>
+
+namespace genny::driver {
+
+/**
+ * Takes commands on a local Unix socket while a workload runs, for `genny run
+ * --control-socket`, so a long run can be steered without killing it.
+ *
+ * Commands are lines of text. Each is answered with any output followed by a line of
+ * `ok` or `error: <why>`:
+ *
+ * - `rate <name> <n> per <duration>` changes the GlobalRate of that name, e.g.
+ *   `rate InsertRate 500 per 1 second`. Only rates given as operations or bytes per
+ *   duration can be changed. With `--processes` the rate is shared, so any worker's
+ *   socket changes it for the whole group.
+ * - `end-phase` ends the running phase; see Orchestrator::endPhase().
+ * - `status` prints a line for each Actor: its id, name, phase, iterations in that
+ *   phase, and the operation it last started.
+ * - `flush` sends the ftdc metrics buffered so far to the collector.
+ *
+ * Every command is reported to the Genny-internal `[workload].Control` operation,
+ * as a failure if it was rejected, and logged.
+ *
+ * Try it with `socat - UNIX-CONNECT:<path>` or `nc -U <path>`.
+ */
+class ControlServer {
+public:
+    /**
+     * Listen on `path`, replacing any socket left there by an earlier run, and keep
+     * the status of each of `actors`. Call during setup.
+     *
+     * @throws InvalidConfigurationException if the path is too long for a socket.
+     * @throws std::system_error if it can't be listened on.
+     */
+    ControlServer(std::string path,
+                  WorkloadContext& context,
+                  Orchestrator& orchestrator,
+                  metrics::Registry& metrics,
+                  const std::string& workloadName,
+                  const std::vector<Actor*>& actors);
+
+    /**
+     * Stop listening and remove the socket.
+     */
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    /**
+     * @return where the Actor with this id publishes what it's doing.
+     */
+    v1::ActorStatus& status(ActorId id) {
+        return *_statuses.at(id);
+    }
+
+    /**
+     * Run one command as if it had been received on the socket.
+     *
+     * @return the reply, ending in `ok` or `error: <why>`.
+     */
+    std::string execute(const std::string& command);
+
+private:
+    void serve();
+    void serveClient(int fd);
+
+    const std::string _path;
+    WorkloadContext& _context;
+    Orchestrator& _orchestrator;
+    metrics::Registry& _metrics;
+
+    // Sorted so status lists Actors in order.
+    std::map<ActorId, std::unique_ptr<v1::ActorStatus>> _statuses;
+
+    // Commands only ever report to this from one thread at a time.
+    std::mutex _executing;
+    metrics::Operation _reported;
+
+    int _listening = -1;
+    std::atomic_bool _stopping = false;
+    std::thread _thread;
+};
+
+}  // namespace genny::driver
+
+#endif  // HEADER_351E5CA2_B4AD_42BE_AEA5_06DD72AAC3FC_INCLUDED
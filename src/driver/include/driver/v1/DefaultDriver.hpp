@@ -23,18 +23,24 @@
 
 #include <gennylib/ActorProducer.hpp>
 #include <gennylib/ActorVector.hpp>
+#include <gennylib/v1/FiberPool.hpp>
 #include <metrics/metrics.hpp>
 
+#include <driver/v1/MockServer.hpp>
+
 namespace genny::driver {
 
 /**
- * Basic workload driver that spins up one thread per actor.
+ * Basic workload driver that spins up one thread per actor, or with `--fibers`
+ * runs every actor as a fiber on a v1::FiberPool.
  */
 class DefaultDriver {
 public:
     enum class RunMode {
         kNormal,
         kDryRun,
+        kEstimate,
+        kCompile,
         kListActors,
         kHelp,
     };
@@ -66,6 +72,37 @@ public:
         std::string description;
         DefaultDriver::RunMode runMode = RunMode::kNormal;
         boost::log::trivial::severity_level logVerbosity;
+
+        // Number of v1::FiberPool workers to run actors on. 0 runs each on its own thread.
+        size_t fiberWorkers = 0;
+        size_t fiberStackSize = v1::FiberPool::kDefaultStackSize;
+
+        // Where to write a v1::Tracer trace of the run. Empty disables tracing.
+        std::string traceFile;
+
+        // Where to listen for ControlServer commands. Empty disables it.
+        std::string controlSocket;
+
+        // Where to write a v1::Profiler profile of the run. Empty disables profiling.
+        std::string profileFile;
+
+        // Where to write a v1::OperationRecorder log of each actor's commands. Empty
+        // disables recording.
+        std::string recordDirectory;
+
+        // Whether to run against an in-process MockServer instead of mongoUri.
+        bool mockServer = false;
+        MockServer::Options mockServerOptions;
+
+        // Number of threads constructing actors.
+        size_t setupThreads = 1;
+
+        // Number of worker processes to split the actors between. See v1::ProcessGroup.
+        size_t processes = 1;
+
+        // Where `compile` writes the v1::WorkloadPlan. Empty uses the workload file's path
+        // with a .plan extension.
+        std::string planFile;
     };
 
     /**
@@ -0,0 +1,93 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_2F6B8D14_7E3A_4C59_B1D0_94A7E5C3F812_INCLUDED
+#define HEADER_2F6B8D14_7E3A_4C59_B1D0_94A7E5C3F812_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <gennylib/Node.hpp>
+#include <gennylib/context.hpp>
+
+namespace genny::driver {
+
+/**
+ * What `genny estimate` predicts for one phase of one Actor.
+ */
+struct PhaseEstimate {
+    std::string actor;
+    PhaseNumber phase;
+    int threads;
+
+    /** The document templates found in the phase and benchmarked. */
+    size_t templates = 0;
+    /** Documents one thread can generate per second, cycling through the templates. */
+    double documentsPerSecond = 0;
+    double bytesPerSecond = 0;
+    /** Iterations one thread can run per second if each generates every template once. */
+    double iterationsPerSecond = 0;
+
+    /** The phase's fixed `GlobalRate` per second, if it has one. */
+    std::optional<double> globalRate;
+    bool globalRateInBytes = false;
+};
+
+/**
+ * What `genny estimate` predicts for a whole workload.
+ */
+struct WorkloadEstimate {
+    std::vector<PhaseEstimate> phases;
+
+    size_t actorThreads = 0;
+    /** Clients the Actors took while being constructed. */
+    size_t clients = 0;
+    /** Metrics operations, counting each thread's separately. */
+    size_t metricsOperations = 0;
+    /** What those operations reserve for their events up front. */
+    size_t metricsBytes = 0;
+
+    std::vector<std::string> warnings;
+};
+
+/**
+ * Benchmark the documents each Actor's phases generate, without a server, to catch
+ * workloads that can't run as configured before any cluster time is spent on them.
+ *
+ * Actors don't expose their DocumentGenerators, so templates are found in the phase
+ * config instead. Genny's own keys are capitalized and document fields usually aren't:
+ * a map whose keys all start with a capital letter is config and is searched, and any
+ * other map is a document template. Those that don't build a DocumentGenerator are
+ * skipped.
+ *
+ * @param context a constructed workload.
+ * @param cpus the CPUs the Actors will have. Each phase is assumed to have them all.
+ * @param budget how long to generate each template for.
+ */
+WorkloadEstimate estimateWorkload(WorkloadContext& context,
+                                  unsigned cpus,
+                                  std::chrono::nanoseconds budget = std::chrono::milliseconds{20});
+
+/**
+ * Print an estimate as a table followed by its warnings.
+ */
+std::ostream& operator<<(std::ostream& out, const WorkloadEstimate& estimate);
+
+}  // namespace genny::driver
+
+#endif  // HEADER_2F6B8D14_7E3A_4C59_B1D0_94A7E5C3F812_INCLUDED
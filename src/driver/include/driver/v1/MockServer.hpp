@@ -0,0 +1,124 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_8592914E_0343_4BFF_9611_634C52A5DEE4_INCLUDED
+#define HEADER_8592914E_0343_4BFF_9611_634C52A5DEE4_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <bsoncxx/document/value.hpp>
+#include <bsoncxx/document/view.hpp>
+
+namespace genny::driver {
+
+/**
+ * A stand-in for a standalone mongod on the loopback interface, for `genny run
+ * --mock-server`, so genny's own throughput can be measured without a server or the
+ * variance one adds.
+ *
+ * It speaks enough of the wire protocol for the driver: OP_MSG, and the OP_QUERY
+ * handshake older drivers start with. Replies are canned rather than computed:
+ *
+ * - `hello` and `isMaster` describe a standalone server.
+ * - `insert`, `update` and `delete` report every write as applied.
+ * - `find` and `aggregate` return `results` copies of a document of about
+ *   `documentSize` bytes, in batches of the request's `batchSize`. `getMore` returns
+ *   the rest. The cursor id is what's left to return, so no cursors are kept.
+ * - Anything else, including `ping`, just succeeds.
+ *
+ * Each reply is sent `latency` after the request is read. Each connection is served
+ * by its own thread, which competes with the Actors for CPU.
+ */
+class MockServer {
+public:
+    struct Options {
+        /** how long to wait before replying */
+        std::chrono::microseconds latency{0};
+        /** documents each query returns */
+        size_t results = 1;
+        /** the approximate BSON size of each */
+        size_t documentSize = 128;
+    };
+
+    /**
+     * Listen on an unused port on 127.0.0.1.
+     *
+     * @throws std::system_error if it can't.
+     */
+    explicit MockServer(Options options);
+
+    /**
+     * Stop listening and close every connection.
+     */
+    ~MockServer();
+
+    MockServer(const MockServer&) = delete;
+    MockServer& operator=(const MockServer&) = delete;
+
+    /**
+     * @return a connection string for this server.
+     */
+    std::string uri() const;
+
+    /**
+     * @return how many commands have been answered.
+     */
+    size_t commands() const {
+        return _commands.load();
+    }
+
+    /**
+     * Answer one command as if it had been received over a connection.
+     *
+     * @param database the `$db` it was sent to.
+     * @param documents how many documents were sent alongside it in an OP_MSG document
+     * sequence, such as an `insert`'s `documents`.
+     */
+    bsoncxx::document::value reply(bsoncxx::document::view command,
+                                   std::string_view database,
+                                   size_t documents = 0) const;
+
+private:
+    void serve();
+    void serveConnection(int fd);
+    // The reply to a whole message, empty if none is expected, or nullopt if it can't
+    // be answered.
+    std::optional<std::string> answer(std::string_view message);
+
+    const Options _options;
+    // `{_id: 0, padding: <string>}` of about documentSize bytes.
+    const bsoncxx::document::value _document;
+
+    std::atomic<size_t> _commands = 0;
+
+    int _listening = -1;
+    uint16_t _port = 0;
+    std::atomic_bool _stopping = false;
+    std::thread _thread;
+    std::mutex _lock;
+    std::list<std::thread> _connectionThreads;
+};
+
+}  // namespace genny::driver
+
+#endif  // HEADER_8592914E_0343_4BFF_9611_634C52A5DEE4_INCLUDED
@@ -0,0 +1,246 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/v1/ControlServer.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <yaml-cpp/yaml.h>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+
+namespace genny::driver {
+namespace {
+
+// How long the server waits for a connection or a command before checking whether
+// it's being stopped.
+constexpr int kPollMillis = 100;
+
+// Longer commands are a client that isn't speaking the protocol.
+constexpr size_t kMaxCommand = 4096;
+
+std::system_error socketError(const std::string& what, const std::string& path) {
+    return std::system_error(errno, std::generic_category(), what + " control socket " + path);
+}
+
+bool readable(int fd) {
+    pollfd polled{fd, POLLIN, 0};
+    return ::poll(&polled, 1, kPollMillis) > 0;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const auto n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+std::string trim(const std::string& str) {
+    const auto begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return str.substr(begin, str.find_last_not_of(" \t\r") - begin + 1);
+}
+
+}  // namespace
+
+
+ControlServer::ControlServer(std::string path,
+                             WorkloadContext& context,
+                             Orchestrator& orchestrator,
+                             metrics::Registry& metrics,
+                             const std::string& workloadName,
+                             const std::vector<Actor*>& actors)
+    : _path{std::move(path)},
+      _context{context},
+      _orchestrator{orchestrator},
+      _metrics{metrics},
+      _reported{metrics.operation(workloadName, "Control", 0u, std::nullopt, true)} {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (_path.empty() || _path.size() >= sizeof(address.sun_path)) {
+        throw InvalidConfigurationException("Control socket path must be 1 to " +
+                                            std::to_string(sizeof(address.sun_path) - 1) +
+                                            " characters: '" + _path + "'");
+    }
+    std::strncpy(address.sun_path, _path.c_str(), sizeof(address.sun_path) - 1);
+
+    for (const auto* actor : actors) {
+        _statuses.emplace(actor->id(), std::make_unique<v1::ActorStatus>());
+    }
+    v1::ActorStatus::enable();
+
+    // Only a socket can be left over from an earlier run; don't remove anything else.
+    struct stat existing;
+    if (::lstat(_path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(_path.c_str());
+    }
+
+    _listening = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_listening < 0) {
+        throw socketError("creating", _path);
+    }
+    if (::bind(_listening, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(_listening, 4) < 0) {
+        const auto error = socketError("listening on", _path);
+        ::close(_listening);
+        throw error;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Listening for control commands on " << _path;
+
+    _thread = std::thread{[this]() { this->serve(); }};
+}
+
+ControlServer::~ControlServer() {
+    _stopping = true;
+    _thread.join();
+    ::close(_listening);
+    ::unlink(_path.c_str());
+}
+
+std::string ControlServer::execute(const std::string& line) {
+    const auto command = trim(line);
+    std::istringstream words{command};
+    std::string verb;
+    words >> verb;
+
+    std::ostringstream out;
+    std::string error;
+    try {
+        if (verb == "rate") {
+            std::string name;
+            words >> name;
+            const auto spec = trim(command.substr(std::min(command.size(), size_t(words.tellg()))));
+            auto* limiter = _context.findRateLimiter(name);
+            if (name.empty() || spec.empty()) {
+                error = "usage: rate <name> <n> per <duration>";
+            } else if (!limiter) {
+                error = "no GlobalRate named " + name;
+            } else {
+                limiter->setRate(YAML::Node{spec}.as<BaseRateSpec>());
+            }
+        } else if (verb == "end-phase") {
+            if (const auto phase = _orchestrator.endPhase()) {
+                out << "ending phase " << *phase << "\n";
+            } else {
+                error = "no phase is running";
+            }
+        } else if (verb == "status") {
+            for (const auto& [id, status] : _statuses) {
+                out << id << " " << _context.actorName(id) << " phase ";
+                if (status->phase() == v1::ActorStatus::kNoPhase) {
+                    out << "-";
+                } else {
+                    out << status->phase();
+                }
+                const auto* operation = status->operation();
+                out << " iterations " << status->iterations() << " operation "
+                    << (operation ? *operation : "-") << "\n";
+            }
+        } else if (verb == "flush") {
+            if (!_metrics.flush()) {
+                error = "only ftdc metrics can be flushed; csv metrics are written at exit";
+            }
+        } else if (verb == "help" || verb.empty()) {
+            out << "rate <name> <n> per <duration>\nend-phase\nstatus\nflush\n";
+        } else {
+            error = "unknown command '" + verb + "'; try help";
+        }
+    } catch (const std::exception& ex) {
+        error = ex.what();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{_executing};
+        auto reported = _reported.start();
+        if (error.empty()) {
+            reported.success();
+        } else {
+            reported.failure();
+        }
+    }
+    if (error.empty()) {
+        BOOST_LOG_TRIVIAL(info) << "Control command '" << command << "' done";
+        out << "ok\n";
+    } else {
+        BOOST_LOG_TRIVIAL(warning) << "Control command '" << command << "' failed: " << error;
+        out << "error: " << error << "\n";
+    }
+    return out.str();
+}
+
+void ControlServer::serve() {
+    while (!_stopping) {
+        if (!readable(_listening)) {
+            continue;
+        }
+        const auto client = ::accept4(_listening, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        this->serveClient(client);
+        ::close(client);
+    }
+}
+
+void ControlServer::serveClient(int fd) {
+    std::string pending;
+    char buffer[512];
+    while (!_stopping) {
+        if (!readable(fd)) {
+            continue;
+        }
+        const auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        pending.append(buffer, n);
+        for (auto end = pending.find('\n'); end != std::string::npos; end = pending.find('\n')) {
+            const auto reply = this->execute(pending.substr(0, end));
+            pending.erase(0, end + 1);
+            if (!sendAll(fd, reply)) {
+                return;
+            }
+        }
+        if (pending.size() > kMaxCommand) {
+            sendAll(fd, "error: command too long\n");
+            return;
+        }
+    }
+}
+
+}  // namespace genny::driver
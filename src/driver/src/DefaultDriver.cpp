@@ -13,10 +13,14 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <fstream>
+#include <optional>
 #include <sstream>
 #include <thread>
+#include <typeinfo>
 #include <vector>
 
+#include <boost/core/demangle.hpp>
 #include <boost/exception/diagnostic_information.hpp>
 #include <boost/exception/exception.hpp>
 #include <boost/filesystem.hpp>
@@ -31,11 +35,20 @@
 
 #include <gennylib/Cast.hpp>
 #include <gennylib/context.hpp>
+#include <gennylib/v1/Affinity.hpp>
+#include <gennylib/v1/CommandMonitor.hpp>
+#include <gennylib/v1/ProcessGroup.hpp>
+#include <gennylib/v1/OperationRecorder.hpp>
+#include <gennylib/v1/Profiler.hpp>
+#include <gennylib/v1/Tracer.hpp>
+#include <gennylib/v1/WorkloadPlan.hpp>
 
 #include <metrics/MetricsReporter.hpp>
 #include <metrics/metrics.hpp>
 
+#include <driver/v1/ControlServer.hpp>
 #include <driver/v1/DefaultDriver.hpp>
+#include <driver/v1/Estimator.hpp>
 
 namespace genny::driver {
 namespace {
@@ -74,6 +87,13 @@ void runActor(Actor&& actor,
     }
 }
 
+void restrictThread(const v1::CpuSet& cpus) {
+    static std::atomic_bool warned = false;
+    if (!cpus.empty() && !v1::setThreadAffinity(cpus) && !warned.exchange(true)) {
+        BOOST_LOG_TRIVIAL(warning) << "Couldn't set the CPU affinity of a thread";
+    }
+}
+
 void reportMetrics(genny::metrics::Registry& metrics,
                    const std::string& actorName,
                    const std::string& operationName,
@@ -107,6 +127,19 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
         return DefaultDriver::OutcomeCode::kUserException;
     }
 
+    if (options.runMode == DefaultDriver::RunMode::kCompile) {
+        if (options.workloadSourceType != DefaultDriver::ProgramOptions::YamlSource::kFile) {
+            std::cerr << "Can only compile a workload file" << std::endl;
+            return DefaultDriver::OutcomeCode::kUserException;
+        }
+        const auto planFile = options.planFile.empty()
+            ? fs::path(options.workloadSource).replace_extension(".plan").string()
+            : options.planFile;
+        v1::WorkloadPlan::compile(options.workloadSource, planFile);
+        std::cout << "Compiled " << options.workloadSource << " to " << planFile << std::endl;
+        return DefaultDriver::OutcomeCode::kSuccess;
+    }
+
     fs::path phaseConfigSource;
     if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kString) {
         phaseConfigSource = fs::current_path();
@@ -124,27 +157,68 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
     }
 
     YAML::Node yaml;
-    if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kFile) {
+    std::string yamlPath = "inline-yaml";
+    if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kFile &&
+        v1::WorkloadPlan::isPlan(options.workloadSource)) {
+        auto plan = v1::WorkloadPlan::load(options.workloadSource);
+        yaml = plan.yaml();
+        yamlPath = plan.sourcePath();
+    } else if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kFile) {
         yaml = loadFile(options.workloadSource);
+        yamlPath = options.workloadSource;
     } else if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kString) {
         yaml = YAML::Load(options.workloadSource);
     } else {
         throw std::invalid_argument("Unrecognized workload source type.");
     }
 
-    auto orchestrator = Orchestrator{};
+    std::optional<v1::ProcessGroup> processGroup;
+    if (options.processes > 1 && options.runMode == DefaultDriver::RunMode::kNormal) {
+        if (options.fiberWorkers > 0) {
+            std::cerr << "Can't run actors as fibers with more than one process" << std::endl;
+            return DefaultDriver::OutcomeCode::kUserException;
+        }
+        processGroup.emplace(options.processes);
+        if (!processGroup->fork()) {
+            return DefaultDriver::OutcomeCode(processGroup->supervise());
+        }
+    }
+
+    auto orchestrator = processGroup ? Orchestrator{*processGroup} : Orchestrator{};
+
+    NodeSource nodeSource{std::move(yaml), std::move(yamlPath)};
 
-    NodeSource nodeSource{YAML::Dump(yaml),
-                          options.workloadSourceType ==
-                                  DefaultDriver::ProgramOptions::YamlSource::kFile
-                              ? options.workloadSource
-                              : "inline-yaml"};
 
+    // Each worker process serves its own actors.
+    std::optional<MockServer> mockServer;
+    auto mongoUri = options.mongoUri;
+    if (options.mockServer && options.runMode == DefaultDriver::RunMode::kNormal) {
+        mockServer.emplace(options.mockServerOptions);
+        mongoUri = mockServer->uri();
+        BOOST_LOG_TRIVIAL(info) << "Running against a mock server at " << mongoUri;
+    }
+
+    std::optional<v1::OperationRecorder> recorder;
+    if (!options.recordDirectory.empty() && options.runMode == DefaultDriver::RunMode::kNormal) {
+        recorder.emplace(options.recordDirectory);
+    }
 
-    auto workloadContext =
-        WorkloadContext{nodeSource.root(), orchestrator, options.mongoUri, globalCast()};
+    const auto constructionStart = genny::metrics::Registry::clock::now();
+    auto workloadContext = WorkloadContext{nodeSource.root(),
+                                           orchestrator,
+                                           mongoUri,
+                                           globalCast(),
+                                           recorder ? recorder->callback()
+                                                    : v1::PoolManager::OnCommandStartCallback{},
+                                           options.setupThreads};
 
     genny::metrics::Registry& metrics = workloadContext.getMetrics();
+    reportMetrics(metrics, workloadName, "ActorConstruction", true, constructionStart);
+    BOOST_LOG_TRIVIAL(info) << "Constructed actors in "
+                            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   genny::metrics::Registry::clock::now() - constructionStart)
+                                   .count()
+                            << "ms on " << options.setupThreads << " threads";
 
     if (options.runMode == DefaultDriver::RunMode::kDryRun) {
         std::cout << "Workload context constructed without errors." << std::endl;
@@ -152,8 +226,25 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
         return DefaultDriver::OutcomeCode::kSuccess;
     }
 
-    orchestrator.addRequiredTokens(
-        int(std::distance(workloadContext.actors().begin(), workloadContext.actors().end())));
+    if (options.runMode == DefaultDriver::RunMode::kEstimate) {
+        const auto& cpus = workloadContext.unreservedCpus();
+        std::cout << estimateWorkload(workloadContext,
+                                      cpus.empty() ? std::thread::hardware_concurrency()
+                                                   : unsigned(cpus.size()));
+        reportMetrics(metrics, workloadName, "Setup", true, startTime);
+        return DefaultDriver::OutcomeCode::kSuccess;
+    }
+
+    // Each worker process only constructed its share of the actors.
+    std::vector<Actor*> actors;
+    for (const auto& actor : workloadContext.actors()) {
+        actors.push_back(actor.get());
+    }
+    orchestrator.addRequiredTokens(int(actors.size()));
+    if (processGroup && !processGroup->awaitWorkers()) {
+        BOOST_LOG_TRIVIAL(error) << "Another worker process failed to set up";
+        return DefaultDriver::OutcomeCode::kInternalException;
+    }
 
     reportMetrics(metrics, workloadName, "Setup", true, startTime);
 
@@ -162,35 +253,143 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
 
     std::atomic<DefaultDriver::OutcomeCode> outcomeCode = DefaultDriver::OutcomeCode::kSuccess;
 
+    std::optional<ControlServer> control;
+    if (!options.controlSocket.empty()) {
+        // Each worker process is controlled separately.
+        auto path = options.controlSocket;
+        if (processGroup) {
+            path += "-worker-" + std::to_string(*processGroup->rank());
+        }
+        control.emplace(
+            std::move(path), workloadContext, orchestrator, metrics, workloadName, actors);
+    }
+
+    // Each worker process traces and samples itself.
+    auto traceFile = options.traceFile;
+    if (!traceFile.empty()) {
+        if (processGroup) {
+            traceFile += "-worker-" + std::to_string(*processGroup->rank());
+        }
+        v1::Tracer::enable();
+    }
+    auto profileFile = options.profileFile;
+    if (!profileFile.empty()) {
+        if (processGroup) {
+            profileFile += "-worker-" + std::to_string(*processGroup->rank());
+        }
+        v1::Profiler::enable();
+    }
+    if (recorder) {
+        recorder->start();
+    }
+
     std::mutex reporting;
-    std::vector<std::thread> threads;
-    std::transform(cbegin(workloadContext.actors()),
-                   cend(workloadContext.actors()),
-                   std::back_inserter(threads),
-                   [&](const auto& actor) {
-                       return std::thread{[&]() {
-                           {
-                               auto ctx = startedActors.start();
-                               ctx.addDocuments(1);
-
-                               std::lock_guard<std::mutex> lk{reporting};
-                               ctx.success();
-                           }
-
-                           runActor(actor, outcomeCode, orchestrator);
-
-                           {
-                               auto ctx = finishedActors.start();
-                               ctx.addDocuments(1);
-
-                               std::lock_guard<std::mutex> lk{reporting};
-                               ctx.success();
-                           }
-                       }};
-                   });
-
-    for (auto& thread : threads)
-        thread.join();
+    auto runOne = [&](const auto& actor) {
+        v1::CommandMonitor::setActor(workloadContext.actorName(actor->id()), actor->id());
+        if (control) {
+            v1::ActorStatus::setCurrent(&control->status(actor->id()));
+        }
+        if (v1::Profiler::enabled()) {
+            v1::Profiler::setActor(&workloadContext.actorName(actor->id()));
+        }
+        if (recorder) {
+            recorder->attach(workloadContext.actorName(actor->id()), actor->id());
+        }
+        if (v1::Tracer::enabled()) {
+            const auto& type = *actor;
+            v1::Tracer::setTrack(boost::core::demangle(typeid(type).name()) + " " +
+                                 std::to_string(actor->id()));
+        }
+        {
+            auto ctx = startedActors.start();
+            ctx.addDocuments(1);
+
+            std::lock_guard<std::mutex> lk{reporting};
+            ctx.success();
+        }
+
+        runActor(actor, outcomeCode, orchestrator);
+
+        {
+            auto ctx = finishedActors.start();
+            ctx.addDocuments(1);
+
+            std::lock_guard<std::mutex> lk{reporting};
+            ctx.success();
+        }
+    };
+
+    if (options.fiberWorkers > 0) {
+        BOOST_LOG_TRIVIAL(info) << "Running actors as fibers on " << options.fiberWorkers
+                                << " threads";
+        // Fibers move between workers, so only the CPUs reserved for genny's own threads
+        // are honored. The workers inherit this thread's affinity.
+        if (std::any_of(actors.begin(), actors.end(), [&](const auto& actor) {
+                return workloadContext.affinity(actor->id()) != workloadContext.unreservedCpus();
+            })) {
+            BOOST_LOG_TRIVIAL(warning) << "Actor Affinity is ignored when running with --fibers";
+        }
+        const auto mainCpus = v1::threadAffinity();
+        restrictThread(workloadContext.unreservedCpus());
+        v1::FiberPool pool{options.fiberWorkers, options.fiberStackSize};
+        restrictThread(mainCpus);
+        for (const auto& actor : actors) {
+            pool.launch([&]() { runOne(actor); });
+        }
+        pool.join();
+    } else {
+        std::vector<std::thread> threads;
+        std::transform(cbegin(actors),
+                       cend(actors),
+                       std::back_inserter(threads),
+                       [&](const auto& actor) {
+                           return std::thread{[&]() {
+                               restrictThread(workloadContext.affinity(actor->id()));
+                               runOne(actor);
+                           }};
+                       });
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+    control.reset();
+
+    if (!profileFile.empty()) {
+        v1::Profiler::disable();
+        std::ofstream profileOutput{profileFile, std::ofstream::out | std::ofstream::trunc};
+        v1::Profiler::writeFolded(profileOutput);
+        if (!profileOutput) {
+            BOOST_LOG_TRIVIAL(error) << "Couldn't write the profile to " << profileFile;
+        } else if (v1::Profiler::dropped() > 0) {
+            BOOST_LOG_TRIVIAL(warning) << "The profile is missing " << v1::Profiler::dropped()
+                                       << " of " << v1::Profiler::samples()
+                                       << " samples with too many distinct stacks";
+        }
+    }
+
+    if (recorder) {
+        try {
+            const auto recorded = recorder->close();
+            BOOST_LOG_TRIVIAL(info) << "Recorded " << recorded << " commands to "
+                                    << options.recordDirectory;
+        } catch (const InvalidConfigurationException& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Couldn't finish recording: " << ex.what();
+        }
+    }
+
+    if (mockServer) {
+        BOOST_LOG_TRIVIAL(info) << "The mock server answered " << mockServer->commands()
+                                << " commands";
+    }
+
+    if (!traceFile.empty()) {
+        v1::Tracer::disable();
+        std::ofstream traceOutput{traceFile, std::ofstream::out | std::ofstream::trunc};
+        v1::Tracer::writeChromeJson(traceOutput);
+        if (!traceOutput) {
+            BOOST_LOG_TRIVIAL(error) << "Couldn't write the trace to " << traceFile;
+        }
+    }
 
     if (metrics.getFormat().useCsv()) {
         const auto reporter = genny::metrics::Reporter{metrics};
@@ -287,6 +486,11 @@ DefaultDriver::ProgramOptions::ProgramOptions(int argc, char** argv) {
     run          Run the workload normally
     dry-run      Exit before the run step -- this may still make network
                  connections during workload initialization
+    compile      Write the workload as a plan that run, dry-run and estimate
+                 load without parsing its YAML
+    estimate     Construct the workload, benchmark the documents each phase
+                 generates and report the rates, threads, clients and
+                 metrics memory it will need
     list-actors  List all actors available for use
     )" << "\n";
 
@@ -310,7 +514,62 @@ DefaultDriver::ProgramOptions::ProgramOptions(int argc, char** argv) {
              "Mongo URI to use for the default connection-pool.")
             ("verbosity,v",
               po::value<std::string>()->default_value("info"),
-              "Log severity for boost logging. Valid values are trace/debug/info/warning/error/fatal.");
+              "Log severity for boost logging. Valid values are trace/debug/info/warning/error/fatal.")
+            ("fibers",
+             po::value<size_t>()->default_value(0),
+             "Run actors as fibers on this many threads instead of one thread per actor. "
+             "Sleeps, rate limits and phase waits yield the thread. Use at most one per core. "
+             "0 disables.")
+            ("fiber-stack-size",
+             po::value<size_t>()->default_value(v1::FiberPool::kDefaultStackSize),
+             "Stack size in bytes for each actor when running with --fibers.")
+            ("trace-file",
+             po::value<std::string>()->default_value(""),
+             "Record each actor's phase waits, sleeps, rate-limit waits and a sample of its "
+             "operations, and write them to this file as Chrome trace-event JSON for "
+             "chrome://tracing or ui.perfetto.dev. Disabled if empty.")
+            ("control-socket",
+             po::value<std::string>()->default_value(""),
+             "Listen on this Unix socket for commands that change a GlobalRate, end the "
+             "running phase, print what each actor is doing, or flush ftdc metrics. Send "
+             "'help' for the list. Disabled if empty.")
+            ("profile",
+             po::value<std::string>()->default_value(""),
+             "Sample the CPU genny uses while actors run, tagged with the actor, phase and "
+             "operation, and write it to this file as folded stacks for flamegraph.pl or "
+             "speedscope. Disabled if empty.")
+            ("record",
+             po::value<std::string>()->default_value(""),
+             "Record every command each actor runs, with when it ran, to one compressed log "
+             "per actor in this directory, for the Replay actor to run again. Disabled if "
+             "empty.")
+            ("mock-server",
+             "Run against a mock mongod in this process instead of --mongo-uri, to measure "
+             "genny's own overhead. Every write succeeds, queries return --mock-results "
+             "canned documents and everything else just succeeds.")
+            ("mock-latency-us",
+             po::value<size_t>()->default_value(0),
+             "Microseconds the mock server waits before each reply.")
+            ("mock-results",
+             po::value<size_t>()->default_value(1),
+             "Documents each query returns from the mock server.")
+            ("mock-document-size",
+             po::value<size_t>()->default_value(128),
+             "Approximate size in bytes of each document the mock server returns.")
+            ("setup-threads",
+             po::value<size_t>()->default_value(0),
+             "Construct actors on this many threads. 0 uses one per CPU.")
+            ("processes",
+             po::value<size_t>()->default_value(1),
+             "Fork this many worker processes that each run a share of the actors. Phases "
+             "and GlobalRates are coordinated between them through shared memory, and each "
+             "writes its own metrics to the metrics Path, and its own trace, profile and "
+             "control socket, with a -worker-<n> suffix. Can't be combined with --fibers.")
+            ("plan-file",
+             po::value<std::string>()->default_value(""),
+             "Where compile writes the plan. Defaults to the workload file with a .plan "
+             "extension. A plan whose workload file has changed since is ignored in favor of "
+             "the workload file.");
 
     positional.add("subcommand", 1);
     positional.add("workload-file", -1);
@@ -342,6 +601,10 @@ DefaultDriver::ProgramOptions::ProgramOptions(int argc, char** argv) {
         this->runMode = RunMode::kListActors;
     else if (subcommand == "dry-run")
         this->runMode = RunMode::kDryRun;
+    else if (subcommand == "compile")
+        this->runMode = RunMode::kCompile;
+    else if (subcommand == "estimate")
+        this->runMode = RunMode::kEstimate;
     else if (subcommand == "run")
         this->runMode = RunMode::kNormal;
     else if (subcommand == "help")
@@ -357,6 +620,23 @@ DefaultDriver::ProgramOptions::ProgramOptions(int argc, char** argv) {
 
     this->logVerbosity = parseVerbosity(vm["verbosity"].as<std::string>());
     this->mongoUri = vm["mongo-uri"].as<std::string>();
+    this->fiberWorkers = vm["fibers"].as<size_t>();
+    this->fiberStackSize = vm["fiber-stack-size"].as<size_t>();
+    this->traceFile = vm["trace-file"].as<std::string>();
+    this->controlSocket = vm["control-socket"].as<std::string>();
+    this->profileFile = vm["profile"].as<std::string>();
+    this->recordDirectory = vm["record"].as<std::string>();
+    this->mockServer = vm.count("mock-server") > 0;
+    this->mockServerOptions.latency =
+        std::chrono::microseconds{vm["mock-latency-us"].as<size_t>()};
+    this->mockServerOptions.results = vm["mock-results"].as<size_t>();
+    this->mockServerOptions.documentSize = vm["mock-document-size"].as<size_t>();
+    this->setupThreads = vm["setup-threads"].as<size_t>();
+    this->planFile = vm["plan-file"].as<std::string>();
+    this->processes = vm["processes"].as<size_t>();
+    if (this->setupThreads == 0) {
+        this->setupThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
 
     if (vm.count("workload-file") > 0) {
         this->workloadSource = vm["workload-file"].as<std::string>();
@@ -0,0 +1,206 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/v1/Estimator.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/conventions.hpp>
+
+#include <value_generators/DefaultRandom.hpp>
+#include <value_generators/DocumentGenerator.hpp>
+
+namespace genny::driver {
+namespace {
+
+// Enough to average over a template's random choices without waiting on slow ones.
+constexpr size_t kMaxDocuments = 100 * 1000;
+
+bool isConfigKey(const std::string& key) {
+    return !key.empty() && std::isupper(static_cast<unsigned char>(key.front()));
+}
+
+void findTemplates(const Node& node, std::vector<const Node*>& out) {
+    if (node.isSequence()) {
+        for (const auto& [k, child] : node) {
+            findTemplates(child, out);
+        }
+        return;
+    }
+    if (!node.isMap() || node.size() == 0) {
+        return;
+    }
+    bool config = true;
+    for (const auto& [k, child] : node) {
+        config = config && isConfigKey(k.toString());
+    }
+    if (!config) {
+        out.push_back(&node);
+        return;
+    }
+    for (const auto& [k, child] : node) {
+        findTemplates(child, out);
+    }
+}
+
+struct TemplateCost {
+    double secondsPerDocument;
+    double bytesPerDocument;
+};
+
+std::optional<TemplateCost> benchmark(const Node& node,
+                                      ActorId id,
+                                      std::chrono::nanoseconds budget) {
+    using clock = std::chrono::steady_clock;
+
+    DefaultRandom rng;
+    rng.seed(id);
+    try {
+        DocumentGenerator generator{node, GeneratorArgs{rng, id}};
+        size_t documents = 0;
+        size_t bytes = 0;
+        const auto started = clock::now();
+        auto elapsed = clock::duration::zero();
+        do {
+            bytes += generator().view().length();
+            ++documents;
+            elapsed = clock::now() - started;
+        } while (elapsed < budget && documents < kMaxDocuments);
+
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        return TemplateCost{seconds / documents, double(bytes) / documents};
+    } catch (const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(debug) << "Not estimating " << node.path()
+                                 << " which isn't a document template: " << ex.what();
+        return std::nullopt;
+    }
+}
+
+PhaseEstimate estimatePhase(const Node& actor,
+                            const Node& phase,
+                            PhaseNumber number,
+                            std::chrono::nanoseconds budget) {
+    PhaseEstimate out;
+    out.actor = actor["Name"].maybe<std::string>().value_or("");
+    out.phase = number;
+    out.threads = actor["Threads"].maybe<int>().value_or(1);
+
+    std::vector<const Node*> templates;
+    for (const auto& [k, child] : phase) {
+        findTemplates(child, templates);
+    }
+    double secondsPerIteration = 0;
+    double bytesPerIteration = 0;
+    for (const auto* node : templates) {
+        if (const auto cost = benchmark(*node, number + 1, budget)) {
+            ++out.templates;
+            secondsPerIteration += cost->secondsPerDocument;
+            bytesPerIteration += cost->bytesPerDocument;
+        }
+    }
+    if (secondsPerIteration > 0) {
+        out.iterationsPerSecond = 1 / secondsPerIteration;
+        out.documentsPerSecond = out.templates * out.iterationsPerSecond;
+        out.bytesPerSecond = bytesPerIteration * out.iterationsPerSecond;
+    }
+
+    if (const auto rate = phase["GlobalRate"].maybe<RateSpec>()) {
+        if (const auto base = rate->getBaseSpec(); base && base->per.count() > 0) {
+            out.globalRate = double(base->operations) * 1e9 / base->per.count();
+            out.globalRateInBytes = base->bytes;
+        }
+    }
+    return out;
+}
+
+// What the phase's threads could do at most, in the units of its GlobalRate.
+double maxRate(const PhaseEstimate& phase, unsigned cpus) {
+    const auto usable = std::min<double>(phase.threads, cpus);
+    return usable * (phase.globalRateInBytes ? phase.bytesPerSecond : phase.iterationsPerSecond);
+}
+
+}  // namespace
+
+
+WorkloadEstimate estimateWorkload(WorkloadContext& context,
+                                  unsigned cpus,
+                                  std::chrono::nanoseconds budget) {
+    WorkloadEstimate out;
+    for (const auto& [k, actor] : context["Actors"]) {
+        out.actorThreads += actor["Threads"].maybe<int>().value_or(1);
+        PhaseNumber number = 0;
+        for (const auto& [k, phase] : actor["Phases"]) {
+            out.phases.push_back(estimatePhase(actor, phase, number++, budget));
+        }
+    }
+
+    out.clients = context.setupClients();
+    const auto& metrics = context.getMetrics();
+    out.metricsOperations = metrics.operationCount();
+    out.metricsBytes = out.metricsOperations * metrics.reservedBytesPerOperation();
+
+    for (const auto& phase : out.phases) {
+        // Only phases whose documents were measured can be judged.
+        if (!phase.globalRate || phase.templates == 0) {
+            continue;
+        }
+        if (const auto max = maxRate(phase, cpus); *phase.globalRate > max) {
+            std::ostringstream warning;
+            warning << std::fixed << std::setprecision(0) << phase.actor << " phase "
+                    << phase.phase << " has a GlobalRate of " << *phase.globalRate
+                    << (phase.globalRateInBytes ? " bytes" : " iterations")
+                    << "/s but generating its documents limits it to " << max << "/s with "
+                    << phase.threads << " threads on " << cpus << " CPUs";
+            out.warnings.push_back(warning.str());
+        }
+    }
+    return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const WorkloadEstimate& estimate) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(0);
+
+    out << "Actor,Phase,Threads,Templates,DocumentsPerSecondPerThread,"
+           "BytesPerSecondPerThread,GlobalRatePerSecond\n";
+    for (const auto& phase : estimate.phases) {
+        out << phase.actor << "," << phase.phase << "," << phase.threads << ","
+            << phase.templates << "," << phase.documentsPerSecond << ","
+            << phase.bytesPerSecond << ",";
+        if (phase.globalRate) {
+            out << *phase.globalRate << (phase.globalRateInBytes ? " bytes" : "");
+        }
+        out << "\n";
+    }
+    out << "\n";
+    out << "Actor threads: " << estimate.actorThreads << "\n";
+    out << "Clients: " << estimate.clients << "\n";
+    out << "Metrics operations: " << estimate.metricsOperations << ", reserving "
+        << estimate.metricsBytes / (1024 * 1024) << " MiB\n";
+    for (const auto& warning : estimate.warnings) {
+        out << "WARNING: " << warning << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+    return out;
+}
+
+}  // namespace genny::driver
@@ -0,0 +1,442 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/v1/MockServer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <bsoncxx/builder/basic/array.hpp>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/types.hpp>
+
+namespace genny::driver {
+namespace {
+
+using bsoncxx::builder::basic::kvp;
+using bsoncxx::builder::basic::make_document;
+using bsoncxx::builder::basic::sub_array;
+using bsoncxx::builder::basic::sub_document;
+
+constexpr int32_t kOpReply = 1;
+constexpr int32_t kOpQuery = 2004;
+constexpr int32_t kOpMsg = 2013;
+
+constexpr uint32_t kChecksumPresent = 1 << 0;
+constexpr uint32_t kMoreToCome = 1 << 1;
+
+constexpr int32_t kHeaderSize = 16;
+// What hello promises the driver it can send.
+constexpr int32_t kMaxBsonObjectSize = 16 * 1024 * 1024;
+constexpr int32_t kMaxMessageSize = 48'000'000;
+
+// How long a connection waits for a request before checking whether it's being stopped.
+constexpr int kPollMillis = 100;
+
+// The first field of `{_id: 0, padding: ""}` and the rest of its framing.
+constexpr size_t kDocumentOverhead = 30;
+
+std::system_error socketError(const std::string& what) {
+    return std::system_error(errno, std::generic_category(), what + " mock server");
+}
+
+bool readable(int fd) {
+    pollfd polled{fd, POLLIN, 0};
+    return ::poll(&polled, 1, kPollMillis) > 0;
+}
+
+template <typename T>
+T readAt(std::string_view data, size_t pos) {
+    T out;
+    std::memcpy(&out, data.data() + pos, sizeof(T));
+    return out;
+}
+
+template <typename T>
+void appendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendBson(std::string& out, bsoncxx::document::view document) {
+    out.append(reinterpret_cast<const char*>(document.data()), document.length());
+}
+
+// The BSON document at `pos`, if it fits before `end`.
+std::optional<bsoncxx::document::view> documentAt(std::string_view data, size_t pos, size_t end) {
+    if (end < pos + sizeof(int32_t)) {
+        return std::nullopt;
+    }
+    const auto size = readAt<int32_t>(data, pos);
+    if (size < 5 || end - pos < size_t(size)) {
+        return std::nullopt;
+    }
+    return bsoncxx::document::view{reinterpret_cast<const uint8_t*>(data.data() + pos),
+                                   size_t(size)};
+}
+
+std::string_view stringOf(bsoncxx::document::element element) {
+    if (!element || element.type() != bsoncxx::type::k_utf8) {
+        return {};
+    }
+    const auto value = element.get_utf8().value;
+    return {value.data(), value.size()};
+}
+
+std::optional<int64_t> integerOf(bsoncxx::document::element element) {
+    if (!element) {
+        return std::nullopt;
+    }
+    switch (element.type()) {
+        case bsoncxx::type::k_int32:
+            return element.get_int32().value;
+        case bsoncxx::type::k_int64:
+            return element.get_int64().value;
+        case bsoncxx::type::k_double:
+            return int64_t(element.get_double().value);
+        default:
+            return std::nullopt;
+    }
+}
+
+size_t arraySize(bsoncxx::document::element element) {
+    if (!element || element.type() != bsoncxx::type::k_array) {
+        return 0;
+    }
+    const auto array = element.get_array().value;
+    return std::distance(array.begin(), array.end());
+}
+
+std::string messageHeader(int32_t length, int32_t responseTo, int32_t opCode) {
+    static std::atomic<int32_t> nextRequestId = 1;
+    std::string out;
+    appendValue(out, length);
+    appendValue(out, nextRequestId++);
+    appendValue(out, responseTo);
+    appendValue(out, opCode);
+    return out;
+}
+
+}  // namespace
+
+
+MockServer::MockServer(Options options)
+    : _options{options},
+      _document{make_document(
+          kvp("_id", 0),
+          kvp("padding",
+              std::string(std::max(options.documentSize, kDocumentOverhead) - kDocumentOverhead,
+                          'x')))} {
+    _listening = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_listening < 0) {
+        throw socketError("creating");
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (::bind(_listening, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(_listening, 128) < 0 ||
+        ::getsockname(_listening, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+        const auto error = socketError("listening on");
+        ::close(_listening);
+        throw error;
+    }
+    _port = ntohs(address.sin_port);
+    BOOST_LOG_TRIVIAL(info) << "Mock server listening on " << this->uri();
+
+    _thread = std::thread{[this]() { this->serve(); }};
+}
+
+MockServer::~MockServer() {
+    _stopping = true;
+    _thread.join();
+    for (auto& connection : _connectionThreads) {
+        connection.join();
+    }
+    ::close(_listening);
+}
+
+std::string MockServer::uri() const {
+    return "mongodb://127.0.0.1:" + std::to_string(_port);
+}
+
+bsoncxx::document::value MockServer::reply(bsoncxx::document::view command,
+                                           std::string_view database,
+                                           size_t documents) const {
+    if (command.empty()) {
+        return make_document(kvp("ok", 0.0), kvp("errmsg", "empty command"));
+    }
+    const auto nameKey = command.begin()->key();
+    const std::string_view name{nameKey.data(), nameKey.size()};
+
+    if (name == "hello" || name == "isMaster" || name == "ismaster") {
+        return make_document(
+            kvp("ismaster", true),
+            kvp("isWritablePrimary", true),
+            kvp("helloOk", true),
+            kvp("maxBsonObjectSize", kMaxBsonObjectSize),
+            kvp("maxMessageSizeBytes", kMaxMessageSize),
+            kvp("maxWriteBatchSize", 100'000),
+            kvp("localTime", bsoncxx::types::b_date{std::chrono::system_clock::now()}),
+            kvp("logicalSessionTimeoutMinutes", 30),
+            kvp("minWireVersion", 0),
+            // 4.4, so the driver uses OP_MSG.
+            kvp("maxWireVersion", 9),
+            kvp("readOnly", false),
+            kvp("ok", 1.0));
+    }
+    if (name == "insert") {
+        const auto n = int64_t(documents + arraySize(command["documents"]));
+        return make_document(kvp("n", n), kvp("ok", 1.0));
+    }
+    if (name == "update") {
+        const auto n = int64_t(documents + arraySize(command["updates"]));
+        return make_document(kvp("n", n), kvp("nModified", n), kvp("ok", 1.0));
+    }
+    if (name == "delete") {
+        const auto n = int64_t(documents + arraySize(command["deletes"]));
+        return make_document(kvp("n", n), kvp("ok", 1.0));
+    }
+
+    // Queries return whole batches of the same document.
+    std::optional<int64_t> remaining;
+    std::optional<int64_t> batchSize;
+    std::string ns{database};
+    std::string batchName = "firstBatch";
+    if (name == "find") {
+        remaining = int64_t(_options.results);
+        batchSize = integerOf(command["batchSize"]);
+        ns += "." + std::string{stringOf(command["find"])};
+    } else if (name == "aggregate") {
+        remaining = int64_t(_options.results);
+        if (const auto cursor = command["cursor"];
+            cursor && cursor.type() == bsoncxx::type::k_document) {
+            batchSize = integerOf(cursor.get_document().value["batchSize"]);
+        }
+        const auto collection = stringOf(command["aggregate"]);
+        ns += "." + (collection.empty() ? "$cmd.aggregate" : std::string{collection});
+    } else if (name == "getMore") {
+        // The cursor id is how many documents it has left.
+        remaining = std::max<int64_t>(0, integerOf(command["getMore"]).value_or(0));
+        batchSize = integerOf(command["batchSize"]);
+        ns += "." + std::string{stringOf(command["collection"])};
+        batchName = "nextBatch";
+    }
+    if (!remaining) {
+        return make_document(kvp("ok", 1.0));
+    }
+
+    const auto batch = std::min(*remaining, batchSize.value_or(*remaining));
+    return make_document(kvp("cursor",
+                             [&](sub_document cursor) {
+                                 cursor.append(kvp(batchName, [&](sub_array documents) {
+                                     for (int64_t i = 0; i < batch; ++i) {
+                                         documents.append(_document.view());
+                                     }
+                                 }));
+                                 cursor.append(kvp("id", *remaining - batch));
+                                 cursor.append(kvp("ns", ns));
+                             }),
+                         kvp("ok", 1.0));
+}
+
+void MockServer::serve() {
+    while (!_stopping) {
+        if (!readable(_listening)) {
+            continue;
+        }
+        const auto client = ::accept4(_listening, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        // Replies are small, and the driver waits for each one.
+        int noDelay = 1;
+        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        std::lock_guard<std::mutex> lock{_lock};
+        _connectionThreads.emplace_back([this, client]() {
+            this->serveConnection(client);
+            ::close(client);
+        });
+    }
+}
+
+void MockServer::serveConnection(int fd) {
+    // Fill `out` from the connection, or give up if it closes or the server stops.
+    const auto receive = [&](char* out, size_t size) {
+        size_t received = 0;
+        while (received < size && !_stopping) {
+            if (!readable(fd)) {
+                continue;
+            }
+            const auto n = ::recv(fd, out + received, size - received, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            received += n;
+        }
+        return received == size;
+    };
+
+    std::string message;
+    while (!_stopping) {
+        int32_t length;
+        if (!receive(reinterpret_cast<char*>(&length), sizeof(length))) {
+            return;
+        }
+        if (length < kHeaderSize || length > kMaxMessageSize) {
+            BOOST_LOG_TRIVIAL(warning) << "Mock server got a message of " << length
+                                       << " bytes; closing the connection";
+            return;
+        }
+        message.resize(length);
+        std::memcpy(&message[0], &length, sizeof(length));
+        if (!receive(&message[sizeof(length)], length - sizeof(length))) {
+            return;
+        }
+
+        const auto reply = this->answer(message);
+        if (!reply) {
+            // The driver would wait for an answer that isn't coming.
+            return;
+        }
+        if (reply->empty()) {
+            continue;
+        }
+        if (_options.latency.count() > 0) {
+            std::this_thread::sleep_for(_options.latency);
+        }
+        for (size_t sent = 0; sent < reply->size();) {
+            const auto n = ::send(fd, reply->data() + sent, reply->size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return;
+            }
+            sent += n;
+        }
+    }
+}
+
+std::optional<std::string> MockServer::answer(std::string_view message) {
+    const auto requestId = readAt<int32_t>(message, 4);
+    const auto opCode = readAt<int32_t>(message, 12);
+
+    if (opCode == kOpMsg && message.size() >= kHeaderSize + sizeof(uint32_t)) {
+        const auto flags = readAt<uint32_t>(message, kHeaderSize);
+        auto end = message.size();
+        if (flags & kChecksumPresent) {
+            end -= std::min(end, sizeof(uint32_t));
+        }
+        std::optional<bsoncxx::document::view> body;
+        size_t documents = 0;
+        for (auto pos = kHeaderSize + sizeof(uint32_t); pos < end;) {
+            const auto kind = message[pos++];
+            if (kind == 0) {
+                body = documentAt(message, pos, end);
+                if (!body) {
+                    break;
+                }
+                pos += body->length();
+            } else if (kind == 1 && end - pos >= sizeof(int32_t)) {
+                // A sequence of documents, such as an insert's, after its identifier.
+                const auto size = readAt<int32_t>(message, pos);
+                if (size < int32_t(sizeof(int32_t))) {
+                    break;
+                }
+                const auto sectionEnd = pos + size;
+                pos = message.find('\0', pos + sizeof(int32_t)) + 1;
+                while (pos > 0 && pos < std::min(sectionEnd, end)) {
+                    const auto document = documentAt(message, pos, sectionEnd);
+                    if (!document) {
+                        break;
+                    }
+                    pos += document->length();
+                    ++documents;
+                }
+                pos = sectionEnd;
+            } else {
+                break;
+            }
+        }
+        if (!body) {
+            BOOST_LOG_TRIVIAL(warning) << "Mock server got an OP_MSG without a body";
+            return std::nullopt;
+        }
+
+        const auto reply = this->reply(*body, stringOf((*body)["$db"]), documents);
+        ++_commands;
+        if (flags & kMoreToCome) {
+            return std::string{};
+        }
+        const auto length = int32_t(kHeaderSize + sizeof(uint32_t) + 1 + reply.view().length());
+        auto out = messageHeader(length, requestId, kOpMsg);
+        appendValue(out, uint32_t(0));
+        appendValue(out, uint8_t(0));
+        appendBson(out, reply.view());
+        return out;
+    }
+
+    if (opCode == kOpQuery) {
+        // Only the handshake's commands on `<db>.$cmd` are sent this way.
+        const auto collection = kHeaderSize + sizeof(int32_t);
+        const auto collectionEnd = message.find('\0', collection);
+        if (collectionEnd == std::string_view::npos) {
+            return std::nullopt;
+        }
+        const auto fullName = message.substr(collection, collectionEnd - collection);
+        auto query = documentAt(message, collectionEnd + 1 + 2 * sizeof(int32_t), message.size());
+        if (!query) {
+            return std::nullopt;
+        }
+        if (const auto wrapped = (*query)["$query"];
+            wrapped && wrapped.type() == bsoncxx::type::k_document) {
+            query = wrapped.get_document().value;
+        }
+
+        const auto reply = this->reply(*query, fullName.substr(0, fullName.find('.')));
+        ++_commands;
+        const auto length = int32_t(kHeaderSize + 20 + reply.view().length());
+        auto out = messageHeader(length, requestId, kOpReply);
+        appendValue(out, int32_t(0));  // responseFlags
+        appendValue(out, int64_t(0));  // cursorID
+        appendValue(out, int32_t(0));  // startingFrom
+        appendValue(out, int32_t(1));  // numberReturned
+        appendBson(out, reply.view());
+        return out;
+    }
+
+    BOOST_LOG_TRIVIAL(warning) << "Mock server can't answer opCode " << opCode;
+    return std::nullopt;
+}
+
+}  // namespace genny::driver
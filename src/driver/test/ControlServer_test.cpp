@@ -0,0 +1,141 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include <driver/v1/ControlServer.hpp>
+
+#include <gennylib/Orchestrator.hpp>
+#include <gennylib/context.hpp>
+
+#include <testlib/ActorHelper.hpp>
+#include <testlib/helpers.hpp>
+
+namespace genny::driver {
+namespace {
+
+bool contains(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+// Send one command over the socket and read its reply.
+std::string request(const std::string& path, const std::string& command) {
+    const auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+
+    const auto line = command + "\n";
+    REQUIRE(::send(fd, line.data(), line.size(), 0) == ssize_t(line.size()));
+    std::string reply;
+    char buffer[256];
+    while (!contains(reply, "ok\n") && !contains(reply, "error:")) {
+        const auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        reply.append(buffer, n);
+    }
+    ::close(fd);
+    return reply;
+}
+
+TEST_CASE("ControlServer") {
+    NodeSource config{R"(
+SchemaVersion: 2018-07-01
+Actors:
+- Name: Controlled
+  Type: NopMetrics
+  Threads: 2
+  Phases:
+  - Repeat: 1
+    GlobalRate: 10 per 1 second
+    RateLimiterName: Limited
+  - Repeat: 1
+    GlobalRate: 50%
+    RateLimiterName: Percent
+)",
+                      ""};
+    ActorHelper ah(config.root(), 2);
+    auto& workload = *ah.workload();
+
+    std::vector<Actor*> actors;
+    for (const auto& actor : workload.actors()) {
+        actors.push_back(actor.get());
+    }
+    Orchestrator orchestrator;
+    orchestrator.addRequiredTokens(1);
+
+    namespace fs = boost::filesystem;
+    const auto path = (fs::temp_directory_path() / fs::unique_path()).string();
+    ControlServer server{path, workload, orchestrator, workload.getMetrics(), "Test", actors};
+
+    SECTION("Changes fixed rates") {
+        REQUIRE(contains(server.execute("rate Limited 5 per 1 second"), "ok"));
+        REQUIRE(workload.findRateLimiter("Limited")->getRate() == 200'000'000);
+
+        REQUIRE(contains(server.execute("rate Limited"), "error: usage"));
+        REQUIRE(contains(server.execute("rate Missing 5 per 1 second"), "error: no GlobalRate"));
+        REQUIRE(contains(server.execute("rate Percent 5 per 1 second"), "error:"));
+        REQUIRE(contains(server.execute("rate Limited fast"), "error:"));
+        REQUIRE(workload.findRateLimiter("Limited")->getRate() == 200'000'000);
+    }
+
+    SECTION("Ends the running phase") {
+        REQUIRE(contains(server.execute("end-phase"), "error: no phase is running"));
+        orchestrator.awaitPhaseStart();
+        REQUIRE(!orchestrator.phaseEndRequested(0));
+        REQUIRE(server.execute("end-phase") == "ending phase 0\nok\n");
+        REQUIRE(orchestrator.phaseEndRequested(0));
+        REQUIRE(!orchestrator.phaseEndRequested(1));
+    }
+
+    SECTION("Prints each Actor's status") {
+        const std::string operation = "Iterate";
+        auto& status = server.status(actors[1]->id());
+        status.enterPhase(1);
+        status.setIterations(7);
+        status.setOperation(&operation);
+
+        const auto reply = server.execute("status");
+        REQUIRE(contains(reply,
+                         std::to_string(actors[0]->id()) +
+                             " Controlled phase - iterations 0 operation -\n"));
+        REQUIRE(contains(reply,
+                         std::to_string(actors[1]->id()) +
+                             " Controlled phase 1 iterations 7 operation Iterate\n"));
+    }
+
+    SECTION("Rejects what it can't do") {
+        REQUIRE(contains(server.execute("flush"), "error: only ftdc"));
+        REQUIRE(contains(server.execute("jump"), "error: unknown command 'jump'"));
+    }
+
+    SECTION("Serves the socket") {
+        REQUIRE(contains(request(path, "help"), "end-phase\n"));
+        REQUIRE(contains(request(path, "status"), " Controlled phase - iterations 0"));
+    }
+}
+
+}  // namespace
+}  // namespace genny::driver
@@ -136,7 +136,8 @@ DefaultDriver::ProgramOptions create(const std::string& yaml) {
     return opts;
 }
 
-std::pair<DefaultDriver::OutcomeCode, std::string> outcome(const std::string& yaml) {
+std::pair<DefaultDriver::OutcomeCode, std::string> outcome(const std::string& yaml,
+                                                           size_t fiberWorkers = 0) {
     Fails::state.clear();
 
     boost::filesystem::path ph =
@@ -152,6 +153,7 @@ std::pair<DefaultDriver::OutcomeCode, std::string> outcome(const std::string& ya
         )";
     DefaultDriver driver;
     auto opts = create(yaml + metricsSection);
+    opts.fiberWorkers = fiberWorkers;
     return {driver.run(opts), metricsPath + ".csv"};
 }
 
@@ -342,4 +344,41 @@ TEST_CASE("Various Actor Behaviors") {
                  Fails::state.reachedPhases() == std::multiset<genny::PhaseNumber>{0}));
         REQUIRE(hasMetrics(opts));
     }
+
+    SECTION("Many Actors as fibers on one thread") {
+        auto [code, opts] = outcome(R"(
+        SchemaVersion: 2018-07-01
+        Actors:
+          - Type: Fails
+            Name: Fails
+            Threads: 200
+            Phases:
+              - Repeat: 2
+                SleepBefore: 10 milliseconds
+                Mode: NoException
+              - Repeat: 1
+                Mode: NoException
+        )",
+                                    1);
+        REQUIRE(code == DefaultDriver::OutcomeCode::kSuccess);
+        REQUIRE(Fails::state.reachedPhases().count(0) == 400);
+        REQUIRE(Fails::state.reachedPhases().count(1) == 200);
+        REQUIRE(hasMetrics(opts));
+    }
+
+    SECTION("Exceptions from fibers") {
+        auto [code, opts] = outcome(R"(
+        SchemaVersion: 2018-07-01
+        Actors:
+          - Type: Fails
+            Name: Fails
+            Threads: 2
+            Phases:
+              - Repeat: 1
+                Mode: BoostException
+        )",
+                                    2);
+        REQUIRE(code == DefaultDriver::OutcomeCode::kBoostException);
+        REQUIRE(hasMetrics(opts));
+    }
 }
@@ -0,0 +1,80 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include <driver/v1/Estimator.hpp>
+
+#include <gennylib/context.hpp>
+
+#include <testlib/ActorHelper.hpp>
+#include <testlib/helpers.hpp>
+
+namespace genny::driver {
+namespace {
+
+TEST_CASE("estimateWorkload benchmarks document templates and checks GlobalRates") {
+    NodeSource config{R"(
+SchemaVersion: 2018-07-01
+Actors:
+- Name: Estimated
+  Type: NopMetrics
+  Threads: 2
+  Phases:
+  - Repeat: 1
+    Document: {a: {^RandomInt: {min: 0, max: 10}}, b: "some text"}
+  - Repeat: 1
+    GlobalRate: 1 per 1 nanosecond
+    Document: {a: {^RandomInt: {min: 0, max: 10}}}
+  - Repeat: 1
+    GlobalRate: 1 per 1 hour
+    Filter: {a: 1}
+    Update: {$set: {b: {^RandomString: {length: 10}}}}
+Metrics:
+  Format: csv
+)",
+                      ""};
+    ActorHelper ah(config.root(), 2);
+
+    const auto estimate = estimateWorkload(*ah.workload(), 1);
+
+    REQUIRE(estimate.actorThreads == 2);
+    REQUIRE(estimate.metricsOperations >= 2);
+    REQUIRE(estimate.metricsBytes > 0);
+
+    REQUIRE(estimate.phases.size() == 3);
+    for (const auto& phase : estimate.phases) {
+        REQUIRE(phase.actor == "Estimated");
+        REQUIRE(phase.threads == 2);
+        REQUIRE(phase.bytesPerSecond > 0);
+    }
+    REQUIRE(estimate.phases[0].templates == 1);
+    REQUIRE(!estimate.phases[0].globalRate);
+    REQUIRE(estimate.phases[1].globalRate == 1e9);
+    REQUIRE(estimate.phases[2].templates == 2);
+    REQUIRE(estimate.phases[2].documentsPerSecond ==
+            Approx(2 * estimate.phases[2].iterationsPerSecond));
+
+    // Only the nanosecond rate is out of reach.
+    REQUIRE(estimate.warnings.size() == 1);
+    REQUIRE(estimate.warnings[0].find("Estimated phase 1") == 0);
+
+    std::ostringstream out;
+    out << estimate;
+    REQUIRE(out.str().find("Estimated,1,2,1,") != std::string::npos);
+    REQUIRE(out.str().find("WARNING: Estimated phase 1") != std::string::npos);
+}
+
+}  // namespace
+}  // namespace genny::driver
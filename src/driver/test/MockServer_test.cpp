@@ -0,0 +1,118 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <vector>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+
+#include <mongocxx/client.hpp>
+#include <mongocxx/instance.hpp>
+#include <mongocxx/options/find.hpp>
+#include <mongocxx/uri.hpp>
+
+#include <driver/v1/MockServer.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::driver {
+namespace {
+
+using bsoncxx::builder::basic::kvp;
+using bsoncxx::builder::basic::make_document;
+
+TEST_CASE("MockServer answers the driver") {
+    mongocxx::instance::current();
+    MockServer::Options options;
+    options.results = 5;
+    options.documentSize = 1000;
+    MockServer server{options};
+    mongocxx::client client{mongocxx::uri{server.uri()}};
+    auto collection = client["test"]["mock"];
+
+    SECTION("Commands succeed") {
+        const auto reply = client["admin"].run_command(make_document(kvp("ping", 1)));
+        REQUIRE(reply.view()["ok"].get_double().value == 1.0);
+    }
+
+    SECTION("Writes are all applied") {
+        std::vector<bsoncxx::document::value> documents;
+        for (int i = 0; i < 3; ++i) {
+            documents.push_back(make_document(kvp("i", i)));
+        }
+        REQUIRE(collection.insert_many(documents)->inserted_count() == 3);
+        REQUIRE(collection.update_many({}, make_document(kvp("$set", make_document(kvp("i", 0)))))
+                    ->modified_count() == 1);
+        REQUIRE(collection.delete_one({})->deleted_count() == 1);
+    }
+
+    SECTION("Queries return the configured documents in batches") {
+        mongocxx::options::find find;
+        find.batch_size(2);
+        size_t found = 0;
+        for (const auto& document : collection.find({}, find)) {
+            REQUIRE(document.length() >= 990);
+            REQUIRE(document.length() <= 1000);
+            ++found;
+        }
+        REQUIRE(found == 5);
+    }
+
+    SECTION("Replies wait for the latency") {
+        options.latency = std::chrono::milliseconds{20};
+        MockServer slow{options};
+        mongocxx::client slowClient{mongocxx::uri{slow.uri()}};
+        // Connect first.
+        slowClient["admin"].run_command(make_document(kvp("ping", 1)));
+
+        const auto started = std::chrono::steady_clock::now();
+        slowClient["admin"].run_command(make_document(kvp("ping", 1)));
+        REQUIRE(std::chrono::steady_clock::now() - started >= options.latency);
+    }
+
+    REQUIRE(server.commands() > 0);
+}
+
+TEST_CASE("MockServer replies") {
+    MockServer server{{}};
+
+    SECTION("Writes count documents sent alongside the command") {
+        const auto reply = server.reply(make_document(kvp("insert", "mock")), "test", 4);
+        REQUIRE(reply.view()["n"].get_int64().value == 4);
+    }
+
+    SECTION("Cursor ids are what's left to return") {
+        MockServer::Options options;
+        options.results = 3;
+        MockServer many{options};
+        const auto first =
+            many.reply(make_document(kvp("find", "mock"), kvp("batchSize", 2)), "test");
+        const auto cursor = first.view()["cursor"].get_document().value;
+        REQUIRE(cursor["id"].get_int64().value == 1);
+        REQUIRE(cursor["ns"].get_utf8().value == bsoncxx::stdx::string_view{"test.mock"});
+
+        const auto next = many.reply(
+            make_document(kvp("getMore", int64_t(1)), kvp("collection", "mock")), "test");
+        REQUIRE(next.view()["cursor"].get_document().value["id"].get_int64().value == 0);
+    }
+
+    SECTION("Unknown commands succeed") {
+        const auto reply = server.reply(make_document(kvp("buildInfo", 1)), "admin");
+        REQUIRE(reply.view()["ok"].get_double().value == 1.0);
+    }
+}
+
+}  // namespace
+}  // namespace genny::driver
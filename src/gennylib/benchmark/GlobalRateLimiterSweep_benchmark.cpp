@@ -0,0 +1,269 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <ctime>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <boost/thread/barrier.hpp>
+
+#include <gennylib/GlobalRateLimiter.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::testing {
+
+namespace {
+
+using namespace std::chrono;
+
+//
+// Regression thresholds.
+//
+// A limiter must never let through more than its rate, regardless of the hardware, so
+// overshoot is checked at every point. Undershoot depends on whether the machine can keep
+// up, so it is only checked for modest rates and no more threads than cores.
+//
+// Both allow an extra burst of slack since tokens are handed out a burst at a time.
+//
+constexpr double kMaxOvershoot = 0.10;
+constexpr double kMaxUndershoot = 0.10;
+constexpr double kMaxRateCheckedForUndershoot = 1e5;
+
+// Don't keep more than this many arrival times per point; they're only used for jitter.
+constexpr size_t kMaxArrivals = 4 * 1000 * 1000;
+
+struct SweepPoint {
+    double rate;  // ops per second
+    int threads;
+    int64_t burst;
+};
+
+struct SweepResult {
+    SweepPoint point;
+    double seconds;
+    int64_t ops;
+    double expectedOps;
+    double achievedRate;
+    double idealGapNanos;
+    // Inter-arrival times of successful consumes, all threads combined.
+    int64_t gapP50, gapP90, gapP99, gapP999;
+    double cpuSecondsPerSecond;
+    // Fraction of thread-time spent in sleep_for() waiting for tokens.
+    double sleepFraction;
+    int64_t casFailures;
+    bool undershootChecked;
+    bool pass;
+};
+
+int64_t processCpuNanos() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return int64_t{ts.tv_sec} * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+int64_t percentile(const std::vector<int64_t>& sorted, double pct) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto idx = static_cast<size_t>(pct / 100 * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+SweepResult runPoint(const SweepPoint& point) {
+    const auto per = static_cast<int64_t>(point.burst * 1e9 / point.rate);
+    GlobalRateLimiter limiter{BaseRateSpec{per, point.burst}};
+    for (int i = 0; i < point.threads; ++i) {
+        limiter.addUser();
+    }
+
+    // Low rates need longer to let through enough operations to be measured.
+    const nanoseconds runFor = point.rate < 10 ? seconds{5} : seconds{1};
+    const auto expectedPerThread =
+        static_cast<size_t>(point.rate * duration_cast<duration<double>>(runFor).count() /
+                            point.threads) +
+        point.burst + 16;
+    const auto capacity = std::min(expectedPerThread * 2, kMaxArrivals / point.threads + 1);
+
+    std::vector<std::vector<int64_t>> arrivals(point.threads);
+    std::vector<int64_t> opCounts(point.threads, 0);
+    std::vector<int64_t> sleptNanos(point.threads, 0);
+    std::atomic_bool stop = false;
+    boost::barrier start{static_cast<unsigned>(point.threads + 1)};
+
+    std::vector<std::thread> threads;
+    threads.reserve(point.threads);
+    for (int i = 0; i < point.threads; ++i) {
+        threads.emplace_back([&, i]() {
+            auto& mine = arrivals[i];
+            mine.reserve(capacity);
+            start.wait();
+            while (!stop) {
+                const auto now = SteadyClock::now();
+                if (limiter.consumeIfWithinRate(now)) {
+                    ++opCounts[i];
+                    if (mine.size() < capacity) {
+                        mine.push_back(now.time_since_epoch().count());
+                    }
+                    limiter.notifyOfIteration();
+                    continue;
+                }
+                // Same back-off as IterationChecker::limitRate().
+                const auto rate = limiter.getRate() > 1e9 ? 1e9 : limiter.getRate();
+                const auto sleepStart = SteadyClock::now();
+                std::this_thread::sleep_for(
+                    nanoseconds(int64_t(rate * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))));
+                sleptNanos[i] += (SteadyClock::now() - sleepStart).count();
+            }
+        });
+    }
+
+    // Tokens accrue from the reset, even while threads are still waking up from the barrier.
+    const auto started = SteadyClock::now();
+    limiter.resetLastEmptied();
+    const auto cpuStart = processCpuNanos();
+    start.wait();
+    std::this_thread::sleep_for(runFor);
+    stop = true;
+    const auto finished = SteadyClock::now();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto cpuNanos = processCpuNanos() - cpuStart;
+
+    std::vector<int64_t> all;
+    for (auto& mine : arrivals) {
+        for (auto t : mine) {
+            if (t <= finished.time_since_epoch().count()) {
+                all.push_back(t);
+            }
+        }
+    }
+    std::sort(all.begin(), all.end());
+    std::vector<int64_t> gaps;
+    gaps.reserve(all.size());
+    for (size_t i = 1; i < all.size(); ++i) {
+        gaps.push_back(all[i] - all[i - 1]);
+    }
+    std::sort(gaps.begin(), gaps.end());
+
+    SweepResult result{point};
+    result.seconds = duration_cast<duration<double>>(finished - started).count();
+    result.ops = 0;
+    for (auto count : opCounts) {
+        result.ops += count;
+    }
+    // A burst is available at the start and after every `per` nanoseconds.
+    result.expectedOps = point.burst * (std::floor((finished - started).count() / double(per)) + 1);
+    result.achievedRate = result.ops / result.seconds;
+    result.idealGapNanos = 1e9 / point.rate;
+    result.gapP50 = percentile(gaps, 50);
+    result.gapP90 = percentile(gaps, 90);
+    result.gapP99 = percentile(gaps, 99);
+    result.gapP999 = percentile(gaps, 99.9);
+    result.cpuSecondsPerSecond = cpuNanos / 1e9 / result.seconds;
+    int64_t totalSlept = 0;
+    for (auto slept : sleptNanos) {
+        totalSlept += slept;
+    }
+    result.sleepFraction = totalSlept / (result.seconds * 1e9 * point.threads);
+    result.casFailures = limiter.getCasFailures();
+
+    const auto cores = std::max(1u, std::thread::hardware_concurrency());
+    result.undershootChecked =
+        point.rate <= kMaxRateCheckedForUndershoot && point.threads <= int(cores);
+    result.pass = result.ops <= result.expectedOps * (1 + kMaxOvershoot) + point.burst &&
+        (!result.undershootChecked ||
+         result.ops >= result.expectedOps * (1 - kMaxUndershoot) - point.burst);
+    return result;
+}
+
+void writeJson(std::ostream& out, const std::vector<SweepResult>& results) {
+    out << std::setprecision(10);
+    out << "{\n";
+    out << "  \"benchmark\": \"GlobalRateLimiter\",\n";
+    out << "  \"thresholds\": {\"maxOvershoot\": " << kMaxOvershoot
+        << ", \"maxUndershoot\": " << kMaxUndershoot
+        << ", \"maxRateCheckedForUndershoot\": " << kMaxRateCheckedForUndershoot
+        << ", \"cores\": " << std::thread::hardware_concurrency() << "},\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"targetRate\": " << r.point.rate << ", \"threads\": " << r.point.threads
+            << ", \"burst\": " << r.point.burst << ", \"seconds\": " << r.seconds
+            << ", \"ops\": " << r.ops << ", \"expectedOps\": " << r.expectedOps
+            << ", \"achievedRate\": " << r.achievedRate
+            << ", \"interArrivalNanos\": {\"ideal\": " << r.idealGapNanos
+            << ", \"p50\": " << r.gapP50 << ", \"p90\": " << r.gapP90 << ", \"p99\": " << r.gapP99
+            << ", \"p999\": " << r.gapP999 << "}"
+            << ", \"cpuSecondsPerSecond\": " << r.cpuSecondsPerSecond
+            << ", \"sleepFraction\": " << r.sleepFraction << ", \"casFailures\": " << r.casFailures
+            << ", \"undershootChecked\": " << (r.undershootChecked ? "true" : "false")
+            << ", \"pass\": " << (r.pass ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+TEST_CASE("Rate limiter accuracy and overhead sweep", "[benchmark]") {
+    std::vector<SweepPoint> points;
+    for (double rate : {1e0, 1e2, 1e4, 1e6, 1e7}) {
+        for (int threads : {1, 8, 64, 512, 2048}) {
+            points.push_back({rate, threads, 1});
+            // The docs recommend a burst size roughly equal to the number of threads.
+            if (threads > 1 && threads <= rate) {
+                points.push_back({rate, threads, threads});
+            }
+        }
+    }
+
+    std::vector<SweepResult> results;
+    for (const auto& point : points) {
+        results.push_back(runPoint(point));
+        const auto& r = results.back();
+        BOOST_LOG_TRIVIAL(info) << "rate=" << r.point.rate << " threads=" << r.point.threads
+                                << " burst=" << r.point.burst << " achieved=" << r.achievedRate
+                                << " gap p50/p99=" << r.gapP50 << "/" << r.gapP99 << "ns"
+                                << " cpu/s=" << r.cpuSecondsPerSecond
+                                << " casFailures=" << r.casFailures
+                                << (r.pass ? "" : " REGRESSION");
+    }
+
+    const auto outputPath = "GlobalRateLimiter-sweep.json";
+    {
+        std::ofstream out{outputPath};
+        writeJson(out, results);
+    }
+    BOOST_LOG_TRIVIAL(info) << "Wrote rate limiter sweep results to " << outputPath;
+
+    for (const auto& r : results) {
+        INFO("rate=" << r.point.rate << " threads=" << r.point.threads
+                     << " burst=" << r.point.burst << " ops=" << r.ops
+                     << " expected=" << r.expectedOps);
+        REQUIRE(r.pass);
+    }
+}
+
+}  // namespace
+}  // namespace genny::testing
@@ -17,12 +17,14 @@
 #include <iostream>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <thread>
 #include <vector>
 
 #include <yaml-cpp/yaml.h>
 
 #include <boost/format.hpp>
+#include <boost/log/trivial.hpp>
 #include <boost/thread/barrier.hpp>
 
 #include <gennylib/Orchestrator.hpp>
@@ -184,9 +186,135 @@ void comparePerformance(int threads, long iterations, int tolerance) {
     REQUIRE(actMean <= regMean * tolerance);
 }
 
+// What Orchestrator::currentPhase() and morePhases() used to do: take a shared_lock
+// for every read. Kept here to show what the lock-free reads buy us.
+struct SharedMutexPhase {
+    mutable std::shared_mutex mutex;
+    PhaseNumber current = 0;
+    PhaseNumber max = 0;
+
+    PhaseNumber currentPhase() const {
+        std::shared_lock<std::shared_mutex> lock{mutex};
+        return current;
+    }
+
+    bool morePhases() const {
+        std::shared_lock<std::shared_mutex> lock{mutex};
+        return current <= max;
+    }
+};
+
+// Each thread does what a non-blocking Actor with a sleep does every iteration.
+template <typename PhaseSource>
+struct PhaseReadsRunnable : public VirtualRunnable {
+    static atomic_int mismatches;
+
+    const PhaseSource& source;
+    const long iterations;
+
+    PhaseReadsRunnable(const PhaseSource& source, long iterations)
+        : source{source}, iterations{iterations} {}
+
+    void run() override {
+        int local = 0;
+        for (long j = 0; j < iterations; ++j) {
+            if (!source.morePhases() || source.currentPhase() != 0) {
+                ++local;
+            }
+        }
+        mismatches += local;
+    }
+};
+
+template <typename PhaseSource>
+atomic_int PhaseReadsRunnable<PhaseSource>::mismatches = 0;
+
+template <typename PhaseSource>
+int64_t timePhaseReads(const PhaseSource& source, int threads, long iterations) {
+    std::vector<std::unique_ptr<PhaseReadsRunnable<PhaseSource>>> runners;
+    for (int i = 0; i < threads; ++i) {
+        runners.emplace_back(
+            std::make_unique<PhaseReadsRunnable<PhaseSource>>(source, iterations));
+    }
+    auto duration = timedRun(runners);
+    REQUIRE(PhaseReadsRunnable<PhaseSource>::mismatches == 0);
+    return duration;
+}
+
 }  // namespace
 
 
+TEST_CASE("Orchestrator phase reads don't contend", "[benchmark]") {
+    Orchestrator orchestrator;
+    SharedMutexPhase sharedMutex;
+
+    for (int threads : {1, 64, 1000}) {
+        const long iterations = 10 * 1000 * 1000 / threads;
+
+        // Interleave the runs so CPU caches and frequency scaling affect both equally.
+        int64_t lockFree = 0;
+        int64_t locked = 0;
+        for (int run = 0; run < 3; ++run) {
+            lockFree += timePhaseReads(orchestrator, threads, iterations);
+            locked += timePhaseReads(sharedMutex, threads, iterations);
+        }
+
+        INFO("threads=" << threads << ", iterations=" << iterations << ", lock-free "
+                        << lockFree << "ns vs shared_mutex " << locked
+                        << "ns. Ratio = " << double(lockFree) / double(locked));
+        BOOST_LOG_TRIVIAL(info) << "Phase reads with " << threads << " threads: lock-free "
+                                << lockFree << "ns, shared_mutex " << locked << "ns";
+        REQUIRE(lockFree < locked);
+    }
+}
+
+TEST_CASE("Orchestrator phase transitions with many threads", "[benchmark]") {
+    constexpr PhaseNumber kPhases = 20;
+
+    for (int threads : {100, 1000, 4000}) {
+        Orchestrator orchestrator;
+        orchestrator.addRequiredTokens(threads);
+        orchestrator.phasesAtLeastTo(kPhases - 1);
+
+        int64_t startSkew = 0;
+        int64_t endSkew = 0;
+        boost::barrier ready(threads + 1);
+        std::vector<std::thread> actors;
+        for (int i = 0; i < threads; ++i) {
+            actors.emplace_back([&, i]() {
+                ready.wait();
+                while (orchestrator.morePhases()) {
+                    orchestrator.awaitPhaseStart();
+                    // Every thread has arrived by now so the skew is for this phase.
+                    if (i == 0) {
+                        startSkew += orchestrator.lastPhaseStartSkew().count();
+                    }
+                    orchestrator.awaitPhaseEnd();
+                    if (i == 0) {
+                        endSkew += orchestrator.lastPhaseEndSkew().count();
+                    }
+                }
+            });
+        }
+
+        const auto start = steady_clock::now();
+        ready.wait();
+        for (auto& actor : actors) {
+            actor.join();
+        }
+        const auto perTransition =
+            duration_cast<microseconds>(steady_clock::now() - start).count() / (2.0 * kPhases);
+
+        BOOST_LOG_TRIVIAL(info) << threads << " threads: " << perTransition
+                                << "us per phase transition, mean skew start "
+                                << startSkew / kPhases / 1000 << "us end "
+                                << endSkew / kPhases / 1000 << "us";
+        REQUIRE(orchestrator.currentPhase() == kPhases);
+        // Generous: this is about not regressing by orders of magnitude.
+        REQUIRE(perTransition < threads * 100.0);
+    }
+}
+
 TEST_CASE("PhaseLoop performance", "[benchmark]") {
     // low tolerance for added latency with few threads
     comparePerformance(50, 10000, 10);
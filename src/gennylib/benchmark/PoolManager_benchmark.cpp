@@ -0,0 +1,138 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <boost/thread/barrier.hpp>
+
+#include <mongocxx/instance.hpp>
+
+#include <gennylib/Node.hpp>
+#include <gennylib/v1/PoolManager.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace std::chrono;
+
+constexpr int kNames = 4;
+
+// Nothing listens here; handing out clients doesn't connect.
+constexpr auto kUri = "mongodb://127.0.0.1:1";
+
+// Enough connections per pool that no thread is turned away.
+constexpr auto kClients = R"(
+Clients:
+  Pool0: {Instances: 16, QueryOptions: {maxPoolSize: 5000}}
+  Pool1: {Instances: 16, QueryOptions: {maxPoolSize: 5000}}
+  Pool2: {Instances: 16, QueryOptions: {maxPoolSize: 5000}}
+  Pool3: {Instances: 16, QueryOptions: {maxPoolSize: 5000}}
+)";
+
+// What PoolManager::client() used to do before handing out a client: take a global
+// lock to find the name's pools and then the name's lock to find the instance.
+struct LockedLookup {
+    std::mutex poolsLock;
+    std::unordered_map<std::string, std::pair<std::mutex, int>> pools;
+
+    void find(const std::string& name) {
+        std::unique_lock<std::mutex> getLock{poolsLock};
+        auto& lap = pools[name];
+        getLock.unlock();
+        std::lock_guard<std::mutex> lock{lap.first};
+        ++lap.second;
+    }
+};
+
+// Each thread asks for a client and hands it back, over and over, like an Actor
+// acquiring clients at run time would.
+template <typename Acquire>
+int64_t timeAcquisitions(int threads, long iterations, Acquire&& acquire) {
+    boost::barrier ready{unsigned(threads) + 1};
+    std::atomic<long> acquired = 0;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i]() {
+            const auto name = "Pool" + std::to_string(i % kNames);
+            ready.wait();
+            long local = 0;
+            for (long j = 0; j < iterations; ++j) {
+                local += acquire(name) != nullptr;
+            }
+            acquired += local;
+        });
+    }
+    ready.wait();
+    const auto start = steady_clock::now();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const auto duration = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    REQUIRE(acquired == threads * iterations);
+    return duration;
+}
+
+}  // namespace
+
+
+TEST_CASE("PoolManager hands out clients to many threads at once", "[benchmark]") {
+    mongocxx::instance::current();
+    NodeSource ns{kClients, ""};
+    auto& config = ns.root();
+
+    for (int threads : {100, 1000, 4000}) {
+        const long iterations = 1000 * 1000 / threads;
+
+        v1::PoolManager manager{kUri, {}, config};
+        LockedLookup locks;
+
+        // Interleave the runs so CPU caches and frequency scaling affect both equally.
+        int64_t lockFree = 0;
+        int64_t locked = 0;
+        for (int run = 0; run < 3; ++run) {
+            lockFree += timeAcquisitions(threads, iterations, [&](const std::string& name) {
+                return manager.client(name, 0);
+            });
+            locked += timeAcquisitions(threads, iterations, [&](const std::string& name) {
+                locks.find(name);
+                return manager.client(name, 0);
+            });
+        }
+
+        const auto count = manager.instanceCount();
+        REQUIRE(count.size() == kNames);
+        for (const auto& [name, instances] : count) {
+            REQUIRE(instances == 16);
+        }
+
+        const auto perAcquisition = [&](int64_t total) {
+            return double(total) / (3 * threads * iterations);
+        };
+        BOOST_LOG_TRIVIAL(info) << "Client acquisitions with " << threads
+                                << " threads: " << perAcquisition(lockFree)
+                                << "ns each, or " << perAcquisition(locked)
+                                << "ns each with the old lookup's locks";
+    }
+}
+
+}  // namespace genny
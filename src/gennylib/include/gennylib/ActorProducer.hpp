@@ -67,13 +67,25 @@ private:
     std::string_view _name;
 };
 
-/** @private */
+/**
+ * Produces an Actor's `Threads:` one at a time.
+ *
+ * WorkloadContext may call produceInto() for different threads concurrently, rather
+ * than calling produce(), so it must be safe to.
+ *
+ * @private
+ */
 class ParallelizedActorProducer : public ActorProducer {
 public:
     using ActorProducer::ActorProducer;
 
     virtual void produceInto(ActorVector& out, ActorContext& context) = 0;
     ActorVector produce(ActorContext& context) override;
+
+    /**
+     * @return how many times produce() calls produceInto().
+     */
+    static int threads(ActorContext& context);
 };
 
 /** @private */
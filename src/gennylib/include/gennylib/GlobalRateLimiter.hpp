@@ -18,14 +18,83 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <thread>
 
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/LatencyController.hpp>
 
 namespace genny {
 
 using SteadyClock = std::chrono::steady_clock;
 
+namespace v1 {
+
+/**
+ * A burst size and the nanoseconds per burst, read and written as a pair so a consumer
+ * never charges the new burst size at the old rate or the reverse. A seqlock: changes
+ * are rare and reads, on every consumeIfWithinRate(), don't write.
+ */
+class PublishedRate {
+public:
+    struct Rate {
+        int64_t burstSize;
+        int64_t rateNS;
+    };
+
+    Rate load() const {
+        while (true) {
+            const auto version = _version.load(std::memory_order_acquire);
+            const Rate rate{_burstSize.load(std::memory_order_relaxed),
+                            _rateNS.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // An odd version means a store is in progress.
+            if (version % 2 == 0 && _version.load(std::memory_order_relaxed) == version) {
+                return rate;
+            }
+        }
+    }
+
+    void store(Rate rate) {
+        // Taking an even version to odd keeps out other stores.
+        auto version = _version.load(std::memory_order_relaxed);
+        while (version % 2 != 0 ||
+               !_version.compare_exchange_weak(version, version + 1, std::memory_order_acquire)) {
+            version = _version.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        _burstSize.store(rate.burstSize, std::memory_order_relaxed);
+        _rateNS.store(rate.rateNS, std::memory_order_relaxed);
+        _version.store(version + 2, std::memory_order_release);
+    }
+
+private:
+    std::atomic_uint64_t _version = 0;
+    std::atomic_int64_t _burstSize = 0;
+    std::atomic_int64_t _rateNS = 0;
+};
+
+/**
+ * The part of a GlobalRateLimiter that every consumer races on, and the rate it's charged
+ * at. Kept apart so worker processes can share one; see v1::ProcessGroup.
+ */
+struct TokenBucket {
+    // 64 is the cache line size for recent Intel and AMD processors.
+    static constexpr int kCacheLineSize = 64;
+
+    // Manually align lastEmptiedTimeNS and burstCount here to vastly improve performance.
+    // Lazily initialized by the first call to consumeIfWithinRate().
+    // Note that std::chrono::time_point is not trivially copyable and can't be used here.
+    alignas(kCacheLineSize) std::atomic_int64_t lastEmptiedTimeNS = 0;
+    // burstCount stores the remaining
+    alignas(kCacheLineSize) std::atomic_int64_t burstCount = 0;
+    // Read on every request but rarely changed, so kept off the lines above.
+    alignas(kCacheLineSize) PublishedRate rate;
+};
+
+}  // namespace v1
+
 /**
  * Rate limiter that applies globally across all threads using the token
  * bucket algorithm.
@@ -48,6 +117,14 @@ using SteadyClock = std::chrono::steady_clock;
  * (using this rate limiter) but a small burst size and a high frequency rate,
  * you may experience bad performance.
  *
+ * 3. A rate limiter is either charged one operation at a time (consumeIfWithinRate(now))
+ * or a number of tokens at a time (consumeIfWithinRate(now, tokens)), e.g. the bytes of
+ * a batch for a rate given in bytes. The two should not be mixed on one instance.
+ *
+ * 4. With a LatencyRateSpec the rate is not fixed: a v1::LatencyController observes
+ * an operation's latencies and periodically adjusts the rate to keep them on target.
+ * The caller must feed it observations; see latencyController().
+ *
  * Inspired by
  * https://github.com/facebook/folly/blob/7c6897aa18e71964e097fc238c93b3efa98b2c61/folly/TokenBucket.h
  */
@@ -68,14 +145,16 @@ public:
 public:
     explicit BaseGlobalRateLimiter(const RateSpec& rs) {
         if (auto spec = rs.getBaseSpec()) {
-            _burstSize = spec->operations;
-            _rateNS = spec->per.count();
+            _bucket->rate.store({spec->operations, spec->per.count()});
             _fullSpeed = false;
         } else if (auto spec = rs.getPercentileSpec()) {
-            _burstSize = 0;
-            _rateNS = 0;
+            _bucket->rate.store({0, 0});
             _percent = spec->percent;
             _fullSpeed = true;
+        } else if (auto spec = rs.getLatencySpec()) {
+            _controller = std::make_unique<v1::LatencyController>(*spec);
+            _bucket->rate.store({_controller->burstSize(), _controller->rateNS()});
+            _fullSpeed = false;
         }
     }
 
@@ -102,28 +181,36 @@ public:
             return *breakIn;
         }
 
+        if (_controller) {
+            if (auto newRate = _controller->maybeAdjust(now.time_since_epoch().count())) {
+                _bucket->rate.store({_controller->burstSize(), *newRate});
+            }
+        }
+        const auto [burstSize, rateNS] = _bucket->rate.load();
+
         // This if-block deviates from the "burst" behavior of the default token-bucket
         // algorithm. Instead of having the caller burst, we parallelize the burst
         // behavior by granting one token to each consumer thread across as many threads
-        // as possible, up to "_burstSize".
+        // as possible, up to "burstSize".
         //
         // This means we basically have two serial token bucket rate limiters. We first
-        // check the bucket for _burstCount, and proceeed if there are tokens available
+        // check the bucket for burstCount, and proceeed if there are tokens available
         // (i.e. canBurst is true). If not, we fallback to the token bucket for
-        // _lastEmptiedTimeNS and check if the emptied time is in the future.
-        if (_burstSize > 1) {
-            int64_t curBurstCount = _burstCount.load();
-            const bool canBurst = (curBurstCount % _burstSize) != 0;
+        // lastEmptiedTimeNS and check if the emptied time is in the future.
+        if (burstSize > 1) {
+            int64_t curBurstCount = _bucket->burstCount.load();
+            const bool canBurst = (curBurstCount % burstSize) != 0;
             if (canBurst) {
-                return _burstCount.compare_exchange_weak(curBurstCount, curBurstCount + 1);
+                return casSucceeded(
+                    _bucket->burstCount.compare_exchange_weak(curBurstCount, curBurstCount + 1));
             }
         }
 
         // The time the bucket was emptied before this consumeIfWithinRate() call.
-        int64_t curEmptiedTime = _lastEmptiedTimeNS.load();
+        int64_t curEmptiedTime = _bucket->lastEmptiedTimeNS.load();
 
         // The time the bucket was emptied after this consumeIfWithinRate() call.
-        const auto newEmptiedTime = curEmptiedTime + getRate();
+        const auto newEmptiedTime = curEmptiedTime + rateNS;
 
         // If the new emptied time is in the future, the bucket is empty. Return early.
         if (now.time_since_epoch().count() < newEmptiedTime) {
@@ -133,22 +220,102 @@ public:
         // Use the "weak" version for performance at the expense of false negatives (i.e.
         // `compare_exchange` not comparing equal when it should).
         const auto success =
-            _lastEmptiedTimeNS.compare_exchange_weak(curEmptiedTime, newEmptiedTime);
+            casSucceeded(_bucket->lastEmptiedTimeNS.compare_exchange_weak(curEmptiedTime,
+                                                                          newEmptiedTime));
 
 
-        // Note that incrementing _burstCount is *not* atomic with incrementing _lastEmptiedTimeNS.
-        // This may cause some threads to see an outdated _burstCount, causing unnecessary waiting
+        // Note that incrementing burstCount is *not* atomic with incrementing lastEmptiedTimeNS.
+        // This may cause some threads to see an outdated burstCount, causing unnecessary waiting
         // in the caller. For this reason, the caller should ensure the number of tokens does not
-        // greatly exceed _burstSize.
+        // greatly exceed the burst size.
         if (success) {
-            _burstCount++;
+            _bucket->burstCount++;
         }
         return success;
     }
 
+    /**
+     * Request to consume `tokens` tokens from the bucket, where the bucket refills at
+     * the burst size in tokens per rate in nanoseconds and holds at most a burst.
+     * Does not block.
+     *
+     * The request succeeds whenever the bucket isn't empty, even if it holds fewer than
+     * `tokens` tokens; the shortfall is paid back before the next request succeeds.
+     * This lets requests larger than the bucket (e.g. a big batch) through without
+     * changing the long-run rate.
+     *
+     * @return bool whether consume() succeeded. The caller is responsible for using an
+     * appropriate back-off strategy if this function returns false.
+     */
+    bool consumeIfWithinRate(const typename ClockT::time_point& now, int64_t tokens) {
+        const auto nowNS = now.time_since_epoch().count();
+        const auto [burstSize, rate] = _bucket->rate.load();
+
+        // lastEmptiedTimeNS is the time at which the bucket is exactly empty; if it's not
+        // in the past the bucket is empty or in debt.
+        int64_t curEmptiedTime = _bucket->lastEmptiedTimeNS.load();
+        if (nowNS <= curEmptiedTime) {
+            return false;
+        }
 
-    constexpr int64_t getRate() const {
-        return _rateNS;
+        // A bucket can't fill beyond a burst of tokens, i.e. rate worth of time.
+        const auto cost =
+            static_cast<int64_t>(double(tokens) * rate / std::max(burstSize, int64_t{1}));
+        const auto newEmptiedTime = std::max(curEmptiedTime, nowNS - rate) + cost;
+        return casSucceeded(
+            _bucket->lastEmptiedTimeNS.compare_exchange_weak(curEmptiedTime, newEmptiedTime));
+    }
+
+    int64_t getRate() const {
+        return _bucket->rate.load().rateNS;
+    }
+
+    /**
+     * Change to a fixed rate from now on, e.g. from `genny run --control-socket`.
+     * Consumers pick it up on their next request.
+     *
+     * @throws InvalidConfigurationException if the rate is a percentage or a latency
+     * target, which set their own.
+     */
+    void setRate(const BaseRateSpec& spec) {
+        if (_controller || _percent) {
+            throw InvalidConfigurationException(
+                "Can only change a GlobalRate given as operations per duration");
+        }
+        if (spec.operations <= 0 || spec.per.count() <= 0) {
+            throw InvalidConfigurationException("A GlobalRate must be positive");
+        }
+        _bucket->rate.store({spec.operations, spec.per.count()});
+    }
+
+    /**
+     * Consume from `bucket` instead of this limiter's own, so that limiters with the
+     * same name in different processes enforce one rate between them. The rate is shared
+     * too, so setRate() in any process changes it for all. Call during setup.
+     *
+     * @throws InvalidConfigurationException for a latency target, which each process
+     * would adjust from its own latencies, or a percentage, which each process would
+     * take of the throughput it measured itself.
+     */
+    void shareBucket(v1::TokenBucket& bucket) {
+        if (_controller) {
+            throw InvalidConfigurationException(
+                "A GlobalRate given as a latency target can't be shared between processes");
+        }
+        if (_percent) {
+            throw InvalidConfigurationException(
+                "A GlobalRate given as a percentage can't be shared between processes");
+        }
+        bucket.rate.store(_ownBucket.rate.load());
+        _bucket = &bucket;
+    }
+
+    /**
+     * @return the controller adjusting the rate if constructed with a LatencyRateSpec,
+     * nullptr otherwise. It must be given latency observations to have any effect.
+     */
+    v1::LatencyController* latencyController() const {
+        return _controller.get();
     }
 
     /**
@@ -156,7 +323,7 @@ public:
      * decide how congested the rate limiter is and find an appropriate time to wait until
      * retrying.
      *
-     * E.g. if there are X users, each caller on average gets called per (_rateNS * _numUsers).
+     * E.g. if there are X users, each caller on average gets called per (rate * _numUsers).
      * So it makes sense for each caller to wait for a duration of the same magnitude.
      * @return
      */
@@ -173,11 +340,28 @@ public:
     }
 
     /**
-     * The rate limiter should be reset to allow one thread to run _burstSize number of times before
+     * @return the number of times a token was available but another thread took it first
+     * (or compare_exchange_weak failed spuriously). Used to measure contention.
+     */
+    int64_t getCasFailures() const {
+        return _casFailures.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * The rate limiter should be reset to allow one thread to run a burst of times before
      * the start of each phase.
+     *
+     * @param resetBucket false to leave a shared bucket alone, because another process
+     * already reset it for this phase.
      */
-    void resetLastEmptied() noexcept {
-        _lastEmptiedTimeNS = ClockT::now().time_since_epoch().count() - _rateNS;
+    void resetLastEmptied(bool resetBucket = true) noexcept {
+        if (_controller) {
+            _controller->reset(ClockT::now().time_since_epoch().count());
+            _bucket->rate.store({_controller->burstSize(), _controller->rateNS()});
+        }
+        if (resetBucket) {
+            _bucket->lastEmptiedTimeNS = ClockT::now().time_since_epoch().count() - getRate();
+        }
         _iters = 0;
         if (_percent) {
             _fullSpeed = true;
@@ -196,7 +380,7 @@ public:
                 const auto rate = this->getRate() > 1e9 ? 1e9 : this->getRate();
 
                 // Add ±5% jitter to avoid threads waking up at once.
-                std::this_thread::sleep_for(std::chrono::nanoseconds(
+                v1::sleepFor(std::chrono::nanoseconds(
                     int64_t(rate * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))));
                 continue;
             }
@@ -205,9 +389,35 @@ public:
         this->notifyOfIteration();
     }
 
+    /**
+     * Blocking version of consumeIfWithinRate(now, tokens).
+     */
+    void simpleLimitRate(int64_t tokens) {
+        while (!this->consumeIfWithinRate(SteadyClock::now(), tokens)) {
+            // Sleep until the bucket is out of debt, but no more than 1 second for the
+            // same reason as above.
+            const auto now = SteadyClock::now().time_since_epoch().count();
+            const auto debt =
+                std::clamp<int64_t>(_bucket->lastEmptiedTimeNS.load() - now, 1, 1e9);
+
+            // Add ±5% jitter to avoid threads waking up at once.
+            v1::sleepFor(std::chrono::nanoseconds(
+                int64_t(debt * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))));
+        }
+        this->notifyOfIteration();
+    }
+
     const int64_t _nsPerMinute = 60000000000;
 
 private:
+    // Only touches _casFailures on failure so uncontended callers don't pay for it.
+    bool casSucceeded(bool success) {
+        if (!success) {
+            _casFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+        return success;
+    }
+
     /**
      * Logic for percentile rates. We "break in" the rate limiter for 1 minutes or 3 iterations,
      * whichever is longer, to determine the limit to set.
@@ -218,8 +428,9 @@ private:
             return std::nullopt;
         }
 
-        _burstCount++;
-        auto nsSincePhaseStarted = ClockT::now().time_since_epoch().count() - _lastEmptiedTimeNS;
+        _bucket->burstCount++;
+        auto nsSincePhaseStarted =
+            ClockT::now().time_since_epoch().count() - _bucket->lastEmptiedTimeNS;
 
         // 3 iterations or 1 minute, whichever is longer.
         if (_iters >= _numUsers * 3 && nsSincePhaseStarted >= _nsPerMinute) {
@@ -228,32 +439,30 @@ private:
                 return true;
             }
             // Reconfigure as a "normal" rate limiter running for the first time.
-            _burstSize = _burstCount * _percent.value() / 100;
-            _rateNS = nsSincePhaseStarted;
-            _lastEmptiedTimeNS = ClockT::now().time_since_epoch().count() - _rateNS;
-            _burstCount = 0;
+            _bucket->rate.store(
+                {_bucket->burstCount * _percent.value() / 100, nsSincePhaseStarted});
+            _bucket->lastEmptiedTimeNS =
+                ClockT::now().time_since_epoch().count() - nsSincePhaseStarted;
+            _bucket->burstCount = 0;
             _fullSpeed = false;
         }
         return true;
     }
 
 
-    // Manually align _lastEmptiedTimeNS and _burstCount here to vastly improve performance.
-    // Lazily initialized by the first call to consumeIfWithinRate().
-    // Note that std::chrono::time_point is not trivially copyable and can't be used here.
-    alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _lastEmptiedTimeNS = 0;
-    // _burstCount stores the remaining
-    alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _burstCount = 0;
+    // Its rate is stored with the burst size, as they're specified together in the YAML
+    // as RateSpec. setRate(), a LatencyController and percentile break-in change it while
+    // other threads consume.
+    v1::TokenBucket _ownBucket;
+    // _ownBucket, or one shared with other processes.
+    v1::TokenBucket* _bucket = &_ownBucket;
     // number of iterations this phase
     alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _iters = 0;
+    alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _casFailures = 0;
 
-    // Note that the rate limiter as-is doesn't use the burst size, but it is cleaner to
-    // store the burst size and the rate together, since they're specified together in
-    // the YAML as RateSpec.
-    int64_t _burstSize;
-    int64_t _rateNS;
     std::optional<int64_t> _percent;
     std::atomic<bool> _fullSpeed;
+    std::unique_ptr<v1::LatencyController> _controller;
 
     // Number of threads using this rate limiter.
     int64_t _numUsers = 0;
@@ -60,6 +60,14 @@ public:
      */
     NodeSource(std::string yaml, std::string path);
 
+    /**
+     * @param yaml
+     *   The full document, already loaded e.g. from a v1::WorkloadPlan.
+     * @param path
+     *   Path information. Used in error messages.
+     */
+    NodeSource(YAML::Node yaml, std::string path);
+
 private:
     const YAML::Node _yaml;
     const std::unique_ptr<class Node> _root;
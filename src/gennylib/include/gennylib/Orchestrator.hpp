@@ -15,16 +15,25 @@
 #ifndef HEADER_8615FA7A_9344_43E1_A102_889F47CCC1A6_INCLUDED
 #define HEADER_8615FA7A_9344_43E1_A102_889F47CCC1A6_INCLUDED
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
-#include <shared_mutex>
+#include <mutex>
+#include <optional>
 #include <vector>
 
+#include <boost/fiber/condition_variable.hpp>
+
 #include <gennylib/conventions.hpp>
 
 namespace genny {
 
+namespace v1 {
+class ProcessGroup;
+}  // namespace v1
+
 class Orchestrator;
 
 using OrchestratorCB = std::function<void(const Orchestrator*)>;
@@ -32,6 +41,16 @@ using OrchestratorCB = std::function<void(const Orchestrator*)>;
 /**
  * Responsible for the synchronization of actors
  * across a workload's lifecycle.
+ *
+ * Phase transitions are a barrier across every Actor thread, of which there can be
+ * tens of thousands. Arriving at the barrier is a single atomic add, and waiters park
+ * on a futex rather than a mutex, so the thread that completes a transition wakes
+ * everyone with one system call and they don't then queue up on a lock. Actors running
+ * on a v1::FiberPool park their fiber instead so the worker can run other Actors.
+ *
+ * With `genny run --processes`, the Orchestrators of every worker process share one
+ * barrier in a v1::ProcessGroup's shared memory, so a phase starts once the Actors of
+ * every process have arrived.
  */
 class Orchestrator {
 
@@ -40,13 +59,29 @@ public:
     // "Orchestrator Perf" benchmark where as low as 75% of `regIters` occur.
     explicit Orchestrator() {}
 
+    /**
+     * Synchronize with the Orchestrators of the group's other processes.
+     * Actors in a group can't run on a v1::FiberPool.
+     */
+    explicit Orchestrator(v1::ProcessGroup& group);
+
+    /**
+     * @return the group this is shared with, or nullptr if it isn't.
+     */
+    v1::ProcessGroup* processGroup() const {
+        return _group;
+    }
+
     /**
      * @return the current phase number
+     *
+     * This is lock-free: it's called on every iteration by Actors that don't block
+     * on their phase and by v1::Sleeper.
      */
     PhaseNumber currentPhase() const;
 
     /**
-     * @return if there are any more phases.
+     * @return if there are any more phases. Lock-free like currentPhase().
      */
     bool morePhases() const;
 
@@ -95,8 +130,34 @@ public:
 
     void abort();
 
+    /**
+     * Have every Actor finish the phase that's running as though its Repeat, Duration
+     * or EndWhen had been met. Actors that don't block the phase carry on until it ends,
+     * as they would have anyway. In a v1::ProcessGroup this ends it in every process.
+     *
+     * @return the phase being ended, or nullopt if none is running.
+     */
+    std::optional<PhaseNumber> endPhase();
+
+    /**
+     * @return whether endPhase() was called while `phase` ran. Lock-free like
+     * currentPhase(), since blocking Actors check it on every iteration.
+     */
+    bool phaseEndRequested(PhaseNumber phase) const {
+        return _barrier.endBefore.load(std::memory_order_relaxed) > phase;
+    }
+
     void addPrePhaseStartHook(const OrchestratorCB& f);
 
+    /**
+     * @return whether the pre-phase hooks running now are starting the phase, rather than
+     * catching up on a phase another process of the v1::ProcessGroup started. Hooks
+     * should only reset what the group shares when this is true. Only call from a hook.
+     */
+    bool startingPhase() const {
+        return _startingPhase;
+    }
+
     /**
      * @return whether the workload should continue running. This is true as long as
      * no calls to abort() have been made.
@@ -109,25 +170,106 @@ public:
      */
     void sleepToPhaseEnd(Duration timeout, const PhaseNumber pn);
 
+    /**
+     * @return the time between the first and the last call to awaitPhaseStart() for the
+     * most recently started phase. Valid once that phase has started.
+     */
+    Duration lastPhaseStartSkew() const;
+
+    /**
+     * @return the time between the first and the last blocking call to awaitPhaseEnd()
+     * for the most recently ended phase. Valid once that phase has ended.
+     */
+    Duration lastPhaseEndSkew() const;
+
 private:
-    mutable std::shared_mutex _mutex;
-    std::condition_variable_any _phaseChange;
+    friend class v1::ProcessGroup;
 
-    int _requireTokens = 0;
-    int _currentTokens = 0;
+    enum class State { PhaseEnded, PhaseStarted };
 
-    PhaseNumber _max = 0;
-    PhaseNumber _current = 0;
+    // The current phase number and its State, packed into one word so readers see
+    // a consistent pair with a single load.
+    static constexpr uint64_t pack(PhaseNumber phase, State state) {
+        return (uint64_t{phase} << 1) | (state == State::PhaseStarted ? 1 : 0);
+    }
+    static constexpr PhaseNumber phaseOf(uint64_t packed) {
+        return static_cast<PhaseNumber>(packed >> 1);
+    }
+    static constexpr State stateOf(uint64_t packed) {
+        return (packed & 1) ? State::PhaseStarted : State::PhaseEnded;
+    }
 
-    // Having this lets us avoid locking on _mutex for every call of
-    // continueRunning(). This gave two orders of magnitude speedup.
-    std::atomic_bool _errors = false;
+    // Everything the Actors synchronize on. It's all lock-free atomics so that a
+    // v1::ProcessGroup can put it in memory shared between processes.
+    struct Barrier {
+        std::atomic<int> requireTokens = 0;
 
-    enum class State { PhaseEnded, PhaseStarted };
+        // Every thread arriving at a barrier adds to or removes from this.
+        alignas(64) std::atomic<int> currentTokens = 0;
+        std::atomic<int64_t> firstArrivalNanos = 0;
+
+        // Writers claim a transition by moving claimedState, store phaseState, then
+        // bump epoch and wake waiters. Readers that don't wait just load; this keeps
+        // every iteration of every Actor from touching a lock.
+        alignas(64) std::atomic<uint64_t> phaseState = pack(0, State::PhaseEnded);
+        std::atomic<uint64_t> claimedState = pack(0, State::PhaseEnded);
+        std::atomic<PhaseNumber> max = 0;
+
+        // The futex word: bumped on every transition and on abort().
+        alignas(64) std::atomic<uint32_t> epoch = 0;
+
+        // Every phase before this one was ended by endPhase().
+        std::atomic<uint64_t> endBefore = 0;
+
+        std::atomic<int64_t> startSkewNanos = 0;
+        std::atomic<int64_t> endSkewNanos = 0;
+
+        // Having this lets us avoid locking on _mutex for every call of
+        // continueRunning(). This gave two orders of magnitude speedup.
+        std::atomic_bool errors = false;
+    };
+
+    // Record when the first thread arrived at the current barrier.
+    void noteArrival();
+    // @return the nanoseconds since the first arrival, and reset for the next barrier.
+    int64_t takeSkewNanos();
+    // Run the pre-phase hooks if they haven't been for the `started` phase, with
+    // startingPhase() as `starting`. Requires _mutex.
+    void runHooks(uint64_t started, bool starting);
+    // In a group, the process that starts a phase only runs its own hooks. The others
+    // run theirs when their Actors see it has started, before any of them carry on.
+    void catchUpHooks();
+    // Publish `newState` and wake every parked thread or fiber. Requires _mutex.
+    void publish(uint64_t newState);
+    // Park until the phase state is `target` or we've been aborted.
+    void awaitState(State target);
+    // Block while the epoch is still `seen`, for at most `timeout` if given.
+    void park(uint32_t seen, std::optional<std::chrono::nanoseconds> timeout = std::nullopt);
+
+    // Serializes transitions with each other and with setup calls. Never held while waiting.
+    std::mutex _mutex;
+
+    v1::ProcessGroup* const _group = nullptr;
+    Barrier _ownBarrier;
+    // _ownBarrier, or the group's.
+    Barrier& _barrier = _ownBarrier;
 
-    State state = State::PhaseEnded;
+    // Threads wait on _parked where futexes aren't available. Fibers wait on one of
+    // _fiberParked, chosen by their worker and by the epoch they're waiting to leave.
+    // A fiber holds a spinlock in the condition variable while it switches out, and
+    // notify_all() holds it while waking every waiter, so this keeps fibers from
+    // spinning on each other or on the wakeup from the previous transition.
+    static constexpr size_t kFiberParkShards = 8;
+    std::mutex _parkMutex;
+    std::condition_variable _parked;
+    std::array<std::array<boost::fibers::condition_variable_any, kFiberParkShards>, 2>
+        _fiberParked;
 
     std::vector<OrchestratorCB> _prePhaseHooks;
+    // The started phase whose hooks this process last ran.
+    std::atomic<uint64_t> _hooksRan = UINT64_MAX;
+    // Only read by the hooks, while runHooks() holds _mutex.
+    bool _startingPhase = false;
 };
 
 }  // namespace genny
@@ -15,11 +15,13 @@
 #ifndef HEADER_10276107_F885_4F2C_B99B_014AF3B4504A_INCLUDED
 #define HEADER_10276107_F885_4F2C_B99B_014AF3B4504A_INCLUDED
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <iterator>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
@@ -32,7 +34,12 @@
 #include <gennylib/InvalidConfigurationException.hpp>
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/context.hpp>
+#include <gennylib/v1/ActorStatus.hpp>
+#include <gennylib/v1/CoarseClock.hpp>
+#include <gennylib/v1/Profiler.hpp>
 #include <gennylib/v1/Sleeper.hpp>
+#include <gennylib/v1/SteadyStateDetector.hpp>
+#include <gennylib/v1/Tracer.hpp>
 
 /**
  * @file
@@ -51,7 +58,7 @@ namespace v1 {
  * Determine the conditions for continuing to iterate a given Phase.
  *
  * One of these is constructed for each `ActorPhase<T>` (below)
- * using a PhaseContext's `Repeat` and `Duration` keys. It is
+ * using a PhaseContext's `Repeat` and `Duration` keys, or its `EndWhen` key. It is
  * then passed to the downstream `ActorPhaseIterator` which
  * actually keeps track of the current state of the iteration in
  * `for(auto _ : phase)` loops. The `ActorPhaseIterator` keeps track
@@ -68,11 +75,18 @@ public:
                      bool isNop,
                      TimeSpec sleepBefore,
                      TimeSpec sleepAfter,
-                     std::optional<RateSpec> rateSpec)
+                     std::optional<RateSpec> rateSpec,
+                     SteadyStateDetector* steadyState = nullptr)
         : _minDuration{minDuration},
           // If it is a nop then should iterate 0 times.
           _minIterations{isNop ? IntegerSpec(0l) : minIterations},
-          _doesBlock{_minIterations || _minDuration} {
+          _steadyState{isNop ? nullptr : steadyState},
+          _doesBlock{_minIterations || _minDuration || _steadyState},
+          _coarseClock{minDuration || _steadyState ? &CoarseClock::get() : nullptr} {
+        if (_steadyState && (minDuration || minIterations)) {
+            throw InvalidConfigurationException(
+                "EndWhen must *not* be specified alongside either Duration or Repeat.");
+        }
         if (minDuration && minDuration->count() < 0) {
             std::stringstream str;
             str << "Need non-negative duration. Gave " << minDuration->count() << " milliseconds";
@@ -100,12 +114,13 @@ public:
                            phaseContext.isNop(),
                            phaseContext["SleepBefore"].maybe<TimeSpec>().value_or(TimeSpec{}),
                            phaseContext["SleepAfter"].maybe<TimeSpec>().value_or(TimeSpec{}),
-                           phaseContext["GlobalRate"].maybe<RateSpec>()) {
+                           phaseContext["GlobalRate"].maybe<RateSpec>(),
+                           steadyStateDetector(phaseContext)) {
         if (!phaseContext.isNop() && !phaseContext["Duration"] && !phaseContext["Repeat"] &&
-            phaseContext["Blocking"].maybe<std::string>() != "None") {
+            !phaseContext["EndWhen"] && phaseContext["Blocking"].maybe<std::string>() != "None") {
             std::stringstream msg;
             msg << "Must specify 'Blocking: None' for Actors in Phases that don't block "
-                   "completion with a Repeat or Duration value. In Phase "
+                   "completion with a Repeat, Duration, or EndWhen value. In Phase "
                 << phaseContext.path() << ". Gave";
             msg << " Duration:"
                 << phaseContext["Duration"].maybe<std::string>().value_or("undefined");
@@ -115,18 +130,19 @@ public:
             throw InvalidConfigurationException(msg.str());
         }
 
-        const auto rateSpec = phaseContext["GlobalRate"].maybe<RateSpec>();
-        const auto rateLimiterName =
-            phaseContext["RateLimiterName"].maybe<std::string>().value_or("defaultRateLimiter");
+        auto rateSpec = phaseContext["GlobalRate"].maybe<RateSpec>();
 
-        if (rateSpec) {
-            std::ostringstream defaultRLName;
-            defaultRLName << phaseContext.actor()["Name"] << phaseContext.getPhaseNumber();
-            const auto rateLimiterName =
-                phaseContext["RateLimiterName"].maybe<std::string>().value_or(defaultRLName.str());
+        // Byte rates are charged by the Actor; see PhaseContext::getByteRateLimiter().
+        if (rateSpec && !(rateSpec->getBaseSpec() && rateSpec->getBaseSpec()->bytes)) {
+            // Latency targets observe this Actor's operations unless told otherwise.
+            if (auto latencySpec = rateSpec->getLatencySpec();
+                latencySpec && latencySpec->actor.empty()) {
+                latencySpec->actor = phaseContext.actor()["Name"].to<std::string>();
+                rateSpec = RateSpec{*latencySpec};
+            }
 
-            _rateLimiter =
-                phaseContext.workload().getRateLimiter(rateLimiterName, rateSpec.value());
+            _rateLimiter = phaseContext.workload().getRateLimiter(phaseContext.rateLimiterName(),
+                                                                  rateSpec.value());
         }
     }
 
@@ -135,31 +151,54 @@ public:
                              Orchestrator& orchestrator,
                              const PhaseNumber inPhase) {
         if (_rateLimiter) {
-            while (true) {
-                const auto now = SteadyClock::now();
-                auto success = _rateLimiter->consumeIfWithinRate(now);
-                // If we don't block, we can trust the sleeper to check if the phase ended.
-                bool phaseStillGoing =
-                    !_doesBlock || !isDone(referenceStartingPoint, currentIteration, now);
-                if (!success && phaseStillGoing) {
-
-                    // Don't sleep for more than 1 second (1e9 nanoseconds). Otherwise rates
-                    // specified in seconds or lower resolution can cause the workloads to
-                    // run visibly longer than the specified duration.
-                    const auto rate = _rateLimiter->getRate() > 1e9 ? 1e9 : _rateLimiter->getRate();
-
-                    // Add ±5% jitter to avoid threads waking up at once.
-                    _sleeper->sleepFor(orchestrator,
-                                       inPhase,
-                                       std::chrono::nanoseconds(int64_t(
-                                           rate * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))),
-                                       !_doesBlock);
-                    continue;
+            awaitToken(*_rateLimiter, orchestrator, inPhase, [&](SteadyClock::time_point now) {
+                return isDone(referenceStartingPoint, currentIteration, now);
+            });
+        }
+    }
+
+    /**
+     * Take a token from `rateLimiter`, sleeping until one is free or, if the phase
+     * blocks, until `isDone(now)` or the phase is asked to end.
+     *
+     * @return whether a token was taken.
+     */
+    template <typename IsDone>
+    bool awaitToken(GlobalRateLimiter& rateLimiter,
+                    Orchestrator& orchestrator,
+                    const PhaseNumber inPhase,
+                    IsDone&& isDone) {
+        bool success;
+        while (true) {
+            const auto now = SteadyClock::now();
+            success = rateLimiter.consumeIfWithinRate(now);
+            // If we don't block, we can trust the sleeper to check if the phase ended.
+            bool phaseStillGoing =
+                !_doesBlock || (!isDone(now) && !orchestrator.phaseEndRequested(inPhase));
+            if (!success && phaseStillGoing) {
+
+                // Don't sleep for more than 1 second (1e9 nanoseconds). Otherwise rates
+                // specified in seconds or lower resolution can cause the workloads to
+                // run visibly longer than the specified duration.
+                const auto rate = rateLimiter.getRate() > 1e9 ? 1e9 : rateLimiter.getRate();
+
+                // Add ±5% jitter to avoid threads waking up at once.
+                const auto waitStartNS = v1::Tracer::enabled() ? v1::Tracer::nowNS() : 0;
+                _sleeper->sleepFor(orchestrator,
+                                   inPhase,
+                                   std::chrono::nanoseconds(
+                                       int64_t(rate * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))),
+                                   !_doesBlock);
+                if (waitStartNS != 0) {
+                    v1::Tracer::record(
+                        v1::Tracer::kRateLimitWait, waitStartNS, v1::Tracer::nowNS(), inPhase);
                 }
-                break;
+                continue;
             }
-            _rateLimiter->notifyOfIteration();
+            break;
         }
+        rateLimiter.notifyOfIteration();
+        return success;
     }
 
     constexpr SteadyClock::time_point computeReferenceStartingPoint() const {
@@ -170,12 +209,69 @@ public:
     constexpr bool isDone(SteadyClock::time_point startedAt,
                           int64_t currentIteration,
                           SteadyClock::time_point now) {
+        if (_steadyState) {
+            return _steadyState->isDone(now);
+        }
         return (!_minIterations || currentIteration >= (*_minIterations).value) &&
             (!_minDuration || (*_minDuration).value <= now - startedAt);
     }
 
+    /**
+     * Like isDone() above but reads the clock itself, and only if the Duration matters.
+     *
+     * Most iterations read the CoarseClock instead of the real clock. The real clock is
+     * still read once `currentIteration` reaches `nextRealClockIteration`, which is then
+     * moved kRealClockInterval iterations on. Comparing with a threshold rather than
+     * testing for a multiple of the interval keeps batches from stepping over it, so a Duration-bound phase never ends
+     * early and overruns its Duration by no more than the smaller of
+     * - CoarseClock::kResolution plus any delay in scheduling its ticker, and
+     * - the time taken by kRealClockInterval iterations.
+     *
+     * An `EndWhen` phase only needs the CoarseClock: its detector works in buckets
+     * far longer than a tick.
+     */
+    bool isDone(SteadyClock::time_point startedAt,
+                int64_t currentIteration,
+                int64_t& nextRealClockIteration) const {
+        if (_steadyState) {
+            return _steadyState->isDone(_coarseClock->now());
+        }
+        if (_minIterations && currentIteration < (*_minIterations).value) {
+            return false;
+        }
+        if (!_minDuration) {
+            return true;
+        }
+        // Also read the real clock as soon as the Repeat is met so a short Duration
+        // doesn't wait for the next tick.
+        const bool useRealClock = currentIteration >= nextRealClockIteration ||
+            (_minIterations && currentIteration == (*_minIterations).value);
+        if (useRealClock) {
+            nextRealClockIteration = currentIteration + kRealClockInterval;
+        }
+        const auto now = useRealClock ? SteadyClock::now() : _coarseClock->now();
+        return (*_minDuration).value <= now - startedAt;
+    }
+
+    /**
+     * @return how many iterations starting at `currentIteration` can run before the
+     * phase is checked again. That's `requested`, except the last batch before the
+     * Repeat count is met stops at it, and phases that sleep or are rate limited check
+     * every iteration since those apply per iteration.
+     */
+    int64_t batchSize(int64_t requested, int64_t currentIteration) const {
+        if (_rateLimiter || _sleeper->sleepsEachIteration()) {
+            return 1;
+        }
+        if (_minIterations && currentIteration < (*_minIterations).value) {
+            return std::min(requested, (*_minIterations).value - currentIteration);
+        }
+        return requested;
+    }
+
     constexpr bool operator==(const IterationChecker& other) const {
-        return _minDuration == other._minDuration && _minIterations == other._minIterations;
+        return _minDuration == other._minDuration && _minIterations == other._minIterations &&
+            _steadyState == other._steadyState;
     }
 
     constexpr bool doesBlockCompletion() const {
@@ -191,16 +287,41 @@ public:
     }
 
 private:
+    // The shared detector for this phase's `EndWhen: {SteadyState: ...}`, if any.
+    static SteadyStateDetector* steadyStateDetector(PhaseContext& phaseContext) {
+        const auto& endWhen = phaseContext["EndWhen"];
+        if (!endWhen || phaseContext.isNop()) {
+            return nullptr;
+        }
+        if (!endWhen["SteadyState"]) {
+            throw InvalidConfigurationException(
+                "EndWhen must specify a SteadyState. In Phase " + phaseContext.path());
+        }
+        auto spec = endWhen["SteadyState"].to<SteadyStateSpec>();
+        const auto actorName = phaseContext.actor()["Name"].to<std::string>();
+        if (spec.actor.empty()) {
+            spec.actor = actorName;
+        }
+        return phaseContext.workload().getSteadyStateDetector(
+            actorName, phaseContext.getPhaseNumber(), spec);
+    }
+
     // Debatable about whether this should also track the current iteration and
     // referenceStartingPoint time (versus having those in the ActorPhaseIterator). BUT: even the
     // .end() iterator needs an instance of this, so it's weird
 
+    static constexpr int64_t kRealClockInterval = 1024;
+
     const std::optional<TimeSpec> _minDuration;
     const std::optional<IntegerSpec> _minIterations;
+    // The detector is owned by the workload context.
+    SteadyStateDetector* const _steadyState;
 
     // The rate limiter is owned by the workload context.
     GlobalRateLimiter* _rateLimiter = nullptr;
     const bool _doesBlock;  // Computed/cached value. Computed at ctor time.
+    // Only set if there's a _minDuration or _steadyState.
+    const CoarseClock* _coarseClock;
     std::optional<v1::Sleeper> _sleeper;
 };
 
@@ -230,9 +351,18 @@ public:
                                                 : _iterationCheck->computeReferenceStartingPoint()},
           _inPhase{inPhase},
           _isEndIterator{isEndIterator},
-          _currentIteration{0} {
+          _currentIteration{0},
+          _nextRealClockIteration{0},
+          _status{isEndIterator || !v1::ActorStatus::enabled() ? nullptr
+                                                               : v1::ActorStatus::current()} {
         // iterationCheck should only be null if we're end() iterator.
         assert(isEndIterator == (iterationCheck == nullptr));
+        if (_status) {
+            _status->enterPhase(inPhase);
+        }
+        if (!isEndIterator && v1::Profiler::enabled()) {
+            v1::Profiler::setPhase(inPhase);
+        }
     }
 
     // iterator concept value-type
@@ -244,13 +374,30 @@ public:
     }
 
     constexpr ActorPhaseIterator& operator++() {
+        return this->advance(1);
+    }
+
+    /**
+     * Like operator++ but counts `iterations` iterations as done.
+     */
+    constexpr ActorPhaseIterator& advance(int64_t iterations) {
         if (_iterationCheck) {
             _iterationCheck->sleepAfter(*_orchestrator, _inPhase);
         }
-        ++_currentIteration;
+        _currentIteration += iterations;
+        if (_status) {
+            _status->setIterations(_currentIteration);
+        }
         return *this;
     }
 
+    /**
+     * @return how many iterations the batch starting at the current one should run.
+     */
+    int64_t batchSize(int64_t requested) const {
+        return _iterationCheck->batchSize(requested, _currentIteration);
+    }
+
     bool operator==(const ActorPhaseIterator& rhs) const {
         if (_iterationCheck) {
             _iterationCheck->sleepBefore(*_orchestrator, _inPhase);
@@ -267,7 +414,9 @@ public:
                      // if we block, then check to see if we're done in current phase
                      // else check to see if current phase has expired
                      (_iterationCheck->doesBlockCompletion()
-                            ? _iterationCheck->isDone(_referenceStartingPoint, _currentIteration, SteadyClock::now())
+                            ? _iterationCheck->isDone(_referenceStartingPoint, _currentIteration,
+                                                      _nextRealClockIteration)
+                                || _orchestrator->phaseEndRequested(_inPhase)
                             : _orchestrator->currentPhase() != _inPhase)))
 
                 // Below checks are mostly for pure correctness;
@@ -306,6 +455,10 @@ private:
     const PhaseNumber _inPhase;
     const bool _isEndIterator;
     int64_t _currentIteration;
+    // When IterationChecker::isDone() next reads the real clock rather than the coarse one.
+    mutable int64_t _nextRealClockIteration;
+    // Where to publish progress, if anywhere.
+    v1::ActorStatus* _status;
 
 public:
     // <iterator-concept>
@@ -318,6 +471,119 @@ public:
 };
 
 
+/**
+ * The iterations in one batch from `ActorPhase::batches()`.
+ *
+ * ```c++
+ * for (auto&& batch : config.batches(256)) {
+ *     for (auto _ : batch) {
+ *         counter++;
+ *     }
+ * }
+ * ```
+ */
+class IterationBatch final {
+public:
+    class Iterator final {
+    public:
+        explicit constexpr Iterator(int64_t remaining) : _remaining{remaining} {}
+
+        constexpr ActorPhaseIterator::Value operator*() const {
+            return {};
+        }
+
+        constexpr Iterator& operator++() {
+            --_remaining;
+            return *this;
+        }
+
+        constexpr bool operator!=(const Iterator& rhs) const {
+            return _remaining != rhs._remaining;
+        }
+
+    private:
+        int64_t _remaining;
+    };
+
+    explicit constexpr IterationBatch(int64_t size) : _size{size} {}
+
+    /**
+     * @return the number of iterations in the batch; always at least 1.
+     */
+    constexpr int64_t size() const {
+        return _size;
+    }
+
+    constexpr Iterator begin() const {
+        return Iterator{_size};
+    }
+
+    constexpr Iterator end() const {
+        return Iterator{0};
+    }
+
+private:
+    int64_t _size;
+};
+
+
+/**
+ * The iterator used in `for(auto&& batch : cfg.batches(n))`. It wraps the
+ * ActorPhaseIterator so the phase is checked once per batch rather than once
+ * per iteration.
+ */
+class ActorPhaseBatchIterator final {
+public:
+    ActorPhaseBatchIterator(ActorPhaseIterator iterator, int64_t batchSize)
+        : _iterator{std::move(iterator)}, _batchSize{batchSize} {}
+
+    IterationBatch operator*() const {
+        return IterationBatch{_iterator.batchSize(_batchSize)};
+    }
+
+    // A batch counts as run in full even if the Actor stopped iterating it early.
+    ActorPhaseBatchIterator& operator++() {
+        _iterator.advance(_iterator.batchSize(_batchSize));
+        return *this;
+    }
+
+    bool operator==(const ActorPhaseBatchIterator& rhs) const {
+        return _iterator == rhs._iterator;
+    }
+
+    bool operator!=(const ActorPhaseBatchIterator& rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    ActorPhaseIterator _iterator;
+    const int64_t _batchSize;
+};
+
+
+/**
+ * The range returned by `ActorPhase::batches()`.
+ */
+class ActorPhaseBatches final {
+public:
+    ActorPhaseBatches(ActorPhaseIterator begin, ActorPhaseIterator end, int64_t batchSize)
+        : _begin{std::move(begin)}, _end{std::move(end)}, _batchSize{batchSize} {}
+
+    ActorPhaseBatchIterator begin() const {
+        return ActorPhaseBatchIterator{_begin, _batchSize};
+    }
+
+    ActorPhaseBatchIterator end() const {
+        return ActorPhaseBatchIterator{_end, _batchSize};
+    }
+
+private:
+    const ActorPhaseIterator _begin;
+    const ActorPhaseIterator _end;
+    const int64_t _batchSize;
+};
+
+
 /**
  * Represents an Actor's configuration for a particular Phase.
  *
@@ -374,6 +640,32 @@ public:
         return ActorPhaseIterator{_orchestrator, nullptr, _currentPhase, true};
     };
 
+    /**
+     * Iterate in batches of up to `batchSize` iterations, for Actors whose operations
+     * are so cheap that the per-iteration checks would dominate.
+     *
+     * The phase is checked as usual before each batch but not within one, so a
+     * Duration or the end of a non-blocking phase is only noticed between batches.
+     * Batches never run past the Repeat count. Phases with SleepBefore, SleepAfter or
+     * a GlobalRate get batches of 1 iteration, since those apply to each iteration.
+     *
+     * ```c++
+     * for (auto&& config : _loop) {
+     *     for (auto&& batch : config.batches(256)) {
+     *         for (auto _ : batch) {
+     *             config->counter++;
+     *         }
+     *     }
+     * }
+     * ```
+     */
+    ActorPhaseBatches batches(int64_t batchSize) {
+        if (batchSize <= 0) {
+            BOOST_THROW_EXCEPTION(std::invalid_argument("Batches need at least one iteration"));
+        }
+        return ActorPhaseBatches{this->begin(), this->end(), batchSize};
+    }
+
     // Used by PhaseLoopIterator::doesBlockCompletion()
     constexpr bool doesBlock() const {
         return _iterationCheck->doesBlockCompletion();
@@ -433,6 +725,20 @@ public:
         return _currentPhase;
     }
 
+    /**
+     * Wait on a limiter of the Actor's own, e.g. a per-operation rate, the way the loop
+     * waits on the phase's GlobalRate: a blocking phase stops waiting once its end is
+     * requested. Call it before starting the operation's metrics so the wait isn't timed.
+     *
+     * @return false if the phase ended first, in which case skip the operation.
+     */
+    bool limitRate(GlobalRateLimiter& rateLimiter) {
+        return _iterationCheck->awaitToken(
+            rateLimiter, _orchestrator, _currentPhase, [](SteadyClock::time_point) {
+                return false;
+            });
+    }
+
 private:
     Orchestrator& _orchestrator;
     const PhaseNumber _currentPhase;
@@ -15,14 +15,17 @@
 #ifndef HEADER_0E802987_B910_4661_8FAB_8B952A1E453B_INCLUDED
 #define HEADER_0E802987_B910_4661_8FAB_8B952A1E453B_INCLUDED
 
+#include <atomic>
 #include <cassert>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
@@ -39,7 +42,9 @@
 #include <gennylib/Node.hpp>
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/Affinity.hpp>
 #include <gennylib/v1/PoolManager.hpp>
+#include <gennylib/v1/SteadyStateDetector.hpp>
 
 #include <metrics/metrics.hpp>
 
@@ -139,12 +144,17 @@ public:
      * @param mongoUri the base mongo URI to use @see PoolFactory
      * @param cast source of Actors to use. Actors are constructed
      * from the cast at construction-time.
+     * @param apmCallback called when a command starts on any connection
+     * @param setupThreads how many threads construct Actors. The threads of an Actor
+     * whose producer is a ParallelizedActorProducer, such as every DefaultActorProducer,
+     * are constructed in parallel. Other producers are run one at a time.
      */
     WorkloadContext(const Node& node,
                     Orchestrator& orchestrator,
                     const std::string& mongoUri,
                     const Cast& cast,
-                    v1::PoolManager::OnCommandStartCallback apmCallback = {});
+                    v1::PoolManager::OnCommandStartCallback apmCallback = {},
+                    size_t setupThreads = 1);
 
     // no copy or move
     WorkloadContext(WorkloadContext&) = delete;
@@ -153,18 +163,46 @@ public:
     void operator=(WorkloadContext&&) = delete;
 
     /**
-     * @return all the actors produced. This should only be called by workload drivers.
+     * @return all the actors produced. In a worker of a v1::ProcessGroup, only those it
+     * runs. This should only be called by workload drivers.
      */
     constexpr const ActorVector& actors() const {
         return _actors;
     }
 
+    /**
+     * @return the CPUs the thread running the Actor with this id should be restricted to,
+     * from its `Affinity:` or because `Metrics: {Affinity: ...}` reserved some for genny's
+     * own threads. Empty if it can run anywhere. This should only be called by workload
+     * drivers.
+     */
+    const v1::CpuSet& affinity(ActorId id) const {
+        const auto it = _affinities.find(id);
+        return it == _affinities.end() ? _unreservedCpus : it->second;
+    }
+
+    /**
+     * @return the `Name:` of the Actor with this id, which its metrics are reported under.
+     * This should only be called by workload drivers.
+     */
+    const std::string& actorName(ActorId id) const {
+        return _actorNames.at(id);
+    }
+
+    /**
+     * @return the CPUs `Metrics: {Affinity: ...}` didn't reserve, or empty if it's unset.
+     */
+    const v1::CpuSet& unreservedCpus() const {
+        return _unreservedCpus;
+    }
+
     /**
      * @return
      *   *the* DefaultRandom instance for the given `id`.
      *   Note that `DefaultRandom` is *not* thread-safe so two Actors
      *   should not use the same `DefaultRandom` at the same time.
      *   If you use `YourActorClass::id()` for `id` you'll be fine.
+     *   Its seed depends only on the `RandomSeed` and `id`.
      */
     DefaultRandom& getRNGForThread(ActorId id);
 
@@ -182,9 +220,21 @@ public:
      * @return The next sequential id
      */
     ActorId nextActorId() {
-        return _nextActorId++;
+        // An Actor constructed in parallel gets the id it would have had serially.
+        if (const auto reserved = std::exchange(_reservedActorId, 0)) {
+            return reserved;
+        }
+        return _constructingType ? this->_assignActorId(*_constructingType) : _nextActorId++;
     }
 
+    /**
+     * @return how many Actors of the same `Type:` come before the one with this id in
+     * the workload, counting from 0. Unlike a counter the Actors share, it doesn't
+     * depend on the order they're constructed in or on which worker of a
+     * v1::ProcessGroup constructs them. Only valid during setup.
+     */
+    size_t actorOrdinal(ActorId id);
+
     /**
      * Return a named connection pool instance.
      *
@@ -203,6 +253,14 @@ public:
      */
     mongocxx::pool::entry client(const std::string& name = "Default", size_t instance = 0);
 
+    /**
+     * @return how many clients Actors took while they were being constructed. Each
+     * holds its own connection to every server it uses.
+     */
+    size_t setupClients() const {
+        return _setupClients;
+    }
+
     /**
      * Get states that can be shared across actors using the same WorkloadContext.
      *
@@ -252,6 +310,33 @@ public:
      */
     GlobalRateLimiter* getRateLimiter(const std::string& name, const RateSpec& spec);
 
+    /**
+     * @return the rate limiter of this name, or nullptr if getRateLimiter() never created
+     * one. Unlike getRateLimiter(), this can be called once setup is done.
+     */
+    GlobalRateLimiter* findRateLimiter(const std::string& name) const {
+        const auto it = _rateLimiters.find(name);
+        return it == _rateLimiters.end() ? nullptr : it->second.get();
+    }
+
+    /**
+     * Access the detector that ends a phase with `EndWhen: {SteadyState: ...}`.
+     *
+     * It is called by PhaseLoop and, like getRateLimiter(), can only be called during setup.
+     * Every thread of an Actor shares the detector for a given phase. The detector is reset
+     * when that phase starts and reports its stable window to the Genny-internal
+     * `[actorName].SteadyStateWindow.[phase]` operation.
+     *
+     * @param actorName the Actor declaring the phase.
+     * @param phase the phase being ended.
+     * @param spec what to observe. Its actor must already be filled in.
+     *
+     * @private
+     */
+    v1::SteadyStateDetector* getSteadyStateDetector(const std::string& actorName,
+                                                    PhaseNumber phase,
+                                                    const SteadyStateSpec& spec);
+
     metrics::Registry& getMetrics() {
         return _registry;
     }
@@ -261,8 +346,15 @@ private:
     friend class PhaseContext;
 
     // helper methods used during construction
-    static ActorVector _constructActors(const Cast& cast,
-                                        const std::unique_ptr<ActorContext>& contexts);
+    static std::shared_ptr<ActorProducer> _producer(const Cast& cast,
+                                                    const std::unique_ptr<ActorContext>& context);
+
+    // @return each ActorContext's Actors, in order, with null for each Actor another
+    // worker of the process group runs.
+    std::vector<ActorVector> _constructActors(const Cast& cast, size_t setupThreads);
+
+    // Connect the clients of `Prewarm: true` pools and report how long it took.
+    void _prewarmClients(size_t threads);
 
     metrics::Registry _registry;
     Orchestrator* _orchestrator;
@@ -272,22 +364,49 @@ private:
     // we own the child ActorContexts
     std::vector<std::unique_ptr<ActorContext>> _actorContexts;
     ActorVector _actors;
+
+    std::unordered_map<ActorId, std::string> _actorNames;
+    // From each Actor's `Affinity:`, for those that have one.
+    std::unordered_map<ActorId, v1::CpuSet> _affinities;
+    v1::CpuSet _unreservedCpus;
     DefaultRandom _rng;
 
     // Indicate that we are doing building the context. This is used to gate certain methods that
     // should not be called after construction.
     bool _done = false;
 
-    // Actors should always be constructed in a single-threaded context.
-    // That said, atomic integral types are very cheap to work with.
+    // Actors may be constructed on several threads.
     //
     // We start at 1 because, if we send ID 0 to Poplar, the field
     // gets used as a monotonically-increasing value.
     std::atomic<ActorId> _nextActorId{1};
 
+    // Counted by client() until construction is done.
+    std::atomic<size_t> _setupClients{0};
+
+    // Set while a setup thread constructs an Actor whose id was reserved in advance.
+    static inline thread_local ActorId _reservedActorId = 0;
+    // The `Type:` of the Actors a setup thread is constructing, if known.
+    static inline thread_local const std::string* _constructingType = nullptr;
+
+    // Guards the registries below, which Actors fill in during setup.
+    std::mutex _setupMutex;
+
+    // Take the next id for an Actor of this `Type:` and note its actorOrdinal().
+    ActorId _assignActorId(const std::string& type);
+
+    // Each Actor's actorOrdinal(), by id. Ids are assigned in workload order.
+    std::vector<size_t> _actorOrdinals;
+    std::unordered_map<std::string, size_t> _actorsOfType;
+
+    // The seed of the DefaultRandom for each ActorId, drawn from _rng in id order.
+    std::vector<DefaultRandom::result_type> _rngSeeds;
     std::unordered_map<ActorId, DefaultRandom> _rngRegistry;
 
     std::unordered_map<std::string, std::unique_ptr<GlobalRateLimiter>> _rateLimiters;
+
+    std::map<std::pair<std::string, PhaseNumber>, std::unique_ptr<v1::SteadyStateDetector>>
+        _steadyStateDetectors;
 };
 
 // For some reason need to decl this; see impl below
@@ -328,6 +447,7 @@ public:
     ActorContext(const Node& node, WorkloadContext& workloadContext)
         : v1::HasNode{node}, _workload{&workloadContext}, _phaseContexts{} {
         _phaseContexts = constructPhaseContexts(_node, this);
+        addExclusionWindows();
     }
 
     // no copy or move
@@ -429,6 +549,9 @@ private:
 
     constructPhaseContexts(const Node&, ActorContext*);
 
+    // Flag metrics in each phase's `Warmup:` and `Cooldown:` windows.
+    void addExclusionWindows();
+
     WorkloadContext* _workload;
     std::unordered_map<PhaseNumber, std::unique_ptr<PhaseContext>> _phaseContexts;
 };
@@ -486,6 +609,33 @@ public:
         return SleepContext(_phaseNumber, this->actor().orchestrator());
     }
 
+    /**
+     * @return the name of the rate limiter used for this phase's `GlobalRate`: the
+     *   `RateLimiterName` if given, otherwise the Actor's name followed by the phase number.
+     */
+    std::string rateLimiterName() const;
+
+    /**
+     * Rate limiter for a `GlobalRate` given in bytes, e.g. `GlobalRate: 200 MB per 1 second`.
+     *
+     * PhaseLoop does not limit iterations by a byte rate. Actors that move data instead
+     * charge the returned limiter with the number of bytes they move,
+     * e.g. `limiter->simpleLimitRate(batchBytes)`.
+     *
+     * Like WorkloadContext::getRateLimiter(), this can only be called during setup. A
+     * byte `GlobalRate` for an Actor that doesn't call it is rejected once the Actors
+     * have been constructed.
+     *
+     * @return the limiter, or nullptr if this phase has no byte `GlobalRate`.
+     */
+    GlobalRateLimiter* getByteRateLimiter();
+
+    /**
+     * @throws InvalidConfigurationException if this phase has a byte `GlobalRate` but its
+     *   Actor never called getByteRateLimiter(), so nothing would enforce it.
+     */
+    void checkByteRateEnforced() const;
+
     /**
      * Convenience method for creating a metrics::Operation that's unique for this phase and thread.
      *
@@ -520,6 +670,8 @@ public:
 private:
     ActorContext* _actor;
     const PhaseNumber _phaseNumber;
+    // Set by getByteRateLimiter(), which the threads of one Actor call in parallel.
+    std::atomic_bool _byteRateLimited = false;
 };
 
 }  // namespace genny
@@ -15,10 +15,17 @@
 #ifndef HEADER_CC9B7EF0_9FB9_4AD4_B64C_DC7AE48F72A6_INCLUDED
 #define HEADER_CC9B7EF0_9FB9_4AD4_B64C_DC7AE48F72A6_INCLUDED
 
+#include <algorithm>
 #include <chrono>
 #include <climits>
 #include <cmath>
+#include <limits>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
 
 #include <mongocxx/read_concern.hpp>
 #include <mongocxx/read_preference.hpp>
@@ -115,22 +122,28 @@ inline bool operator==(const TimeSpec& lhs, const TimeSpec& rhs) {
 using Duration = typename TimeSpec::ValueT;
 
 /**
- * BaseRateSpec defined as X operations per Y duration.
+ * BaseRateSpec defined as X operations per Y duration, or X bytes per Y duration.
  */
 struct BaseRateSpec {
     BaseRateSpec() = default;
     ~BaseRateSpec() = default;
 
-    BaseRateSpec(TimeSpec t, IntegerSpec i) : per{t.count()}, operations{i.value} {}
+    BaseRateSpec(TimeSpec t, IntegerSpec i, bool bytes = false)
+        : per{t.count()}, operations{i.value}, bytes{bytes} {}
 
     // Allow construction with integers for testing.
-    BaseRateSpec(int64_t t, int64_t i) : per{t}, operations{i} {}
+    BaseRateSpec(int64_t t, int64_t i, bool bytes = false)
+        : per{t}, operations{i}, bytes{bytes} {}
     std::chrono::nanoseconds per;
     int64_t operations;
+
+    // If true, `operations` is a number of bytes. Byte rates don't limit iterations; Actors
+    // that move data charge them with the number of bytes moved.
+    bool bytes = false;
 };
 
 inline bool operator==(const BaseRateSpec& lhs, const BaseRateSpec& rhs) {
-    return (lhs.per == rhs.per) && (lhs.operations == rhs.operations);
+    return (lhs.per == rhs.per) && (lhs.operations == rhs.operations) && (lhs.bytes == rhs.bytes);
 }
 
 /**
@@ -152,7 +165,41 @@ inline bool operator==(const PercentileRateSpec& lhs, const PercentileRateSpec&
 }
 
 /**
- * RateSpec defined as either X operations per Y duration or Z% of max throughput each phase.
+ * LatencyRateSpec defines a closed-loop rate: starting from an initial rate, the rate is adjusted
+ * every interval so the given percentile of an operation's latency stays at or below the target.
+ */
+struct LatencyRateSpec {
+    LatencyRateSpec() = default;
+    ~LatencyRateSpec() = default;
+
+    LatencyRateSpec(double percentile, TimeSpec target, std::string operation)
+        : percentile{percentile}, target{target}, operation{std::move(operation)} {}
+
+    // The latency percentile to keep under the target, e.g. 99 for "p99".
+    double percentile = 99;
+    TimeSpec target;
+
+    // The operation whose latencies are observed. An empty actor means the Actor that
+    // declared the GlobalRate.
+    std::string operation;
+    std::string actor;
+
+    // How often the rate is re-evaluated.
+    TimeSpec interval{std::chrono::seconds{1}};
+
+    // The rate to start at; its operation count is also used as the burst size.
+    BaseRateSpec startingRate{std::chrono::nanoseconds{std::chrono::milliseconds{1}}.count(), 1};
+};
+
+inline bool operator==(const LatencyRateSpec& lhs, const LatencyRateSpec& rhs) {
+    return lhs.percentile == rhs.percentile && lhs.target == rhs.target &&
+        lhs.operation == rhs.operation && lhs.actor == rhs.actor &&
+        lhs.interval == rhs.interval && lhs.startingRate == rhs.startingRate;
+}
+
+/**
+ * RateSpec defined as either X operations per Y duration, Z% of max throughput each phase, or
+ * the highest rate that keeps an operation's latency under a target.
  */
 class RateSpec {
 public:
@@ -163,6 +210,8 @@ public:
 
     RateSpec(PercentileRateSpec s) : _spec{s} {}
 
+    RateSpec(LatencyRateSpec s) : _spec{std::move(s)} {}
+
     std::optional<BaseRateSpec> getBaseSpec() const {
         if (auto pval = std::get_if<BaseRateSpec>(&_spec)) {
             return *pval;
@@ -179,13 +228,21 @@ public:
         }
     }
 
+    std::optional<LatencyRateSpec> getLatencySpec() const {
+        if (auto pval = std::get_if<LatencyRateSpec>(&_spec)) {
+            return *pval;
+        } else {
+            return std::nullopt;
+        }
+    }
+
     bool operator==(const RateSpec& rhs) {
         // Equality is well-behaved for variants if it is for their contents.
         return _spec == rhs._spec;
     }
 
 private:
-    std::variant<std::monostate, BaseRateSpec, PercentileRateSpec> _spec;
+    std::variant<std::monostate, BaseRateSpec, PercentileRateSpec, LatencyRateSpec> _spec;
 };
 
 
@@ -218,6 +275,63 @@ struct PhaseRangeSpec {
     genny::PhaseNumber end;
 };
 
+/**
+ * SteadyStateSpec ends a phase once an operation's throughput or latency stops changing:
+ * once the coefficient of variation (standard deviation over mean) of its per-bucket values
+ * across a sliding window is at most `maxCoV`.
+ */
+struct SteadyStateSpec {
+    enum class Metric { kThroughput, kLatency };
+
+    // The operation that is observed. An empty actor means the Actor that declared the phase.
+    std::string operation;
+    std::string actor;
+
+    // Throughput is operations per second in each bucket; latency is their mean duration.
+    Metric metric = Metric::kThroughput;
+
+    // The window is split into this many buckets; the CoV is taken across the buckets.
+    TimeSpec window;
+    int64_t buckets = 10;
+    double maxCoV = 0;
+
+    // The phase runs for at least minDuration, which defaults to the window, and ends
+    // after maxDuration even if it never became steady.
+    std::optional<TimeSpec> minDuration;
+    TimeSpec maxDuration;
+};
+
+inline bool operator==(const SteadyStateSpec& lhs, const SteadyStateSpec& rhs) {
+    return lhs.operation == rhs.operation && lhs.actor == rhs.actor &&
+        lhs.metric == rhs.metric && lhs.window == rhs.window && lhs.buckets == rhs.buckets &&
+        lhs.maxCoV == rhs.maxCoV && lhs.minDuration == rhs.minDuration &&
+        lhs.maxDuration == rhs.maxDuration;
+}
+
+/**
+ * AffinitySpec says which CPUs an Actor's threads may run on.
+ */
+struct AffinitySpec {
+    enum class Policy {
+        // Any of `cpus`.
+        kCpus,
+        // One CPU each, alternating between NUMA nodes.
+        kSpread,
+        // One CPU each, filling one NUMA node before the next.
+        kCompact,
+        // Any CPU of `numaNode`.
+        kNumaNode,
+    };
+
+    Policy policy = Policy::kCpus;
+    std::vector<int> cpus;
+    int numaNode = 0;
+};
+
+inline bool operator==(const AffinitySpec& lhs, const AffinitySpec& rhs) {
+    return lhs.policy == rhs.policy && lhs.cpus == rhs.cpus && lhs.numaNode == rhs.numaNode;
+}
+
 }  // namespace genny
 
 namespace YAML {
@@ -442,15 +556,39 @@ struct convert<genny::PhaseRangeSpec> {
  *
  * The YAML syntax accepts [genny::Integer] per [genny::Time]
  * The syntax is interpreted as operations per unit of time.
+ *
+ * A byte unit may follow the integer, e.g. `200 MB per 1 second`, to give a number
+ * of bytes per unit of time. Accepted units are B, KB, MB, GB (powers of 1000) and
+ * KiB, MiB, GiB (powers of 1024).
  */
 template <>
 struct convert<genny::BaseRateSpec> {
     static Node encode(const genny::BaseRateSpec& rhs) {
         std::stringstream msg;
-        msg << rhs.operations << " per " << rhs.per.count() << " nanoseconds";
+        msg << rhs.operations << (rhs.bytes ? " B" : "") << " per " << rhs.per.count()
+            << " nanoseconds";
         return Node{msg.str()};
     }
 
+    static std::optional<int64_t> bytesPerUnit(const std::string& unit) {
+        if (unit == "B") {
+            return 1;
+        } else if (unit == "KB") {
+            return 1000;
+        } else if (unit == "MB") {
+            return 1000 * 1000;
+        } else if (unit == "GB") {
+            return 1000 * 1000 * 1000;
+        } else if (unit == "KiB") {
+            return 1024;
+        } else if (unit == "MiB") {
+            return 1024 * 1024;
+        } else if (unit == "GiB") {
+            return 1024 * 1024 * 1024;
+        }
+        return std::nullopt;
+    }
+
     static bool decode(const Node& node, genny::BaseRateSpec& rhs) {
         if (node.IsSequence() || node.IsMap()) {
             return false;
@@ -470,13 +608,40 @@ struct convert<genny::BaseRateSpec> {
             throw genny::InvalidConfigurationException(msg.str());
         }
 
-        auto opCountYaml = Load(strRepr.substr(0, spacePos));
+        auto opCountStr = strRepr.substr(0, spacePos);
+        std::optional<int64_t> bytesPerUnit;
+        if (auto unitPos = opCountStr.find(' '); unitPos != std::string::npos) {
+            const auto unit = opCountStr.substr(unitPos + 1);
+            bytesPerUnit = convert::bytesPerUnit(unit);
+            if (!bytesPerUnit) {
+                std::stringstream msg;
+                msg << "Invalid byte unit for genny::BaseRateSpec field, expected one of B, KB, "
+                       "MB, GB, KiB, MiB, or GiB. Saw: "
+                    << unit;
+                throw genny::InvalidConfigurationException(msg.str());
+            }
+            opCountStr = opCountStr.substr(0, unitPos);
+        }
+
+        auto opCountYaml = Load(opCountStr);
         auto opCount = opCountYaml.as<genny::IntegerSpec>();
 
         auto timeUnitYaml = Load(strRepr.substr(spacePos + delimiter.size()));
         auto timeUnit = timeUnitYaml.as<genny::TimeSpec>();
 
-        rhs = genny::BaseRateSpec(timeUnit, opCount);
+        if (bytesPerUnit) {
+            // IntegerSpec is never negative.
+            if (opCount.value > std::numeric_limits<int64_t>::max() / *bytesPerUnit) {
+                std::stringstream msg;
+                msg << "Byte count for genny::BaseRateSpec field doesn't fit in 64 bits. Saw: "
+                    << strRepr;
+                throw genny::InvalidConfigurationException(msg.str());
+            }
+            rhs = genny::BaseRateSpec(
+                timeUnit, genny::IntegerSpec{opCount.value * *bytesPerUnit}, true);
+        } else {
+            rhs = genny::BaseRateSpec(timeUnit, opCount);
+        }
 
         return true;
     }
@@ -532,14 +697,294 @@ struct convert<genny::PercentileRateSpec> {
     }
 };
 
+/**
+ * Convert between YAML and genny::LatencyRateSpec
+ *
+ * The YAML syntax is a map:
+ *
+ * ```yaml
+ * TargetLatency: {p99: 5 milliseconds}  # required, percentile key of the form p[Number]
+ * Operation: Insert                     # required, operation whose latency is observed
+ * Actor: Inserter                       # optional, defaults to the declaring Actor
+ * StartingRate: 100 per 1 second        # optional, defaults to 1 per 1 millisecond
+ * Interval: 1 second                    # optional, defaults to 1 second
+ * ```
+ */
+template <>
+struct convert<genny::LatencyRateSpec> {
+    static Node encode(const genny::LatencyRateSpec& rhs) {
+        Node node;
+        std::stringstream percentile;
+        percentile << "p" << rhs.percentile;
+        node["TargetLatency"][percentile.str()] = rhs.target;
+        node["Operation"] = rhs.operation;
+        if (!rhs.actor.empty()) {
+            node["Actor"] = rhs.actor;
+        }
+        node["StartingRate"] = rhs.startingRate;
+        node["Interval"] = rhs.interval;
+        return node;
+    }
+
+    static bool decode(const Node& node, genny::LatencyRateSpec& rhs) {
+        if (!node.IsMap() || !node["TargetLatency"]) {
+            return false;
+        }
+
+        const auto target = node["TargetLatency"];
+        if (!target.IsMap() || target.size() != 1) {
+            throw genny::InvalidConfigurationException(
+                "Invalid value for TargetLatency, expected a single percentile such as "
+                "'{p99: 5 milliseconds}'.");
+        }
+        const auto key = target.begin()->first.as<std::string>();
+        double percentile = -1;
+        if (key.size() > 1 && key[0] == 'p') {
+            std::istringstream in{key.substr(1)};
+            in >> percentile;
+            if (in.fail() || !in.eof()) {
+                percentile = -1;
+            }
+        }
+        if (percentile <= 0 || percentile >= 100) {
+            std::stringstream msg;
+            msg << "Invalid percentile for TargetLatency, expected p[Number] with the number "
+                   "between 0 and 100, exclusive. Saw: "
+                << key;
+            throw genny::InvalidConfigurationException(msg.str());
+        }
+
+        if (!node["Operation"]) {
+            throw genny::InvalidConfigurationException(
+                "A TargetLatency GlobalRate must name the Operation whose latency is observed.");
+        }
+
+        rhs = genny::LatencyRateSpec(percentile,
+                                     target.begin()->second.as<genny::TimeSpec>(),
+                                     node["Operation"].as<std::string>());
+        if (node["Actor"]) {
+            rhs.actor = node["Actor"].as<std::string>();
+        }
+        if (node["StartingRate"]) {
+            rhs.startingRate = node["StartingRate"].as<genny::BaseRateSpec>();
+        }
+        if (node["Interval"]) {
+            rhs.interval = node["Interval"].as<genny::TimeSpec>();
+        }
+        if (rhs.target.count() <= 0 || rhs.interval.count() <= 0 ||
+            rhs.startingRate.operations <= 0 || rhs.startingRate.per.count() <= 0) {
+            throw genny::InvalidConfigurationException(
+                "TargetLatency, Interval, and StartingRate must be positive.");
+        }
+        return true;
+    }
+};
+
+/**
+ * Convert between YAML and genny::SteadyStateSpec
+ *
+ * The YAML syntax is a map, given under a phase's `EndWhen: {SteadyState: ...}`:
+ *
+ * ```yaml
+ * Operation: Insert          # required, operation that is observed
+ * Actor: Inserter            # optional, defaults to the declaring Actor
+ * Metric: Throughput         # optional, Throughput or Latency, defaults to Throughput
+ * Window: 30 seconds         # required, how long the operation must be steady
+ * Buckets: 10                # optional, defaults to 10
+ * MaxCoV: 0.05               # required, largest coefficient of variation that counts as steady
+ * MinDuration: 2 minutes     # optional, defaults to the Window
+ * MaxDuration: 20 minutes    # required, end the phase here even if it never became steady
+ * ```
+ */
+template <>
+struct convert<genny::SteadyStateSpec> {
+    static Node encode(const genny::SteadyStateSpec& rhs) {
+        Node node;
+        node["Operation"] = rhs.operation;
+        if (!rhs.actor.empty()) {
+            node["Actor"] = rhs.actor;
+        }
+        node["Metric"] =
+            rhs.metric == genny::SteadyStateSpec::Metric::kLatency ? "Latency" : "Throughput";
+        node["Window"] = rhs.window;
+        node["Buckets"] = rhs.buckets;
+        node["MaxCoV"] = rhs.maxCoV;
+        if (rhs.minDuration) {
+            node["MinDuration"] = *rhs.minDuration;
+        }
+        node["MaxDuration"] = rhs.maxDuration;
+        return node;
+    }
+
+    static bool decode(const Node& node, genny::SteadyStateSpec& rhs) {
+        if (!node.IsMap()) {
+            return false;
+        }
+        for (auto&& key : {"Operation", "Window", "MaxCoV", "MaxDuration"}) {
+            if (!node[key]) {
+                std::stringstream msg;
+                msg << "SteadyState must specify " << key << ".";
+                throw genny::InvalidConfigurationException(msg.str());
+            }
+        }
+
+        rhs = genny::SteadyStateSpec{};
+        rhs.operation = node["Operation"].as<std::string>();
+        if (node["Actor"]) {
+            rhs.actor = node["Actor"].as<std::string>();
+        }
+        if (node["Metric"]) {
+            const auto metric = node["Metric"].as<std::string>();
+            if (metric == "Throughput") {
+                rhs.metric = genny::SteadyStateSpec::Metric::kThroughput;
+            } else if (metric == "Latency") {
+                rhs.metric = genny::SteadyStateSpec::Metric::kLatency;
+            } else {
+                throw genny::InvalidConfigurationException(
+                    "Invalid SteadyState Metric, expected Throughput or Latency. Saw: " + metric);
+            }
+        }
+        rhs.window = node["Window"].as<genny::TimeSpec>();
+        if (node["Buckets"]) {
+            rhs.buckets = node["Buckets"].as<genny::IntegerSpec>().value;
+        }
+        rhs.maxCoV = node["MaxCoV"].as<double>();
+        if (node["MinDuration"]) {
+            rhs.minDuration = node["MinDuration"].as<genny::TimeSpec>();
+        }
+        rhs.maxDuration = node["MaxDuration"].as<genny::TimeSpec>();
+
+        if (rhs.window.count() <= 0 || rhs.maxDuration.count() <= 0 || !(rhs.maxCoV > 0)) {
+            throw genny::InvalidConfigurationException(
+                "SteadyState Window, MaxCoV, and MaxDuration must be positive.");
+        }
+        if (rhs.buckets < 2 || rhs.window.count() / rhs.buckets <= 0) {
+            throw genny::InvalidConfigurationException(
+                "SteadyState needs at least 2 Buckets, each at least a nanosecond long.");
+        }
+        if (rhs.minDuration && rhs.minDuration->count() > rhs.maxDuration.count()) {
+            throw genny::InvalidConfigurationException(
+                "SteadyState MinDuration must not be longer than MaxDuration.");
+        }
+        return true;
+    }
+};
+
+/**
+ * Convert between YAML and genny::AffinitySpec
+ *
+ * Accepts a list of CPUs, a Linux-style CPU list string, `spread`, `compact`, or a
+ * NUMA node:
+ *
+ * ```yaml
+ * Affinity: [0, 1, 2, 3]
+ * Affinity: 0-3,8-11
+ * Affinity: spread
+ * Affinity: {NumaNode: 1}
+ * ```
+ */
+template <>
+struct convert<genny::AffinitySpec> {
+    using Policy = genny::AffinitySpec::Policy;
+
+    static Node encode(const genny::AffinitySpec& rhs) {
+        Node node;
+        switch (rhs.policy) {
+            case Policy::kCpus:
+                for (auto cpu : rhs.cpus) {
+                    node.push_back(cpu);
+                }
+                break;
+            case Policy::kSpread:
+                node = "spread";
+                break;
+            case Policy::kCompact:
+                node = "compact";
+                break;
+            case Policy::kNumaNode:
+                node["NumaNode"] = rhs.numaNode;
+                break;
+        }
+        return node;
+    }
+
+    static bool decode(const Node& node, genny::AffinitySpec& rhs) {
+        rhs = genny::AffinitySpec{};
+        if (node.IsMap()) {
+            if (!node["NumaNode"] || node.size() != 1) {
+                throw genny::InvalidConfigurationException(
+                    "Affinity must be a CPU list, spread, compact, or {NumaNode: N}.");
+            }
+            rhs.policy = Policy::kNumaNode;
+            rhs.numaNode = node["NumaNode"].as<int>();
+            if (rhs.numaNode < 0) {
+                throw genny::InvalidConfigurationException("Affinity NumaNode can't be negative.");
+            }
+            return true;
+        }
+        if (node.IsSequence()) {
+            for (auto&& cpu : node) {
+                rhs.cpus.push_back(cpu.as<int>());
+            }
+        } else {
+            const auto str = node.as<std::string>();
+            if (str == "spread") {
+                rhs.policy = Policy::kSpread;
+                return true;
+            }
+            if (str == "compact") {
+                rhs.policy = Policy::kCompact;
+                return true;
+            }
+            rhs.cpus = parseCpuList(str);
+        }
+        if (rhs.cpus.empty() ||
+            std::any_of(rhs.cpus.begin(), rhs.cpus.end(), [](int cpu) { return cpu < 0; })) {
+            throw genny::InvalidConfigurationException(
+                "Affinity CPUs must be a non-empty list of CPU numbers.");
+        }
+        std::sort(rhs.cpus.begin(), rhs.cpus.end());
+        rhs.cpus.erase(std::unique(rhs.cpus.begin(), rhs.cpus.end()), rhs.cpus.end());
+        return true;
+    }
+
+    // Parse "0-3,8" as in /sys/devices/system/node/node0/cpulist.
+    static std::vector<int> parseCpuList(const std::string& str) {
+        std::vector<int> cpus;
+        std::stringstream ranges{str};
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            try {
+                size_t end;
+                const auto first = std::stoi(range, &end);
+                auto last = first;
+                if (end < range.size() && range[end] == '-') {
+                    const auto rest = range.substr(end + 1);
+                    last = std::stoi(rest, &end);
+                    end += range.size() - rest.size();
+                }
+                if (range.find_first_not_of(" ", end) != std::string::npos || last < first) {
+                    throw std::invalid_argument{range};
+                }
+                for (auto cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            } catch (const std::logic_error&) {
+                throw genny::InvalidConfigurationException("Invalid Affinity CPU list: " + str);
+            }
+        }
+        return cpus;
+    }
+};
+
 /**
  * Convert between YAML and genny::RateSpec
  *
- * The YAML syntax accepts either [genny::Integer] per [genny::Time]
- * or [genny::Integer]%
+ * The YAML syntax accepts either [genny::Integer] per [genny::Time],
+ * [genny::Integer]%, or a genny::LatencyRateSpec map.
  *
- * The syntax is interpreted as operations per unit of time or
- * percentage of max throughput.
+ * The syntax is interpreted as operations per unit of time,
+ * percentage of max throughput, or the highest rate meeting a latency target.
  */
 template <>
 struct convert<genny::RateSpec> {
@@ -547,9 +992,11 @@ struct convert<genny::RateSpec> {
         std::stringstream msg;
 
         if (auto spec = rhs.getBaseSpec()) {
-            msg << spec->operations << " per " << spec->per.count() << " nanoseconds";
+            return Node{*spec};
         } else if (auto spec = rhs.getPercentileSpec()) {
             msg << spec->percent << "%";
+        } else if (auto spec = rhs.getLatencySpec()) {
+            return Node{*spec};
         } else {
             throw genny::InvalidConfigurationException("Cannot encode empty RateSpec.");
         }
@@ -558,6 +1005,10 @@ struct convert<genny::RateSpec> {
     }
 
     static bool decode(const Node& node, genny::RateSpec& rhs) {
+        if (node.IsMap() && node["TargetLatency"]) {
+            rhs = genny::RateSpec(node.as<genny::LatencyRateSpec>());
+            return true;
+        }
         if (node.IsSequence() || node.IsMap()) {
             return false;
         }
@@ -0,0 +1,119 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_924AB2A4_D8F4_42CB_91D9_A4CD1AA72189_INCLUDED
+#define HEADER_924AB2A4_D8F4_42CB_91D9_A4CD1AA72189_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <gennylib/conventions.hpp>
+
+namespace genny::v1 {
+
+/**
+ * What one Actor is doing right now, for the `status` command of `genny run
+ * --control-socket`.
+ *
+ * The Actor's thread, or fiber when run on a v1::FiberPool, is attached to its status
+ * with setCurrent(). From then on its ActorPhaseIterators publish the phase and the
+ * iterations done in it, and metrics publish the operation it last started. Each is
+ * a relaxed store that only the Actor makes, so a reader may see them a little stale
+ * and not all from the same moment.
+ *
+ * When no status is being kept, each instrumented operation costs a relaxed load and
+ * a branch that's never taken.
+ */
+class ActorStatus {
+public:
+    static constexpr PhaseNumber kNoPhase = UINT32_MAX;
+
+    ActorStatus() = default;
+
+    ActorStatus(const ActorStatus&) = delete;
+    ActorStatus& operator=(const ActorStatus&) = delete;
+
+    /**
+     * @return whether any Actor is publishing its status.
+     */
+    static bool enabled() noexcept {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Start publishing. Call before any Actor starts.
+     */
+    static void enable();
+
+    /**
+     * @return the status of the Actor the calling thread or fiber runs, or nullptr.
+     */
+    static ActorStatus* current();
+
+    /**
+     * Publish what the calling thread or fiber does to `status` from now on.
+     *
+     * @param status not owned; must outlive the Actor's run.
+     */
+    static void setCurrent(ActorStatus* status);
+
+    void enterPhase(PhaseNumber phase) noexcept {
+        _iterations.store(0, std::memory_order_relaxed);
+        _phase.store(phase, std::memory_order_relaxed);
+    }
+
+    void setIterations(int64_t iterations) noexcept {
+        _iterations.store(iterations, std::memory_order_relaxed);
+    }
+
+    /**
+     * @param operation the name of a metrics operation; operations outlive the run.
+     */
+    void setOperation(const std::string* operation) noexcept {
+        _operation.store(operation, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the phase the Actor last started iterating, or kNoPhase.
+     */
+    PhaseNumber phase() const noexcept {
+        return _phase.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the iterations done in that phase.
+     */
+    int64_t iterations() const noexcept {
+        return _iterations.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the name of the operation the Actor last started, or nullptr.
+     */
+    const std::string* operation() const noexcept {
+        return _operation.load(std::memory_order_relaxed);
+    }
+
+private:
+    static inline std::atomic_bool _enabled = false;
+
+    std::atomic<PhaseNumber> _phase = kNoPhase;
+    std::atomic<int64_t> _iterations = 0;
+    std::atomic<const std::string*> _operation = nullptr;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_924AB2A4_D8F4_42CB_91D9_A4CD1AA72189_INCLUDED
@@ -0,0 +1,114 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_B43E0A57_91C2_4D6F_8E1A_5F3C7D20B8E4_INCLUDED
+#define HEADER_B43E0A57_91C2_4D6F_8E1A_5F3C7D20B8E4_INCLUDED
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include <gennylib/conventions.hpp>
+
+namespace genny::v1 {
+
+// CPU numbers as the OS numbers them, in ascending order.
+using CpuSet = std::vector<int>;
+
+/**
+ * The CPUs this process may run on, grouped by NUMA node.
+ */
+class CpuTopology {
+public:
+    /**
+     * @param nodes the CPUs of each NUMA node, indexed by node number.
+     */
+    explicit CpuTopology(std::vector<CpuSet> nodes);
+
+    /**
+     * @return the machine's NUMA nodes, less any CPUs the process isn't allowed to use.
+     * Machines without NUMA information are one node.
+     */
+    static CpuTopology current();
+
+    const std::vector<CpuSet>& nodes() const {
+        return _nodes;
+    }
+
+    CpuSet allCpus() const;
+
+private:
+    std::vector<CpuSet> _nodes;
+};
+
+/**
+ * Decides which CPUs each Actor thread runs on from its `Affinity:`.
+ *
+ * CPUs can be reserved for genny's own threads, such as the metrics drain, with
+ * `Metrics: {Affinity: ...}`. Actors without an `Affinity:` are then kept off them,
+ * and `spread` and `compact` don't hand them out.
+ */
+class AffinityAssigner {
+public:
+    AffinityAssigner(CpuTopology topology, CpuSet reserved = {});
+
+    /**
+     * @param spec the Actor's `Affinity:`, if it has one.
+     * @return the CPUs for the Actor's next thread. Empty if it can run anywhere.
+     * @throws InvalidConfigurationException if `spec` names CPUs or a node this
+     * process can't use.
+     */
+    CpuSet next(const std::optional<AffinitySpec>& spec);
+
+    /**
+     * @return the CPUs a list or NUMA node spec names.
+     * @throws InvalidConfigurationException for `spread` and `compact` or if `spec`
+     * names CPUs or a node this process can't use.
+     */
+    CpuSet cpus(const AffinitySpec& spec) const;
+
+    /**
+     * @return the CPUs that aren't reserved, or empty if none are reserved.
+     */
+    const CpuSet& unreserved() const {
+        return _unreserved;
+    }
+
+private:
+    const CpuTopology _topology;
+    const bool _anyReserved;
+    CpuSet _unreserved;
+
+    // Unreserved CPUs in the order each policy hands them out.
+    CpuSet _spread;
+    CpuSet _compact;
+    size_t _nextSpread = 0;
+    size_t _nextCompact = 0;
+};
+
+/**
+ * Restrict the calling thread to `cpus`. Threads it starts afterwards inherit this.
+ *
+ * @return whether it worked. Only supported on Linux.
+ */
+bool setThreadAffinity(const CpuSet& cpus);
+
+/**
+ * @return the CPUs the calling thread may run on, or empty if unknown.
+ */
+CpuSet threadAffinity();
+
+}  // namespace genny::v1
+
+#endif  // HEADER_B43E0A57_91C2_4D6F_8E1A_5F3C7D20B8E4_INCLUDED
@@ -0,0 +1,116 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_5D0B8F3E_6E2A_4C1B_9F4D_2A7C3E8B1D60_INCLUDED
+#define HEADER_5D0B8F3E_6E2A_4C1B_9F4D_2A7C3E8B1D60_INCLUDED
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Weighted sampling of indices in O(1) per sample using Vose's alias method.
+ *
+ * Construction is O(n). Each sample draws one bucket uniformly and then either
+ * keeps it or takes its alias, so the cost doesn't depend on the number or
+ * skew of the weights.
+ *
+ * ```c++
+ * AliasTable table{{90, 10}};
+ * auto index = table.sample(rng);  // 0 about 90% of the time
+ * ```
+ */
+class AliasTable {
+public:
+    /**
+     * @param weights relative weights. Must be finite and non-negative with a positive sum.
+     * @throws std::invalid_argument if the weights are invalid.
+     */
+    explicit AliasTable(const std::vector<double>& weights)
+        : _probability(weights.size()), _alias(weights.size()) {
+        double sum = 0;
+        for (auto weight : weights) {
+            if (!std::isfinite(weight) || weight < 0) {
+                throw std::invalid_argument("Weights must be finite and non-negative");
+            }
+            sum += weight;
+        }
+        if (weights.empty() || !(sum > 0)) {
+            throw std::invalid_argument("Weights must have a positive sum");
+        }
+
+        // Scale so the average bucket holds exactly 1.
+        const auto n = weights.size();
+        std::vector<double> scaled(n);
+        std::vector<size_t> small;
+        std::vector<size_t> large;
+        for (size_t i = 0; i < n; ++i) {
+            scaled[i] = weights[i] * n / sum;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+
+        // Top up each under-full bucket from an over-full one.
+        while (!small.empty() && !large.empty()) {
+            const auto less = small.back();
+            small.pop_back();
+            const auto more = large.back();
+            _probability[less] = scaled[less];
+            _alias[less] = more;
+            scaled[more] -= 1 - scaled[less];
+            if (scaled[more] < 1) {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+
+        // Whatever is left is full up to rounding error.
+        for (auto i : large) {
+            _probability[i] = 1;
+            _alias[i] = i;
+        }
+        for (auto i : small) {
+            _probability[i] = 1;
+            _alias[i] = i;
+        }
+    }
+
+    /**
+     * @return an index in `[0, size())` chosen with probability proportional to its weight.
+     */
+    template <typename URNG>
+    size_t sample(URNG& rng) const {
+        const auto bucket =
+            boost::random::uniform_int_distribution<size_t>{0, _probability.size() - 1}(rng);
+        const auto coin = boost::random::uniform_real_distribution<double>{0, 1}(rng);
+        return coin < _probability[bucket] ? bucket : _alias[bucket];
+    }
+
+    size_t size() const {
+        return _probability.size();
+    }
+
+private:
+    std::vector<double> _probability;
+    std::vector<size_t> _alias;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_5D0B8F3E_6E2A_4C1B_9F4D_2A7C3E8B1D60_INCLUDED
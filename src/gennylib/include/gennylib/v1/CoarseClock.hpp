@@ -0,0 +1,69 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_1E6A9C2B_7F3D_4B8E_A5C1_93D0F2E4B7A8_INCLUDED
+#define HEADER_1E6A9C2B_7F3D_4B8E_A5C1_93D0F2E4B7A8_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace genny::v1 {
+
+/**
+ * A cheap, coarse view of `std::chrono::steady_clock`.
+ *
+ * One background thread per process publishes `steady_clock::now()` about every
+ * `kResolution`. Reading it is a relaxed atomic load rather than a clock call, which
+ * matters for Actors whose iterations don't do much more than check whether their
+ * `Duration` is up.
+ *
+ * The published time is never ahead of the real clock. It can fall behind by
+ * `kResolution` plus however long the ticker thread waits to be scheduled, so callers
+ * that need a bound regardless of load should also check the real clock now and then.
+ * See IterationChecker::isDone().
+ */
+class CoarseClock {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds kResolution{1};
+
+    /**
+     * @return the process-wide instance. The first call starts the ticker thread.
+     */
+    static const CoarseClock& get();
+
+    clock::time_point now() const {
+        return clock::time_point{clock::duration{_now.load(std::memory_order_relaxed)}};
+    }
+
+    ~CoarseClock();
+
+    CoarseClock(const CoarseClock&) = delete;
+    CoarseClock& operator=(const CoarseClock&) = delete;
+
+private:
+    CoarseClock();
+
+    // Written once per tick and read by every Duration-bound iteration; keep it
+    // away from anything else that's written.
+    alignas(64) std::atomic<clock::rep> _now;
+    alignas(64) std::atomic_bool _stop = false;
+    std::thread _ticker;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_1E6A9C2B_7F3D_4B8E_A5C1_93D0F2E4B7A8_INCLUDED
@@ -0,0 +1,89 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_9C4E2F71_5B8A_4D03_A6E2_7F1D3C58B0A9_INCLUDED
+#define HEADER_9C4E2F71_5B8A_4D03_A6E2_7F1D3C58B0A9_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <mongocxx/options/apm.hpp>
+
+#include <gennylib/Actor.hpp>
+
+#include <metrics/metrics.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Reports how long the server took to answer each command, as the driver measured
+ * it, for pools configured with `Clients: {<name>: {CommandMonitoring: true}}`.
+ *
+ * The driver's duration covers sending the command and reading the reply, so it
+ * leaves out the BSON generation and cursor handling an Actor's own operation
+ * metrics include. Each command is reported three ways:
+ *
+ * - `<ActorName>.Command.<command>`, next to the Actor's own operations.
+ * - `Commands.<command>`, for every Actor.
+ * - `Hosts.<host>:<port>`, to spot a slow server.
+ *
+ * Commands are attributed to the Actor set with setActor() on the thread, or fiber
+ * when run on a v1::FiberPool, that ran them, including through v1::runBlocking().
+ * Commands run elsewhere, such as while Actors are being constructed, aren't reported.
+ *
+ * Operations are only created for the commands each Actor runs. Creating one can wait
+ * on the metrics collector, so a command first run while the Actor is timing one of its
+ * own operations is held until that operation is reported, and reported then.
+ */
+class CommandMonitor {
+public:
+    /**
+     * @param registry where to report. Must outlive this.
+     */
+    explicit CommandMonitor(metrics::Registry& registry) : _registry{&registry} {}
+
+    /**
+     * Report the commands of a pool's clients.
+     *
+     * @param apm the pool's options. Its command-started callback is left alone.
+     */
+    void monitor(mongocxx::options::apm& apm);
+
+    /**
+     * Attribute commands the calling thread or fiber runs from now on to this Actor.
+     */
+    static void setActor(const std::string& actorName, ActorId id);
+
+    /**
+     * Report one command. The callbacks monitor() installs call this.
+     *
+     * @param duration how long the driver says it took.
+     * @param replyBytes the size of the reply, or 0 if it failed.
+     */
+    void report(std::string_view command,
+                std::string_view host,
+                uint16_t port,
+                std::chrono::microseconds duration,
+                bool ok,
+                size_t replyBytes = 0);
+
+private:
+    metrics::Registry* _registry;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_9C4E2F71_5B8A_4D03_A6E2_7F1D3C58B0A9_INCLUDED
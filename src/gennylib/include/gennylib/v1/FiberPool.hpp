@@ -0,0 +1,162 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_3F9B6C21_84D7_4E0A_B5A3_6D1E2C7F0A94_INCLUDED
+#define HEADER_3F9B6C21_84D7_4E0A_B5A3_6D1E2C7F0A94_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <gennylib/conventions.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Runs tasks as stackful fibers multiplexed over a small, fixed set of worker threads.
+ *
+ * This is the cooperative alternative to one `std::thread` per Actor used by
+ * `genny run --fibers N`. Fibers only give up their worker when they wait, so
+ * everything an Actor commonly waits on yields instead of blocking:
+ *
+ * - v1::Sleeper, SleepContext and the PhaseLoop rate limiting call v1::sleepFor().
+ * - GlobalRateLimiter::simpleLimitRate() calls v1::sleepFor().
+ * - Orchestrator phase waits park the fiber rather than the thread.
+ *
+ * Calls into the driver still block whatever thread makes them. Wrap them in
+ * v1::runBlocking() to run them on a separate, elastic pool of threads while the
+ * fiber waits; CrudActor does this for its operations.
+ *
+ * A fiber is free to move between workers whenever it waits, so tasks mustn't
+ * rely on `thread_local` state across a wait.
+ */
+class FiberPool {
+public:
+    /**
+     * The default stack for each fiber. This is plenty for Actor logic when driver
+     * calls go through v1::runBlocking(); Actors that call the driver directly on
+     * the fiber need more.
+     */
+    static constexpr size_t kDefaultStackSize = 64 * 1024;
+
+    /**
+     * Start the worker threads.
+     *
+     * @param workers number of worker threads; must be positive.
+     * @param stackSize stack size for each fiber, in bytes.
+     */
+    explicit FiberPool(size_t workers, size_t stackSize = kDefaultStackSize);
+
+    /**
+     * Calls join() if it hasn't been called already.
+     */
+    ~FiberPool();
+
+    FiberPool(const FiberPool&) = delete;
+    FiberPool& operator=(const FiberPool&) = delete;
+
+    /**
+     * Run `task` on a new fiber. Must not be called after join().
+     */
+    void launch(std::function<void()> task);
+
+    /**
+     * Wait for every launched fiber to finish, then stop the workers. Call this
+     * from outside the pool.
+     */
+    void join();
+
+    /**
+     * @return whether the caller is running on a FiberPool worker.
+     */
+    static bool onFiber();
+
+    /**
+     * @return a number identifying the calling worker thread, unique across every
+     * pool in the process, or 0 if the caller isn't a worker. Fibers can move between
+     * workers when they wait, so this only describes the present.
+     */
+    static size_t workerNumber();
+
+private:
+    struct State;
+    std::unique_ptr<State> _state;
+};
+
+/**
+ * Sleep for `duration`. Yields the worker if called from a FiberPool fiber and
+ * is `std::this_thread::sleep_for()` otherwise.
+ */
+void sleepFor(Duration duration);
+
+/**
+ * Per-fiber state that code run on the fiber's behalf by v1::runBlocking() has to see
+ * as well, such as the Actor that v1::CommandMonitor attributes commands to. The pool
+ * thread running the task isn't a fiber, so it looks such state up as thread state.
+ *
+ * Before each task, `capture` is called on the fiber. The pool thread passes what it
+ * returned to `install` before running the task, and passes what `install` returned
+ * back to it afterwards.
+ */
+struct BlockingCarry {
+    void* (*capture)();
+    void* (*install)(void* captured);
+};
+
+/**
+ * Carry `carry`'s state into every v1::runBlocking() task from now on. Call during
+ * static initialization, before any FiberPool is started.
+ *
+ * @return true, so it can initialize a static.
+ */
+bool carryIntoBlocking(BlockingCarry carry);
+
+namespace detail {
+// Run `task` on the elastic pool and suspend the calling fiber until it's done.
+// Rethrows anything `task` threw.
+void runOnBlockingPool(const std::function<void()>& task);
+}  // namespace detail
+
+/**
+ * Run `f`, which may block its thread, without holding up a FiberPool worker.
+ *
+ * From a fiber, `f` runs on a separate pool of threads that grows as needed, and
+ * the fiber waits for it. Otherwise `f` is just called.
+ *
+ * ```c++
+ * auto result = v1::runBlocking([&]() { return collection.insert_one(doc.view()); });
+ * ```
+ *
+ * @return whatever `f` returns.
+ */
+template <typename F>
+auto runBlocking(F&& f) -> decltype(f()) {
+    using Result = decltype(f());
+    if (!FiberPool::onFiber()) {
+        return f();
+    }
+    if constexpr (std::is_void_v<Result>) {
+        detail::runOnBlockingPool([&]() { f(); });
+    } else {
+        std::optional<Result> out;
+        detail::runOnBlockingPool([&]() { out.emplace(f()); });
+        return std::move(*out);
+    }
+}
+
+}  // namespace genny::v1
+
+#endif  // HEADER_3F9B6C21_84D7_4E0A_B5A3_6D1E2C7F0A94_INCLUDED
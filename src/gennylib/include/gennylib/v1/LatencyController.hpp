@@ -0,0 +1,353 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_8C70A692_0ECE_4A5F_8AF2_69C24CBCE242_INCLUDED
+#define HEADER_8C70A692_0ECE_4A5F_8AF2_69C24CBCE242_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/conventions.hpp>
+
+#include <metrics/metrics.hpp>
+#include <metrics/operation.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Lock-free latency histogram with log-linear buckets.
+ *
+ * Each power of two is split into 16 linear sub-buckets so any recorded value
+ * is reported within 1/16th (~6%) of its actual value. Recording is a single
+ * relaxed increment and is safe to call from any number of threads.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int64_t kSubBuckets = int64_t{1} << kSubBucketBits;
+    static constexpr size_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    using Counts = std::array<int64_t, kNumBuckets>;
+
+    void record(int64_t nanos) {
+        _counts[bucketFor(std::max(nanos, int64_t{0}))].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Read and zero every bucket. Values recorded concurrently with drain() land
+     * either in this or the next snapshot.
+     */
+    Counts drain() {
+        Counts out{};
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            out[i] = _counts[i].exchange(0, std::memory_order_relaxed);
+        }
+        return out;
+    }
+
+    static int64_t total(const Counts& counts) {
+        int64_t out = 0;
+        for (auto count : counts) {
+            out += count;
+        }
+        return out;
+    }
+
+    /**
+     * @return the (upper bound of the bucket holding the) given percentile, or 0 if empty.
+     */
+    static int64_t percentile(const Counts& counts, double percentile) {
+        const auto count = total(counts);
+        if (count == 0) {
+            return 0;
+        }
+        const auto rank =
+            std::max(int64_t{1}, static_cast<int64_t>(std::ceil(percentile / 100 * count)));
+        int64_t seen = 0;
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return upperBound(i);
+            }
+        }
+        return upperBound(kNumBuckets - 1);
+    }
+
+    static constexpr size_t bucketFor(int64_t nanos) {
+        if (nanos < kSubBuckets) {
+            return static_cast<size_t>(nanos);
+        }
+        const int msb = 63 - __builtin_clzll(static_cast<uint64_t>(nanos));
+        const int shift = msb - kSubBucketBits;
+        return static_cast<size_t>((shift + 1) * kSubBuckets +
+                                   ((nanos >> shift) & (kSubBuckets - 1)));
+    }
+
+    static constexpr int64_t upperBound(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return static_cast<int64_t>(bucket);
+        }
+        const auto shift = static_cast<int>(bucket / kSubBuckets) - 1;
+        const auto sub = static_cast<int64_t>(bucket % kSubBuckets);
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic_int64_t, kNumBuckets> _counts{};
+};
+
+/**
+ * Closed-loop controller behind `GlobalRate: {TargetLatency: ...}`.
+ *
+ * It observes the latencies of one operation and, once per interval, adjusts the
+ * target throughput with additive-increase/multiplicative-decrease:
+ *
+ * - If the observed percentile is within the target and the operation is keeping up
+ *   with the current rate, the rate grows by a tenth of the starting rate.
+ * - If the observed percentile exceeds the target, the rate is cut by 20%.
+ *
+ * The highest throughput achieved in an interval that met the target is reported
+ * as the sustained throughput at the SLO.
+ *
+ * Each interval is logged and, if given operations by reportTo(), reported to them so
+ * analysis can line the rate up with the latency it produced.
+ */
+class LatencyController : public metrics::OperationObserver {
+public:
+    static constexpr double kDecreaseFactor = 0.8;
+    static constexpr double kIncreaseFraction = 0.1;
+    // Only increase when the achieved rate is at least this fraction of the target;
+    // otherwise the limiter isn't what is holding throughput back.
+    static constexpr double kKeepingUpFraction = 0.9;
+
+    struct Sample {
+        Duration elapsed;
+        double targetRate;    // ops/second the limiter allowed during the interval
+        double achievedRate;  // ops/second observed during the interval
+        Duration latency;     // the observed percentile
+        bool withinTarget;
+    };
+
+    explicit LatencyController(LatencyRateSpec spec)
+        : _spec{std::move(spec)},
+          _burstSize{_spec.startingRate.operations},
+          _startingRate{opsPerSecond(_spec.startingRate)},
+          _targetRate{_startingRate} {}
+
+    ~LatencyController() override {
+        std::lock_guard<std::mutex> lock{_mutex};
+        logSummary();
+    }
+
+    /**
+     * Report each interval from now on.
+     *
+     * @param rateOp gets the operations the limiter allowed over the interval, with the
+     * interval's length as the duration.
+     * @param latencyOp gets the observed percentile as the duration, the operations
+     * observed, and whether the interval met the target as the outcome.
+     */
+    void reportTo(metrics::Operation rateOp, metrics::Operation latencyOp) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _rateOp.emplace(std::move(rateOp));
+        _latencyOp.emplace(std::move(latencyOp));
+    }
+
+    void observe(std::chrono::nanoseconds duration) override {
+        _histogram.record(duration.count());
+    }
+
+    /**
+     * Called on the rate limiter's hot path. At most one caller per interval
+     * does any work beyond a relaxed load.
+     *
+     * @return the new rate, in nanoseconds per burst, if it changed.
+     */
+    std::optional<int64_t> maybeAdjust(int64_t nowNS) {
+        auto nextTick = _nextTickNS.load(std::memory_order_relaxed);
+        if (nowNS < nextTick) {
+            return std::nullopt;
+        }
+        if (!_nextTickNS.compare_exchange_strong(nextTick, nowNS + _spec.interval.count())) {
+            return std::nullopt;
+        }
+        if (nextTick == 0) {
+            // First call without a reset(): start the first interval now.
+            std::lock_guard<std::mutex> lock{_mutex};
+            _startNS = _lastTickNS = nowNS;
+            _histogram.drain();
+            return std::nullopt;
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        const auto counts = _histogram.drain();
+        const auto count = LatencyHistogram::total(counts);
+        const auto elapsed = nowNS - _lastTickNS;
+        _lastTickNS = nowNS;
+        if (count == 0 || elapsed <= 0) {
+            return std::nullopt;
+        }
+
+        const auto targetRate = _targetRate.load(std::memory_order_relaxed);
+        const Sample sample{
+            Duration{nowNS - _startNS},
+            targetRate,
+            count * 1e9 / elapsed,
+            Duration{LatencyHistogram::percentile(counts, _spec.percentile)},
+            LatencyHistogram::percentile(counts, _spec.percentile) <= _spec.target.count()};
+        _timeline.push_back(sample);
+        report(sample, Duration{elapsed}, count);
+
+        auto nextRate = targetRate;
+        if (sample.withinTarget) {
+            _sustainedRate = std::max(_sustainedRate, sample.achievedRate);
+            if (sample.achievedRate >= kKeepingUpFraction * targetRate) {
+                nextRate += kIncreaseFraction * _startingRate;
+            }
+        } else {
+            nextRate = std::max(1.0, targetRate * kDecreaseFactor);
+        }
+        _targetRate.store(nextRate, std::memory_order_relaxed);
+
+        BOOST_LOG_TRIVIAL(info) << "GlobalRate " << describe() << " at "
+                                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       sample.elapsed)
+                                       .count()
+                                << "ms: p" << _spec.percentile << "="
+                                << sample.latency.count() << "ns achieved="
+                                << sample.achievedRate << " ops/s, rate " << sample.targetRate
+                                << " -> " << nextRate << " ops/s";
+        return rateNS();
+    }
+
+    /**
+     * Begin a new phase. Summarizes the previous one if it used this controller.
+     * Safe to call more than once per phase. The current rate carries over.
+     */
+    void reset(int64_t nowNS) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        logSummary();
+        _timeline.clear();
+        _sustainedRate = 0;
+        _startNS = _lastTickNS = nowNS;
+        _histogram.drain();
+        _nextTickNS = nowNS + _spec.interval.count();
+    }
+
+    /**
+     * @return the current rate in nanoseconds per burst of `burstSize()` operations.
+     */
+    int64_t rateNS() const {
+        const auto targetRate = _targetRate.load(std::memory_order_relaxed);
+        return std::max(int64_t{1}, static_cast<int64_t>(_burstSize * 1e9 / targetRate));
+    }
+
+    int64_t burstSize() const {
+        return _burstSize;
+    }
+
+    /**
+     * @return the highest ops/second achieved in an interval that met the target this phase.
+     */
+    double sustainedRate() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _sustainedRate;
+    }
+
+    std::vector<Sample> timeline() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _timeline;
+    }
+
+    const LatencyRateSpec& spec() const {
+        return _spec;
+    }
+
+private:
+    static double opsPerSecond(const BaseRateSpec& spec) {
+        return spec.operations * 1e9 / spec.per.count();
+    }
+
+    std::string describe() const {
+        std::ostringstream out;
+        out << _spec.actor << "." << _spec.operation << " (p" << _spec.percentile
+            << " <= " << _spec.target.count() << "ns)";
+        return out.str();
+    }
+
+    // Requires _mutex.
+    void report(const Sample& sample, Duration elapsed, int64_t observed) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        const auto now = metrics::clock::now();
+        if (_rateOp) {
+            const auto allowed = std::llround(sample.targetRate * elapsed.count() / 1e9);
+            _rateOp->report(now,
+                            duration_cast<microseconds>(elapsed),
+                            metrics::OutcomeType::kSuccess,
+                            allowed);
+        }
+        if (_latencyOp) {
+            _latencyOp->report(now,
+                               duration_cast<microseconds>(sample.latency),
+                               sample.withinTarget ? metrics::OutcomeType::kSuccess
+                                                   : metrics::OutcomeType::kFailure,
+                               observed);
+        }
+    }
+
+    // Requires _mutex.
+    void logSummary() const {
+        if (_timeline.empty()) {
+            return;
+        }
+        const auto compliant = std::count_if(
+            _timeline.begin(), _timeline.end(), [](const Sample& s) { return s.withinTarget; });
+        BOOST_LOG_TRIVIAL(info) << "GlobalRate " << describe()
+                                << " sustained throughput: " << _sustainedRate << " ops/s ("
+                                << compliant << " of " << _timeline.size()
+                                << " intervals met the target)";
+    }
+
+    const LatencyRateSpec _spec;
+    const int64_t _burstSize;
+    const double _startingRate;
+
+    LatencyHistogram _histogram;
+    std::atomic_int64_t _nextTickNS = 0;
+    // Only changed under _mutex, but rateNS() reads it without.
+    std::atomic<double> _targetRate;
+
+    mutable std::mutex _mutex;
+    double _sustainedRate = 0;
+    int64_t _startNS = 0;
+    int64_t _lastTickNS = 0;
+    std::vector<Sample> _timeline;
+    std::optional<metrics::Operation> _rateOp;
+    std::optional<metrics::Operation> _latencyOp;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_8C70A692_0ECE_4A5F_8AF2_69C24CBCE242_INCLUDED
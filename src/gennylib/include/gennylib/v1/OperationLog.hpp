@@ -0,0 +1,169 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_D560C6BB_435F_4F88_811C_59D32024F584_INCLUDED
+#define HEADER_D560C6BB_435F_4F88_811C_59D32024F584_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <gennylib/Actor.hpp>
+
+namespace genny::v1 {
+
+/**
+ * One command an Actor ran, as written by `genny run --record`.
+ */
+struct LoggedOperation {
+    /** when it started, since recording began */
+    std::chrono::nanoseconds offset;
+    /** the database it ran on */
+    std::string_view database;
+    /** the command's BSON */
+    std::string_view command;
+};
+
+/**
+ * Writes the commands one Actor runs to an operation log.
+ *
+ * A log is a header naming the Actor and then blocks of records, each block
+ * zlib-compressed on its own. Records are buffered until a block is full, so only
+ * the command that fills a block pays for compressing and writing it.
+ *
+ * Only the thread or fiber running the Actor may append.
+ */
+class OperationLogWriter {
+public:
+    /**
+     * Bumped whenever the layout changes.
+     */
+    static constexpr uint32_t kVersion = 1;
+
+    /**
+     * How many bytes of records are compressed together.
+     */
+    static constexpr size_t kBlockSize = 1 << 20;
+
+    /**
+     * @throws InvalidConfigurationException if the log can't be created.
+     */
+    OperationLogWriter(const std::string& path, const std::string& actorName, ActorId id);
+
+    /**
+     * Writes what's buffered. Call close() to find out whether that worked.
+     */
+    ~OperationLogWriter();
+
+    OperationLogWriter(const OperationLogWriter&) = delete;
+    OperationLogWriter& operator=(const OperationLogWriter&) = delete;
+
+    /**
+     * @throws InvalidConfigurationException if the log can't be written.
+     */
+    void append(const LoggedOperation& operation);
+
+    /**
+     * Write what's buffered and close the log. Nothing can be appended afterwards.
+     *
+     * @throws InvalidConfigurationException if the log can't be written.
+     */
+    void close();
+
+    /**
+     * @return how many commands were appended.
+     */
+    size_t count() const {
+        return _count;
+    }
+
+private:
+    void _writeBlock();
+
+    std::string _path;
+    std::ofstream _out;
+    std::string _block;
+    std::string _compressed;
+    size_t _count = 0;
+};
+
+/**
+ * Reads an operation log written by OperationLogWriter.
+ *
+ * The log is memory-mapped, and one block at a time is decompressed into a buffer
+ * that the LoggedOperations it returns point into, so reading costs one copy of each
+ * command and no allocations once the buffer has grown to the size of a block.
+ */
+class OperationLogReader {
+public:
+    /**
+     * @throws InvalidConfigurationException if the file can't be mapped or isn't a log
+     * this genny can read.
+     */
+    explicit OperationLogReader(const std::string& path);
+    ~OperationLogReader();
+
+    OperationLogReader(OperationLogReader&&) noexcept;
+    OperationLogReader& operator=(OperationLogReader&&) noexcept;
+
+    /**
+     * @return the name of the Actor that was recorded.
+     */
+    const std::string& actorName() const {
+        return _actorName;
+    }
+
+    /**
+     * @return the ActorId of the Actor that was recorded.
+     */
+    ActorId actorId() const {
+        return _actorId;
+    }
+
+    /**
+     * Read the next command.
+     *
+     * @param out set to the next command. Its views are valid until the next call.
+     * @return false once every command has been read.
+     * @throws InvalidConfigurationException if the log is truncated or corrupt.
+     */
+    bool next(LoggedOperation& out);
+
+    /**
+     * Start again from the first command.
+     */
+    void rewind();
+
+private:
+    struct Mapping;
+
+    std::string _path;
+    std::unique_ptr<Mapping> _mapping;
+    std::string _actorName;
+    ActorId _actorId = 0;
+    // Where the first block starts in the mapping, and where the next one does.
+    size_t _firstBlock = 0;
+    size_t _nextBlock = 0;
+    // The decompressed block being read, and how far into it.
+    std::string _block;
+    size_t _pos = 0;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_D560C6BB_435F_4F88_811C_59D32024F584_INCLUDED
@@ -0,0 +1,113 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_2EAFFDD3_FC5F_4B34_8714_865F9EA31080_INCLUDED
+#define HEADER_2EAFFDD3_FC5F_4B34_8714_865F9EA31080_INCLUDED
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <bsoncxx/document/view.hpp>
+
+#include <mongocxx/events/command_started_event.hpp>
+
+#include <gennylib/Actor.hpp>
+#include <gennylib/v1/OperationLog.hpp>
+#include <gennylib/v1/PoolManager.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Records every command each Actor runs, for `genny run --record <directory>`, so
+ * that the Replay Actor can run the same commands again without generating them.
+ *
+ * Commands are captured from the driver as they're sent, after the Actor has
+ * generated them, into one v1::OperationLogWriter per Actor in the directory. Each is
+ * stored with when it started, so a replay can keep the original timing.
+ *
+ * Session and cluster-time fields the driver adds are left out, so commands run in a
+ * transaction are replayed outside one. Commands that only make sense on the original
+ * connection aren't recorded: `getMore` and `killCursors`, which name cursors that
+ * won't exist, ending sessions and transactions, and the handshake and authentication
+ * commands the driver hides.
+ *
+ * Commands are attributed to the Actor attached with attach() on the thread, or fiber
+ * when run on a v1::FiberPool, that ran them, including through v1::runBlocking().
+ * Commands run elsewhere aren't recorded.
+ */
+class OperationRecorder {
+public:
+    /**
+     * @param directory where to write the logs. Created if it doesn't exist.
+     * @throws InvalidConfigurationException if it can't be created.
+     */
+    explicit OperationRecorder(std::string directory);
+
+    OperationRecorder(const OperationRecorder&) = delete;
+    OperationRecorder& operator=(const OperationRecorder&) = delete;
+
+    /**
+     * @return a callback for WorkloadContext that records the commands it's called with.
+     * This must outlive the pools it's given to.
+     */
+    PoolManager::OnCommandStartCallback callback();
+
+    /**
+     * Measure when commands start from now. Call just before the Actors start.
+     */
+    void start();
+
+    /**
+     * Record commands the calling thread or fiber runs from now on as this Actor's. If
+     * the Actor's log can't be created, the error is logged and it isn't recorded.
+     */
+    void attach(const std::string& actorName, ActorId id);
+
+    /**
+     * Record one command, if the calling thread or fiber is attached. Never throws:
+     * if an Actor's log can't be written, the error is logged and that Actor isn't
+     * recorded any further.
+     */
+    void record(std::string_view commandName,
+                std::string_view database,
+                bsoncxx::document::view command) noexcept;
+
+    /**
+     * Finish writing every log. Call once the Actors are done.
+     *
+     * @return how many commands were recorded.
+     * @throws InvalidConfigurationException if a log couldn't be written.
+     */
+    size_t close();
+
+    /**
+     * @return the logs recorded in a directory, in the order their Actors were created.
+     */
+    static std::vector<std::string> logs(const std::string& directory);
+
+private:
+    std::string _directory;
+    std::chrono::steady_clock::time_point _started;
+    std::mutex _lock;
+    std::map<ActorId, std::unique_ptr<OperationLogWriter>> _logs;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_2EAFFDD3_FC5F_4B34_8714_865F9EA31080_INCLUDED
@@ -71,6 +71,11 @@ public:
      */
     void overrideHosts(const std::set<std::string>& hosts);
 
+    /**
+     * @return the host(s) the pool will connect to.
+     */
+    const std::set<std::string>& hosts() const;
+
     template <typename ContainerT = std::map<std::string, std::string>>
     void setOptions(OptionType type, ContainerT list) {
         for (const auto& [key, value] : list) {
@@ -83,10 +88,18 @@ public:
 
     std::optional<std::string_view> getOption(OptionType type, const std::string& option) const;
 
+    /**
+     * Report the server round trip of every command the pool's clients run.
+     *
+     * @param monitor not owned; must outlive the pool.
+     */
+    void monitorCommands(CommandMonitor* monitor);
+
 private:
     struct Config;
     std::unique_ptr<Config> _config;
     PoolManager::OnCommandStartCallback _apmCallback;
+    CommandMonitor* _commandMonitor = nullptr;
 };
 
 }  // namespace genny::v1
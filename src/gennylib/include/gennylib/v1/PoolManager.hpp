@@ -15,15 +15,22 @@
 #ifndef HEADER_088A462A_CF7B_4114_841E_C19AA8D29774_INCLUDED
 #define HEADER_088A462A_CF7B_4114_841E_C19AA8D29774_INCLUDED
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <mongocxx/pool.hpp>
 
 #include <gennylib/Node.hpp>
+#include <gennylib/v1/CommandMonitor.hpp>
 
 namespace genny::v1 {
 
@@ -49,9 +56,12 @@ public:
      *
      * @param callback
      *   a callback to be invoked for every `mongocxx::events::command_started_event`
+     *
+     * @param context
+     *   the WorkloadContext used to look up the configurations. Must outlive this PoolManager.
+     *   The pools of every name under `Clients`, and of `Default`, are laid out here.
      */
-    PoolManager(std::string mongoUri, OnCommandStartCallback callback)
-        : _mongoUri{std::move(mongoUri)}, _apmCallback{std::move(callback)} {}
+    PoolManager(std::string mongoUri, OnCommandStartCallback callback, const Node& context);
 
     /**
      * Obtain a connection or throw if none available.
@@ -65,12 +75,48 @@ public:
      *  the name of the pool to use. This corresponds to a key within the `Clients` configuration.
      * @param instance
      *   which instance of the named pool to use. Will be created on-demand the first time the
-     *   (name,instance) pair is used.
-     * @param context
-     *   the WorkloadContext used to look up the configurations
+     *   (name,instance) pair is used. Ignored if the pool is configured with `Instances` or
+     *   `Assign`, in which case successive calls are handed out round-robin over its instances.
      * @return a connection from the pool or throw if none available
      */
-    mongocxx::pool::entry client(const std::string& name, size_t instance, const Node& context);
+    mongocxx::pool::entry client(const std::string& name, size_t instance);
+
+    /**
+     * How long it took a `Prewarm: true` client to set up its connection.
+     */
+    struct ConnectionSetup {
+        /** The `Clients:` name of its pool. */
+        std::string name;
+        /** The first command, which connects, does the TLS handshake, and authenticates. */
+        std::chrono::nanoseconds firstCommand;
+        /** A second command over the connection the first one set up. */
+        std::chrono::nanoseconds roundTrip;
+        bool ok;
+    };
+
+    /**
+     * Run a `ping` on every client handed out so far from a pool configured with
+     * `Clients: {<name>: {Prewarm: true}}`, so the connection each one's first operation
+     * uses is established before the workload starts rather than during it.
+     *
+     * Must be called before any of those clients are used. Each client is only
+     * prewarmed once.
+     *
+     * @param threads how many clients to prewarm at a time.
+     * @return how long each took. Failures are logged and have `ok == false`.
+     */
+    std::vector<ConnectionSetup> prewarm(size_t threads);
+
+    /**
+     * Report the server round trip of every command run by the clients of pools
+     * configured with `Clients: {<name>: {CommandMonitoring: true}}`. Without this,
+     * that setting is ignored. Must be called before any such pool is created.
+     *
+     * @param registry where to report. Must outlive this PoolManager.
+     */
+    void monitorCommands(metrics::Registry& registry) {
+        _commandMonitor.emplace(registry);
+    }
 
     // Only used for testing
     /** @private */
@@ -81,15 +127,73 @@ private:
     std::string _mongoUri;
     /** callback passed into ctor */
     OnCommandStartCallback _apmCallback;
+    /** context passed into ctor */
+    const Node& _context;
+    /** set by monitorCommands() */
+    std::optional<CommandMonitor> _commandMonitor;
+
+    /**
+     * How `client()` spreads the callers of one name over its instances, from
+     * `Clients: {<name>: {Instances: <n>, Assign: round-robin|per-host}}`.
+     */
+    struct Assignment {
+        /** zero if callers choose the instance themselves */
+        size_t instances = 0;
+        /** for `per-host`, the URI's hosts; instance `i` connects only to `hosts[i % size]` */
+        std::vector<std::string> hosts;
+
+        static Assignment parse(const std::string& mongoUri,
+                                const std::string& name,
+                                const Node& context);
+    };
+
+    /** one (name,instance) pair's pool, created the first time it's used */
+    struct Instance {
+        std::mutex lock;
+        std::unique_ptr<mongocxx::pool> pool;
+        /** `pool` once it exists, so it can be read without `lock` */
+        std::atomic<mongocxx::pool*> created = nullptr;
+    };
+
+    /**
+     * The pools for one name.
+     *
+     * Its instances are laid out when it's constructed, so finding one takes no lock
+     * and writes nothing shared, and threads asking for clients don't contend. Only
+     * the rare caller choosing an instance past those waits on `lock`.
+     */
+    struct NamedPools {
+        NamedPools(const std::string& mongoUri, const std::string& name, const Node& context);
+
+        Instance& instance(size_t instance);
+
+        const Assignment assignment;
+        /** whether `Clients: {<name>: {Prewarm: true}}` */
+        const bool prewarm;
+        /** whether `Clients: {<name>: {CommandMonitoring: true}}` */
+        const bool monitorCommands;
+        /** the instance the next caller gets, if `assignment` chooses */
+        std::atomic<size_t> nextInstance = 0;
+
+        /** one per assigned instance, or just instance 0 if callers choose */
+        std::deque<Instance> instances;
+        /** instances chosen past those */
+        std::map<size_t, Instance> extraInstances;
+        std::mutex lock;
+    };
+
+    /** find the pools for `name`, the same way NamedPools finds instances */
+    NamedPools& _named(const std::string& name);
 
-    using Pools = std::unordered_map<size_t, std::unique_ptr<mongocxx::pool>>;
-    // pair each map ↑ with a mutex for adding new pools
-    using LockAndPools = std::pair<std::mutex, Pools>;
+    /** the names under `Clients`, and `Default`; not changed after construction */
+    std::unordered_map<std::string, NamedPools> _pools;
+    /** names asked for that aren't under `Clients` */
+    std::map<std::string, NamedPools> _unconfiguredPools;
+    std::mutex _unconfiguredPoolsLock;
 
-    /** the pools themselves */
-    std::unordered_map<std::string, LockAndPools> _pools;
-    /** lock on finding/creating the LockAndPools for a given string */
-    std::mutex _poolsLock;
+    /** clients handed out that are still to be prewarmed, and their pool's name */
+    std::vector<std::pair<std::string, mongocxx::client*>> _toPrewarm;
+    std::mutex _toPrewarmLock;
 };
 
 }  // namespace genny::v1
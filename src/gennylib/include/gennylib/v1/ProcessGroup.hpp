@@ -0,0 +1,135 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_970FD065_93BF_49C8_A9A3_8359CFAC76AA_INCLUDED
+#define HEADER_970FD065_93BF_49C8_A9A3_8359CFAC76AA_INCLUDED
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <gennylib/GlobalRateLimiter.hpp>
+#include <gennylib/Orchestrator.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Worker processes that run one workload between them, for `genny run --processes`.
+ *
+ * One process can top out on its allocator, its metrics and its connection pools
+ * long before the machine does. A group forks workers that each run a share of the
+ * Actors: worker `r` of `n` runs the Actors whose index in the workload is `r` modulo
+ * `n`. A worker only constructs its own Actors, and so only opens their clients and
+ * metrics, but takes the ActorIds of the others in workload order, so every Actor has
+ * the same ActorId everywhere. Producers that aren't ParallelizedActorProducers are
+ * the exception: every worker constructs their Actors and drops the others' at once.
+ *
+ * What the workers have to agree on lives in anonymous shared memory mapped before
+ * they're forked:
+ *
+ * - The Orchestrator barrier. Phases start and end once the Actors of every worker
+ *   have arrived, and an abort() in any worker stops them all. Threads park on a
+ *   shared futex, so Actors can't run on a v1::FiberPool in a group.
+ *
+ * - The token buckets of the GlobalRateLimiters, by name, so that a GlobalRate is
+ *   the rate of the whole group rather than of each worker.
+ *
+ * Each worker writes its own metrics. The process that forked them supervises: it
+ * aborts the rest when a worker fails, and exits with the first failure.
+ */
+class ProcessGroup {
+public:
+    static constexpr size_t kMaxRateLimiters = 1024;
+    static constexpr size_t kMaxRateLimiterName = 256;
+
+    /**
+     * Map the shared memory. Call before starting any threads.
+     *
+     * @param processes how many workers to fork.
+     * @throws InvalidConfigurationException if there are no workers, or on platforms
+     * without futexes.
+     */
+    explicit ProcessGroup(size_t processes);
+
+    ~ProcessGroup();
+
+    ProcessGroup(const ProcessGroup&) = delete;
+    ProcessGroup& operator=(const ProcessGroup&) = delete;
+
+    size_t processes() const {
+        return _processes;
+    }
+
+    /**
+     * @return this worker's number, or nullopt in the process that forked them.
+     */
+    std::optional<size_t> rank() const {
+        return _rank;
+    }
+
+    /**
+     * Fork the workers.
+     *
+     * @return true in each worker and false in the process that forked them.
+     */
+    bool fork();
+
+    /**
+     * Wait for every worker to exit. If one fails, abort the others.
+     *
+     * @return the exit code of the first worker that failed, or 0.
+     */
+    int supervise();
+
+    /**
+     * Block until every worker has called this, so that none starts a phase before
+     * the others have added their Actors to the barrier.
+     *
+     * @return false if the workload was aborted meanwhile, e.g. because another
+     * worker failed to set up.
+     */
+    bool awaitWorkers();
+
+    /**
+     * @return whether this worker runs the Actor at this index.
+     */
+    bool runs(size_t actorIndex) const {
+        return _rank && actorIndex % _processes == *_rank;
+    }
+
+    /**
+     * @return the bucket every worker's GlobalRateLimiter of this name shares.
+     * @throws InvalidConfigurationException if the name is too long or there are too many.
+     */
+    TokenBucket& rateLimiterBucket(const std::string& name);
+
+private:
+    friend class genny::Orchestrator;
+
+    struct Segment;
+
+    Orchestrator::Barrier& orchestratorBarrier();
+
+    const size_t _processes;
+    Segment* _segment;
+    std::optional<size_t> _rank;
+    std::vector<pid_t> _workers;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_970FD065_93BF_49C8_A9A3_8359CFAC76AA_INCLUDED
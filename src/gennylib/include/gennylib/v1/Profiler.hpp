@@ -0,0 +1,125 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_7D69BDA4_0198_4CFD_8E75_63EA9F327403_INCLUDED
+#define HEADER_7D69BDA4_0198_4CFD_8E75_63EA9F327403_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace genny::v1 {
+
+/**
+ * Samples where genny spends its CPU time, for `genny run --profile`.
+ *
+ * A CPU-time timer sends SIGPROF to whichever thread is running when it expires, so
+ * samples land on threads in proportion to the CPU they use. Each sample is the
+ * interrupted thread's stack plus its tag: the Actor, phase and operation it
+ * published last. Metrics publish the Actor and operation when an operation starts
+ * and clear the operation when it's reported, and ActorPhaseIterators publish the
+ * phase, so time generating documents, waiting in the driver or recording metrics can
+ * be told apart under each Actor and operation.
+ *
+ * Samples are counted in a fixed table in the signal handler, which allocates
+ * nothing. Stacks are walked through frame pointers from the interrupted frame, so
+ * frames built without them cut the stack short; genny itself is built with them,
+ * though a leaf function that needs no frame can still hide its caller.
+ * writeFolded() writes them as folded stacks, which flamegraph.pl and
+ * speedscope both load. Frames that aren't exported are shown as their module and
+ * offset, to be resolved with addr2line.
+ *
+ * Tags are kept per thread, so when Actors run on a v1::FiberPool a sample may
+ * carry the phase of the last Actor that started iterating on that worker, and only
+ * the interrupted frame, since only a thread's own stack is walked.
+ *
+ * When profiling isn't enabled, each instrumented point costs a relaxed load and a
+ * branch that's never taken.
+ */
+class Profiler {
+public:
+    // Not a multiple of common timer frequencies so sampling doesn't fall in step with them.
+    static constexpr int kDefaultFrequency = 99;
+    static constexpr size_t kMaxFrames = 48;
+    static constexpr uint32_t kNoPhase = UINT32_MAX;
+
+    /**
+     * @return whether samples are being taken.
+     */
+    static bool enabled() noexcept {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Start sampling the whole process. Call before any Actor starts.
+     *
+     * @param frequency samples per second of CPU time.
+     * @throws std::system_error if the timer or signal handler can't be installed.
+     */
+    static void enable(int frequency = kDefaultFrequency);
+
+    /**
+     * Stop sampling. Samples are kept until clear(). The SIGPROF handler stays installed
+     * but does nothing until the next enable().
+     */
+    static void disable();
+
+    /**
+     * Disable and forget every sample.
+     */
+    static void clear();
+
+    /**
+     * Tag the calling thread's samples from now on with this Actor, until the next
+     * call. Strings aren't copied and must outlive the profile.
+     */
+    static void setActor(const std::string* actor) noexcept;
+
+    /**
+     * @see setActor()
+     */
+    static void setPhase(uint32_t phase) noexcept;
+
+    /**
+     * @param actor the Actor running the operation.
+     * @param operation the operation, or nullptr once it's done.
+     * @see setActor()
+     */
+    static void setOperation(const std::string* actor, const std::string* operation) noexcept;
+
+    /**
+     * @return how many samples were taken.
+     */
+    static size_t samples();
+
+    /**
+     * @return how many samples weren't counted because too many distinct stacks were seen.
+     */
+    static size_t dropped();
+
+    /**
+     * Write every sample as a folded stack: the Actor, phase and operation, then the
+     * frames from the outermost in, then the count. Nothing may be sampling.
+     */
+    static void writeFolded(std::ostream& out);
+
+private:
+    static inline std::atomic_bool _enabled = false;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_7D69BDA4_0198_4CFD_8E75_63EA9F327403_INCLUDED
@@ -19,6 +19,7 @@
 
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/FiberPool.hpp>
 
 
 namespace genny::v1 {
@@ -60,7 +61,7 @@ public:
             // only use this mechanism if the caller explicitly asked for it.
             orchestrator.sleepToPhaseEnd(period, phase);
         } else if (period.count() > 0 && orchestrator.currentPhase() == phase) {
-            std::this_thread::sleep_for(period);
+            v1::sleepFor(period);
         }
     }
 
@@ -70,7 +71,7 @@ public:
      */
     constexpr void before(const Orchestrator& orchestrator, const PhaseNumber phase) const {
         if (_before.count() > 0 && orchestrator.currentPhase() == phase) {
-            std::this_thread::sleep_for(_before);
+            v1::sleepFor(_before);
         }
     }
 
@@ -79,10 +80,17 @@ public:
      */
     constexpr void after(const Orchestrator& orchestrator, const PhaseNumber phase) const {
         if (_after.count() > 0 && orchestrator.currentPhase() == phase) {
-            std::this_thread::sleep_for(_after);
+            v1::sleepFor(_after);
         }
     }
 
+    /**
+     * @return whether before() or after() ever sleep.
+     */
+    constexpr bool sleepsEachIteration() const {
+        return _before.count() > 0 || _after.count() > 0;
+    }
+
 private:
     Duration _before;
     Duration _after;
@@ -0,0 +1,245 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_9682D91E_3F2B_43B4_AED8_B2E5B9DF557F_INCLUDED
+#define HEADER_9682D91E_3F2B_43B4_AED8_B2E5B9DF557F_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/conventions.hpp>
+
+#include <metrics/metrics.hpp>
+#include <metrics/operation.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Decides when a phase with `EndWhen: {SteadyState: ...}` is done.
+ *
+ * It observes one operation and, once per bucket (the Window divided by Buckets),
+ * records the operation's throughput or mean latency over that bucket. The phase is
+ * done once the last Window's worth of buckets has a coefficient of variation of at
+ * most MaxCoV and the phase has run for MinDuration, or once it has run for MaxDuration.
+ *
+ * The stable window is logged and, if given an operation, reported to it with the
+ * window's end as the finish time and its length as the duration, so analysis can
+ * use just that interval.
+ */
+class SteadyStateDetector : public metrics::OperationObserver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // When the operation became steady, relative to the start of the phase.
+    struct Window {
+        Duration start;
+        Duration end;
+        double cov;
+    };
+
+    /**
+     * @param spec what to observe and when it counts as steady.
+     * @param windowOp where to report the stable window, if anywhere.
+     */
+    explicit SteadyStateDetector(SteadyStateSpec spec,
+                                 std::optional<metrics::Operation> windowOp = std::nullopt)
+        : _spec{std::move(spec)},
+          _bucketNS{_spec.window.count() / _spec.buckets},
+          _minDurationNS{_spec.minDuration.value_or(_spec.window).count()},
+          _windowOp{std::move(windowOp)} {}
+
+    void observe(std::chrono::nanoseconds duration) override {
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _latencySumNS.fetch_add(duration.count(), std::memory_order_relaxed);
+    }
+
+    /**
+     * Called on the PhaseLoop's hot path. At most one caller per bucket does any
+     * work beyond a couple of relaxed loads.
+     *
+     * @return whether the phase should end.
+     */
+    bool isDone(Clock::time_point now) {
+        if (_done.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        const auto nowNS = now.time_since_epoch().count();
+        auto nextTick = _nextTickNS.load(std::memory_order_relaxed);
+        if (nowNS < nextTick) {
+            return false;
+        }
+        if (!_nextTickNS.compare_exchange_strong(nextTick, nowNS + _bucketNS)) {
+            return _done.load(std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (nextTick == 0) {
+            // First call without a reset(): start the phase now.
+            this->start(nowNS);
+            return false;
+        }
+        this->tick(nowNS);
+        return _done.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Begin a new phase. Safe to call more than once per phase.
+     */
+    void reset(Clock::time_point now) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        this->start(now.time_since_epoch().count());
+    }
+
+    /**
+     * @return the window that met MaxCoV this phase, if any.
+     */
+    std::optional<Window> stableWindow() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _stable;
+    }
+
+    const SteadyStateSpec& spec() const {
+        return _spec;
+    }
+
+private:
+    struct Bucket {
+        int64_t startNS;
+        double value;
+    };
+
+    // Requires _mutex.
+    void start(int64_t nowNS) {
+        _buckets.clear();
+        _stable.reset();
+        _count.exchange(0, std::memory_order_relaxed);
+        _latencySumNS.exchange(0, std::memory_order_relaxed);
+        _startNS = _lastTickNS = nowNS;
+        _nextTickNS = nowNS + _bucketNS;
+        _done = false;
+    }
+
+    // Requires _mutex.
+    void tick(int64_t nowNS) {
+        const auto count = _count.exchange(0, std::memory_order_relaxed);
+        const auto latencySumNS = _latencySumNS.exchange(0, std::memory_order_relaxed);
+        const auto elapsed = nowNS - _lastTickNS;
+
+        double value;
+        if (_spec.metric == SteadyStateSpec::Metric::kThroughput) {
+            value = elapsed > 0 ? count * 1e9 / elapsed : 0;
+        } else {
+            // An empty bucket says nothing about latency, so it can't be steady.
+            value = count > 0 ? double(latencySumNS) / count
+                              : std::numeric_limits<double>::quiet_NaN();
+        }
+        _buckets.push_back({_lastTickNS, value});
+        _lastTickNS = nowNS;
+        while (_buckets.size() > size_t(_spec.buckets)) {
+            _buckets.pop_front();
+        }
+
+        const auto sinceStart = nowNS - _startNS;
+        if (_buckets.size() == size_t(_spec.buckets) && sinceStart >= _minDurationNS) {
+            const auto cov = coefficientOfVariation();
+            if (cov <= _spec.maxCoV) {
+                _stable = Window{Duration{_buckets.front().startNS - _startNS},
+                                 Duration{sinceStart},
+                                 cov};
+                _done = true;
+                this->recordStable();
+                return;
+            }
+        }
+        if (sinceStart >= _spec.maxDuration.count()) {
+            _done = true;
+            const auto maxMillis =
+                std::chrono::duration_cast<std::chrono::milliseconds>(_spec.maxDuration.value);
+            BOOST_LOG_TRIVIAL(warning) << describe() << " did not become steady within "
+                                       << maxMillis.count() << "ms; ending the phase anyway";
+        }
+    }
+
+    // Requires _mutex. NaN unless every bucket has a value and the mean is positive.
+    double coefficientOfVariation() const {
+        double sum = 0;
+        for (const auto& bucket : _buckets) {
+            sum += bucket.value;
+        }
+        const auto mean = sum / _buckets.size();
+        if (!(mean > 0)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        double squares = 0;
+        for (const auto& bucket : _buckets) {
+            squares += (bucket.value - mean) * (bucket.value - mean);
+        }
+        return std::sqrt(squares / _buckets.size()) / mean;
+    }
+
+    // Requires _mutex.
+    void recordStable() {
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+        BOOST_LOG_TRIVIAL(info) << describe() << " became steady with CoV " << _stable->cov
+                                << " over [" << duration_cast<milliseconds>(_stable->start).count()
+                                << "ms, " << duration_cast<milliseconds>(_stable->end).count()
+                                << "ms] of the phase";
+        if (_windowOp) {
+            _windowOp->report(
+                metrics::clock::now(),
+                duration_cast<std::chrono::microseconds>(_stable->end - _stable->start));
+        }
+    }
+
+    std::string describe() const {
+        std::ostringstream out;
+        out << "SteadyState " << _spec.actor << "." << _spec.operation
+            << (_spec.metric == SteadyStateSpec::Metric::kThroughput ? " throughput"
+                                                                     : " latency");
+        return out.str();
+    }
+
+    const SteadyStateSpec _spec;
+    const int64_t _bucketNS;
+    const int64_t _minDurationNS;
+
+    std::atomic_int64_t _count = 0;
+    std::atomic_int64_t _latencySumNS = 0;
+    std::atomic_int64_t _nextTickNS = 0;
+    // Written under _mutex.
+    std::atomic_bool _done = false;
+
+    mutable std::mutex _mutex;
+    int64_t _startNS = 0;
+    int64_t _lastTickNS = 0;
+    std::deque<Bucket> _buckets;
+    std::optional<Window> _stable;
+    std::optional<metrics::Operation> _windowOp;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_9682D91E_3F2B_43B4_AED8_B2E5B9DF557F_INCLUDED
@@ -0,0 +1,153 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_6E0C4B8A_2D71_4F3E_9A55_C1B7E04D3F26_INCLUDED
+#define HEADER_6E0C4B8A_2D71_4F3E_9A55_C1B7E04D3F26_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace genny::v1 {
+
+/**
+ * Records what each Actor spent its time waiting on, for `genny run --trace-file`.
+ *
+ * Every thread that records anything gets a fixed-size ring of compact events that
+ * keeps the most recent ones. Events are spans: the phase-start and phase-end waits
+ * in the Orchestrator, sleeps, rate-limit waits, and one in every `sampleEvery`
+ * operation reported to metrics. writeChromeJson() exports them in the Chrome
+ * trace-event format, which chrome://tracing and ui.perfetto.dev both load.
+ *
+ * Each span is shown on the track of the Actor that recorded it, named with
+ * setTrack(), so the Actor that kept everyone else waiting at the end of a phase
+ * is the one without a long PhaseEndWait.
+ *
+ * When tracing isn't enabled, each instrumented point costs a relaxed load and a
+ * branch that's never taken.
+ */
+class Tracer {
+public:
+    // Names of the spans genny records itself. Operations get theirs from intern().
+    enum Name : uint32_t {
+        kPhaseStartWait = 0,
+        kPhaseEndWait,
+        kSleep,
+        kRateLimitWait,
+    };
+
+    static constexpr size_t kDefaultEventsPerThread = 8 * 1024;
+    static constexpr uint32_t kDefaultSampleEvery = 64;
+    static constexpr uint32_t kNoPhase = UINT32_MAX;
+
+    /**
+     * @return whether spans are being recorded. This is the only check made when
+     * tracing is off.
+     */
+    static bool enabled() noexcept {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Start recording. Call before any Actor starts.
+     *
+     * @param eventsPerThread how many of its most recent events each thread keeps.
+     * @param sampleEvery record one in this many operations on each thread.
+     */
+    static void enable(size_t eventsPerThread = kDefaultEventsPerThread,
+                       uint32_t sampleEvery = kDefaultSampleEvery);
+
+    /**
+     * Stop recording. Recorded events are kept until clear().
+     */
+    static void disable();
+
+    /**
+     * Disable and forget everything recorded. Nothing may be recording.
+     */
+    static void clear();
+
+    /**
+     * @return the current time on the clock spans use.
+     */
+    static int64_t nowNS();
+
+    /**
+     * Record a span on the calling thread's ring.
+     */
+    static void record(uint32_t name, int64_t startNS, int64_t endNS, uint32_t phase = kNoPhase);
+
+    /**
+     * @return the name id to record() spans named `name` with.
+     */
+    static uint32_t intern(const std::string& name);
+
+    /**
+     * Counts operations reported on this thread.
+     *
+     * @return whether this one should be recorded.
+     */
+    static bool sampleOperation();
+
+    /**
+     * Show spans recorded by the calling thread, or by the calling fiber when run
+     * on a v1::FiberPool, on a track with this name.
+     */
+    static void setTrack(const std::string& name);
+
+    /**
+     * Write everything recorded as Chrome trace-event JSON. Nothing may be recording.
+     */
+    static void writeChromeJson(std::ostream& out);
+
+private:
+    static inline std::atomic_bool _enabled = false;
+};
+
+/**
+ * Records the span from its construction to its destruction if tracing was enabled
+ * when it was constructed.
+ *
+ * ```c++
+ * {
+ *     v1::TraceSpan span{v1::Tracer::kPhaseEndWait, phase};
+ *     this->awaitState(State::PhaseEnded);
+ * }
+ * ```
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(uint32_t name, uint32_t phase = Tracer::kNoPhase)
+        : _startNS{Tracer::enabled() ? Tracer::nowNS() : 0}, _name{name}, _phase{phase} {}
+
+    ~TraceSpan() {
+        if (_startNS != 0) {
+            Tracer::record(_name, _startNS, Tracer::nowNS(), _phase);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const int64_t _startNS;
+    const uint32_t _name;
+    const uint32_t _phase;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_6E0C4B8A_2D71_4F3E_9A55_C1B7E04D3F26_INCLUDED
@@ -0,0 +1,106 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_3BE53049_DE4A_429E_BB48_4516F2A109EF_INCLUDED
+#define HEADER_3BE53049_DE4A_429E_BB48_4516F2A109EF_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <yaml-cpp/yaml.h>
+
+namespace genny::v1 {
+
+/**
+ * A workload compiled by `genny compile` so that `genny run` can skip parsing its YAML.
+ *
+ * Parsing is most of what large workloads spend reading their config. A plan is the
+ * parsed document written out depth-first, each node as its type, tag, and then its
+ * scalar, its items, or its keys and values, with every string length-prefixed.
+ * Loading one memory-maps it and builds the YAML::Node tree directly, with no
+ * scanning or tokenizing. Aliases are expanded when compiling.
+ *
+ * A plan records the path of its source and a hash of its contents. If the source
+ * still exists and no longer matches, the plan is stale and the source is loaded
+ * instead. A plan without its source is used as is.
+ *
+ * Plans are only meant to be read by the genny build that wrote them; a plan from
+ * another version is rejected rather than read.
+ */
+class WorkloadPlan {
+public:
+    /**
+     * Bumped whenever the layout changes.
+     */
+    static constexpr uint32_t kVersion = 1;
+
+    /**
+     * @param sourcePath the workload file to compile.
+     * @param planPath where to write the plan.
+     * @throws InvalidConfigurationException if either can't be read or written.
+     */
+    static void compile(const std::string& sourcePath, const std::string& planPath);
+
+    /**
+     * @return whether the file at this path is a plan rather than YAML.
+     */
+    static bool isPlan(const std::string& path);
+
+    /**
+     * Load a plan, or its source if the plan is stale.
+     *
+     * @throws InvalidConfigurationException if the plan is truncated or from another version.
+     */
+    static WorkloadPlan load(const std::string& planPath);
+
+    /**
+     * @return the FNV-1a hash plans record of their source.
+     */
+    static uint64_t hash(std::string_view contents);
+
+    /**
+     * The workload.
+     */
+    const YAML::Node& yaml() const {
+        return _yaml;
+    }
+
+    /**
+     * The workload file the plan was compiled from.
+     */
+    const std::string& sourcePath() const {
+        return _sourcePath;
+    }
+
+    /**
+     * Whether the source had changed since compiling, so it was loaded instead.
+     */
+    bool stale() const {
+        return _stale;
+    }
+
+private:
+    WorkloadPlan(YAML::Node yaml, std::string sourcePath, bool stale)
+        : _yaml{std::move(yaml)}, _sourcePath{std::move(sourcePath)}, _stale{stale} {}
+
+    YAML::Node _yaml;
+    std::string _sourcePath;
+    bool _stale;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_3BE53049_DE4A_429E_BB48_4516F2A109EF_INCLUDED
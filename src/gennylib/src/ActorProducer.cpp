@@ -21,11 +21,15 @@ namespace genny {
 ActorVector ParallelizedActorProducer::produce(ActorContext& context) {
     ActorVector out;
 
-    auto threads = context["Threads"].maybe<int>().value_or(1);
+    auto threads = ParallelizedActorProducer::threads(context);
     for (decltype(threads) i = 0; i < threads; ++i) {
         produceInto(out, context);
     }
     return out;
 }
 
+int ParallelizedActorProducer::threads(ActorContext& context) {
+    return context["Threads"].maybe<int>().value_or(1);
+}
+
 }  // namespace genny
@@ -0,0 +1,79 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/ActorStatus.hpp>
+
+#include <boost/fiber/fss.hpp>
+
+#include <gennylib/v1/FiberPool.hpp>
+
+#include <metrics/operation.hpp>
+
+namespace genny::v1 {
+namespace {
+
+thread_local ActorStatus* threadStatus = nullptr;
+
+// Fibers can move between threads, so a fiber's status has to travel with it. The
+// statuses aren't owned.
+boost::fibers::fiber_specific_ptr<ActorStatus> fiberStatus{[](ActorStatus*) {}};
+
+// Publishes the operation metrics says is running.
+class OperationPublisher : public metrics::OperationListener {
+public:
+    void started(const std::string&, const std::string& opName) override {
+        if (ActorStatus::enabled()) {
+            if (auto* status = ActorStatus::current()) {
+                status->setOperation(&opName);
+            }
+        }
+    }
+
+    void stopped(const std::string&) override {}
+
+    void reported(const std::string&,
+                  const std::string&,
+                  std::chrono::nanoseconds,
+                  std::chrono::nanoseconds) override {}
+};
+
+}  // namespace
+
+
+void ActorStatus::enable() {
+    static OperationPublisher operationPublisher;
+    static std::atomic_bool listening = false;
+    if (!listening.exchange(true)) {
+        metrics::addOperationListener(&operationPublisher);
+    }
+    _enabled = true;
+}
+
+
+ActorStatus* ActorStatus::current() {
+    if (FiberPool::onFiber()) {
+        return fiberStatus.get();
+    }
+    return threadStatus;
+}
+
+void ActorStatus::setCurrent(ActorStatus* status) {
+    if (FiberPool::onFiber()) {
+        fiberStatus.reset(status);
+    } else {
+        threadStatus = status;
+    }
+}
+
+}  // namespace genny::v1
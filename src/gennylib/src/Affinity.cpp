@@ -0,0 +1,232 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/Affinity.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <gennylib/InvalidConfigurationException.hpp>
+
+namespace genny::v1 {
+namespace {
+
+CpuSet without(const CpuSet& cpus, const CpuSet& removed) {
+    CpuSet out;
+    std::set_difference(
+        cpus.begin(), cpus.end(), removed.begin(), removed.end(), std::back_inserter(out));
+    return out;
+}
+
+// Every node's first CPU, then every node's second CPU, and so on.
+CpuSet interleave(const std::vector<CpuSet>& nodes) {
+    CpuSet out;
+    for (size_t i = 0;; ++i) {
+        bool any = false;
+        for (const auto& node : nodes) {
+            if (i < node.size()) {
+                out.push_back(node[i]);
+                any = true;
+            }
+        }
+        if (!any) {
+            return out;
+        }
+    }
+}
+
+#ifdef __linux__
+std::string firstLine(const std::string& path) {
+    std::ifstream file{path};
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// The NUMA nodes as sysfs describes them, or nothing if it doesn't.
+std::vector<CpuSet> sysfsNodes() {
+    const std::string root = "/sys/devices/system/node/";
+    const auto possible = firstLine(root + "possible");
+    if (possible.empty()) {
+        return {};
+    }
+    std::vector<CpuSet> nodes;
+    for (const auto node : YAML::convert<AffinitySpec>::parseCpuList(possible)) {
+        nodes.resize(node + 1);
+        if (const auto cpus = firstLine(root + "node" + std::to_string(node) + "/cpulist");
+            !cpus.empty()) {
+            nodes[node] = YAML::convert<AffinitySpec>::parseCpuList(cpus);
+        }
+    }
+    return nodes;
+}
+#endif
+
+}  // namespace
+
+
+CpuTopology::CpuTopology(std::vector<CpuSet> nodes) : _nodes{std::move(nodes)} {
+    for (auto& node : _nodes) {
+        std::sort(node.begin(), node.end());
+    }
+}
+
+CpuTopology CpuTopology::current() {
+    std::vector<CpuSet> nodes;
+#ifdef __linux__
+    nodes = sysfsNodes();
+#endif
+    if (nodes.empty()) {
+        CpuSet all;
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+            all.push_back(cpu);
+        }
+        nodes.push_back(std::move(all));
+    }
+    if (const auto allowed = threadAffinity(); !allowed.empty()) {
+        for (auto& node : nodes) {
+            CpuSet usable;
+            std::set_intersection(node.begin(),
+                                  node.end(),
+                                  allowed.begin(),
+                                  allowed.end(),
+                                  std::back_inserter(usable));
+            node = std::move(usable);
+        }
+    }
+    return CpuTopology{std::move(nodes)};
+}
+
+CpuSet CpuTopology::allCpus() const {
+    CpuSet out;
+    for (const auto& node : _nodes) {
+        out.insert(out.end(), node.begin(), node.end());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+
+AffinityAssigner::AffinityAssigner(CpuTopology topology, CpuSet reserved)
+    : _topology{std::move(topology)}, _anyReserved{!reserved.empty()} {
+    std::sort(reserved.begin(), reserved.end());
+    if (_anyReserved) {
+        _unreserved = without(_topology.allCpus(), reserved);
+        if (_unreserved.empty()) {
+            throw InvalidConfigurationException(
+                "Metrics Affinity reserves every CPU, leaving none for Actors.");
+        }
+    }
+
+    std::vector<CpuSet> nodes;
+    for (const auto& node : _topology.nodes()) {
+        nodes.push_back(without(node, reserved));
+    }
+    _spread = interleave(nodes);
+    for (const auto& node : nodes) {
+        _compact.insert(_compact.end(), node.begin(), node.end());
+    }
+}
+
+CpuSet AffinityAssigner::next(const std::optional<AffinitySpec>& spec) {
+    if (!spec) {
+        // The thread starting Actors runs on the reserved CPUs, if there are any,
+        // so its Actors' threads need moving off them.
+        return _unreserved;
+    }
+    switch (spec->policy) {
+        case AffinitySpec::Policy::kSpread:
+            if (_spread.empty()) {
+                return {};
+            }
+            return {_spread[_nextSpread++ % _spread.size()]};
+        case AffinitySpec::Policy::kCompact:
+            if (_compact.empty()) {
+                return {};
+            }
+            return {_compact[_nextCompact++ % _compact.size()]};
+        default:
+            return this->cpus(*spec);
+    }
+}
+
+CpuSet AffinityAssigner::cpus(const AffinitySpec& spec) const {
+    std::ostringstream msg;
+    switch (spec.policy) {
+        case AffinitySpec::Policy::kCpus: {
+            const auto missing = without(spec.cpus, _topology.allCpus());
+            if (missing.empty()) {
+                return spec.cpus;
+            }
+            msg << "Affinity names CPU " << missing.front() << " which this process can't use.";
+            break;
+        }
+        case AffinitySpec::Policy::kNumaNode: {
+            const auto& nodes = _topology.nodes();
+            if (size_t(spec.numaNode) < nodes.size() && !nodes[spec.numaNode].empty()) {
+                return nodes[spec.numaNode];
+            }
+            msg << "Affinity names NUMA node " << spec.numaNode
+                << " which has no CPUs this process can use.";
+            break;
+        }
+        default:
+            msg << "Only a CPU list or a NumaNode can be used here, not spread or compact.";
+            break;
+    }
+    throw InvalidConfigurationException(msg.str());
+}
+
+
+bool setThreadAffinity(const CpuSet& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+CpuSet threadAffinity() {
+    CpuSet out;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                out.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return out;
+}
+
+}  // namespace genny::v1
@@ -0,0 +1,38 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/CoarseClock.hpp>
+
+namespace genny::v1 {
+
+const CoarseClock& CoarseClock::get() {
+    static CoarseClock instance;
+    return instance;
+}
+
+CoarseClock::CoarseClock() : _now{clock::now().time_since_epoch().count()} {
+    _ticker = std::thread([this]() {
+        while (!_stop.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(kResolution);
+            _now.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        }
+    });
+}
+
+CoarseClock::~CoarseClock() {
+    _stop = true;
+    _ticker.join();
+}
+
+}  // namespace genny::v1
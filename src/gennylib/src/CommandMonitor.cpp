@@ -0,0 +1,248 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/CommandMonitor.hpp>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <boost/fiber/fss.hpp>
+
+#include <mongocxx/events/command_failed_event.hpp>
+#include <mongocxx/events/command_succeeded_event.hpp>
+
+#include <gennylib/v1/FiberPool.hpp>
+
+namespace genny::v1 {
+namespace {
+
+// One command, waiting for the operation it's reported to.
+struct Sample {
+    metrics::clock::time_point finished;
+    std::chrono::microseconds duration;
+    bool ok;
+    size_t replyBytes;
+};
+
+// Where one Actor reports one command or host. The names are built once.
+struct Destination {
+    std::string actorName;
+    std::string opName;
+    std::optional<metrics::Operation> operation;
+    // Reported before the operation could be created.
+    std::vector<Sample> waiting;
+};
+
+// The Actor the calling thread or fiber runs commands for.
+struct Attribution {
+    std::string actorName;
+    ActorId id;
+
+    // Destinations already looked up. Only the thread or fiber this belongs to reports
+    // to them, and only while it runs as this Actor.
+    metrics::Registry* registry = nullptr;
+    // command -> {the Actor's `Command.<command>`, `Commands.<command>`}
+    std::map<std::string, std::array<Destination, 2>, std::less<>> commands;
+    // host -> port -> `Hosts.<host>:<port>`
+    std::map<std::string, std::map<uint16_t, Destination>, std::less<>> hosts;
+
+    // Operations the Actor started and hasn't stopped, and destinations whose operation
+    // is to be created once there are none.
+    int timing = 0;
+    std::vector<Destination*> waiting;
+};
+
+thread_local std::unique_ptr<Attribution> threadAttribution;
+
+// Fibers can move between threads, so a fiber's Actor has to travel with it.
+boost::fibers::fiber_specific_ptr<Attribution> fiberAttribution;
+
+// The Actor of the fiber a v1::runBlocking() thread is running a task for.
+thread_local Attribution* carriedAttribution = nullptr;
+
+Attribution* currentAttribution() {
+    if (FiberPool::onFiber()) {
+        return fiberAttribution.get();
+    }
+    if (carriedAttribution) {
+        return carriedAttribution;
+    }
+    return threadAttribution.get();
+}
+
+// The fiber waits for the task, so nothing else uses its Attribution meanwhile.
+const bool carried = carryIntoBlocking({
+    []() -> void* { return currentAttribution(); },
+    [](void* captured) -> void* {
+        return std::exchange(carriedAttribution, static_cast<Attribution*>(captured));
+    },
+});
+
+// Beyond this many, a destination's operation is created even while one is timed, in
+// case the Actor never stops it.
+constexpr size_t kMaxWaiting = 1024;
+
+void report(metrics::Operation& operation, const Sample& sample) {
+    const auto outcome =
+        sample.ok ? metrics::OutcomeType::kSuccess : metrics::OutcomeType::kFailure;
+    operation.report(
+        sample.finished, sample.duration, outcome, 1, sample.ok ? 0 : 1, 1, sample.replyBytes);
+}
+
+void create(const Attribution& attribution, Destination& destination) {
+    destination.operation.emplace(attribution.registry->operation(
+        destination.actorName, destination.opName, attribution.id));
+    for (const auto& sample : destination.waiting) {
+        report(*destination.operation, sample);
+    }
+    destination.waiting.clear();
+}
+
+// Creating an operation waits on the metrics collector, so a command reported while the
+// Actor is timing one of its own operations waits for it to stop.
+void record(Attribution& attribution, Destination& destination, const Sample& sample) {
+    if (!destination.operation) {
+        if (attribution.timing > 0 && destination.waiting.size() < kMaxWaiting) {
+            if (destination.waiting.empty()) {
+                attribution.waiting.push_back(&destination);
+            }
+            destination.waiting.push_back(sample);
+            return;
+        }
+        create(attribution, destination);
+    }
+    report(*destination.operation, sample);
+}
+
+// Tracks which operations the Actor is timing, to create operations between them.
+class TimingListener : public metrics::OperationListener {
+public:
+    void started(const std::string&, const std::string&) override {
+        if (auto* attribution = currentAttribution()) {
+            ++attribution->timing;
+        }
+    }
+
+    void stopped(const std::string&) override {
+        auto* attribution = currentAttribution();
+        if (!attribution || attribution->timing == 0 || --attribution->timing > 0) {
+            return;
+        }
+        for (auto* destination : attribution->waiting) {
+            if (!destination->operation) {
+                create(*attribution, *destination);
+            }
+        }
+        attribution->waiting.clear();
+    }
+
+    void reported(const std::string&,
+                  const std::string&,
+                  std::chrono::nanoseconds,
+                  std::chrono::nanoseconds) override {}
+};
+
+template <typename StringView>
+std::string_view view(const StringView& str) {
+    return {str.data(), str.size()};
+}
+
+}  // namespace
+
+
+void CommandMonitor::monitor(mongocxx::options::apm& apm) {
+    static TimingListener timingListener;
+    static std::atomic_bool listening = false;
+    if (!listening.exchange(true)) {
+        metrics::addOperationListener(&timingListener);
+    }
+    apm.on_command_succeeded([this](const mongocxx::events::command_succeeded_event& event) {
+        this->report(view(event.command_name()),
+                     view(event.host()),
+                     event.port(),
+                     std::chrono::microseconds{event.duration()},
+                     true,
+                     event.reply().length());
+    });
+    apm.on_command_failed([this](const mongocxx::events::command_failed_event& event) {
+        this->report(view(event.command_name()),
+                     view(event.host()),
+                     event.port(),
+                     std::chrono::microseconds{event.duration()},
+                     false);
+    });
+}
+
+void CommandMonitor::setActor(const std::string& actorName, ActorId id) {
+    auto attribution = std::make_unique<Attribution>();
+    attribution->actorName = actorName;
+    attribution->id = id;
+    if (FiberPool::onFiber()) {
+        fiberAttribution.reset(attribution.release());
+    } else {
+        threadAttribution = std::move(attribution);
+    }
+}
+
+void CommandMonitor::report(std::string_view command,
+                            std::string_view host,
+                            uint16_t port,
+                            std::chrono::microseconds duration,
+                            bool ok,
+                            size_t replyBytes) {
+    auto* attribution = currentAttribution();
+    if (!attribution) {
+        return;
+    }
+    if (attribution->registry != _registry) {
+        attribution->commands.clear();
+        attribution->hosts.clear();
+        attribution->waiting.clear();
+        attribution->registry = _registry;
+    }
+    const Sample sample{metrics::clock::now(), duration, ok, replyBytes};
+
+    auto byCommand = attribution->commands.find(command);
+    if (byCommand == attribution->commands.end()) {
+        std::string name{command};
+        auto destinations = std::array<Destination, 2>{
+            Destination{attribution->actorName, "Command." + name, {}, {}},
+            Destination{"Commands", name, {}, {}}};
+        byCommand =
+            attribution->commands.emplace(std::move(name), std::move(destinations)).first;
+    }
+    auto byHost = attribution->hosts.find(host);
+    if (byHost == attribution->hosts.end()) {
+        byHost = attribution->hosts.emplace(std::string{host}, std::map<uint16_t, Destination>{})
+                     .first;
+    }
+    auto byPort = byHost->second.find(port);
+    if (byPort == byHost->second.end()) {
+        auto name = byHost->first + ":" + std::to_string(port);
+        byPort = byHost->second.emplace(port, Destination{"Hosts", std::move(name), {}, {}}).first;
+    }
+
+    for (auto& destination : byCommand->second) {
+        record(*attribution, destination, sample);
+    }
+    record(*attribution, byPort->second, sample);
+}
+
+}  // namespace genny::v1
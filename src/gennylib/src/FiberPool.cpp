@@ -0,0 +1,337 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/Tracer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/fiber/algo/algorithm.hpp>
+#include <boost/fiber/context.hpp>
+#include <boost/fiber/fiber.hpp>
+#include <boost/fiber/fixedsize_stack.hpp>
+#include <boost/fiber/future.hpp>
+#include <boost/fiber/operations.hpp>
+#include <boost/fiber/scheduler.hpp>
+
+namespace genny::v1 {
+namespace {
+
+// Numbers every worker thread of every pool, starting at 1. 0 means not a worker.
+std::atomic<size_t> workersStarted = 0;
+thread_local size_t currentWorker = 0;
+
+// Fibers that are ready to run on any of one pool's workers.
+struct SharedQueue {
+    std::mutex mutex;
+    // Signalled when a fiber is queued or a specific worker was notify()'d.
+    std::condition_variable ready;
+    std::deque<boost::fibers::context*> contexts;
+};
+
+/**
+ * Like boost::fibers::algo::shared_work, except the queue belongs to one pool rather
+ * than to the whole process, so there can be more than one pool over a process's life.
+ */
+class SharedWork : public boost::fibers::algo::algorithm {
+public:
+    explicit SharedWork(SharedQueue& shared) : _shared{shared} {}
+
+    void awakened(boost::fibers::context* ctx) noexcept override {
+        if (ctx->is_context(boost::fibers::type::pinned_context)) {
+            // The worker's own main and dispatcher fibers can't move.
+            _local.push_back(*ctx);
+            return;
+        }
+        ctx->detach();
+        {
+            std::lock_guard<std::mutex> lock{_shared.mutex};
+            _shared.contexts.push_back(ctx);
+        }
+        _shared.ready.notify_one();
+    }
+
+    boost::fibers::context* pick_next() noexcept override {
+        std::unique_lock<std::mutex> lock{_shared.mutex};
+        if (!_shared.contexts.empty()) {
+            auto ctx = _shared.contexts.front();
+            _shared.contexts.pop_front();
+            lock.unlock();
+            boost::fibers::context::active()->attach(ctx);
+            return ctx;
+        }
+        lock.unlock();
+        if (!_local.empty()) {
+            auto ctx = &_local.front();
+            _local.pop_front();
+            return ctx;
+        }
+        return nullptr;
+    }
+
+    bool has_ready_fibers() const noexcept override {
+        std::lock_guard<std::mutex> lock{_shared.mutex};
+        return !_shared.contexts.empty() || !_local.empty();
+    }
+
+    void suspend_until(const std::chrono::steady_clock::time_point& until) noexcept override {
+        std::unique_lock<std::mutex> lock{_shared.mutex};
+        auto wake = [&]() { return _notified || !_shared.contexts.empty(); };
+        _idle = true;
+        if (until == std::chrono::steady_clock::time_point::max()) {
+            _shared.ready.wait(lock, wake);
+        } else {
+            _shared.ready.wait_until(lock, until, wake);
+        }
+        _idle = false;
+        _notified = false;
+    }
+
+    void notify() noexcept override {
+        // This is called for every fiber another thread wakes, e.g. once per Actor at
+        // each phase transition, so only make a system call if we're actually idle.
+        std::unique_lock<std::mutex> lock{_shared.mutex};
+        _notified = true;
+        if (_idle) {
+            lock.unlock();
+            // Every idle worker waits on the same condition variable, so wake them
+            // all to be sure this one hears it.
+            _shared.ready.notify_all();
+        }
+    }
+
+private:
+    SharedQueue& _shared;
+    boost::fibers::scheduler::ready_queue_type _local;
+    // Guarded by _shared.mutex.
+    bool _notified = false;
+    bool _idle = false;
+};
+
+/**
+ * The threads behind v1::runBlocking(). A thread is added whenever a task would
+ * otherwise have to queue, and threads that have been idle for a while exit.
+ */
+class BlockingPool {
+public:
+    static constexpr std::chrono::seconds kIdleTimeout{10};
+
+    static BlockingPool& get() {
+        // Leaked so idle threads can't outlive it during static destruction.
+        static auto* pool = new BlockingPool;
+        return *pool;
+    }
+
+    void submit(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _tasks.push_back(std::move(task));
+        if (_tasks.size() > _idle) {
+            std::thread{[this]() { this->work(); }}.detach();
+        } else {
+            _ready.notify_one();
+        }
+    }
+
+private:
+    void work() {
+        std::unique_lock<std::mutex> lock{_mutex};
+        while (true) {
+            ++_idle;
+            const auto woken =
+                _ready.wait_for(lock, kIdleTimeout, [&]() { return !_tasks.empty(); });
+            --_idle;
+            if (!woken) {
+                return;
+            }
+            auto task = std::move(_tasks.front());
+            _tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::deque<std::function<void()>> _tasks;
+    size_t _idle = 0;
+};
+
+// Everything carryIntoBlocking() has been given. Only added to during static
+// initialization, so it's read without a lock.
+std::vector<BlockingCarry>& carries() {
+    static std::vector<BlockingCarry> carries;
+    return carries;
+}
+
+}  // namespace
+
+
+struct FiberPool::State {
+    // How often each worker looks for launched tasks and checks whether it's done.
+    // Polling means launch() and finishing fibers never wake a worker, which matters
+    // when starting tens of thousands of fibers: waking a fiber on another thread
+    // goes through spinlocks that behave badly when there are more threads than cores.
+    static constexpr std::chrono::milliseconds kPollInterval{1};
+
+    explicit State(size_t stackSize) : stackSize{stackSize} {}
+
+    const size_t stackSize;
+    SharedQueue shared;
+    std::vector<std::thread> workers;
+
+    // Launched but not yet finished.
+    std::atomic<size_t> running = 0;
+
+    // Guards the members below.
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    bool closed = false;
+};
+
+FiberPool::FiberPool(size_t workers, size_t stackSize)
+    : _state{std::make_unique<State>(stackSize)} {
+    if (workers == 0) {
+        throw std::invalid_argument("A FiberPool needs at least one worker");
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        _state->workers.emplace_back([state = _state.get()]() {
+            currentWorker = ++workersStarted;
+            boost::fibers::use_scheduling_algorithm<SharedWork>(state->shared);
+
+            // This main fiber only turns tasks into fibers. Sleeping in between
+            // lets the worker run them.
+            while (true) {
+                std::deque<std::function<void()>> tasks;
+                bool closed;
+                {
+                    std::lock_guard<std::mutex> lock{state->mutex};
+                    tasks.swap(state->tasks);
+                    closed = state->closed;
+                }
+                for (auto& task : tasks) {
+                    boost::fibers::fiber{std::allocator_arg,
+                                         boost::fibers::fixedsize_stack{state->stackSize},
+                                         [state, task = std::move(task)]() {
+                                             task();
+                                             --state->running;
+                                         }}
+                        .detach();
+                }
+                // Anything launched before join() was in `tasks` or counted by
+                // `running` by the time we saw `closed`.
+                if (closed && tasks.empty() && state->running == 0) {
+                    return;
+                }
+                boost::this_fiber::sleep_for(State::kPollInterval);
+            }
+        });
+    }
+}
+
+FiberPool::~FiberPool() {
+    this->join();
+}
+
+void FiberPool::launch(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock{_state->mutex};
+    if (_state->closed) {
+        throw std::logic_error("Can't launch onto a FiberPool after join()");
+    }
+    _state->tasks.push_back(std::move(task));
+    ++_state->running;
+}
+
+void FiberPool::join() {
+    {
+        std::lock_guard<std::mutex> lock{_state->mutex};
+        _state->closed = true;
+    }
+    for (auto& worker : _state->workers) {
+        worker.join();
+    }
+    _state->workers.clear();
+}
+
+bool FiberPool::onFiber() {
+    return currentWorker != 0;
+}
+
+size_t FiberPool::workerNumber() {
+    return currentWorker;
+}
+
+void sleepFor(Duration duration) {
+    TraceSpan span{Tracer::kSleep};
+    if (FiberPool::onFiber()) {
+        boost::this_fiber::sleep_for(duration);
+    } else {
+        std::this_thread::sleep_for(duration);
+    }
+}
+
+bool carryIntoBlocking(BlockingCarry carry) {
+    carries().push_back(carry);
+    return true;
+}
+
+namespace detail {
+
+void runOnBlockingPool(const std::function<void()>& task) {
+    const auto& carried = carries();
+    std::vector<void*> captured;
+    captured.reserve(carried.size());
+    for (const auto& carry : carried) {
+        captured.push_back(carry.capture());
+    }
+
+    // Shared so the pool thread can't touch it after the fiber has moved on.
+    auto done = std::make_shared<boost::fibers::promise<void>>();
+    auto finished = done->get_future();
+    BlockingPool::get().submit([done, &task, &carried, &captured]() {
+        // The pool thread's own state is put back before the fiber can resume and
+        // free what was captured.
+        std::vector<void*> previous;
+        previous.reserve(carried.size());
+        for (size_t i = 0; i < carried.size(); ++i) {
+            previous.push_back(carried[i].install(captured[i]));
+        }
+        auto restore = [&]() {
+            for (size_t i = 0; i < carried.size(); ++i) {
+                carried[i].install(previous[i]);
+            }
+        };
+        try {
+            task();
+            restore();
+            done->set_value();
+        } catch (...) {
+            restore();
+            done->set_exception(std::current_exception());
+        }
+    });
+    finished.get();
+}
+
+}  // namespace detail
+
+}  // namespace genny::v1
@@ -1,6 +1,7 @@
 #include <utility>
 
 #include <map>
+#include <mutex>
 
 #include <gennylib/Node.hpp>
 
@@ -63,6 +64,10 @@ NodeSource::NodeSource(std::string yaml, std::string path)
     : _yaml{parse(std::move(yaml), path)},
       _root{std::make_unique<Node>(v1::NodeKey::Path{v1::NodeKey{path}}, _yaml)} {}
 
+NodeSource::NodeSource(YAML::Node yaml, std::string path)
+    : _yaml{std::move(yaml)},
+      _root{std::make_unique<Node>(v1::NodeKey::Path{v1::NodeKey{path}}, _yaml)} {}
+
 NodeSource::~NodeSource() = default;
 
 
@@ -151,13 +156,19 @@ public:
           _path{path} {}
 
     const Node& get(const v1::NodeKey& key) const {
-        auto&& it = _children.find(key);
-        if (it == _children.end()) {
+        if (auto it = _children.find(key); it != _children.end()) {
+            return *it->second;
+        }
+        // Actors constructed in parallel can look up the same missing key.
+        std::lock_guard<std::mutex> lock{_zombiesMutex};
+        auto it = _zombies.find(key);
+        if (it == _zombies.end()) {
             v1::NodeKey::Path childPath = _self->_impl->_path;
             childPath.push_back(key);
-            _children.emplace(key, std::make_unique<Node>(std::move(childPath), _zombie));
+            it = _zombies.emplace(key, std::make_unique<Node>(std::move(childPath), _zombie))
+                     .first;
         }
-        return *_children.at(key);
+        return *it->second;
     }
 
     const YAML::Node yaml() const {
@@ -249,9 +260,11 @@ private:
     static const YAML::Node _zombie;
 
     const Node* _self;
-    // these 2 need to be mutable to generate placeholder nodes for non-existent keys.
-    mutable ChildKeys _keyOrder;  // maintain insertion-order
-    mutable Children _children;
+    ChildKeys _keyOrder;  // maintain insertion-order
+    const Children _children;
+    // Placeholder nodes for non-existent keys, generated on demand.
+    mutable std::mutex _zombiesMutex;
+    mutable Children _zombies;
     const YAML::Node _yaml;
     const v1::NodeKey::Path _path;
 };
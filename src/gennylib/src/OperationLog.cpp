@@ -0,0 +1,242 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/OperationLog.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+#include <zlib.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+
+namespace genny::v1 {
+namespace {
+
+constexpr char kMagic[8] = {'G', 'E', 'N', 'N', 'Y', 'O', 'P', 'S'};
+
+template <typename T>
+void appendValue(std::string& out, T value) {
+    static_assert(std::is_arithmetic_v<T>);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendString(std::string& out, std::string_view str) {
+    appendValue(out, uint32_t(str.size()));
+    out.append(str.data(), str.size());
+}
+
+// Reads a log's header and blocks out of the mapping, or a block's records out of
+// its buffer.
+class Cursor {
+public:
+    Cursor(const char* data, size_t size, size_t pos, const std::string& path)
+        : _data{data}, _size{size}, _pos{pos}, _path{path} {}
+
+    template <typename T>
+    T read() {
+        need(sizeof(T));
+        T out;
+        std::memcpy(&out, _data + _pos, sizeof(T));
+        _pos += sizeof(T);
+        return out;
+    }
+
+    std::string_view readBytes(size_t size) {
+        need(size);
+        std::string_view out{_data + _pos, size};
+        _pos += size;
+        return out;
+    }
+
+    std::string_view readString() {
+        return readBytes(read<uint32_t>());
+    }
+
+    size_t pos() const {
+        return _pos;
+    }
+
+    [[noreturn]] void fail(const std::string& why) const {
+        throw InvalidConfigurationException("Can't read operation log '" + _path + "': " + why);
+    }
+
+private:
+    void need(size_t bytes) const {
+        if (_size - _pos < bytes) {
+            fail("it's truncated");
+        }
+    }
+
+    const char* _data;
+    const size_t _size;
+    size_t _pos;
+    const std::string& _path;
+};
+
+}  // namespace
+
+
+OperationLogWriter::OperationLogWriter(const std::string& path,
+                                       const std::string& actorName,
+                                       ActorId id)
+    : _path{path}, _out{path, std::ios::binary | std::ios::trunc} {
+    std::string header{kMagic, sizeof(kMagic)};
+    appendValue(header, kVersion);
+    appendValue(header, uint32_t(id));
+    appendString(header, actorName);
+    _out.write(header.data(), header.size());
+    if (!_out) {
+        throw InvalidConfigurationException("Can't create operation log '" + _path + "'");
+    }
+    _block.reserve(kBlockSize);
+}
+
+OperationLogWriter::~OperationLogWriter() {
+    try {
+        this->close();
+    } catch (const InvalidConfigurationException&) {
+        // Only close() can report it.
+    }
+}
+
+void OperationLogWriter::append(const LoggedOperation& operation) {
+    appendValue(_block, int64_t(operation.offset.count()));
+    appendString(_block, operation.database);
+    appendString(_block, operation.command);
+    ++_count;
+    if (_block.size() >= kBlockSize) {
+        this->_writeBlock();
+    }
+}
+
+void OperationLogWriter::close() {
+    if (!_out.is_open()) {
+        return;
+    }
+    this->_writeBlock();
+    _out.close();
+    if (!_out) {
+        throw InvalidConfigurationException("Can't write operation log '" + _path + "'");
+    }
+}
+
+void OperationLogWriter::_writeBlock() {
+    if (_block.empty()) {
+        return;
+    }
+    auto compressedSize = compressBound(_block.size());
+    _compressed.resize(compressedSize + 2 * sizeof(uint32_t));
+    // Recorded commands are mostly generated documents that compress well even at
+    // the fastest level, and the Actor is waiting.
+    const auto status =
+        compress2(reinterpret_cast<Bytef*>(&_compressed[2 * sizeof(uint32_t)]),
+                  &compressedSize,
+                  reinterpret_cast<const Bytef*>(_block.data()),
+                  _block.size(),
+                  Z_BEST_SPEED);
+    if (status != Z_OK) {
+        throw InvalidConfigurationException("Can't compress operation log '" + _path + "'");
+    }
+    const uint32_t sizes[] = {uint32_t(_block.size()), uint32_t(compressedSize)};
+    std::memcpy(&_compressed[0], sizes, sizeof(sizes));
+    _out.write(_compressed.data(), sizeof(sizes) + compressedSize);
+    _block.clear();
+    if (!_out) {
+        throw InvalidConfigurationException("Can't write operation log '" + _path + "'");
+    }
+}
+
+
+struct OperationLogReader::Mapping {
+    boost::interprocess::file_mapping file;
+    boost::interprocess::mapped_region region;
+
+    const char* data() const {
+        return static_cast<const char*>(region.get_address());
+    }
+
+    size_t size() const {
+        return region.get_size();
+    }
+};
+
+OperationLogReader::OperationLogReader(const std::string& path) : _path{path} {
+    namespace ipc = boost::interprocess;
+    try {
+        ipc::file_mapping file{path.c_str(), ipc::read_only};
+        ipc::mapped_region region{file, ipc::read_only};
+        _mapping = std::make_unique<Mapping>(Mapping{std::move(file), std::move(region)});
+    } catch (const ipc::interprocess_exception& ex) {
+        throw InvalidConfigurationException("Can't map operation log '" + path +
+                                            "': " + ex.what());
+    }
+
+    Cursor header{_mapping->data(), _mapping->size(), 0, _path};
+    if (header.readBytes(sizeof(kMagic)) != std::string_view{kMagic, sizeof(kMagic)}) {
+        header.fail("it isn't an operation log");
+    }
+    if (const auto version = header.read<uint32_t>(); version != OperationLogWriter::kVersion) {
+        header.fail("it's version " + std::to_string(version) + " but this genny reads version " +
+                    std::to_string(OperationLogWriter::kVersion) + ". Record it again.");
+    }
+    _actorId = header.read<uint32_t>();
+    _actorName = std::string{header.readString()};
+    _firstBlock = _nextBlock = header.pos();
+}
+
+OperationLogReader::~OperationLogReader() = default;
+OperationLogReader::OperationLogReader(OperationLogReader&&) noexcept = default;
+OperationLogReader& OperationLogReader::operator=(OperationLogReader&&) noexcept = default;
+
+bool OperationLogReader::next(LoggedOperation& out) {
+    if (_pos == _block.size()) {
+        if (_nextBlock == _mapping->size()) {
+            return false;
+        }
+        Cursor blocks{_mapping->data(), _mapping->size(), _nextBlock, _path};
+        const auto rawSize = blocks.read<uint32_t>();
+        const auto compressed = blocks.readString();
+        _nextBlock = blocks.pos();
+
+        _block.resize(rawSize);
+        uLongf size = rawSize;
+        if (uncompress(reinterpret_cast<Bytef*>(&_block[0]),
+                       &size,
+                       reinterpret_cast<const Bytef*>(compressed.data()),
+                       compressed.size()) != Z_OK ||
+            size != rawSize) {
+            blocks.fail("a block is corrupt");
+        }
+        _pos = 0;
+    }
+
+    Cursor records{_block.data(), _block.size(), _pos, _path};
+    out.offset = std::chrono::nanoseconds{records.read<int64_t>()};
+    out.database = records.readString();
+    out.command = records.readString();
+    _pos = records.pos();
+    return true;
+}
+
+void OperationLogReader::rewind() {
+    _nextBlock = _firstBlock;
+    _block.clear();
+    _pos = 0;
+}
+
+}  // namespace genny::v1
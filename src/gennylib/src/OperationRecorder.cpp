@@ -0,0 +1,207 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/OperationRecorder.hpp>
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+#include <boost/fiber/fss.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+
+namespace genny::v1 {
+namespace {
+
+namespace fs = boost::filesystem;
+
+const std::string kPrefix = "actor-";
+const std::string kExtension = ".ops";
+
+// The log the calling thread or fiber records to.
+struct Attachment {
+    const OperationRecorder* recorder;
+    std::string actorName;
+    OperationLogWriter* log;
+};
+
+thread_local std::unique_ptr<Attachment> threadAttachment;
+
+// Fibers can move between threads, so a fiber's log has to travel with it.
+boost::fibers::fiber_specific_ptr<Attachment> fiberAttachment;
+
+// The log of the fiber a v1::runBlocking() thread is running a task for.
+thread_local Attachment* carriedAttachment = nullptr;
+
+Attachment* currentAttachment() {
+    if (FiberPool::onFiber()) {
+        return fiberAttachment.get();
+    }
+    if (carriedAttachment) {
+        return carriedAttachment;
+    }
+    return threadAttachment.get();
+}
+
+// CrudActor runs its commands through runBlocking() under --fibers.
+const bool carried = carryIntoBlocking({
+    []() -> void* { return currentAttachment(); },
+    [](void* captured) -> void* {
+        return std::exchange(carriedAttachment, static_cast<Attachment*>(captured));
+    },
+});
+
+// Commands that can't be run again outside the connection and session they were on.
+const std::unordered_set<std::string_view> kUnrecorded = {
+    "getMore",
+    "killCursors",
+    "endSessions",
+    "commitTransaction",
+    "abortTransaction",
+};
+
+// Fields the driver adds for the connection or session a command was sent on.
+const std::unordered_set<std::string_view> kSessionFields = {
+    "$db",
+    "$clusterTime",
+    "$readPreference",
+    "lsid",
+    "txnNumber",
+    "autocommit",
+    "startTransaction",
+};
+
+template <typename StringView>
+std::string_view view(const StringView& str) {
+    return {str.data(), str.size()};
+}
+
+}  // namespace
+
+
+OperationRecorder::OperationRecorder(std::string directory)
+    : _directory{std::move(directory)}, _started{std::chrono::steady_clock::now()} {
+    boost::system::error_code error;
+    fs::create_directories(_directory, error);
+    if (error) {
+        throw InvalidConfigurationException("Can't create recording directory '" + _directory +
+                                            "': " + error.message());
+    }
+}
+
+PoolManager::OnCommandStartCallback OperationRecorder::callback() {
+    return [this](const mongocxx::events::command_started_event& event) {
+        this->record(view(event.command_name()), view(event.database_name()), event.command());
+    };
+}
+
+void OperationRecorder::start() {
+    _started = std::chrono::steady_clock::now();
+}
+
+void OperationRecorder::attach(const std::string& actorName, ActorId id) {
+    OperationLogWriter* log = nullptr;
+    try {
+        std::lock_guard<std::mutex> lock{_lock};
+        auto it = _logs.find(id);
+        if (it == _logs.end()) {
+            const auto path = fs::path(_directory) / (kPrefix + std::to_string(id) + kExtension);
+            auto writer = std::make_unique<OperationLogWriter>(path.string(), actorName, id);
+            it = _logs.emplace(id, std::move(writer)).first;
+        }
+        log = it->second.get();
+    } catch (const InvalidConfigurationException& ex) {
+        BOOST_LOG_TRIVIAL(error) << "Not recording " << actorName << ": " << ex.what();
+    }
+
+    auto attachment = std::make_unique<Attachment>(Attachment{this, actorName, log});
+    if (FiberPool::onFiber()) {
+        fiberAttachment.reset(attachment.release());
+    } else {
+        threadAttachment = std::move(attachment);
+    }
+}
+
+void OperationRecorder::record(std::string_view commandName,
+                               std::string_view database,
+                               bsoncxx::document::view command) noexcept {
+    auto* attachment = currentAttachment();
+    if (!attachment || attachment->recorder != this || !attachment->log) {
+        return;
+    }
+    // The driver hides the bodies of handshake and authentication commands.
+    if (command.empty() || kUnrecorded.count(commandName) > 0) {
+        return;
+    }
+    const auto started = std::chrono::steady_clock::now() - _started;
+
+    try {
+        bsoncxx::builder::basic::document recorded;
+        for (const auto& element : command) {
+            if (kSessionFields.count(view(element.key())) == 0) {
+                recorded.append(bsoncxx::builder::basic::kvp(element.key(), element.get_value()));
+            }
+        }
+        const auto bson = recorded.view();
+        attachment->log->append(
+            {started, database, {reinterpret_cast<const char*>(bson.data()), bson.length()}});
+    } catch (const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "Stopped recording " << attachment->actorName << ": "
+                                 << ex.what();
+        attachment->log = nullptr;
+    }
+}
+
+size_t OperationRecorder::close() {
+    std::lock_guard<std::mutex> lock{_lock};
+    size_t recorded = 0;
+    for (auto& [id, log] : _logs) {
+        log->close();
+        recorded += log->count();
+    }
+    return recorded;
+}
+
+std::vector<std::string> OperationRecorder::logs(const std::string& directory) {
+    std::vector<std::pair<unsigned long, std::string>> found;
+    boost::system::error_code error;
+    for (fs::directory_iterator it{directory, error}, end; !error && it != end; ++it) {
+        const auto name = it->path().filename().string();
+        if (name.size() <= kPrefix.size() + kExtension.size() || name.rfind(kPrefix, 0) != 0 ||
+            it->path().extension() != kExtension) {
+            continue;
+        }
+        const auto id =
+            name.substr(kPrefix.size(), name.size() - kPrefix.size() - kExtension.size());
+        if (id.find_first_not_of("0123456789") == std::string::npos) {
+            found.emplace_back(std::stoul(id), it->path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> out;
+    for (auto& [id, path] : found) {
+        out.push_back(std::move(path));
+    }
+    return out;
+}
+
+}  // namespace genny::v1
@@ -13,12 +13,22 @@
 // limitations under the License.
 
 #include <gennylib/Orchestrator.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/ProcessGroup.hpp>
+#include <gennylib/v1/Tracer.hpp>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include <boost/log/trivial.hpp>
 
 #include <algorithm>  // std::max
 #include <cassert>
 #include <chrono>
+#include <climits>
 
 namespace {
 
@@ -29,32 +39,33 @@ inline constexpr bool morePhaseLogic(genny::PhaseNumber currentPhase,
     return currentPhase <= maxPhase && !errors;
 }
 
+using SteadyClock = std::chrono::steady_clock;
+
+int64_t nowNanos() {
+    return SteadyClock::now().time_since_epoch().count();
+}
+
 }  // namespace
 
 
 namespace genny {
 
-/*
- * Multiple readers can access at same time, but only one writer.
- * Use reader when only reading internal state, but use writer whenever changing it.
- */
 /** @private */
-using reader = std::shared_lock<std::shared_mutex>;
-/** @private */
-using writer = std::unique_lock<std::shared_mutex>;
+using writer = std::lock_guard<std::mutex>;
 
-PhaseNumber Orchestrator::currentPhase() const {
-    reader lock{_mutex};
+Orchestrator::Orchestrator(v1::ProcessGroup& group)
+    : _group{&group}, _barrier{group.orchestratorBarrier()} {}
 
-    return this->_current;
+PhaseNumber Orchestrator::currentPhase() const {
+    return phaseOf(_barrier.phaseState.load(std::memory_order_acquire));
 }
 
 bool Orchestrator::continueRunning() const {
     // Be careful when changing this.
     //
     // In particular, stay away from changes that want to add
-    //     reader lock{_mutex}
-    // here. This is a performance-killer, so the _errors state
+    //     writer lock{_mutex}
+    // here. This is a performance-killer, so the errors state
     // isn't guarded by the Orchestrator's mutex.
     //
     // This method is called in a tight loop by every Actor
@@ -65,60 +76,69 @@ bool Orchestrator::continueRunning() const {
     // PhaseLoop_perf_test.cpp deals heavily with the performance
     // implications of this method.
     //
-    return !this->_errors;
+    return !_barrier.errors;
 }
 
 bool Orchestrator::morePhases() const {
-    reader lock{_mutex};
-
-    return morePhaseLogic(this->_current, this->_max, this->_errors);
+    return morePhaseLogic(this->currentPhase(), _barrier.max, _barrier.errors);
 }
 
 // we start once we have required number of tokens
 PhaseNumber Orchestrator::awaitPhaseStart(bool block, int addTokens) {
-    writer lock{_mutex};
-    assert(state == State::PhaseEnded || this->_errors);
+    assert(stateOf(_barrier.phaseState) == State::PhaseEnded || _barrier.errors);
+    this->noteArrival();
 
-    _currentTokens += addTokens;
+    const auto currentPhase = this->currentPhase();
+    v1::TraceSpan span{v1::Tracer::kPhaseStartWait, currentPhase};
+    const auto tokens = _barrier.currentTokens.fetch_add(addTokens) + addTokens;
 
-    const auto currentPhase = this->_current;
-    if (_currentTokens >= _requireTokens) {
-        for (auto&& cb : _prePhaseHooks) {
-            cb(this);
-        }
-        BOOST_LOG_TRIVIAL(debug) << "Beginning phase " << currentPhase;
-        _phaseChange.notify_all();
-        state = State::PhaseStarted;
-    } else {
-        if (block) {
-            while (state != State::PhaseStarted && !this->_errors) {
-                _phaseChange.wait(lock);
-            }
+    if (tokens >= _barrier.requireTokens) {
+        writer lock{_mutex};
+        // Only the first caller to get here, in any process, starts the phase.
+        auto ended = pack(currentPhase, State::PhaseEnded);
+        const auto started = pack(currentPhase, State::PhaseStarted);
+        if (_barrier.claimedState.compare_exchange_strong(ended, started)) {
+            this->runHooks(started, true);
+            _barrier.startSkewNanos = this->takeSkewNanos();
+            BOOST_LOG_TRIVIAL(debug) << "Beginning phase " << currentPhase;
+            this->publish(started);
         }
+    } else if (block) {
+        this->awaitState(State::PhaseStarted);
     }
+    this->catchUpHooks();
     return currentPhase;
 }
 
 void Orchestrator::addRequiredTokens(int tokens) {
     writer lock{_mutex};
 
-    this->_requireTokens += tokens;
+    _barrier.requireTokens += tokens;
 }
 
 void Orchestrator::phasesAtLeastTo(PhaseNumber minPhase) {
     writer lock{_mutex};
-    this->_max = std::max(this->_max, minPhase);
+    // Other processes in the group can be raising it too.
+    auto max = _barrier.max.load();
+    while (max < minPhase && !_barrier.max.compare_exchange_weak(max, minPhase)) {
+    }
 }
 
 // we end once no more tokens left
 bool Orchestrator::awaitPhaseEnd(bool block, int removeTokens) {
-    writer lock{_mutex};
-    assert(State::PhaseStarted == state || this->_errors);
+    assert(State::PhaseStarted == stateOf(_barrier.phaseState) || _barrier.errors);
+    this->catchUpHooks();
+    // Actors that don't block don't hold the phase open, so they don't count toward skew.
+    if (block) {
+        this->noteArrival();
+    }
 
-    _currentTokens -= removeTokens;
+    const auto currentPhase = this->currentPhase();
+    v1::TraceSpan span{v1::Tracer::kPhaseEndWait, currentPhase};
+    const auto tokens = _barrier.currentTokens.fetch_sub(removeTokens) - removeTokens;
 
-    // Not clear if we should allow _currentTokens to drop below zero
-    // and if below check should be `if (_currentTokens == 0)`.
+    // Not clear if we should allow currentTokens to drop below zero
+    // and if below check should be `if (currentTokens == 0)`.
     //
     // - defensive programming says that a bug could cause it to go below zero
     //   and if that happens and we're comparing == 0, then the workload will
@@ -135,47 +155,179 @@ bool Orchestrator::awaitPhaseEnd(bool block, int removeTokens) {
     // Similar thing applies to the block in awaitPhaseStart() where we
     // compare with >= rather than ==.
 
-    if (_currentTokens <= 0) {
-        ++_current;
-        BOOST_LOG_TRIVIAL(debug) << "Ended phase " << (this->_current - 1);
-        _phaseChange.notify_all();
-        state = State::PhaseEnded;
-    } else {
-        if (block) {
-            while (state != State::PhaseEnded && !this->_errors) {
-                _phaseChange.wait(lock);
-            }
+    if (tokens <= 0) {
+        writer lock{_mutex};
+        // Only the first caller to get here, in any process, ends the phase.
+        auto started = pack(currentPhase, State::PhaseStarted);
+        const auto ended = pack(currentPhase + 1, State::PhaseEnded);
+        if (_barrier.claimedState.compare_exchange_strong(started, ended)) {
+            _barrier.endSkewNanos = this->takeSkewNanos();
+            BOOST_LOG_TRIVIAL(debug) << "Ended phase " << currentPhase;
+            this->publish(ended);
         }
+    } else if (block) {
+        this->awaitState(State::PhaseEnded);
     }
-    return morePhaseLogic(this->_current, this->_max, this->_errors);
+    return morePhaseLogic(this->currentPhase(), _barrier.max, _barrier.errors);
 }
 
 
 void Orchestrator::addPrePhaseStartHook(const OrchestratorCB& f) {
+    writer lock{_mutex};
     _prePhaseHooks.push_back(f);
 }
 
 void Orchestrator::abort() {
     writer lock{_mutex};
-    this->_errors = true;
-    _phaseChange.notify_all();
+    _barrier.errors = true;
+    this->publish(_barrier.phaseState.load());
+}
+
+std::optional<PhaseNumber> Orchestrator::endPhase() {
+    const auto state = _barrier.phaseState.load();
+    if (stateOf(state) != State::PhaseStarted) {
+        return std::nullopt;
+    }
+    const uint64_t endBefore = phaseOf(state) + 1;
+    auto seen = _barrier.endBefore.load();
+    while (seen < endBefore && !_barrier.endBefore.compare_exchange_weak(seen, endBefore)) {
+    }
+    return phaseOf(state);
 }
 
 void Orchestrator::sleepToPhaseEnd(Duration timeout, const PhaseNumber pn) {
-    using SteadyClock = std::chrono::steady_clock;
+    v1::TraceSpan span{v1::Tracer::kSleep, pn};
     const auto sleepEnd = SteadyClock::now() + timeout;
 
-    reader lock{_mutex};
-
     // While loop to handle spurious wakeups.
-    while (this->_current == pn && state != State::PhaseEnded) {
+    while (true) {
+        // Read the epoch before the state so we can't miss a transition in between.
+        const auto seen = _barrier.epoch.load();
+        const auto state = _barrier.phaseState.load();
+        if (phaseOf(state) != pn || stateOf(state) == State::PhaseEnded || _barrier.errors) {
+            return;
+        }
         const auto waitTimeout = sleepEnd - SteadyClock::now();
         // If we've already passed the timeout then exit.
         if (waitTimeout < Duration::zero()) {
             return;
         }
-        _phaseChange.wait_for(lock, waitTimeout);
+        this->park(seen, waitTimeout);
+    }
+}
+
+Duration Orchestrator::lastPhaseStartSkew() const {
+    return Duration{_barrier.startSkewNanos.load()};
+}
+
+Duration Orchestrator::lastPhaseEndSkew() const {
+    return Duration{_barrier.endSkewNanos.load()};
+}
+
+void Orchestrator::noteArrival() {
+    // Only the first arrival pays for a read-modify-write.
+    if (_barrier.firstArrivalNanos.load(std::memory_order_relaxed) == 0) {
+        int64_t none = 0;
+        _barrier.firstArrivalNanos.compare_exchange_strong(none, nowNanos());
+    }
+}
+
+int64_t Orchestrator::takeSkewNanos() {
+    const auto first = _barrier.firstArrivalNanos.exchange(0);
+    return first == 0 ? 0 : std::max(int64_t{0}, nowNanos() - first);
+}
+
+void Orchestrator::runHooks(uint64_t started, bool starting) {
+    if (_hooksRan.load() == started) {
+        return;
+    }
+    _startingPhase = starting;
+    for (auto&& cb : _prePhaseHooks) {
+        cb(this);
+    }
+    _hooksRan = started;
+}
+
+void Orchestrator::catchUpHooks() {
+    if (!_group) {
+        return;
+    }
+    const auto state = _barrier.phaseState.load();
+    if (stateOf(state) == State::PhaseStarted && _hooksRan.load() != state) {
+        writer lock{_mutex};
+        this->runHooks(state, false);
+    }
+}
+
+void Orchestrator::publish(uint64_t newState) {
+    _barrier.phaseState.store(newState);
+    const auto previous = _barrier.epoch.fetch_add(1);
+    // Wake every parked thread at once. They only re-check atomics on the way out, so
+    // unlike a condition variable's notify_all() they don't then contend for a mutex.
+#ifdef __linux__
+    // Only a group's futex is shared with other processes.
+    const int op = _group ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    syscall(SYS_futex, &_barrier.epoch, op, INT_MAX, nullptr, nullptr, 0);
+#endif
+    // Anyone else checks the epoch under _parkMutex, so once we've held it they've
+    // either seen the new epoch or are waiting to be notified.
+    { std::lock_guard<std::mutex> lock{_parkMutex}; }
+#ifndef __linux__
+    _parked.notify_all();
+#endif
+    // Only fibers that saw the previous epoch can be waiting.
+    for (auto& parked : _fiberParked[previous % 2]) {
+        parked.notify_all();
+    }
+}
+
+void Orchestrator::awaitState(State target) {
+    while (true) {
+        // Read the epoch before the state so we can't miss a transition in between.
+        const auto seen = _barrier.epoch.load();
+        if (stateOf(_barrier.phaseState.load()) == target || _barrier.errors) {
+            return;
+        }
+        this->park(seen);
+    }
+}
+
+void Orchestrator::park(uint32_t seen, std::optional<std::chrono::nanoseconds> timeout) {
+    if (v1::FiberPool::onFiber()) {
+        // A futex would block the worker and every other fiber on it.
+        auto& parked =
+            _fiberParked[seen % 2][v1::FiberPool::workerNumber() % kFiberParkShards];
+        std::unique_lock<std::mutex> lock{_parkMutex};
+        auto changed = [&]() { return _barrier.epoch.load() != seen; };
+        if (timeout) {
+            parked.wait_for(lock, *timeout, changed);
+        } else {
+            parked.wait(lock, changed);
+        }
+        return;
+    }
+#ifdef __linux__
+    // std::atomic<uint32_t> has the same representation as the uint32_t a futex needs.
+    static_assert(sizeof(_barrier.epoch) == sizeof(uint32_t));
+    const int op = _group ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    if (timeout) {
+        const auto secs = std::chrono::duration_cast<std::chrono::seconds>(*timeout);
+        timespec ts{};
+        ts.tv_sec = secs.count();
+        ts.tv_nsec = (*timeout - secs).count();
+        syscall(SYS_futex, &_barrier.epoch, op, seen, &ts, nullptr, 0);
+    } else {
+        syscall(SYS_futex, &_barrier.epoch, op, seen, nullptr, nullptr, 0);
+    }
+#else
+    std::unique_lock<std::mutex> lock{_parkMutex};
+    auto changed = [&]() { return _barrier.epoch.load() != seen; };
+    if (timeout) {
+        _parked.wait_for(lock, *timeout, changed);
+    } else {
+        _parked.wait(lock, changed);
     }
+#endif
 }
 
 }  // namespace genny
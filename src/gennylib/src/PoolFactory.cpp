@@ -231,11 +231,16 @@ std::unique_ptr<mongocxx::pool> PoolFactory::makePool() const {
     }
 
     // option::client can be implicitly coverted into option::pool. This is to be able to set the
-    // apm options for testing.
+    // apm options for testing and command monitoring.
     auto clientOpts = mongocxx::options::client{poolOptions.client_opts()};
-    if (_apmCallback) {
+    if (_apmCallback || _commandMonitor) {
         mongocxx::options::apm apmOptions;
-        apmOptions.on_command_started(_apmCallback);
+        if (_apmCallback) {
+            apmOptions.on_command_started(_apmCallback);
+        }
+        if (_commandMonitor) {
+            _commandMonitor->monitor(apmOptions);
+        }
         clientOpts.apm_opts(apmOptions);
     }
 
@@ -250,6 +255,14 @@ void PoolFactory::overrideHosts(const std::set<std::string>& hosts) {
     _config->hosts = hosts;
 }
 
+const std::set<std::string>& PoolFactory::hosts() const {
+    return _config->hosts;
+}
+
+void PoolFactory::monitorCommands(CommandMonitor* monitor) {
+    _commandMonitor = monitor;
+}
+
 void PoolFactory::setOptionFromInt(OptionType type, const std::string& option, int32_t value) {
     auto valueStr = std::to_string(value);
     setOption(type, option, valueStr);
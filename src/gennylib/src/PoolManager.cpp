@@ -12,6 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <thread>
+
+#include <boost/log/trivial.hpp>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+
+#include <mongocxx/client.hpp>
+
 #include <gennylib/InvalidConfigurationException.hpp>
 #include <gennylib/v1/PoolFactory.hpp>
 #include <gennylib/v1/PoolManager.hpp>
@@ -19,12 +32,7 @@
 namespace genny::v1 {
 namespace {
 
-auto createPool(const std::string& mongoUri,
-                const std::string& name,
-                PoolManager::OnCommandStartCallback& apmCallback,
-                const Node& context) {
-    auto poolFactory = PoolFactory(mongoUri, apmCallback);
-
+void setOptions(PoolFactory& poolFactory, const std::string& name, const Node& context) {
     auto queryOpts =
         context["Clients"][name]["QueryOptions"].maybe<std::map<std::string, std::string>>();
     if (queryOpts) {
@@ -36,57 +44,227 @@ auto createPool(const std::string& mongoUri,
     if (accessOpts) {
         poolFactory.setOptions(genny::v1::PoolFactory::kAccessOption, *accessOpts);
     }
+}
 
+auto createPool(const std::string& mongoUri,
+                const std::string& name,
+                PoolManager::OnCommandStartCallback& apmCallback,
+                const Node& context,
+                const std::optional<std::string>& host,
+                CommandMonitor* commandMonitor) {
+    auto poolFactory = PoolFactory(mongoUri, apmCallback);
+    setOptions(poolFactory, name, context);
+    if (host) {
+        poolFactory.overrideHosts({*host});
+    }
+    poolFactory.monitorCommands(commandMonitor);
     return poolFactory.makePool();
 }
 
+// Time a command, which on a new client also sets up the connection it runs over.
+std::chrono::nanoseconds ping(mongocxx::client& client) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+
+    const auto started = std::chrono::steady_clock::now();
+    client["admin"].run_command(make_document(kvp("ping", 1)));
+    return std::chrono::steady_clock::now() - started;
+}
+
 }  // namespace
 
+PoolManager::Assignment PoolManager::Assignment::parse(const std::string& mongoUri,
+                                                       const std::string& name,
+                                                       const Node& context) {
+    const auto& config = context["Clients"][name];
+    auto instances = config["Instances"].maybe<int>();
+    const auto assign = config["Assign"].maybe<std::string>();
+
+    Assignment out;
+    if (assign && *assign == "per-host") {
+        auto factory = PoolFactory(mongoUri);
+        setOptions(factory, name, context);
+        const auto protocol = factory.getOption(PoolFactory::kAccessOption, "Protocol");
+        if (mongoUri.rfind("mongodb+srv://", 0) == 0 || protocol == "mongodb+srv://") {
+            throw InvalidConfigurationException("Clients " + name +
+                                                " can't Assign per-host with a mongodb+srv URI.");
+        }
+        out.hosts.assign(factory.hosts().begin(), factory.hosts().end());
+        if (out.hosts.empty()) {
+            throw InvalidConfigurationException("Clients " + name +
+                                                " can't Assign per-host without any hosts.");
+        }
+        instances = instances.value_or(out.hosts.size());
+    } else if (assign && *assign != "round-robin") {
+        throw InvalidConfigurationException("Clients " + name + " has unknown Assign '" +
+                                            *assign + "'. Use round-robin or per-host.");
+    } else if (assign && !instances) {
+        throw InvalidConfigurationException("Clients " + name +
+                                            " needs Instances to Assign round-robin.");
+    }
+
+    if (instances) {
+        if (*instances < 1) {
+            throw InvalidConfigurationException("Clients " + name +
+                                                " needs at least one Instance.");
+        }
+        out.instances = *instances;
+    }
+    return out;
+}
+
 }  // namespace genny::v1
 
 
-mongocxx::pool::entry genny::v1::PoolManager::client(const std::string& name,
-                                                     size_t instance,
-                                                     const Node& context) {
-    // Only one thread can access pools.operator[] at a time...
-    std::unique_lock<std::mutex> getLock{this->_poolsLock};
-    LockAndPools& lap = this->_pools[name];
-    // ...but no need to keep the lock open past this.
-    // Two threads trying access client("foo",0) at the same
-    // time will subsequently block on the unique_lock.
-    getLock.unlock();
+genny::v1::PoolManager::PoolManager(std::string mongoUri,
+                                    OnCommandStartCallback callback,
+                                    const Node& context)
+    : _mongoUri{std::move(mongoUri)}, _apmCallback{std::move(callback)}, _context{context} {
+    _pools.try_emplace("Default", _mongoUri, "Default", context);
+    for (const auto& [k, config] : context["Clients"]) {
+        const auto name = k.toString();
+        _pools.try_emplace(name, _mongoUri, name, context);
+    }
+}
 
-    // only one thread can access the map of pools at once
-    std::unique_lock<std::mutex> lock{lap.first};
+genny::v1::PoolManager::NamedPools::NamedPools(const std::string& mongoUri,
+                                               const std::string& name,
+                                               const Node& context)
+    : assignment{Assignment::parse(mongoUri, name, context)},
+      prewarm{context["Clients"][name]["Prewarm"].maybe<bool>().value_or(false)},
+      monitorCommands{context["Clients"][name]["CommandMonitoring"].maybe<bool>().value_or(false)},
+      instances(std::max<size_t>(assignment.instances, 1)) {}
 
-    Pools& pools = lap.second;
+genny::v1::PoolManager::Instance& genny::v1::PoolManager::NamedPools::instance(size_t instance) {
+    if (instance < this->instances.size()) {
+        return this->instances[instance];
+    }
+    std::lock_guard<std::mutex> lock{this->lock};
+    return this->extraInstances[instance];
+}
+
+genny::v1::PoolManager::NamedPools& genny::v1::PoolManager::_named(const std::string& name) {
+    if (auto it = this->_pools.find(name); it != this->_pools.end()) {
+        return it->second;
+    }
+    std::lock_guard<std::mutex> lock{this->_unconfiguredPoolsLock};
+    auto it = this->_unconfiguredPools.find(name);
+    if (it == this->_unconfiguredPools.end()) {
+        it = this->_unconfiguredPools.try_emplace(name, this->_mongoUri, name, this->_context)
+                 .first;
+    }
+    return it->second;
+}
 
-    auto& pool = pools[instance];
+mongocxx::pool::entry genny::v1::PoolManager::client(const std::string& name, size_t instance) {
+    // Neither lookup takes a lock for the names and instances laid out up front.
+    auto& named = this->_named(name);
+    const auto& assignment = named.assignment;
+    if (assignment.instances > 0) {
+        instance = named.nextInstance.fetch_add(1, std::memory_order_relaxed) %
+            assignment.instances;
+    }
+    auto& slot = named.instance(instance);
+
+    auto* pool = slot.created.load(std::memory_order_acquire);
     if (pool == nullptr) {
-        pool = createPool(this->_mongoUri, name, this->_apmCallback, context);
+        // Only callers of this (name,instance) wait while its pool is created.
+        std::lock_guard<std::mutex> lock{slot.lock};
+        if (slot.pool == nullptr) {
+            std::optional<std::string> host;
+            if (!assignment.hosts.empty()) {
+                host = assignment.hosts[instance % assignment.hosts.size()];
+            }
+            auto* monitor = named.monitorCommands && this->_commandMonitor
+                ? &*this->_commandMonitor
+                : nullptr;
+            slot.pool =
+                createPool(this->_mongoUri, name, this->_apmCallback, this->_context, host, monitor);
+            slot.created.store(slot.pool.get(), std::memory_order_release);
+        }
+        pool = slot.pool.get();
+    }
+
+    auto entry = [&]() {
+        if (_apmCallback) {
+            // TODO: Remove this conditional when TIG-1396 is resolved.
+            return pool->acquire();
+        }
+        auto entry = pool->try_acquire();
+        if (!entry) {
+            // TODO: better error handling
+            throw InvalidConfigurationException(
+                "Failed to acquire an entry from the client pool.");
+        }
+        return std::move(*entry);
+    }();
+
+    if (named.prewarm) {
+        std::lock_guard<std::mutex> prewarmLock{this->_toPrewarmLock};
+        this->_toPrewarm.emplace_back(name, entry.get());
     }
+    return entry;
+}
 
-    // no need to keep it past this point; pool is thread-safe
-    lock.unlock();
+std::vector<genny::v1::PoolManager::ConnectionSetup> genny::v1::PoolManager::prewarm(
+    size_t threads) {
+    std::vector<std::pair<std::string, mongocxx::client*>> clients;
+    {
+        std::lock_guard<std::mutex> prewarmLock{this->_toPrewarmLock};
+        clients.swap(this->_toPrewarm);
+    }
 
-    if (_apmCallback) {
-        // TODO: Remove this conditional when TIG-1396 is resolved.
-        return pool->acquire();
+    std::vector<ConnectionSetup> out(clients.size());
+    std::atomic<size_t> next = 0;
+    auto work = [&]() {
+        for (auto i = next++; i < clients.size(); i = next++) {
+            auto& [name, client] = clients[i];
+            auto& setup = out[i];
+            setup.name = name;
+            try {
+                setup.firstCommand = ping(*client);
+                setup.roundTrip = ping(*client);
+                setup.ok = true;
+            } catch (const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(warning)
+                    << "Couldn't prewarm a connection for client " << name << ": " << ex.what();
+                setup.ok = false;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(threads, clients.size()); ++i) {
+        workers.emplace_back(work);
     }
-    auto entry = pool->try_acquire();
-    if (!entry) {
-        // TODO: better error handling
-        throw InvalidConfigurationException("Failed to acquire an entry from the client pool.");
+    work();
+    for (auto& worker : workers) {
+        worker.join();
     }
-    return std::move(*entry);
+    return out;
 }
 
 std::unordered_map<std::string, size_t> genny::v1::PoolManager::instanceCount() {
-    std::lock_guard<std::mutex> getLock{this->_poolsLock};
-
     auto out = std::unordered_map<std::string, size_t>();
-    for (auto&& [k, v] : this->_pools) {
-        out[k] = v.second.size();
+    auto count = [&](const std::string& name, NamedPools& named) {
+        size_t created = 0;
+        for (const auto& slot : named.instances) {
+            created += slot.created.load(std::memory_order_acquire) != nullptr;
+        }
+        std::lock_guard<std::mutex> lock{named.lock};
+        for (const auto& [i, slot] : named.extraInstances) {
+            created += slot.created.load(std::memory_order_acquire) != nullptr;
+        }
+        // Only names that clients were asked for.
+        if (created > 0) {
+            out[name] = created;
+        }
+    };
+    for (auto&& [name, named] : this->_pools) {
+        count(name, named);
+    }
+    std::lock_guard<std::mutex> lock{this->_unconfiguredPoolsLock};
+    for (auto&& [name, named] : this->_unconfiguredPools) {
+        count(name, named);
     }
     return out;
 }
@@ -0,0 +1,205 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/ProcessGroup.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+
+namespace genny::v1 {
+
+struct ProcessGroup::Segment {
+    Orchestrator::Barrier barrier;
+
+    // Workers that have called awaitWorkers(). Also a futex word.
+    std::atomic<uint32_t> ready = 0;
+
+    // Only taken while naming buckets during setup.
+    std::atomic_flag rateLimitersLock = ATOMIC_FLAG_INIT;
+    size_t rateLimiterCount = 0;
+    struct NamedBucket {
+        char name[kMaxRateLimiterName];
+        TokenBucket bucket;
+    };
+    std::array<NamedBucket, kMaxRateLimiters> rateLimiters;
+};
+
+namespace {
+
+// Atomics are only usable from several processes if they don't hide a lock.
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+void wake(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+// Like a futex wait, but gives up after a while so the caller can check for aborts.
+void waitBriefly(std::atomic<uint32_t>& word, uint32_t seen) {
+#ifdef __linux__
+    timespec timeout{0, 100 * 1000 * 1000};
+    syscall(SYS_futex, &word, FUTEX_WAIT, seen, &timeout, nullptr, 0);
+#endif
+}
+
+}  // namespace
+
+
+ProcessGroup::ProcessGroup(size_t processes) : _processes{processes} {
+#ifndef __linux__
+    throw InvalidConfigurationException("Running with more than one process requires Linux");
+#endif
+    if (processes == 0) {
+        throw InvalidConfigurationException("Need at least one worker process");
+    }
+    void* memory = mmap(nullptr,
+                        sizeof(Segment),
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS,
+                        -1,
+                        0);
+    if (memory == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "mapping shared memory");
+    }
+    _segment = new (memory) Segment();
+}
+
+ProcessGroup::~ProcessGroup() {
+    munmap(_segment, sizeof(Segment));
+}
+
+bool ProcessGroup::fork() {
+    // Or the workers would each write out what's buffered again.
+    std::cout.flush();
+    std::fflush(nullptr);
+    for (size_t rank = 0; rank < _processes; ++rank) {
+        const auto pid = ::fork();
+        if (pid == 0) {
+            _rank = rank;
+            _workers.clear();
+            return true;
+        }
+        if (pid < 0) {
+            const auto error = errno;
+            // Don't leave the workers we did fork waiting for this one.
+            Orchestrator{*this}.abort();
+            this->supervise();
+            throw std::system_error(error, std::generic_category(), "forking a worker");
+        }
+        BOOST_LOG_TRIVIAL(info) << "Started worker " << rank << " of " << _processes
+                                << " as process " << pid;
+        _workers.push_back(pid);
+    }
+    return false;
+}
+
+int ProcessGroup::supervise() {
+    int failure = 0;
+    while (!_workers.empty()) {
+        int status = 0;
+        const auto pid = ::waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        const auto worker = std::find(_workers.begin(), _workers.end(), pid);
+        if (worker == _workers.end()) {
+            continue;
+        }
+        _workers.erase(worker);
+
+        const auto code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        if (code != 0 && failure == 0) {
+            BOOST_LOG_TRIVIAL(error) << "Worker process " << pid << " failed with " << code
+                                     << ". Stopping the others.";
+            failure = code;
+            Orchestrator{*this}.abort();
+        }
+    }
+    return failure;
+}
+
+bool ProcessGroup::awaitWorkers() {
+    auto& segment = *_segment;
+    auto arrived = segment.ready.fetch_add(1) + 1;
+    if (arrived == _processes) {
+        wake(segment.ready);
+    }
+    while (arrived < _processes && !segment.barrier.errors) {
+        waitBriefly(segment.ready, arrived);
+        arrived = segment.ready.load();
+    }
+    return !segment.barrier.errors;
+}
+
+TokenBucket& ProcessGroup::rateLimiterBucket(const std::string& name) {
+    if (name.size() >= kMaxRateLimiterName) {
+        throw InvalidConfigurationException("Rate limiter name is too long to share between "
+                                            "processes: " +
+                                            name);
+    }
+    auto& segment = *_segment;
+    while (segment.rateLimitersLock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    auto unlock = [&]() { segment.rateLimitersLock.clear(std::memory_order_release); };
+
+    const auto begin = segment.rateLimiters.begin();
+    const auto end = begin + segment.rateLimiterCount;
+    auto it = std::find_if(
+        begin, end, [&](const auto& named) { return name == named.name; });
+    if (it == end) {
+        if (segment.rateLimiterCount == kMaxRateLimiters) {
+            unlock();
+            throw InvalidConfigurationException(
+                "Too many rate limiters to share between processes");
+        }
+        std::strncpy(it->name, name.c_str(), kMaxRateLimiterName);
+        ++segment.rateLimiterCount;
+    }
+    unlock();
+    return it->bucket;
+}
+
+Orchestrator::Barrier& ProcessGroup::orchestratorBarrier() {
+    return _segment->barrier;
+}
+
+}  // namespace genny::v1
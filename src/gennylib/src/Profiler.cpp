@@ -0,0 +1,390 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/Profiler.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <csignal>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <boost/core/demangle.hpp>
+
+#include <metrics/operation.hpp>
+
+namespace genny::v1 {
+namespace {
+
+// Enough distinct stacks for a large workload. Each takes under half a KB.
+constexpr size_t kTableSize = 1 << 14;
+constexpr size_t kMaxProbes = 64;
+
+// What the calling thread last published. Trivially constructible, so the signal
+// handler can read it without running any initializer, and atomic, so a sample taken
+// in the middle of an update sees either value.
+struct Tag {
+    std::atomic<const std::string*> actor;
+    std::atomic<const std::string*> operation;
+    std::atomic<uint32_t> phase;
+};
+// Initial-exec so the handler reaches it at a fixed offset from the thread pointer
+// rather than through __tls_get_addr, which may allocate.
+__attribute__((tls_model("initial-exec"))) thread_local Tag tag{
+    {nullptr}, {nullptr}, {Profiler::kNoPhase}};
+
+// The calling thread's stack, noted the first time it publishes a tag. The handler
+// only follows frame pointers that stay inside it, so a frame built without one ends
+// the walk instead of faulting. Fiber stacks aren't known, so samples taken on one
+// get only the interrupted frame.
+struct StackBounds {
+    uintptr_t low;
+    uintptr_t high;
+};
+__attribute__((tls_model("initial-exec"))) thread_local StackBounds stackBounds{0, 0};
+
+void noteStackBounds() noexcept {
+    if (stackBounds.high != 0) {
+        return;
+    }
+#if defined(__APPLE__)
+    const auto high = reinterpret_cast<uintptr_t>(pthread_get_stackaddr_np(pthread_self()));
+    stackBounds.low = high - pthread_get_stacksize_np(pthread_self());
+#else
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return;
+    }
+    void* addr = nullptr;
+    size_t size = 0;
+    const auto got = pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    if (got != 0) {
+        return;
+    }
+    const auto high = reinterpret_cast<uintptr_t>(addr) + size;
+    stackBounds.low = reinterpret_cast<uintptr_t>(addr);
+#endif
+    // A sample between the two stores sees no bounds and walks nothing.
+    std::atomic_signal_fence(std::memory_order_release);
+    stackBounds.high = high;
+}
+
+// The interrupted thread's program counter, frame pointer and stack pointer.
+struct Registers {
+    uintptr_t pc;
+    uintptr_t fp;
+    uintptr_t sp;
+};
+
+Registers registersOf(const void* context) {
+    const auto* uc = static_cast<const ucontext_t*>(context);
+#if defined(__APPLE__) && defined(__x86_64__)
+    const auto& ss = uc->uc_mcontext->__ss;
+    return {ss.__rip, ss.__rbp, ss.__rsp};
+#elif defined(__APPLE__) && defined(__aarch64__)
+    const auto& ss = uc->uc_mcontext->__ss;
+    return {ss.__pc, ss.__fp, ss.__sp};
+#elif defined(__linux__) && defined(__x86_64__)
+    const auto* gregs = uc->uc_mcontext.gregs;
+    return {uintptr_t(gregs[REG_RIP]), uintptr_t(gregs[REG_RBP]), uintptr_t(gregs[REG_RSP])};
+#elif defined(__linux__) && defined(__aarch64__)
+    const auto& mc = uc->uc_mcontext;
+    return {uintptr_t(mc.pc), uintptr_t(mc.regs[29]), uintptr_t(mc.sp)};
+#else
+    (void)uc;
+    return {0, 0, 0};
+#endif
+}
+
+// Walk the frame-pointer chain from the interrupted frame, innermost first. Each frame
+// holds the caller's frame pointer and then the return address.
+int walkFrames(const void* context, void** frames, int max) {
+    const auto regs = registersOf(context);
+    if (regs.pc == 0 || max == 0) {
+        return 0;
+    }
+    int depth = 0;
+    frames[depth++] = reinterpret_cast<void*>(regs.pc);
+
+    std::atomic_signal_fence(std::memory_order_acquire);
+    const auto high = stackBounds.high;
+    const auto low = std::max(stackBounds.low, regs.sp);
+    auto fp = regs.fp;
+    while (depth < max && fp >= low && fp % alignof(uintptr_t) == 0 &&
+           fp + 2 * sizeof(uintptr_t) <= high) {
+        const auto* frame = reinterpret_cast<const uintptr_t*>(fp);
+        if (frame[1] == 0) {
+            break;
+        }
+        frames[depth++] = reinterpret_cast<void*>(frame[1]);
+        // Stacks grow down, so each caller's frame is above its callee's.
+        if (frame[0] <= fp) {
+            break;
+        }
+        fp = frame[0];
+    }
+    return depth;
+}
+
+// One distinct (tag, stack). Claimed by moving key from 0 to the stack's hash; the
+// rest is filled in by the claimer and only read once sampling is over.
+struct Stack {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> count;
+    const std::string* actor;
+    const std::string* operation;
+    uint32_t phase;
+    uint32_t depth;
+    void* frames[Profiler::kMaxFrames];
+};
+
+std::unique_ptr<Stack[]> table;
+std::atomic<size_t> samplesTaken = 0;
+std::atomic<size_t> samplesDropped = 0;
+// Handlers still running, so disable() can wait for them.
+std::atomic<int> sampling = 0;
+
+uint64_t hashOf(const std::string* actor,
+                const std::string* operation,
+                uint32_t phase,
+                void* const* frames,
+                int depth) {
+    uint64_t hash = 14695981039346656037ULL;
+    const auto mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+    mix(reinterpret_cast<uintptr_t>(actor));
+    mix(reinterpret_cast<uintptr_t>(operation));
+    mix(phase);
+    for (int i = 0; i < depth; ++i) {
+        mix(reinterpret_cast<uintptr_t>(frames[i]));
+    }
+    // 0 marks an empty slot.
+    return hash | 1;
+}
+
+void onSample(int, siginfo_t*, void* context) {
+    const auto savedErrno = errno;
+    ++sampling;
+    if (Profiler::enabled()) {
+        void* frames[Profiler::kMaxFrames];
+        const auto depth = walkFrames(context, frames, Profiler::kMaxFrames);
+        const auto* actor = tag.actor.load(std::memory_order_relaxed);
+        const auto* operation = tag.operation.load(std::memory_order_relaxed);
+        const auto phase = tag.phase.load(std::memory_order_relaxed);
+        const auto key = hashOf(actor, operation, phase, frames, depth);
+
+        ++samplesTaken;
+        bool counted = false;
+        for (size_t probe = 0; probe < kMaxProbes && !counted; ++probe) {
+            auto& stack = table[(key + probe) % kTableSize];
+            uint64_t seen = 0;
+            if (stack.key.compare_exchange_strong(seen, key)) {
+                stack.actor = actor;
+                stack.operation = operation;
+                stack.phase = phase;
+                stack.depth = depth;
+                std::copy_n(frames, depth, stack.frames);
+                seen = key;
+            }
+            if (seen == key) {
+                ++stack.count;
+                counted = true;
+            }
+        }
+        if (!counted) {
+            ++samplesDropped;
+        }
+    }
+    --sampling;
+    errno = savedErrno;
+}
+
+// Tags samples with the operation metrics says is running.
+class OperationTagger : public metrics::OperationListener {
+public:
+    void started(const std::string& actorName, const std::string& opName) override {
+        if (Profiler::enabled()) {
+            Profiler::setOperation(&actorName, &opName);
+        }
+    }
+
+    void stopped(const std::string& actorName) override {
+        if (Profiler::enabled()) {
+            Profiler::setOperation(&actorName, nullptr);
+        }
+    }
+
+    void reported(const std::string&,
+                  const std::string&,
+                  std::chrono::nanoseconds,
+                  std::chrono::nanoseconds) override {}
+};
+
+void setTimer(int frequency) {
+    itimerval timer{};
+    if (frequency > 0) {
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = std::max(1, 1000 * 1000 / frequency);
+        timer.it_value = timer.it_interval;
+    }
+    if (::setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        throw std::system_error(errno, std::generic_category(), "setting the profiling timer");
+    }
+}
+
+// Folded stacks are split on ';' and end at the last space.
+std::string sanitize(std::string frame) {
+    std::replace(frame.begin(), frame.end(), ';', ':');
+    std::replace(frame.begin(), frame.end(), '\n', ' ');
+    return frame;
+}
+
+std::string symbolize(void* address) {
+    Dl_info info{};
+    if (::dladdr(address, &info) == 0) {
+        std::ostringstream out;
+        out << address;
+        return out.str();
+    }
+    if (info.dli_sname) {
+        return sanitize(boost::core::demangle(info.dli_sname));
+    }
+    std::ostringstream out;
+    out << (info.dli_fname ? info.dli_fname : "?") << "+0x" << std::hex
+        << (static_cast<char*>(address) - static_cast<char*>(info.dli_fbase));
+    return sanitize(out.str());
+}
+
+}  // namespace
+
+
+void Profiler::enable(int frequency) {
+    if (frequency <= 0) {
+        throw std::invalid_argument("Profiler needs a positive frequency");
+    }
+    if (!table) {
+        table = std::make_unique<Stack[]>(kTableSize);
+    }
+    static OperationTagger operationTagger;
+    static std::atomic_bool listening = false;
+    if (!listening.exchange(true)) {
+        metrics::addOperationListener(&operationTagger);
+    }
+
+    noteStackBounds();
+
+    struct sigaction action {};
+    action.sa_sigaction = onSample;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (::sigaction(SIGPROF, &action, nullptr) != 0) {
+        throw std::system_error(errno, std::generic_category(), "handling SIGPROF");
+    }
+    _enabled = true;
+    setTimer(frequency);
+}
+
+void Profiler::disable() {
+    if (!_enabled.exchange(false)) {
+        return;
+    }
+    setTimer(0);
+    // The handler stays installed: a SIGPROF raised before the timer stopped may not be
+    // delivered yet, and the default action would kill the process. It ignores it.
+    while (sampling.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+void Profiler::clear() {
+    disable();
+    table.reset();
+    samplesTaken = 0;
+    samplesDropped = 0;
+}
+
+void Profiler::setActor(const std::string* actor) noexcept {
+    noteStackBounds();
+    tag.actor.store(actor, std::memory_order_relaxed);
+}
+
+void Profiler::setPhase(uint32_t phase) noexcept {
+    noteStackBounds();
+    tag.phase.store(phase, std::memory_order_relaxed);
+}
+
+void Profiler::setOperation(const std::string* actor, const std::string* operation) noexcept {
+    noteStackBounds();
+    tag.actor.store(actor, std::memory_order_relaxed);
+    tag.operation.store(operation, std::memory_order_relaxed);
+}
+
+size_t Profiler::samples() {
+    return samplesTaken.load();
+}
+
+size_t Profiler::dropped() {
+    return samplesDropped.load();
+}
+
+void Profiler::writeFolded(std::ostream& out) {
+    if (!table) {
+        return;
+    }
+    // Return addresses that differ only within a function fold into one line.
+    std::map<std::string, uint64_t> folded;
+    std::unordered_map<void*, std::string> symbols;
+    for (size_t i = 0; i < kTableSize; ++i) {
+        const auto& stack = table[i];
+        const auto count = stack.count.load();
+        if (count == 0) {
+            continue;
+        }
+        std::ostringstream line;
+        line << (stack.actor ? sanitize(*stack.actor) : "(no actor)") << ";";
+        if (stack.phase == kNoPhase) {
+            line << "(no phase);";
+        } else {
+            line << "phase " << stack.phase << ";";
+        }
+        line << (stack.operation ? sanitize(*stack.operation) : "(no operation)");
+        // Frames are stored innermost first.
+        for (auto frame = int(stack.depth) - 1; frame >= 0; --frame) {
+            auto [symbol, inserted] = symbols.try_emplace(stack.frames[frame]);
+            if (inserted) {
+                symbol->second = symbolize(stack.frames[frame]);
+            }
+            line << ";" << symbol->second;
+        }
+        folded[line.str()] += count;
+    }
+    for (const auto& [line, count] : folded) {
+        out << line << " " << count << "\n";
+    }
+}
+
+}  // namespace genny::v1
@@ -0,0 +1,321 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/Tracer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/fiber/fss.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/v1/FiberPool.hpp>
+
+#include <metrics/operation.hpp>
+
+namespace genny::v1 {
+namespace {
+
+struct Event {
+    int64_t startNS;
+    int64_t durationNS;
+    uint32_t name;
+    uint32_t track;
+    uint32_t phase;
+};
+
+// One thread's most recent events. Only that thread writes to it.
+struct Ring {
+    explicit Ring(size_t capacity) : events(capacity) {}
+
+    std::vector<Event> events;
+    // Ever recorded; the ones before the last events.size() have been overwritten.
+    size_t recorded = 0;
+};
+
+struct Track {
+    uint64_t generation;
+    uint32_t id;
+};
+
+struct State {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> nameIds;
+    std::vector<std::string> tracks;
+    size_t eventsPerThread = Tracer::kDefaultEventsPerThread;
+    int64_t originNS = 0;
+
+    State() {
+        this->reset();
+    }
+
+    // Requires mutex.
+    void reset() {
+        rings.clear();
+        names = {"PhaseStartWait", "PhaseEndWait", "Sleep", "RateLimitWait"};
+        nameIds.clear();
+        tracks.clear();
+        originNS = 0;
+    }
+
+    // Requires mutex.
+    uint32_t addTrack(std::string name) {
+        tracks.push_back(std::move(name));
+        return tracks.size() - 1;
+    }
+};
+
+State& state() {
+    // Leaked so threads still recording can't outlive it during static destruction.
+    static auto* state = new State;
+    return *state;
+}
+
+// Bumped by clear() so each thread notices its ring and track are gone.
+std::atomic<uint64_t> generation = 1;
+std::atomic<uint32_t> operationsPerSample = Tracer::kDefaultSampleEvery;
+
+struct Local {
+    uint64_t generation = 0;
+    Ring* ring = nullptr;
+    uint32_t track = 0;
+    uint32_t operations = 0;
+};
+thread_local Local local;
+
+// Fibers can move between threads, so a fiber's track has to travel with it.
+boost::fibers::fiber_specific_ptr<Track> fiberTrack;
+
+// Set up this thread's ring and default track if it doesn't have them yet.
+Local& ensureLocal() {
+    const auto current = generation.load();
+    if (local.generation != current) {
+        auto& s = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        s.rings.push_back(std::make_unique<Ring>(s.eventsPerThread));
+        local.ring = s.rings.back().get();
+        local.track = s.addTrack("Thread " + std::to_string(s.rings.size()));
+        local.generation = current;
+    }
+    return local;
+}
+
+uint32_t currentTrack(const Local& loc) {
+    if (FiberPool::onFiber()) {
+        if (auto* track = fiberTrack.get(); track && track->generation == loc.generation) {
+            return track->id;
+        }
+    }
+    return loc.track;
+}
+
+void writeEscaped(std::ostream& out, const std::string& str) {
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Records a sample of the operations reported to metrics.
+class OperationTracer : public metrics::OperationListener {
+public:
+    void started(const std::string&, const std::string&) override {}
+
+    void stopped(const std::string&) override {}
+
+    void reported(const std::string& actorName,
+                  const std::string& opName,
+                  std::chrono::nanoseconds started,
+                  std::chrono::nanoseconds finished) override {
+        if (!Tracer::enabled() || !Tracer::sampleOperation()) {
+            return;
+        }
+        Tracer::record(nameOf(actorName, opName), started.count(), finished.count());
+    }
+
+private:
+    struct Interned {
+        uint64_t generation;
+        std::string name;
+        uint32_t id;
+    };
+
+    // Operations' names live as long as they do, but a name's address may be reused by
+    // a later registry's, so the name is checked too.
+    static uint32_t nameOf(const std::string& actorName, const std::string& opName) {
+        thread_local std::unordered_map<const std::string*, Interned> interned;
+        const auto current = generation.load();
+        auto& cached = interned[&opName];
+        const auto matches = cached.name.size() == actorName.size() + 1 + opName.size() &&
+            cached.name.compare(0, actorName.size(), actorName) == 0 &&
+            cached.name.compare(actorName.size() + 1, std::string::npos, opName) == 0;
+        if (cached.generation != current || !matches) {
+            cached.name = actorName + "." + opName;
+            cached.id = Tracer::intern(cached.name);
+            cached.generation = current;
+        }
+        return cached.id;
+    }
+};
+
+const char* category(uint32_t name) {
+    switch (name) {
+        case Tracer::kPhaseStartWait:
+        case Tracer::kPhaseEndWait:
+            return "phase";
+        case Tracer::kSleep:
+        case Tracer::kRateLimitWait:
+            return "wait";
+        default:
+            return "operation";
+    }
+}
+
+}  // namespace
+
+
+void Tracer::enable(size_t eventsPerThread, uint32_t sampleEvery) {
+    if (eventsPerThread == 0 || sampleEvery == 0) {
+        throw std::invalid_argument("Tracer needs room for events and a positive sample rate");
+    }
+    {
+        auto& s = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        s.eventsPerThread = eventsPerThread;
+        if (s.originNS == 0) {
+            s.originNS = nowNS();
+        }
+    }
+    operationsPerSample = sampleEvery;
+    static OperationTracer operationTracer;
+    static std::atomic_bool listening = false;
+    if (!listening.exchange(true)) {
+        metrics::addOperationListener(&operationTracer);
+    }
+    _enabled = true;
+}
+
+void Tracer::disable() {
+    _enabled = false;
+}
+
+void Tracer::clear() {
+    _enabled = false;
+    auto& s = state();
+    std::lock_guard<std::mutex> lock{s.mutex};
+    s.reset();
+    ++generation;
+}
+
+int64_t Tracer::nowNS() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void Tracer::record(uint32_t name, int64_t startNS, int64_t endNS, uint32_t phase) {
+    auto& loc = ensureLocal();
+    auto& ring = *loc.ring;
+    ring.events[ring.recorded % ring.events.size()] =
+        Event{startNS, endNS - startNS, name, currentTrack(loc), phase};
+    ++ring.recorded;
+}
+
+uint32_t Tracer::intern(const std::string& name) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock{s.mutex};
+    const auto [it, inserted] = s.nameIds.try_emplace(name, s.names.size());
+    if (inserted) {
+        s.names.push_back(name);
+    }
+    return it->second;
+}
+
+bool Tracer::sampleOperation() {
+    return ++local.operations % operationsPerSample.load(std::memory_order_relaxed) == 0;
+}
+
+void Tracer::setTrack(const std::string& name) {
+    auto& loc = ensureLocal();
+    uint32_t id;
+    {
+        auto& s = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        id = s.addTrack(name);
+    }
+    if (FiberPool::onFiber()) {
+        fiberTrack.reset(new Track{loc.generation, id});
+    } else {
+        loc.track = id;
+    }
+}
+
+void Tracer::writeChromeJson(std::ostream& out) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock{s.mutex};
+
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    // Chrome wants microseconds. Track ids are offset so none is the 0 of the process.
+    out << R"({"displayTimeUnit":"ms","traceEvents":[)" << "\n";
+    out << R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"genny"}})";
+    for (size_t track = 0; track < s.tracks.size(); ++track) {
+        out << ",\n"
+            << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << track + 1
+            << R"(,"args":{"name":)";
+        writeEscaped(out, s.tracks[track]);
+        out << "}}";
+    }
+    for (const auto& ring : s.rings) {
+        const auto capacity = ring->events.size();
+        const auto kept = std::min(ring->recorded, capacity);
+        if (ring->recorded > capacity) {
+            BOOST_LOG_TRIVIAL(warning) << "Trace kept the last " << capacity << " of "
+                                       << ring->recorded << " events from one thread";
+        }
+        for (auto i = ring->recorded - kept; i < ring->recorded; ++i) {
+            const auto& event = ring->events[i % capacity];
+            out << ",\n{\"name\":";
+            writeEscaped(out, s.names.at(event.name));
+            out << R"(,"cat":")" << category(event.name) << R"(","ph":"X","ts":)"
+                << (event.startNS - s.originNS) / 1e3 << R"(,"dur":)" << event.durationNS / 1e3
+                << R"(,"pid":1,"tid":)" << event.track + 1;
+            if (event.phase != kNoPhase) {
+                out << R"(,"args":{"phase":)" << event.phase << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+}  // namespace genny::v1
@@ -0,0 +1,261 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/WorkloadPlan.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <type_traits>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/Node.hpp>
+
+namespace genny::v1 {
+namespace {
+
+constexpr char kMagic[8] = {'G', 'E', 'N', 'N', 'Y', 'P', 'L', 'N'};
+
+std::optional<std::string> readFile(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        return std::nullopt;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+YAML::Node parse(const std::string& contents, const std::string& path) {
+    try {
+        return YAML::Load(contents);
+    } catch (const YAML::ParserException& x) {
+        BOOST_THROW_EXCEPTION(InvalidYAMLException(path, x));
+    }
+}
+
+class Writer {
+public:
+    template <typename T>
+    void write(T value) {
+        static_assert(std::is_arithmetic_v<T>);
+        _out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void writeString(std::string_view str) {
+        write(uint32_t(str.size()));
+        writeBytes(str);
+    }
+
+    void writeBytes(std::string_view bytes) {
+        _out.append(bytes.data(), bytes.size());
+    }
+
+    void writeNode(const YAML::Node& node) {
+        write(uint8_t(node.Type()));
+        writeString(node.Tag());
+        switch (node.Type()) {
+            case YAML::NodeType::Scalar:
+                writeString(node.Scalar());
+                break;
+            case YAML::NodeType::Sequence:
+                write(uint32_t(node.size()));
+                for (const auto& item : node) {
+                    writeNode(item);
+                }
+                break;
+            case YAML::NodeType::Map:
+                write(uint32_t(node.size()));
+                for (const auto& kvp : node) {
+                    // Node already requires keys to be strings.
+                    writeString(kvp.first.as<std::string>());
+                    writeNode(kvp.second);
+                }
+                break;
+            case YAML::NodeType::Undefined:
+            case YAML::NodeType::Null:
+                break;
+        }
+    }
+
+    const std::string& str() const {
+        return _out;
+    }
+
+private:
+    std::string _out;
+};
+
+class Reader {
+public:
+    Reader(const char* data, size_t size, const std::string& path)
+        : _data{data}, _size{size}, _path{path} {}
+
+    template <typename T>
+    T read() {
+        need(sizeof(T));
+        T out;
+        std::memcpy(&out, _data + _pos, sizeof(T));
+        _pos += sizeof(T);
+        return out;
+    }
+
+    std::string_view readString() {
+        return readBytes(read<uint32_t>());
+    }
+
+    std::string_view readBytes(size_t size) {
+        need(size);
+        std::string_view out{_data + _pos, size};
+        _pos += size;
+        return out;
+    }
+
+    /**
+     * Fill in a node of the tree being built. Creating children through their parent
+     * keeps the whole tree in one yaml-cpp memory pool rather than merging a new pool
+     * into it for every node.
+     */
+    void readNode(YAML::Node out) {
+        const auto type = YAML::NodeType::value(read<uint8_t>());
+        const auto tag = readString();
+        switch (type) {
+            case YAML::NodeType::Scalar:
+                out = std::string{readString()};
+                break;
+            case YAML::NodeType::Sequence: {
+                out = YAML::Node{YAML::NodeType::Sequence};
+                const auto items = read<uint32_t>();
+                for (uint32_t i = 0; i < items; ++i) {
+                    readNode(out[i]);
+                }
+                break;
+            }
+            case YAML::NodeType::Map: {
+                out = YAML::Node{YAML::NodeType::Map};
+                for (auto entries = read<uint32_t>(); entries > 0; --entries) {
+                    const std::string key{readString()};
+                    readNode(out[key]);
+                }
+                break;
+            }
+            case YAML::NodeType::Null:
+                out = YAML::Node{YAML::NodeType::Null};
+                break;
+            default:
+                fail("unknown node type " + std::to_string(int(type)));
+        }
+        if (!tag.empty()) {
+            out.SetTag(std::string{tag});
+        }
+    }
+
+private:
+    void need(size_t bytes) const {
+        if (_size - _pos < bytes) {
+            fail("it's truncated");
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& why) const {
+        throw InvalidConfigurationException("Can't load workload plan '" + _path + "': " + why);
+    }
+
+    const char* _data;
+    const size_t _size;
+    const std::string& _path;
+    size_t _pos = 0;
+};
+
+}  // namespace
+
+
+uint64_t WorkloadPlan::hash(std::string_view contents) {
+    uint64_t out = 14695981039346656037ULL;
+    for (const char c : contents) {
+        out ^= uint8_t(c);
+        out *= 1099511628211ULL;
+    }
+    return out;
+}
+
+void WorkloadPlan::compile(const std::string& sourcePath, const std::string& planPath) {
+    const auto contents = readFile(sourcePath);
+    if (!contents) {
+        throw InvalidConfigurationException("Can't read workload '" + sourcePath + "'");
+    }
+
+    Writer plan;
+    plan.writeBytes({kMagic, sizeof(kMagic)});
+    plan.write(kVersion);
+    plan.write(hash(*contents));
+    plan.writeString(sourcePath);
+    plan.writeNode(parse(*contents, sourcePath));
+
+    std::ofstream out{planPath, std::ios::binary | std::ios::trunc};
+    out.write(plan.str().data(), plan.str().size());
+    out.close();
+    if (!out) {
+        throw InvalidConfigurationException("Can't write workload plan '" + planPath + "'");
+    }
+}
+
+bool WorkloadPlan::isPlan(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+WorkloadPlan WorkloadPlan::load(const std::string& planPath) {
+    namespace ipc = boost::interprocess;
+
+    std::optional<ipc::mapped_region> region;
+    try {
+        ipc::file_mapping file{planPath.c_str(), ipc::read_only};
+        region.emplace(file, ipc::read_only);
+    } catch (const ipc::interprocess_exception& ex) {
+        throw InvalidConfigurationException("Can't map workload plan '" + planPath +
+                                            "': " + ex.what());
+    }
+
+    Reader plan{static_cast<const char*>(region->get_address()), region->get_size(), planPath};
+    if (plan.readBytes(sizeof(kMagic)) != std::string_view{kMagic, sizeof(kMagic)}) {
+        throw InvalidConfigurationException("'" + planPath + "' isn't a workload plan");
+    }
+    if (const auto version = plan.read<uint32_t>(); version != kVersion) {
+        throw InvalidConfigurationException(
+            "Workload plan '" + planPath + "' is version " + std::to_string(version) +
+            " but this genny reads version " + std::to_string(kVersion) + ". Recompile it.");
+    }
+    const auto sourceHash = plan.read<uint64_t>();
+    std::string sourcePath{plan.readString()};
+
+    if (const auto contents = readFile(sourcePath); contents && hash(*contents) != sourceHash) {
+        BOOST_LOG_TRIVIAL(warning) << "Workload plan '" << planPath << "' is stale. Loading '"
+                                   << sourcePath << "' instead. Run genny compile to update it.";
+        auto yaml = parse(*contents, sourcePath);
+        return WorkloadPlan{std::move(yaml), std::move(sourcePath), true};
+    }
+    // Not default-constructed, which would give readNode() a copy that isn't shared.
+    YAML::Node yaml{YAML::NodeType::Null};
+    plan.readNode(yaml);
+    return WorkloadPlan{std::move(yaml), std::move(sourcePath), false};
+}
+
+}  // namespace genny::v1
@@ -14,15 +14,22 @@
 
 #include <gennylib/context.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <memory>
 #include <set>
 #include <sstream>
+#include <thread>
+
+#include <boost/log/trivial.hpp>
 
 #include <mongocxx/instance.hpp>
 #include <mongocxx/pool.hpp>
 #include <mongocxx/uri.hpp>
 
 #include <gennylib/Cast.hpp>
+#include <gennylib/v1/ProcessGroup.hpp>
 #include <gennylib/v1/Sleeper.hpp>
 #include <metrics/metrics.hpp>
 
@@ -32,11 +39,12 @@ WorkloadContext::WorkloadContext(const Node& node,
                                  Orchestrator& orchestrator,
                                  const std::string& mongoUri,
                                  const Cast& cast,
-                                 v1::PoolManager::OnCommandStartCallback apmCallback)
+                                 v1::PoolManager::OnCommandStartCallback apmCallback,
+                                 size_t setupThreads)
     : v1::HasNode{node},
       _orchestrator{&orchestrator},
       _rateLimiters{10},
-      _poolManager{mongoUri, apmCallback} {
+      _poolManager{mongoUri, apmCallback, node} {
 
     std::set<std::string> validSchemaVersions{"2018-07-01"};
 
@@ -64,8 +72,26 @@ WorkloadContext::WorkloadContext(const Node& node,
 
     auto metricsPath =
         ((*this)["Metrics"]["Path"]).maybe<std::string>().value_or("build/WorkloadOutput/CedarMetrics");
+    // Each worker process writes its own, to be merged after the run.
+    if (const auto* group = _orchestrator->processGroup(); group && group->rank()) {
+        metricsPath += "-worker-" + std::to_string(*group->rank());
+    }
+
+    // Reserve CPUs for genny's own threads before the metrics registry starts any. They
+    // inherit this thread's affinity, and Actor threads are moved off it.
+    auto topology = v1::CpuTopology::current();
+    v1::CpuSet reserved;
+    if (const auto spec = (*this)["Metrics"]["Affinity"].maybe<AffinitySpec>()) {
+        reserved = v1::AffinityAssigner{topology}.cpus(*spec);
+        if (!v1::setThreadAffinity(reserved)) {
+            BOOST_LOG_TRIVIAL(warning) << "Couldn't restrict genny's own threads to the "
+                                          "Metrics Affinity CPUs";
+        }
+    }
+    v1::AffinityAssigner affinities{std::move(topology), std::move(reserved)};
 
     _registry = genny::metrics::Registry(std::move(format), std::move(metricsPath));
+    _poolManager.monitorCommands(_registry);
 
 
     // Make a bunch of actor contexts
@@ -77,38 +103,172 @@ WorkloadContext::WorkloadContext(const Node& node,
     // between 1 and 10^9 and concatenating.
     _rng.seed((*this)["RandomSeed"].maybe<long>().value_or(269849313357703264));
 
-    for (auto& actorContext : _actorContexts) {
-        for (auto&& actor : _constructActors(cast, actorContext)) {
+    auto actorsByContext = _constructActors(cast, setupThreads);
+    for (size_t i = 0; i < _actorContexts.size(); ++i) {
+        const auto affinity = (*_actorContexts[i])["Affinity"].maybe<AffinitySpec>();
+        const auto name = (*_actorContexts[i])["Name"].maybe<std::string>().value_or("");
+        for (auto&& actor : actorsByContext[i]) {
+            // Other workers' Actors still take their CPUs, so no two workers share one.
+            auto cpus = affinity ? std::make_optional(affinities.next(affinity)) : std::nullopt;
+            if (!actor) {
+                continue;
+            }
+            _actorNames.emplace(actor->id(), name);
+            if (cpus) {
+                _affinities.emplace(actor->id(), std::move(*cpus));
+            }
             _actors.push_back(std::move(actor));
         }
     }
+    _unreservedCpus = affinities.unreserved();
+
+    // PhaseLoop only limits iterations, so byte rates are up to the Actors.
+    for (const auto& actorContext : _actorContexts) {
+        for (const auto& [number, phase] : actorContext->phases()) {
+            phase->checkByteRateEnforced();
+        }
+    }
+
+    this->_prewarmClients(setupThreads);
 
     _done = true;
 }
 
-ActorVector WorkloadContext::_constructActors(const Cast& cast,
-                                              const std::unique_ptr<ActorContext>& actorContext) {
-    auto actors = ActorVector{};
+std::shared_ptr<ActorProducer> WorkloadContext::_producer(
+    const Cast& cast, const std::unique_ptr<ActorContext>& actorContext) {
     auto name = (*actorContext)["Type"].to<std::string>();
-
-    std::shared_ptr<ActorProducer> producer;
     try {
-        producer = cast.getProducer(name);
+        return cast.getProducer(name);
     } catch (const std::out_of_range&) {
         std::ostringstream stream;
         stream << "Unable to construct actors: No producer for '" << name << "'." << std::endl;
         cast.streamProducersTo(stream);
         throw InvalidConfigurationException(stream.str());
     }
+}
+
+std::vector<ActorVector> WorkloadContext::_constructActors(const Cast& cast,
+                                                           size_t setupThreads) {
+    // One thread of an Actor from a ParallelizedActorProducer.
+    struct Task {
+        ActorContext* context;
+        // Null for another worker's thread.
+        std::shared_ptr<ParallelizedActorProducer> producer;
+        // Which of the returned ActorVectors to add to.
+        size_t contextIndex;
+        // The id the Actor would have had if constructed serially.
+        ActorId id;
+        ActorVector actors;
+        std::exception_ptr error;
+    };
 
-    for (auto&& actor : producer->produce(*actorContext)) {
-        actors.emplace_back(std::forward<std::unique_ptr<Actor>>(actor));
+    // A worker of a v1::ProcessGroup only constructs the Actors it runs. Another worker's
+    // thread still takes its id, so ids are the same in every worker.
+    const auto* group = _orchestrator->processGroup();
+    size_t actorIndex = 0;
+    const auto isOurs = [&]() {
+        return !group || group->runs(actorIndex++);
+    };
+
+    // Other producers run now, in order, so every Actor's id is the same as if they'd
+    // all been constructed one after the other. They only say how many Actors they
+    // make by making them, so every worker constructs theirs and keeps its share.
+    std::vector<ActorVector> out(_actorContexts.size());
+    std::vector<Task> tasks;
+    for (size_t i = 0; i < _actorContexts.size(); ++i) {
+        auto& actorContext = _actorContexts[i];
+        auto producer = _producer(cast, actorContext);
+        const auto type = (*actorContext)["Type"].to<std::string>();
+        if (auto parallel = std::dynamic_pointer_cast<ParallelizedActorProducer>(producer)) {
+            const auto threads = ParallelizedActorProducer::threads(*actorContext);
+            for (int thread = 0; thread < threads; ++thread) {
+                const auto id = this->_assignActorId(type);
+                tasks.push_back({actorContext.get(), isOurs() ? parallel : nullptr, i, id, {}, {}});
+            }
+        } else {
+            _constructingType = &type;
+            auto actors = producer->produce(*actorContext);
+            _constructingType = nullptr;
+            for (auto&& actor : actors) {
+                out[i].emplace_back(isOurs() ? std::move(actor) : nullptr);
+            }
+        }
     }
-    return actors;
+
+    // Tasks are claimed in order and stop being claimed after one fails, so the first
+    // failure is the same whichever thread ran it.
+    std::atomic<size_t> nextTask = 0;
+    std::atomic_bool failed = false;
+    auto work = [&]() {
+        for (auto i = nextTask++; i < tasks.size() && !failed; i = nextTask++) {
+            auto& task = tasks[i];
+            if (!task.producer) {
+                continue;
+            }
+            try {
+                _reservedActorId = task.id;
+                task.producer->produceInto(task.actors, *task.context);
+            } catch (...) {
+                task.error = std::current_exception();
+                failed = true;
+            }
+            _reservedActorId = 0;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(setupThreads, tasks.size()); ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto& task : tasks) {
+        if (task.error) {
+            std::rethrow_exception(task.error);
+        }
+        if (!task.producer) {
+            out[task.contextIndex].emplace_back(nullptr);
+        }
+        for (auto&& actor : task.actors) {
+            out[task.contextIndex].emplace_back(std::move(actor));
+        }
+    }
+    return out;
+}
+
+void WorkloadContext::_prewarmClients(size_t threads) {
+    const auto connections = _poolManager.prewarm(threads);
+    if (connections.empty()) {
+        return;
+    }
+    std::chrono::nanoseconds slowest{0};
+    for (const auto& connection : connections) {
+        const auto outcome =
+            connection.ok ? metrics::OutcomeType::kSuccess : metrics::OutcomeType::kFailure;
+        const auto now = metrics::clock::now();
+        _registry.operation("Clients", connection.name + ".ConnectionSetup", 0u, std::nullopt, true)
+            .report(now,
+                    std::chrono::duration_cast<std::chrono::microseconds>(connection.firstCommand),
+                    outcome);
+        _registry.operation("Clients", connection.name + ".RoundTrip", 0u, std::nullopt, true)
+            .report(now,
+                    std::chrono::duration_cast<std::chrono::microseconds>(connection.roundTrip),
+                    outcome);
+        slowest = std::max(slowest, connection.firstCommand);
+    }
+    const auto slowestMillis = std::chrono::duration_cast<std::chrono::milliseconds>(slowest);
+    BOOST_LOG_TRIVIAL(info) << "Prewarmed " << connections.size()
+                            << " connections. The slowest took " << slowestMillis.count()
+                            << "ms to set up";
 }
 
 mongocxx::pool::entry WorkloadContext::client(const std::string& name, size_t instance) {
-    return _poolManager.client(name, instance, this->_node);
+    if (!this->isDone()) {
+        ++_setupClients;
+    }
+    return _poolManager.client(name, instance);
 }
 
 GlobalRateLimiter* WorkloadContext::getRateLimiter(const std::string& name, const RateSpec& spec) {
@@ -116,25 +276,98 @@ GlobalRateLimiter* WorkloadContext::getRateLimiter(const std::string& name, cons
         BOOST_THROW_EXCEPTION(
             std::logic_error("Cannot create rate-limiters after setup. Name tried: " + name));
     }
+    std::lock_guard<std::mutex> lock{_setupMutex};
     if (_rateLimiters.count(name) == 0) {
-        _rateLimiters.emplace(std::make_pair(name, std::make_unique<GlobalRateLimiter>(spec)));
+        auto [it, inserted] =
+            _rateLimiters.emplace(std::make_pair(name, std::make_unique<GlobalRateLimiter>(spec)));
+        if (auto* group = _orchestrator->processGroup()) {
+            it->second->shareBucket(group->rateLimiterBucket(name));
+        }
+        if (auto controller = it->second->latencyController()) {
+            const auto& actor = controller->spec().actor;
+            _registry.addObserver(actor, controller->spec().operation, controller);
+            // Internal, like SteadyStateWindow, so no ActorId is taken.
+            controller->reportTo(
+                _registry.operation(
+                    actor, "LatencyTarget." + name + ".Rate", 0u, std::nullopt, true),
+                _registry.operation(
+                    actor, "LatencyTarget." + name + ".Latency", 0u, std::nullopt, true));
+        }
     }
     auto rl = _rateLimiters[name].get();
     rl->addUser();
 
-    // Reset the rate-limiter at the start of every Phase
-    this->_orchestrator->addPrePhaseStartHook(
-        [rl](const Orchestrator*) { rl->resetLastEmptied(); });
+    // Reset the rate-limiter at the start of every Phase. Workers of a process group share
+    // its bucket, so only the one starting the phase resets that.
+    this->_orchestrator->addPrePhaseStartHook([rl](const Orchestrator* orchestrator) {
+        rl->resetLastEmptied(orchestrator->startingPhase());
+    });
     return rl;
 }
 
+v1::SteadyStateDetector* WorkloadContext::getSteadyStateDetector(const std::string& actorName,
+                                                                 PhaseNumber phase,
+                                                                 const SteadyStateSpec& spec) {
+    if (this->isDone()) {
+        BOOST_THROW_EXCEPTION(std::logic_error(
+            "Cannot create steady-state detectors after setup. Actor tried: " + actorName));
+    }
+    std::lock_guard<std::mutex> lock{_setupMutex};
+    auto& detector = _steadyStateDetectors[{actorName, phase}];
+    if (!detector) {
+        // Internal operations don't take an ActorId, which would shift every Actor's after
+        // it. The phase in the name keeps each phase's window apart.
+        auto windowOp = _registry.operation(
+            actorName, "SteadyStateWindow." + std::to_string(phase), 0u, std::nullopt, true);
+        detector = std::make_unique<v1::SteadyStateDetector>(spec, std::move(windowOp));
+        _registry.addObserver(spec.actor, spec.operation, detector.get());
+
+        // Only this phase's start begins a new window.
+        this->_orchestrator->addPrePhaseStartHook(
+            [d = detector.get(), phase](const Orchestrator* o) {
+                if (o->currentPhase() == phase) {
+                    d->reset(v1::SteadyStateDetector::Clock::now());
+                }
+            });
+    }
+    return detector.get();
+}
+
+
+ActorId WorkloadContext::_assignActorId(const std::string& type) {
+    std::lock_guard<std::mutex> lock{_setupMutex};
+    const auto id = _nextActorId++;
+    if (_actorOrdinals.size() <= id) {
+        _actorOrdinals.resize(id + 1);
+    }
+    _actorOrdinals[id] = _actorsOfType[type]++;
+    return id;
+}
+
+size_t WorkloadContext::actorOrdinal(ActorId id) {
+    if (this->isDone()) {
+        BOOST_THROW_EXCEPTION(std::logic_error("Cannot look up Actor ordinals after setup"));
+    }
+    std::lock_guard<std::mutex> lock{_setupMutex};
+    if (id >= _actorOrdinals.size()) {
+        BOOST_THROW_EXCEPTION(
+            std::logic_error("No Actor of a known Type has id " + std::to_string(id)));
+    }
+    return _actorOrdinals[id];
+}
 
 DefaultRandom& WorkloadContext::getRNGForThread(ActorId id) {
     if (this->isDone()) {
         BOOST_THROW_EXCEPTION(std::logic_error("Cannot create RNGs after setup"));
     }
+    std::lock_guard<std::mutex> lock{_setupMutex};
     if (auto rng = _rngRegistry.find(id); rng == _rngRegistry.end()) {
-        auto [it, success] = _rngRegistry.try_emplace(id, _rng());
+        // Seeds are drawn in id order rather than in the order Actors ask for them,
+        // which varies when they're constructed in parallel.
+        while (_rngSeeds.size() <= id) {
+            _rngSeeds.push_back(_rng());
+        }
+        auto [it, success] = _rngRegistry.try_emplace(id, _rngSeeds[id]);
         if (!success) {
             // This should be impossible.
             // But invariants don't hurt we only call this during setup
@@ -179,6 +412,59 @@ std::unordered_map<PhaseNumber, std::unique_ptr<PhaseContext>> ActorContext::con
     return out;
 }
 
+void ActorContext::addExclusionWindows() {
+    struct Windows {
+        Duration warmup;
+        // Relative to the start of the phase.
+        std::optional<Duration> cooldownStart;
+    };
+    std::unordered_map<PhaseNumber, Windows> byPhase;
+    for (const auto& [phaseNumber, phase] : _phaseContexts) {
+        const auto warmup = (*phase)["Warmup"].maybe<TimeSpec>();
+        const auto cooldown = (*phase)["Cooldown"].maybe<TimeSpec>();
+        if (!warmup && !cooldown) {
+            continue;
+        }
+        const auto duration = (*phase)["Duration"].maybe<TimeSpec>();
+        if (cooldown && !duration) {
+            // The end of a Repeat or EndWhen phase isn't known until it happens.
+            throw InvalidConfigurationException(
+                "Cooldown requires a Duration. In Phase " + phase->path());
+        }
+        const auto warmupLength = warmup.value_or(TimeSpec{}).value;
+        const auto cooldownLength = cooldown.value_or(TimeSpec{}).value;
+        if (warmupLength.count() < 0 || cooldownLength.count() < 0 ||
+            (duration && warmupLength + cooldownLength >= duration->value)) {
+            throw InvalidConfigurationException(
+                "Warmup and Cooldown must be non-negative and leave some of the Duration. "
+                "In Phase " +
+                phase->path());
+        }
+        byPhase.emplace(phaseNumber,
+                        Windows{warmupLength,
+                                cooldown ? std::make_optional(duration->value - cooldownLength)
+                                         : std::nullopt});
+    }
+    if (byPhase.empty()) {
+        return;
+    }
+
+    auto& window = this->workload()._registry.exclusionWindow((*this)["Name"].to<std::string>());
+    this->orchestrator().addPrePhaseStartHook(
+        [&window, byPhase = std::move(byPhase)](const Orchestrator* o) {
+            const auto now = metrics::clock::now();
+            auto windows = byPhase.find(o->currentPhase());
+            if (windows == byPhase.end()) {
+                window.clear(now);
+                return;
+            }
+            window.set(now,
+                       now + windows->second.warmup,
+                       windows->second.cooldownStart ? now + *windows->second.cooldownStart
+                                                     : metrics::time_point::max());
+        });
+}
+
 // The SleepContext class is basically an actor-friendly adapter
 // for the Sleeper.
 void SleepContext::sleep_for(Duration duration) const {
@@ -191,4 +477,33 @@ bool PhaseContext::isNop() const {
     auto& nop = (*this)["Nop"];
     return nop.maybe<bool>().value_or(false);
 }
+
+std::string PhaseContext::rateLimiterName() const {
+    std::ostringstream defaultName;
+    defaultName << this->actor()["Name"] << _phaseNumber;
+    return (*this)["RateLimiterName"].maybe<std::string>().value_or(defaultName.str());
+}
+
+GlobalRateLimiter* PhaseContext::getByteRateLimiter() {
+    _byteRateLimited = true;
+    const auto rateSpec = (*this)["GlobalRate"].maybe<RateSpec>();
+    if (!rateSpec || !rateSpec->getBaseSpec() || !rateSpec->getBaseSpec()->bytes) {
+        return nullptr;
+    }
+    return this->workload().getRateLimiter(this->rateLimiterName(), *rateSpec);
+}
+
+void PhaseContext::checkByteRateEnforced() const {
+    const auto rateSpec = (*this)["GlobalRate"].maybe<RateSpec>();
+    if (!rateSpec || !rateSpec->getBaseSpec() || !rateSpec->getBaseSpec()->bytes ||
+        _byteRateLimited) {
+        return;
+    }
+    std::ostringstream msg;
+    msg << "GlobalRate is given in bytes in Phase " << _phaseNumber << " of Actor "
+        << this->actor()["Name"] << ", whose Type "
+        << this->actor()["Type"].maybe<std::string>().value_or("undefined")
+        << " doesn't support byte rates";
+    throw InvalidConfigurationException(msg.str());
+}
 }  // namespace genny
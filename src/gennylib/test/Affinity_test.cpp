@@ -0,0 +1,106 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <optional>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/v1/Affinity.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using v1::CpuSet;
+
+// Two NUMA nodes of four CPUs each.
+v1::CpuTopology twoNodes() {
+    return v1::CpuTopology{{{0, 1, 2, 3}, {4, 5, 6, 7}}};
+}
+
+AffinitySpec spec(const char* yaml) {
+    return YAML::Load(yaml).as<AffinitySpec>();
+}
+
+std::vector<CpuSet> take(v1::AffinityAssigner& assigner, const AffinitySpec& affinity, int n) {
+    std::vector<CpuSet> out;
+    for (int i = 0; i < n; ++i) {
+        out.push_back(assigner.next(affinity));
+    }
+    return out;
+}
+
+TEST_CASE("AffinityAssigner") {
+    SECTION("Actors without Affinity run anywhere") {
+        v1::AffinityAssigner assigner{twoNodes()};
+        REQUIRE(assigner.next(std::nullopt).empty());
+        REQUIRE(assigner.unreserved().empty());
+    }
+
+    SECTION("spread alternates between nodes and wraps around") {
+        v1::AffinityAssigner assigner{twoNodes()};
+        REQUIRE(take(assigner, spec("spread"), 9) ==
+                std::vector<CpuSet>{{0}, {4}, {1}, {5}, {2}, {6}, {3}, {7}, {0}});
+    }
+
+    SECTION("compact fills one node first") {
+        v1::AffinityAssigner assigner{twoNodes()};
+        REQUIRE(take(assigner, spec("compact"), 5) ==
+                std::vector<CpuSet>{{0}, {1}, {2}, {3}, {4}});
+    }
+
+    SECTION("CPU lists and NUMA nodes") {
+        v1::AffinityAssigner assigner{twoNodes()};
+        REQUIRE(assigner.next(spec("[1, 6]")) == CpuSet{1, 6});
+        REQUIRE(assigner.next(spec("{NumaNode: 1}")) == CpuSet{4, 5, 6, 7});
+
+        REQUIRE_THROWS_AS(assigner.next(spec("[8]")), InvalidConfigurationException);
+        REQUIRE_THROWS_AS(assigner.next(spec("{NumaNode: 2}")), InvalidConfigurationException);
+        REQUIRE_THROWS_AS(assigner.cpus(spec("spread")), InvalidConfigurationException);
+    }
+
+    SECTION("Reserved CPUs are kept for genny's own threads") {
+        v1::AffinityAssigner assigner{twoNodes(), {0, 4}};
+        REQUIRE(assigner.unreserved() == CpuSet{1, 2, 3, 5, 6, 7});
+        REQUIRE(assigner.next(std::nullopt) == CpuSet{1, 2, 3, 5, 6, 7});
+        REQUIRE(take(assigner, spec("spread"), 3) == std::vector<CpuSet>{{1}, {5}, {2}});
+        REQUIRE(take(assigner, spec("compact"), 4) == std::vector<CpuSet>{{1}, {2}, {3}, {5}});
+
+        REQUIRE_THROWS_AS((v1::AffinityAssigner{twoNodes(), {0, 1, 2, 3, 4, 5, 6, 7}}),
+                          InvalidConfigurationException);
+    }
+}
+
+TEST_CASE("Thread affinity") {
+    const auto topology = v1::CpuTopology::current();
+    REQUIRE(!topology.allCpus().empty());
+
+    const auto original = v1::threadAffinity();
+    if (original.empty()) {
+        // Not supported on this platform.
+        REQUIRE(!v1::setThreadAffinity({0}));
+        return;
+    }
+    REQUIRE(v1::setThreadAffinity({original.front()}));
+    REQUIRE(v1::threadAffinity() == CpuSet{original.front()});
+    REQUIRE(v1::setThreadAffinity(original));
+    REQUIRE(v1::threadAffinity() == original);
+    REQUIRE(!v1::setThreadAffinity({}));
+}
+
+}  // namespace
+}  // namespace genny
@@ -0,0 +1,82 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdexcept>
+#include <vector>
+
+#include <gennylib/v1/AliasTable.hpp>
+
+#include <value_generators/DefaultRandom.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+std::vector<double> frequencies(const v1::AliasTable& table, int samples) {
+    DefaultRandom rng;
+    std::vector<double> counts(table.size(), 0);
+    for (int i = 0; i < samples; ++i) {
+        ++counts[table.sample(rng)];
+    }
+    for (auto& count : counts) {
+        count /= samples;
+    }
+    return counts;
+}
+
+TEST_CASE("AliasTable samples in proportion to the weights") {
+    constexpr int kSamples = 1000 * 1000;
+
+    SECTION("Skewed weights") {
+        const auto actual = frequencies(v1::AliasTable{{90, 10}}, kSamples);
+        REQUIRE(actual[0] == Approx(0.9).margin(0.005));
+        REQUIRE(actual[1] == Approx(0.1).margin(0.005));
+    }
+
+    SECTION("Many uneven weights") {
+        const std::vector<double> weights{1, 2, 3, 4, 5, 0.5, 20, 0.25};
+        double sum = 0;
+        for (auto weight : weights) {
+            sum += weight;
+        }
+        const auto actual = frequencies(v1::AliasTable{weights}, kSamples);
+        for (size_t i = 0; i < weights.size(); ++i) {
+            INFO("index " << i);
+            REQUIRE(actual[i] == Approx(weights[i] / sum).margin(0.005));
+        }
+    }
+
+    SECTION("Zero weights are never chosen") {
+        const auto actual = frequencies(v1::AliasTable{{0, 3, 0, 1, 0}}, kSamples);
+        REQUIRE(actual[0] == 0);
+        REQUIRE(actual[2] == 0);
+        REQUIRE(actual[4] == 0);
+        REQUIRE(actual[1] == Approx(0.75).margin(0.005));
+    }
+
+    SECTION("A single weight") {
+        const auto actual = frequencies(v1::AliasTable{{7}}, 1000);
+        REQUIRE(actual[0] == 1);
+    }
+}
+
+TEST_CASE("AliasTable rejects invalid weights") {
+    REQUIRE_THROWS_AS(v1::AliasTable{{}}, std::invalid_argument);
+    REQUIRE_THROWS_AS((v1::AliasTable{{0, 0}}), std::invalid_argument);
+    REQUIRE_THROWS_AS((v1::AliasTable{{1, -1}}), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace genny
@@ -0,0 +1,175 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mongocxx/options/apm.hpp>
+
+#include <gennylib/v1/CommandMonitor.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+
+#include <metrics/MetricsReporter.hpp>
+#include <metrics/metrics.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace std::chrono_literals;
+
+std::string csv(const metrics::Registry& registry) {
+    std::ostringstream out;
+    metrics::Reporter{registry}.report(out, metrics::MetricsFormat("csv"));
+    return out.str();
+}
+
+bool reported(const std::string& csv, const std::string& metric, const std::string& value) {
+    return csv.find("," + metric + "," + value + "\n") != std::string::npos;
+}
+
+TEST_CASE("CommandMonitor reports commands by Actor, command, and host") {
+    metrics::Registry registry;
+    v1::CommandMonitor monitor{registry};
+
+    std::thread{[&]() {
+        // Not attributed to an Actor yet.
+        monitor.report("find", "localhost", 27017, 100us, true, 50);
+
+        v1::CommandMonitor::setActor("Reader", 3);
+        monitor.report("find", "localhost", 27017, 200us, true, 50);
+        monitor.report("insert", "otherhost", 27018, 300us, false);
+    }}.join();
+
+    const auto out = csv(registry);
+    REQUIRE(reported(out, "Reader.id-3.Command.find_timer", "200000"));
+    REQUIRE(reported(out, "Reader.id-3.Command.find_bytes", "50"));
+    REQUIRE(reported(out, "Reader.id-3.Command.insert_timer", "300000"));
+    REQUIRE(reported(out, "Commands.id-3.find_timer", "200000"));
+    REQUIRE(reported(out, "Commands.id-3.insert_timer", "300000"));
+    REQUIRE(reported(out, "Hosts.id-3.localhost:27017_timer", "200000"));
+    REQUIRE(reported(out, "Hosts.id-3.otherhost:27018_timer", "300000"));
+    REQUIRE(out.find("100000") == std::string::npos);
+}
+
+TEST_CASE("CommandMonitor reports from many threads while operations are created") {
+    metrics::Registry registry;
+    v1::CommandMonitor monitor{registry};
+    const int actors = 16;
+
+    std::atomic_bool done = false;
+    std::thread reader{[&]() {
+        // What each ftdc report asks for, while commands create operations.
+        while (!done) {
+            try {
+                registry.getWorkerCount("Commands", "find");
+            } catch (const std::out_of_range&) {
+                // Not created yet.
+            }
+            registry.operationCount();
+        }
+    }};
+    std::vector<std::thread> threads;
+    for (int id = 1; id <= actors; ++id) {
+        threads.emplace_back([&, id]() {
+            v1::CommandMonitor::setActor("Actor", id);
+            for (int i = 0; i < 100; ++i) {
+                monitor.report("find", "localhost", 27017, 100us, true, 10);
+                monitor.report("cmd" + std::to_string(i % 10), "localhost", 27017, 100us, true);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done = true;
+    reader.join();
+
+    REQUIRE(registry.getWorkerCount("Commands", "find") == actors);
+    REQUIRE(registry.getWorkerCount("Actor", "Command.cmd9") == actors);
+    REQUIRE(reported(csv(registry), "Commands.id-16.find_timer", "100000"));
+}
+
+TEST_CASE("CommandMonitor creates operations after the Actor's own are timed") {
+    metrics::Registry registry;
+    v1::CommandMonitor monitor{registry};
+    mongocxx::options::apm apm;
+    monitor.monitor(apm);
+
+    size_t whileTiming = 0;
+    size_t afterTiming = 0;
+    std::thread{[&]() {
+        v1::CommandMonitor::setActor("Reader", 3);
+        auto read = registry.operation("Reader", "Read", 3);
+        auto context = read.start();
+        monitor.report("find", "localhost", 27017, 200us, true, 50);
+        monitor.report("find", "localhost", 27017, 200us, true, 50);
+        whileTiming = registry.operationCount();
+        context.success();
+        afterTiming = registry.operationCount();
+
+        // Only new commands wait.
+        monitor.report("find", "localhost", 27017, 200us, true, 50);
+    }}.join();
+
+    // Read, then Reader.Command.find, Commands.find and Hosts.localhost:27017.
+    REQUIRE(whileTiming == 1);
+    REQUIRE(afterTiming == 4);
+    const auto out = csv(registry);
+    // Every command is reported, including those that waited.
+    for (std::string metric : {"Reader.id-3.Command.find", "Hosts.id-3.localhost:27017"}) {
+        const auto row = "," + metric + "_timer,200000\n";
+        size_t rows = 0;
+        for (auto at = out.find(row); at != std::string::npos; at = out.find(row, at + 1)) {
+            ++rows;
+        }
+        REQUIRE(rows == 3);
+    }
+}
+
+TEST_CASE("CommandMonitor attributes commands run through runBlocking") {
+    metrics::Registry registry;
+    v1::CommandMonitor monitor{registry};
+
+    v1::FiberPool pool{2};
+    for (ActorId id = 1; id <= 4; ++id) {
+        pool.launch([&, id]() {
+            v1::CommandMonitor::setActor("Fiber", id);
+            v1::runBlocking([&]() { monitor.report("find", "localhost", 27017, 100us, true); });
+        });
+    }
+    pool.join();
+
+    // The pool's threads are left unattributed.
+    v1::FiberPool other{1};
+    other.launch(
+        [&]() { v1::runBlocking([&]() { monitor.report("ping", "localhost", 27017, 1us, true); }); });
+    other.join();
+
+    const auto out = csv(registry);
+    for (ActorId id = 1; id <= 4; ++id) {
+        const auto metric = "Fiber.id-" + std::to_string(id) + ".Command.find_timer";
+        REQUIRE(reported(out, metric, "100000"));
+    }
+    REQUIRE(out.find("ping") == std::string::npos);
+}
+
+}  // namespace
+}  // namespace genny
@@ -0,0 +1,149 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include <gennylib/Orchestrator.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace std::chrono;
+
+TEST_CASE("FiberPool runs sleeping fibers without a thread each") {
+    constexpr int kFibers = 10000;
+    std::atomic_int finished = 0;
+    std::atomic_bool anyOnFiber = true;
+
+    const auto started = steady_clock::now();
+    {
+        v1::FiberPool pool{2};
+        for (int i = 0; i < kFibers; ++i) {
+            pool.launch([&]() {
+                anyOnFiber = anyOnFiber && v1::FiberPool::onFiber();
+                v1::sleepFor(milliseconds{50});
+                v1::sleepFor(milliseconds{50});
+                ++finished;
+            });
+        }
+        pool.join();
+    }
+    const auto elapsed = steady_clock::now() - started;
+
+    REQUIRE(finished == kFibers);
+    REQUIRE(anyOnFiber);
+    REQUIRE(!v1::FiberPool::onFiber());
+    // Sleeping a thread per fiber two at a time would take over 8 minutes.
+    REQUIRE(elapsed < seconds{10});
+}
+
+TEST_CASE("Orchestrator phase waits yield on fibers") {
+    // With one worker, a fiber blocking its thread while it waits for the others to
+    // arrive would deadlock.
+    constexpr int kFibers = 100;
+    constexpr PhaseNumber kPhases = 3;
+    Orchestrator o{};
+    o.addRequiredTokens(kFibers);
+    o.phasesAtLeastTo(kPhases - 1);
+
+    std::atomic_int ran = 0;
+    v1::FiberPool pool{1};
+    for (int i = 0; i < kFibers; ++i) {
+        pool.launch([&]() {
+            while (o.morePhases()) {
+                o.awaitPhaseStart();
+                ++ran;
+                o.awaitPhaseEnd();
+            }
+        });
+    }
+    pool.join();
+
+    REQUIRE(ran == kFibers * kPhases);
+    REQUIRE(o.currentPhase() == kPhases);
+}
+
+TEST_CASE("Orchestrator timed waits yield on fibers") {
+    Orchestrator o{};
+    o.addRequiredTokens(1);
+    o.awaitPhaseStart();
+
+    std::atomic_bool woken = false;
+    v1::FiberPool pool{1};
+    pool.launch([&]() {
+        o.sleepToPhaseEnd(seconds{30}, 0);
+        woken = true;
+    });
+    pool.launch([&]() {
+        v1::sleepFor(milliseconds{10});
+        o.awaitPhaseEnd();
+    });
+    pool.join();
+
+    REQUIRE(woken);
+}
+
+TEST_CASE("runBlocking doesn't hold up the worker") {
+    std::atomic_bool blockingDone = false;
+    std::atomic_bool otherDoneFirst = false;
+    int result = 0;
+
+    v1::FiberPool pool{1};
+    pool.launch([&]() {
+        result = v1::runBlocking([&]() {
+            std::this_thread::sleep_for(milliseconds{500});
+            return 7;
+        });
+        blockingDone = true;
+    });
+    pool.launch([&]() {
+        v1::sleepFor(milliseconds{10});
+        otherDoneFirst = !blockingDone;
+    });
+    pool.join();
+
+    REQUIRE(result == 7);
+    REQUIRE(otherDoneFirst);
+}
+
+TEST_CASE("runBlocking rethrows") {
+    std::atomic_bool caught = false;
+
+    v1::FiberPool pool{1};
+    pool.launch([&]() {
+        try {
+            v1::runBlocking([]() { throw std::runtime_error{"oops"}; });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+    });
+    pool.join();
+
+    REQUIRE(caught);
+
+    // Off a fiber it's just a call.
+    REQUIRE(v1::runBlocking([]() { return 3; }) == 3);
+    REQUIRE_THROWS_AS(v1::runBlocking([]() { throw std::runtime_error{"oops"}; }),
+                      std::runtime_error);
+}
+
+}  // namespace
+}  // namespace genny
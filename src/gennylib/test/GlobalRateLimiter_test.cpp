@@ -14,6 +14,7 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <ratio>
 #include <thread>
@@ -80,6 +81,32 @@ TEST_CASE("Global rate limiter") {
     }
 }
 
+TEST_CASE("Rate changes are seen whole") {
+    // From 1000 per 1s to 1 per 1ms; a mixed read would allow 1000 per 1ms.
+    const v1::PublishedRate::Rate slow{1000, 1000 * 1000 * 1000};
+    const v1::PublishedRate::Rate fast{1, 1000 * 1000};
+    v1::PublishedRate rate;
+    rate.store(slow);
+
+    std::atomic_bool done = false;
+    std::thread writer{[&]() {
+        for (int i = 0; i < 100000; ++i) {
+            rate.store(i % 2 == 0 ? fast : slow);
+        }
+        done = true;
+    }};
+
+    int64_t mixed = 0;
+    while (!done) {
+        const auto [burstSize, rateNS] = rate.load();
+        if (burstSize != (rateNS == fast.rateNS ? fast.burstSize : slow.burstSize)) {
+            ++mixed;
+        }
+    }
+    writer.join();
+    REQUIRE(mixed == 0);
+}
+
 TEST_CASE("Percentile rate limiting") {
     struct DummyTemplateValue {};
     using MyDummyClock = DummyClock<DummyTemplateValue>;
@@ -129,6 +156,130 @@ TEST_CASE("Percentile rate limiting") {
     }
 }
 
+TEST_CASE("Byte rate limiting") {
+    struct DummyTemplateValue {};
+    using MyDummyClock = DummyClock<DummyTemplateValue>;
+
+    // 1000 bytes per 1000 ticks.
+    const BaseRateSpec rs{1000, 1000, true};
+    BaseGlobalRateLimiter<MyDummyClock> grl{rs};
+
+    SECTION("Limits Rate") {
+        grl.resetLastEmptied();
+        auto now = MyDummyClock::now();
+
+        // A full bucket may be spent in pieces.
+        REQUIRE(grl.consumeIfWithinRate(now, 600));
+        REQUIRE(grl.consumeIfWithinRate(now, 400));
+        REQUIRE(!grl.consumeIfWithinRate(now, 1));
+
+        // 100 ticks refill 100 bytes.
+        MyDummyClock::nowRaw += 100;
+        now = MyDummyClock::now();
+        REQUIRE(grl.consumeIfWithinRate(now, 100));
+        REQUIRE(!grl.consumeIfWithinRate(now, 1));
+
+        // A request larger than the bucket goes through but has to be paid back.
+        MyDummyClock::nowRaw += 1000;
+        now = MyDummyClock::now();
+        REQUIRE(grl.consumeIfWithinRate(now, 3000));
+        MyDummyClock::nowRaw += 2000;
+        REQUIRE(!grl.consumeIfWithinRate(MyDummyClock::now(), 1));
+        MyDummyClock::nowRaw += 1;
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), 1));
+
+        // Idle time doesn't accumulate more than a bucket's worth.
+        MyDummyClock::nowRaw += 1000000;
+        now = MyDummyClock::now();
+        REQUIRE(grl.consumeIfWithinRate(now, 1000));
+        REQUIRE(!grl.consumeIfWithinRate(now, 1));
+    }
+}
+
+TEST_CASE("Latency target rate limiting") {
+    struct DummyTemplateValue {};
+    using MyDummyClock = DummyClock<DummyTemplateValue>;
+
+    // Start at 10 operations per 1000 ticks (1e7 ops/second) and hold p99 at or below 1000ns,
+    // re-evaluating every 1000 ticks.
+    LatencyRateSpec rs{99, TimeSpec{1000}, "Op"};
+    rs.interval = TimeSpec{1000};
+    rs.startingRate = BaseRateSpec{1000, 10};
+    BaseGlobalRateLimiter<MyDummyClock> grl{rs};
+    auto controller = grl.latencyController();
+    REQUIRE(controller);
+
+    auto runInterval = [&](int64_t ops, std::chrono::nanoseconds latency) {
+        for (int64_t i = 0; i < ops; ++i) {
+            controller->observe(latency);
+        }
+        MyDummyClock::nowRaw += 1000;
+        grl.consumeIfWithinRate(MyDummyClock::now());
+    };
+
+    SECTION("Adjusts rate to meet the target") {
+        grl.resetLastEmptied();
+        REQUIRE(grl.getRate() == 1000);
+
+        // Under target and keeping up: additive increase.
+        runInterval(10, std::chrono::nanoseconds{500});
+        REQUIRE(grl.getRate() == 909);
+
+        // Over target: multiplicative decrease.
+        runInterval(10, std::chrono::nanoseconds{5000});
+        REQUIRE(grl.getRate() == 1136);
+
+        // Under target but not keeping up with the allowed rate: no change.
+        runInterval(1, std::chrono::nanoseconds{500});
+        REQUIRE(grl.getRate() == 1136);
+
+        REQUIRE(controller->timeline().size() == 3);
+        REQUIRE(controller->sustainedRate() == Approx(1e7));
+
+        // A new phase keeps the rate but starts a new timeline.
+        grl.resetLastEmptied();
+        REQUIRE(grl.getRate() == 1136);
+        REQUIRE(controller->timeline().empty());
+    }
+
+    SECTION("Reports each interval to metrics") {
+        struct RecordingObserver : public metrics::OperationObserver {
+            void observe(std::chrono::nanoseconds duration) override {
+                durations.push_back(duration);
+            }
+            std::vector<std::chrono::nanoseconds> durations;
+        } rates, latencies;
+
+        genny::metrics::Registry metrics;
+        metrics.addObserver("Actor", "Rate", &rates);
+        metrics.addObserver("Actor", "Latency", &latencies);
+        controller->reportTo(metrics.operation("Actor", "Rate", 0u),
+                             metrics.operation("Actor", "Latency", 0u));
+
+        grl.resetLastEmptied();
+        runInterval(10, std::chrono::nanoseconds{500});
+        runInterval(10, std::chrono::nanoseconds{5000});
+
+        // Durations are reported in whole microseconds.
+        REQUIRE(rates.durations.size() == 2);
+        REQUIRE(latencies.durations ==
+                std::vector<std::chrono::nanoseconds>{std::chrono::nanoseconds{0},
+                                                      std::chrono::microseconds{5}});
+    }
+
+    SECTION("Histogram is accurate to within a sub-bucket") {
+        v1::LatencyHistogram histogram;
+        for (int64_t i = 1; i <= 1000; ++i) {
+            histogram.record(i * 1000);
+        }
+        const auto counts = histogram.drain();
+        REQUIRE(v1::LatencyHistogram::total(counts) == 1000);
+        REQUIRE(v1::LatencyHistogram::percentile(counts, 50) == Approx(500000).epsilon(1.0 / 16));
+        REQUIRE(v1::LatencyHistogram::percentile(counts, 99) == Approx(990000).epsilon(1.0 / 16));
+        REQUIRE(v1::LatencyHistogram::total(histogram.drain()) == 0);
+    }
+}
+
 
 class IncActor : public Actor {
 public:
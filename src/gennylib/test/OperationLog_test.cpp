@@ -0,0 +1,106 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/v1/OperationLog.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::v1 {
+namespace {
+
+namespace fs = boost::filesystem;
+
+struct TempFile {
+    const std::string path = (fs::temp_directory_path() / fs::unique_path()).string();
+
+    ~TempFile() {
+        fs::remove(path);
+    }
+};
+
+// A command that doesn't compress away, so a few fill a block.
+std::string commandNumber(int i) {
+    std::string out = "{insert: " + std::to_string(i) + "}";
+    for (int j = 0; j < 1000; ++j) {
+        out += char('a' + (i * 7919 + j * 104729) % 26);
+    }
+    return out;
+}
+
+TEST_CASE("OperationLog") {
+    TempFile file;
+
+    SECTION("Reads back what was written, across blocks, and again after rewinding") {
+        const int commands = 3 * OperationLogWriter::kBlockSize / 1000;
+        {
+            OperationLogWriter writer{file.path, "Inserter", 7};
+            for (int i = 0; i < commands; ++i) {
+                writer.append({std::chrono::nanoseconds{i * 1000},
+                               i % 2 ? "odd" : "even",
+                               commandNumber(i)});
+            }
+            writer.close();
+            REQUIRE(writer.count() == commands);
+        }
+        REQUIRE(fs::file_size(file.path) < commands * 1000);
+
+        OperationLogReader reader{file.path};
+        REQUIRE(reader.actorName() == "Inserter");
+        REQUIRE(reader.actorId() == 7);
+        for (int pass = 0; pass < 2; ++pass) {
+            LoggedOperation operation;
+            int read = 0;
+            bool matched = true;
+            while (reader.next(operation)) {
+                matched = matched && operation.offset.count() == read * 1000 &&
+                    operation.database == (read % 2 ? "odd" : "even") &&
+                    operation.command == commandNumber(read);
+                ++read;
+            }
+            REQUIRE(matched);
+            REQUIRE(read == commands);
+            reader.rewind();
+        }
+    }
+
+    SECTION("An empty log has no commands") {
+        OperationLogWriter{file.path, "Idle", 1}.close();
+        OperationLogReader reader{file.path};
+        LoggedOperation operation;
+        REQUIRE(!reader.next(operation));
+    }
+
+    SECTION("Rejects files that aren't complete logs") {
+        {
+            OperationLogWriter writer{file.path, "Inserter", 7};
+            writer.append({std::chrono::nanoseconds{0}, "test", commandNumber(0)});
+        }
+        fs::resize_file(file.path, fs::file_size(file.path) - 10);
+        OperationLogReader reader{file.path};
+        LoggedOperation operation;
+        REQUIRE_THROWS_AS(reader.next(operation), InvalidConfigurationException);
+
+        std::ofstream{file.path} << "not a log";
+        REQUIRE_THROWS_AS(OperationLogReader{file.path}, InvalidConfigurationException);
+    }
+}
+
+}  // namespace
+}  // namespace genny::v1
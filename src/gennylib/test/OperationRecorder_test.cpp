@@ -0,0 +1,85 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/OperationRecorder.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::v1 {
+namespace {
+
+namespace fs = boost::filesystem;
+
+using bsoncxx::builder::basic::kvp;
+using bsoncxx::builder::basic::make_document;
+
+struct TempDirectory {
+    const std::string path = (fs::temp_directory_path() / fs::unique_path()).string();
+
+    ~TempDirectory() {
+        fs::remove_all(path);
+    }
+};
+
+TEST_CASE("OperationRecorder") {
+    TempDirectory directory;
+    OperationRecorder recorder{directory.path};
+    const auto command = make_document(kvp("insert", "test"), kvp("lsid", 1));
+
+    SECTION("Records the commands of attached threads") {
+        std::thread{[&]() {
+            // Not attached yet.
+            recorder.record("insert", "test", command.view());
+
+            recorder.attach("Inserter", 1);
+            recorder.record("insert", "test", command.view());
+            recorder.record("getMore", "test", make_document(kvp("getMore", 1)).view());
+        }}.join();
+
+        REQUIRE(recorder.close() == 1);
+        REQUIRE(OperationRecorder::logs(directory.path).size() == 1);
+    }
+
+    SECTION("Records commands fibers run through runBlocking") {
+        FiberPool pool{1};
+        for (ActorId id = 1; id <= 3; ++id) {
+            pool.launch([&, id]() {
+                recorder.attach("Fiber", id);
+                runBlocking([&]() { recorder.record("insert", "test", command.view()); });
+            });
+        }
+        pool.join();
+
+        // The pool's threads aren't left attached.
+        FiberPool other{1};
+        other.launch(
+            [&]() { runBlocking([&]() { recorder.record("insert", "test", command.view()); }); });
+        other.join();
+
+        REQUIRE(recorder.close() == 3);
+        REQUIRE(OperationRecorder::logs(directory.path).size() == 3);
+    }
+}
+
+}  // namespace
+}  // namespace genny::v1
@@ -12,13 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <optional>
+#include <thread>
+#include <vector>
 
 #include "NopActor.hpp"
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/PhaseLoop.hpp>
+#include <gennylib/v1/CoarseClock.hpp>
 #include <testlib/ActorHelper.hpp>
 
 #include <testlib/clocks.hpp>
@@ -166,6 +170,143 @@ TEST_CASE("Combinations of duration and iterations") {
     }
 }
 
+TEST_CASE("Duration checks with the coarse clock") {
+    genny::metrics::Registry metrics;
+    genny::Orchestrator o{};
+
+    SECTION("The coarse clock trails the real clock") {
+        const auto& coarse = v1::CoarseClock::get();
+        const auto before = coarse.now();
+        REQUIRE(before <= chrono::steady_clock::now());
+        std::this_thread::sleep_for(chrono::milliseconds{10});
+        REQUIRE(coarse.now() > before);
+        REQUIRE(coarse.now() <= chrono::steady_clock::now());
+    }
+
+    SECTION("Slow iterations stop on the coarse clock and never early") {
+        v1::ActorPhase<int> loop{
+            o,
+            std::make_unique<v1::IterationChecker>(10_ots, nullopt, false, 0_ts, 0_ts, nullopt),
+            0};
+
+        const auto start = chrono::steady_clock::now();
+        std::optional<chrono::steady_clock::time_point> first;
+        int i = 0;
+        int afterDuration = 0;
+        for (auto _ : loop) {
+            const auto now = chrono::steady_clock::now();
+            if (!first) {
+                first = now;
+            }
+            // The phase started before the first iteration, so it's over by now.
+            if (now - *first >= chrono::milliseconds{10}) {
+                ++afterDuration;
+            }
+            ++i;
+            std::this_thread::sleep_for(chrono::microseconds{500});
+        }
+
+        // The coarse clock trails the real one, so the phase can't end early.
+        REQUIRE(chrono::steady_clock::now() - start >= chrono::milliseconds{10});
+        // Only every 1024th iteration reads the real clock, so stopping before then
+        // means the loop relied on the coarse clock. However slow the host, the phase
+        // never runs more than 1024 iterations past its Duration.
+        REQUIRE(i < 1024);
+        REQUIRE(afterDuration < 1024);
+    }
+
+    SECTION("Batches that step over multiples of 1024 still read the real clock") {
+        v1::IterationChecker checker{10_ots, nullopt, false, 0_ts, 0_ts, nullopt};
+        const auto& coarse = v1::CoarseClock::get();
+
+        int64_t nextRealClockIteration = 0;
+        int realClockReads = 0;
+        // Batches of 1000 iterations only land on a multiple of 1024 every 128 batches.
+        for (int64_t iteration = 1000; iteration <= 10000; iteration += 1000) {
+            // The Duration is up by the real clock. If it still isn't by the coarse one
+            // after the check, only the real clock could have said it was done.
+            const auto startedAt = chrono::steady_clock::now() - chrono::milliseconds{10};
+            const bool done = checker.isDone(startedAt, iteration, nextRealClockIteration);
+            if (done && coarse.now() - startedAt < chrono::milliseconds{10}) {
+                ++realClockReads;
+            }
+        }
+
+        // Read at 1000, 3000, 5000, 7000 and 9000: each 1024 or more past the last.
+        REQUIRE(nextRealClockIteration == 10024);
+        // Allow for the coarse clock ticking mid-check.
+        REQUIRE(realClockReads >= 4);
+    }
+}
+
+TEST_CASE("Batched iteration") {
+    genny::metrics::Registry metrics;
+    genny::Orchestrator o{};
+
+    auto batchSizes = [](v1::ActorPhase<int>& loop, int64_t batchSize) {
+        std::vector<int64_t> sizes;
+        for (auto&& batch : loop.batches(batchSize)) {
+            int64_t ran = 0;
+            for (auto _ : batch) {
+                ++ran;
+            }
+            REQUIRE(ran == batch.size());
+            sizes.push_back(ran);
+        }
+        return sizes;
+    };
+
+    SECTION("The last batch stops at the Repeat count") {
+        v1::ActorPhase<int> loop{
+            o,
+            std::make_unique<v1::IterationChecker>(nullopt, 1000_uis, false, 0_ts, 0_ts, nullopt),
+            0};
+        REQUIRE(batchSizes(loop, 256) == std::vector<int64_t>{256, 256, 256, 232});
+        REQUIRE(batchSizes(loop, 2000) == std::vector<int64_t>{1000});
+    }
+
+    SECTION("Repeat 0 runs no batches") {
+        v1::ActorPhase<int> loop{
+            o,
+            std::make_unique<v1::IterationChecker>(nullopt, 0_uis, false, 0_ts, 0_ts, nullopt),
+            0};
+        REQUIRE(batchSizes(loop, 256).empty());
+    }
+
+    SECTION("Duration is checked between batches") {
+        v1::ActorPhase<int> loop{
+            o,
+            std::make_unique<v1::IterationChecker>(10_ots, 1_uis, false, 0_ts, 0_ts, nullopt),
+            0};
+        const auto start = chrono::steady_clock::now();
+        const auto sizes = batchSizes(loop, 100);
+        const auto elapsed = chrono::steady_clock::now() - start;
+
+        REQUIRE(elapsed >= chrono::milliseconds{10});
+        REQUIRE(elapsed <= chrono::milliseconds{15});
+        REQUIRE(sizes.size() > 1);
+        REQUIRE(sizes.front() == 1);
+        REQUIRE(std::all_of(
+            sizes.begin() + 1, sizes.end(), [](auto size) { return size == 100; }));
+    }
+
+    SECTION("Sleeps apply to each iteration") {
+        v1::ActorPhase<int> loop{
+            o,
+            std::make_unique<v1::IterationChecker>(nullopt, 3_uis, false, 1_ts, 0_ts, nullopt),
+            0};
+        REQUIRE(batchSizes(loop, 256) == std::vector<int64_t>{1, 1, 1});
+    }
+
+    SECTION("Batches can't be empty") {
+        v1::ActorPhase<int> loop{
+            o,
+            std::make_unique<v1::IterationChecker>(nullopt, 3_uis, false, 0_ts, 0_ts, nullopt),
+            0};
+        REQUIRE_THROWS_AS(loop.batches(0), std::invalid_argument);
+    }
+}
+
 TEST_CASE("Can do without either iterations or duration") {
     genny::metrics::Registry metrics;
     genny::Orchestrator o{};
@@ -13,10 +13,12 @@
 // limitations under the License.
 
 #include <iostream>
+#include <vector>
 
 #include <mongocxx/instance.hpp>
 #include <mongocxx/pool.hpp>
 
+#include <gennylib/InvalidConfigurationException.hpp>
 #include <gennylib/v1/PoolFactory.hpp>
 #include <gennylib/v1/PoolManager.hpp>
 
@@ -240,19 +242,18 @@ TEST_CASE("PoolFactory behavior") {
     }
 
     SECTION("PoolManager can construct multiple pools") {
-        genny::v1::PoolManager manager{"mongodb:://localhost:27017", {}};
         genny::NodeSource ns{"", ""};
-        auto& config = ns.root();
+        genny::v1::PoolManager manager{"mongodb:://localhost:27017", {}, ns.root()};
 
-        auto foo0 = manager.client("Foo", 0, config);
-        auto foo0again = manager.client("Foo", 0, config);
-        auto foo10 = manager.client("Foo", 10, config);
-        auto bar0 = manager.client("Bar", 0, config);
+        auto foo0 = manager.client("Foo", 0);
+        auto foo0again = manager.client("Foo", 0);
+        auto foo10 = manager.client("Foo", 10);
+        auto bar0 = manager.client("Bar", 0);
 
         // Note to future maintainers:
         //
         // This assertion doesn't actually verify that we aren't calling
-        // `createPool()` again when running `manager.client("Foo", 0, config)` a
+        // `createPool()` again when running `manager.client("Foo", 0)` a
         // second time.
         //
         // A different style of trying to write this test is to register a
@@ -262,4 +263,65 @@ TEST_CASE("PoolFactory behavior") {
         REQUIRE((manager.instanceCount() ==
                  std::unordered_map<std::string, size_t>({{"Foo", 2}, {"Bar", 1}})));
     }
+
+    SECTION("PoolManager spreads clients over Instances") {
+        genny::NodeSource ns{R"(
+Clients:
+  RoundRobin: {Instances: 2}
+  PerHost: {Assign: per-host}
+  FewerThanHosts: {Instances: 2, Assign: per-host}
+)",
+                             ""};
+        genny::v1::PoolManager manager{"mongodb://a:1,b:2,c:3", {}, ns.root()};
+
+        std::vector<mongocxx::pool::entry> clients;
+        for (int i = 0; i < 5; ++i) {
+            clients.push_back(manager.client("RoundRobin", 0));
+            clients.push_back(manager.client("PerHost", 0));
+            clients.push_back(manager.client("FewerThanHosts", 0));
+        }
+        clients.push_back(manager.client("Unassigned", 0));
+
+        REQUIRE((manager.instanceCount() == std::unordered_map<std::string, size_t>({
+                     {"RoundRobin", 2},
+                     {"PerHost", 3},
+                     {"FewerThanHosts", 2},
+                     {"Unassigned", 1},
+                 })));
+    }
+
+    SECTION("PoolManager rejects bad Instances and Assign") {
+        for (const auto clients : {"Clients: {Zero: {Instances: 0}}",
+                                   "Clients: {Unknown: {Instances: 2, Assign: random}}",
+                                   "Clients: {NoInstances: {Assign: round-robin}}"}) {
+            genny::NodeSource ns{clients, ""};
+            REQUIRE_THROWS_AS((genny::v1::PoolManager{"mongodb://a:1", {}, ns.root()}),
+                              genny::InvalidConfigurationException);
+        }
+
+        genny::NodeSource perHost{"Clients: {Default: {Assign: per-host}}", ""};
+        REQUIRE_THROWS_AS(
+            (genny::v1::PoolManager{"mongodb+srv://cluster.example.com", {}, perHost.root()}),
+            genny::InvalidConfigurationException);
+    }
+
+    SECTION("PoolManager prewarms the clients of Prewarm pools once") {
+        // Nothing listens here, so each ping fails once server selection times out.
+        genny::NodeSource ns{"Clients: {Foo: {Prewarm: true}, Bar: {Prewarm: false}}", ""};
+        genny::v1::PoolManager manager{
+            "mongodb://127.0.0.1:1/?serverSelectionTimeoutMS=100", {}, ns.root()};
+
+        auto foo0 = manager.client("Foo", 0);
+        auto foo1 = manager.client("Foo", 1);
+        auto bar0 = manager.client("Bar", 0);
+        auto baz0 = manager.client("Baz", 0);
+
+        const auto connections = manager.prewarm(2);
+        REQUIRE(connections.size() == 2);
+        for (const auto& connection : connections) {
+            REQUIRE(connection.name == "Foo");
+            REQUIRE(!connection.ok);
+        }
+        REQUIRE(manager.prewarm(2).empty());
+    }
 }
@@ -0,0 +1,131 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <gennylib/GlobalRateLimiter.hpp>
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/Orchestrator.hpp>
+#include <gennylib/v1/ProcessGroup.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+// Catch2 can't assert from the workers, so they report through their exit code, and
+// must never return into the test runner.
+[[noreturn]] void exitWorker(bool ok) {
+    _exit(ok ? 0 : 1);
+}
+
+TEST_CASE("ProcessGroup") {
+#ifdef __linux__
+    v1::ProcessGroup group{2};
+
+    SECTION("Workers take phases together and share rate limiter buckets") {
+        Orchestrator orchestrator{group};
+        if (group.fork()) {
+            auto& arrivals = group.rateLimiterBucket("arrivals").burstCount;
+            orchestrator.addRequiredTokens(1);
+            bool ok = group.awaitWorkers();
+
+            ok = ok && orchestrator.awaitPhaseStart() == 0;
+            ++arrivals;
+            orchestrator.awaitPhaseEnd();
+
+            // Phase 1 can't start until the other worker has ended phase 0 too.
+            ok = ok && orchestrator.awaitPhaseStart() == 1;
+            ok = ok && arrivals.load() == 2;
+            orchestrator.awaitPhaseEnd();
+            exitWorker(ok);
+        }
+        REQUIRE(group.processes() == 2);
+        REQUIRE(!group.rank());
+        REQUIRE(group.supervise() == 0);
+    }
+
+    SECTION("Workers charge a shared bucket at the rate any of them sets") {
+        Orchestrator orchestrator{group};
+        if (group.fork()) {
+            const BaseRateSpec configured{1000 * 1000 * 1000, 1000};
+            GlobalRateLimiter limiter{configured};
+            limiter.shareBucket(group.rateLimiterBucket("changed"));
+            orchestrator.addRequiredTokens(1);
+            bool ok = group.awaitWorkers();
+
+            ok = ok && orchestrator.awaitPhaseStart() == 0;
+            if (*group.rank() == 0) {
+                limiter.setRate(BaseRateSpec{1000 * 1000, 1});
+            }
+            orchestrator.awaitPhaseEnd();
+
+            // Phase 1 starts after worker 0 changed the rate in phase 0.
+            ok = ok && orchestrator.awaitPhaseStart() == 1;
+            ok = ok && limiter.getRate() == 1000 * 1000;
+            orchestrator.awaitPhaseEnd();
+            exitWorker(ok);
+        }
+        REQUIRE(group.supervise() == 0);
+    }
+
+    SECTION("Only the worker starting a phase is told it is") {
+        Orchestrator orchestrator{group};
+        if (group.fork()) {
+            auto& starts = group.rateLimiterBucket("starts").burstCount;
+            orchestrator.addPrePhaseStartHook([&](const Orchestrator* o) {
+                if (o->startingPhase()) {
+                    ++starts;
+                }
+            });
+            orchestrator.addRequiredTokens(1);
+            bool ok = group.awaitWorkers();
+
+            ok = ok && orchestrator.awaitPhaseStart() == 0;
+            orchestrator.awaitPhaseEnd();
+            ok = ok && orchestrator.awaitPhaseStart() == 1;
+            ok = ok && starts.load() == 2;
+            orchestrator.awaitPhaseEnd();
+            exitWorker(ok);
+        }
+        REQUIRE(group.supervise() == 0);
+    }
+
+    SECTION("Latency targets can't be shared") {
+        GlobalRateLimiter limiter{LatencyRateSpec{99, TimeSpec{1000}, "Insert"}};
+        REQUIRE_THROWS_AS(limiter.shareBucket(group.rateLimiterBucket("latency")),
+                          InvalidConfigurationException);
+    }
+
+    SECTION("Percentages can't be shared") {
+        GlobalRateLimiter limiter{PercentileRateSpec{50}};
+        REQUIRE_THROWS_AS(limiter.shareBucket(group.rateLimiterBucket("percent")),
+                          InvalidConfigurationException);
+    }
+
+    SECTION("A failed worker stops the others") {
+        if (group.fork()) {
+            if (*group.rank() == 1) {
+                _exit(5);
+            }
+            // Never released by the other worker, but aborted by the supervisor.
+            exitWorker(!group.awaitWorkers());
+        }
+        REQUIRE(group.supervise() == 5);
+    }
+#endif
+}
+
+}  // namespace
+}  // namespace genny
@@ -0,0 +1,97 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <csignal>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <gennylib/v1/Profiler.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::v1 {
+namespace {
+
+volatile double burned;
+
+// Use CPU until `duration` has passed.
+void burn(std::chrono::milliseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    double x = 1;
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; ++i) {
+            x = x * 1.0000001 + 1;
+        }
+    }
+    burned = x;
+}
+
+bool hasLine(const std::string& folded, const std::string& prefix) {
+    std::istringstream lines{folded};
+    for (std::string line; std::getline(lines, line);) {
+        if (line.rfind(prefix, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE("Profiler attributes samples to the tag of the thread they interrupt") {
+    const std::string actor = "Burner";
+    const std::string operation = "Spin";
+
+    Profiler::enable(1000);
+    std::thread{[&]() {
+        Profiler::setActor(&actor);
+        Profiler::setPhase(2);
+        Profiler::setOperation(&actor, &operation);
+        burn(std::chrono::milliseconds{300});
+        Profiler::setOperation(&actor, nullptr);
+        burn(std::chrono::milliseconds{300});
+    }}.join();
+    Profiler::disable();
+
+    std::ostringstream out;
+    Profiler::writeFolded(out);
+    const auto folded = out.str();
+
+    REQUIRE(Profiler::samples() > 0);
+    REQUIRE(Profiler::dropped() == 0);
+    REQUIRE(hasLine(folded, "Burner;phase 2;Spin;"));
+    REQUIRE(hasLine(folded, "Burner;phase 2;(no operation);"));
+    // Nothing was tagged on this thread.
+    REQUIRE(!hasLine(folded, "(no actor);phase 2"));
+
+    Profiler::clear();
+    std::ostringstream cleared;
+    Profiler::writeFolded(cleared);
+    REQUIRE(cleared.str().empty());
+    REQUIRE(Profiler::samples() == 0);
+}
+
+TEST_CASE("Profiler ignores a SIGPROF that arrives after disable()") {
+    Profiler::enable(1000);
+    Profiler::disable();
+    const auto samples = Profiler::samples();
+
+    // As if raised just before the timer stopped. The default action would kill us.
+    REQUIRE(::raise(SIGPROF) == 0);
+    REQUIRE(Profiler::samples() == samples);
+    Profiler::clear();
+}
+
+}  // namespace
+}  // namespace genny::v1
@@ -0,0 +1,123 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include <gennylib/v1/SteadyStateDetector.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace std::chrono;
+using Clock = v1::SteadyStateDetector::Clock;
+
+// Steady if the 10 buckets of a 1-second window vary by no more than 5%, after at
+// least the window and at most 10 seconds.
+SteadyStateSpec spec(SteadyStateSpec::Metric metric = SteadyStateSpec::Metric::kThroughput) {
+    SteadyStateSpec out;
+    out.operation = "Op";
+    out.metric = metric;
+    out.window = TimeSpec{seconds{1}};
+    out.maxCoV = 0.05;
+    out.maxDuration = TimeSpec{seconds{10}};
+    return out;
+}
+
+/**
+ * Simulate a phase a millisecond at a time. `opsAt(ms)` operations of 1ms each are
+ * observed in each millisecond.
+ *
+ * @return how long the phase ran.
+ */
+milliseconds run(v1::SteadyStateDetector& detector, const std::function<int(int)>& opsAt) {
+    const auto started = Clock::now();
+    detector.reset(started);
+    for (int ms = 1; ms <= 60 * 1000; ++ms) {
+        for (int i = 0; i < opsAt(ms); ++i) {
+            detector.observe(milliseconds{1});
+        }
+        if (detector.isDone(started + milliseconds{ms})) {
+            return milliseconds{ms};
+        }
+    }
+    return minutes{1};
+}
+
+TEST_CASE("SteadyStateDetector ends phases once the operation is steady") {
+    SECTION("Constant throughput is steady after one window") {
+        v1::SteadyStateDetector detector{spec()};
+        REQUIRE(run(detector, [](int) { return 10; }) == seconds{1});
+
+        const auto window = detector.stableWindow();
+        REQUIRE(window);
+        REQUIRE(window->start == seconds{0});
+        REQUIRE(window->end == seconds{1});
+        REQUIRE(window->cov == Approx(0).margin(1e-9));
+    }
+
+    SECTION("A ramp isn't steady until it levels off") {
+        v1::SteadyStateDetector detector{spec()};
+        // Throughput grows every 100ms for 3 seconds, then holds.
+        const auto ranFor = run(detector, [](int ms) { return 1 + std::min(ms, 3000) / 100; });
+        REQUIRE(ranFor > seconds{3});
+        REQUIRE(ranFor <= seconds{4});
+
+        const auto window = detector.stableWindow();
+        REQUIRE(window);
+        REQUIRE(window->end == ranFor);
+        REQUIRE(window->end - window->start == seconds{1});
+        REQUIRE(window->cov <= 0.05);
+    }
+
+    SECTION("MinDuration holds off a steady result") {
+        auto minTwo = spec();
+        minTwo.minDuration = TimeSpec{seconds{2}};
+        v1::SteadyStateDetector detector{minTwo};
+        REQUIRE(run(detector, [](int) { return 10; }) == seconds{2});
+        REQUIRE(detector.stableWindow()->start == seconds{1});
+    }
+
+    SECTION("MaxDuration ends phases that never become steady") {
+        v1::SteadyStateDetector detector{spec()};
+        // Alternate between busy and quiet buckets.
+        REQUIRE(run(detector, [](int ms) { return (ms / 100) % 2 ? 20 : 2; }) == seconds{10});
+        REQUIRE(!detector.stableWindow());
+    }
+
+    SECTION("Latency ignores throughput but needs every bucket") {
+        v1::SteadyStateDetector detector{spec(SteadyStateSpec::Metric::kLatency)};
+        // Throughput swings but every operation takes 1ms. Nothing happens at first.
+        const auto ranFor =
+            run(detector, [](int ms) { return ms <= 1500 ? 0 : ((ms / 100) % 2 ? 20 : 2); });
+        REQUIRE(ranFor == milliseconds{2500});
+        REQUIRE(detector.stableWindow()->start == milliseconds{1500});
+    }
+
+    SECTION("Reset starts over") {
+        v1::SteadyStateDetector detector{spec()};
+        REQUIRE(run(detector, [](int) { return 10; }) == seconds{1});
+        REQUIRE(detector.isDone(Clock::now()));
+
+        detector.reset(Clock::now());
+        REQUIRE(!detector.stableWindow());
+        REQUIRE(!detector.isDone(Clock::now()));
+    }
+}
+
+}  // namespace
+}  // namespace genny
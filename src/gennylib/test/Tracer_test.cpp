@@ -0,0 +1,175 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include <gennylib/Orchestrator.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/Tracer.hpp>
+
+#include <metrics/metrics.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace std::chrono;
+
+struct Span {
+    std::string name;
+    std::string track;
+    double ts;
+    double dur;
+    int64_t phase;
+};
+
+// JSON is YAML, so read the trace back with yaml-cpp.
+std::vector<Span> spans() {
+    std::ostringstream json;
+    v1::Tracer::writeChromeJson(json);
+    const auto trace = YAML::Load(json.str());
+
+    std::map<int, std::string> tracks;
+    for (const auto& event : trace["traceEvents"]) {
+        if (event["name"].as<std::string>() == "thread_name") {
+            tracks[event["tid"].as<int>()] = event["args"]["name"].as<std::string>();
+        }
+    }
+    std::vector<Span> out;
+    for (const auto& event : trace["traceEvents"]) {
+        if (event["ph"].as<std::string>() == "X") {
+            out.push_back({event["name"].as<std::string>(),
+                           tracks.at(event["tid"].as<int>()),
+                           event["ts"].as<double>(),
+                           event["dur"].as<double>(),
+                           event["args"] ? event["args"]["phase"].as<int64_t>() : -1});
+        }
+    }
+    return out;
+}
+
+TEST_CASE("Tracer records spans only when enabled") {
+    v1::Tracer::clear();
+    { v1::TraceSpan span{v1::Tracer::kSleep}; }
+    REQUIRE(spans().empty());
+
+    v1::Tracer::enable();
+    v1::Tracer::setTrack("Main");
+    { v1::TraceSpan span{v1::Tracer::kSleep, 3}; }
+    v1::Tracer::disable();
+    { v1::TraceSpan span{v1::Tracer::kSleep}; }
+
+    const auto recorded = spans();
+    REQUIRE(recorded.size() == 1);
+    REQUIRE(recorded[0].name == "Sleep");
+    REQUIRE(recorded[0].track == "Main");
+    REQUIRE(recorded[0].phase == 3);
+    v1::Tracer::clear();
+}
+
+TEST_CASE("Tracer keeps each thread's most recent events") {
+    v1::Tracer::clear();
+    v1::Tracer::enable(4);
+    const auto op = v1::Tracer::intern("Actor.Op");
+    REQUIRE(v1::Tracer::intern("Actor.Op") == op);
+
+    std::thread{[&]() {
+        for (int64_t i = 1; i <= 10; ++i) {
+            v1::Tracer::record(op, i * 1000 * 1000, i * 1000 * 1000 + 1000);
+        }
+    }}.join();
+
+    auto recorded = spans();
+    REQUIRE(recorded.size() == 4);
+    std::sort(recorded.begin(), recorded.end(), [](auto& l, auto& r) { return l.ts < r.ts; });
+    REQUIRE(recorded.front().name == "Actor.Op");
+    REQUIRE(recorded.front().dur == Approx(1));
+    REQUIRE(recorded.back().ts - recorded.front().ts == Approx(3 * 1000));
+    REQUIRE(recorded.front().track == "Thread 1");
+    v1::Tracer::clear();
+}
+
+TEST_CASE("Tracer samples operations") {
+    v1::Tracer::clear();
+    v1::Tracer::enable(v1::Tracer::kDefaultEventsPerThread, 4);
+    int sampled = 0;
+    for (int i = 0; i < 100; ++i) {
+        sampled += v1::Tracer::sampleOperation();
+    }
+    REQUIRE(sampled == 25);
+    v1::Tracer::clear();
+}
+
+TEST_CASE("Tracer samples operations reported to metrics") {
+    v1::Tracer::clear();
+    v1::Tracer::enable(v1::Tracer::kDefaultEventsPerThread, 2);
+    genny::metrics::Registry metrics;
+    auto op = metrics.operation("Actor", "Op", 0u);
+    for (int i = 0; i < 4; ++i) {
+        op.start().success();
+    }
+    v1::Tracer::disable();
+
+    const auto recorded = spans();
+    REQUIRE(recorded.size() == 2);
+    REQUIRE(recorded[0].name == "Actor.Op");
+    v1::Tracer::clear();
+}
+
+TEST_CASE("Tracer shows who held up a phase") {
+    v1::Tracer::clear();
+    v1::Tracer::enable();
+
+    Orchestrator o{};
+    o.addRequiredTokens(2);
+
+    // The fiber that sleeps holds up the start of the phase for the one that doesn't.
+    v1::FiberPool pool{1};
+    for (const auto& [name, delay] : {std::pair{"Slow", 100}, std::pair{"Fast", 0}}) {
+        pool.launch([&o, name = std::string{name}, delay = delay]() {
+            v1::Tracer::setTrack(name);
+            v1::sleepFor(milliseconds{delay});
+            o.awaitPhaseStart();
+            o.awaitPhaseEnd();
+        });
+    }
+    pool.join();
+
+    std::map<std::string, double> startWait;
+    bool slept = false;
+    for (const auto& span : spans()) {
+        if (span.name == "PhaseStartWait") {
+            REQUIRE(span.phase == 0);
+            startWait[span.track] = span.dur;
+        }
+        slept = slept || (span.name == "Sleep" && span.track == "Slow" && span.dur >= 100000);
+    }
+    REQUIRE(slept);
+    REQUIRE(startWait.size() == 2);
+    REQUIRE(startWait["Fast"] >= 90 * 1000);
+    REQUIRE(startWait["Slow"] < startWait["Fast"]);
+    v1::Tracer::clear();
+}
+
+}  // namespace
+}  // namespace genny
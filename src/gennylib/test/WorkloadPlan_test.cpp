@@ -0,0 +1,123 @@
+// Copyright 2019-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <yaml-cpp/yaml.h>
+
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/Node.hpp>
+#include <gennylib/v1/WorkloadPlan.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+namespace fs = boost::filesystem;
+
+const std::string kWorkload = R"(
+SchemaVersion: 2018-07-01
+Defaults:
+  Database: &database test
+Actors:
+- Name: Inserter
+  Type: CrudActor
+  Threads: 2
+  Phases:
+  - Repeat: 10
+    Database: *database
+    Operations:
+    - OperationName: insertOne
+      OperationCommand:
+        Document: {a: {^RandomInt: {min: 0, max: 10}}, b: "quoted", c: ~, d: [1, 2.5, true]}
+  - {Nop: true}
+Metrics:
+  Format: csv
+)";
+
+void writeFile(const fs::path& path, const std::string& contents) {
+    std::ofstream{path.string(), std::ios::binary | std::ios::trunc} << contents;
+}
+
+// Dumping would differ in flow style and anchors, which plans don't keep. Neither do
+// they keep the tags of keys.
+bool same(const YAML::Node& lhs, const YAML::Node& rhs) {
+    if (lhs.Type() != rhs.Type() || lhs.Tag() != rhs.Tag() || lhs.size() != rhs.size()) {
+        return false;
+    }
+    if (lhs.IsScalar()) {
+        return lhs.Scalar() == rhs.Scalar();
+    }
+    for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end(); ++l, ++r) {
+        if (lhs.IsMap() ? l->first.Scalar() != r->first.Scalar() || !same(l->second, r->second)
+                        : !same(*l, *r)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("WorkloadPlan") {
+    const auto dir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(dir);
+    const auto source = (dir / "workload.yml").string();
+    const auto plan = (dir / "workload.plan").string();
+    writeFile(source, kWorkload);
+
+    v1::WorkloadPlan::compile(source, plan);
+    REQUIRE(v1::WorkloadPlan::isPlan(plan));
+    REQUIRE(!v1::WorkloadPlan::isPlan(source));
+
+    SECTION("Loads the same document the YAML parses to") {
+        const auto loaded = v1::WorkloadPlan::load(plan);
+        REQUIRE(!loaded.stale());
+        REQUIRE(loaded.sourcePath() == source);
+        REQUIRE(same(loaded.yaml(), YAML::Load(kWorkload)));
+
+        NodeSource nodes{loaded.yaml(), loaded.sourcePath()};
+        const auto& phase = nodes.root()["Actors"][0]["Phases"][0];
+        REQUIRE(phase["Repeat"].to<int>() == 10);
+        REQUIRE(phase["Database"].to<std::string>() == "test");
+        REQUIRE(phase["Operations"][0]["OperationName"].to<std::string>() == "insertOne");
+        REQUIRE(phase["Operations"][0]["OperationCommand"]["Document"]["c"].isNull());
+        REQUIRE(nodes.root()["Actors"][0]["Phases"][1]["Nop"].to<bool>());
+    }
+
+    SECTION("Loads the source instead once it changes") {
+        writeFile(source, kWorkload + "Clients: {Default: {QueryOptions: {maxPoolSize: 5}}}\n");
+        const auto loaded = v1::WorkloadPlan::load(plan);
+        REQUIRE(loaded.stale());
+        REQUIRE(loaded.yaml()["Clients"]["Default"]["QueryOptions"]["maxPoolSize"].as<int>() ==
+                5);
+    }
+
+    SECTION("Is used as is without its source") {
+        fs::remove(source);
+        REQUIRE(!v1::WorkloadPlan::load(plan).stale());
+    }
+
+    SECTION("Rejects truncated plans") {
+        fs::resize_file(plan, fs::file_size(plan) - 1);
+        REQUIRE_THROWS_AS(v1::WorkloadPlan::load(plan), InvalidConfigurationException);
+    }
+
+    fs::remove_all(dir);
+}
+
+}  // namespace
+}  // namespace genny
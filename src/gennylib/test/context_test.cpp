@@ -20,6 +20,8 @@
 #include <string_view>
 #include <thread>
 
+#include <unistd.h>
+
 #include <yaml-cpp/yaml.h>
 
 #include <bsoncxx/json.hpp>
@@ -27,6 +29,7 @@
 #include <gennylib/Node.hpp>
 #include <gennylib/PhaseLoop.hpp>
 #include <gennylib/context.hpp>
+#include <gennylib/v1/ProcessGroup.hpp>
 
 #include <testlib/ActorHelper.hpp>
 #include <testlib/helpers.hpp>
@@ -420,6 +423,43 @@ TEST_CASE("Duplicate Phase Numbers") {
     }
 }
 
+TEST_CASE("Warmup and Cooldown windows") {
+    genny::Orchestrator orchestrator{};
+
+    auto cast = Cast{
+        {"Nop", std::make_shared<NopProducer>()},
+    };
+
+    auto contextFor = [&](const std::string& phase) {
+        NodeSource ns("SchemaVersion: 2018-07-01\n"
+                      "Actors:\n"
+                      "- Name: Windowed\n"
+                      "  Type: Nop\n"
+                      "  Phases:\n"
+                      "  - " +
+                          phase + "\n",
+                      "");
+        WorkloadContext{ns.root(), orchestrator, mongoUri.data(), cast};
+    };
+
+    SECTION("Fit within the Duration") {
+        REQUIRE_NOTHROW(
+            contextFor("{Duration: 1 minute, Warmup: 10 seconds, Cooldown: 5 seconds}"));
+        REQUIRE_NOTHROW(contextFor("{Repeat: 100, Warmup: 10 seconds}"));
+    }
+
+    SECTION("Cooldown needs a Duration") {
+        REQUIRE_THROWS_WITH(contextFor("{Repeat: 100, Cooldown: 5 seconds}"),
+                            StartsWith("Cooldown requires a Duration"));
+    }
+
+    SECTION("Must leave some of the Duration") {
+        REQUIRE_THROWS_WITH(
+            contextFor("{Duration: 10 seconds, Warmup: 5 seconds, Cooldown: 5 seconds}"),
+            StartsWith("Warmup and Cooldown must be non-negative"));
+    }
+}
+
 TEST_CASE("No PhaseContexts") {
     NodeSource ns(R"(
     SchemaVersion: 2018-07-01
@@ -667,3 +707,190 @@ TEST_CASE("If no producer exists for an actor, then we should throw an error") {
             test(), Matches(R"(Unable to construct actors: No producer for 'Bar'(.*\n*)*)"));
     }
 }
+
+struct ByteRateActor : public Actor {
+    struct PhaseConfig {
+        explicit PhaseConfig(PhaseContext& context) : limiter{context.getByteRateLimiter()} {}
+
+        GlobalRateLimiter* limiter;
+    };
+
+    explicit ByteRateActor(ActorContext& context) : Actor{context}, loop{context} {}
+
+    void run() override {}
+
+    PhaseLoop<PhaseConfig> loop;
+};
+
+TEST_CASE("Byte GlobalRates need an Actor that enforces them") {
+    genny::Orchestrator orchestrator{};
+    auto cast = Cast{
+        {"Nop", std::make_shared<NopProducer>()},
+        {"ByteRate", std::make_shared<DefaultActorProducer<ByteRateActor>>("ByteRate")},
+    };
+    auto yaml = [](const std::string& type) {
+        const std::string phases = "[{Repeat: 1, GlobalRate: 200 MB per 1 second}]";
+        return NodeSource{"SchemaVersion: 2018-07-01\nActors:\n- {Name: Mover, Type: " + type +
+                              ", Phases: " + phases + "}\n",
+                          ""};
+    };
+
+    SECTION("Actors that take the byte limiter") {
+        auto ns = yaml("ByteRate");
+        WorkloadContext context{ns.root(), orchestrator, mongoUri.data(), cast};
+        REQUIRE(context.actors().size() == 1);
+    }
+
+    SECTION("Actors that don't") {
+        auto ns = yaml("Nop");
+        REQUIRE_THROWS_WITH((WorkloadContext{ns.root(), orchestrator, mongoUri.data(), cast}),
+                            Catch::Contains("doesn't support byte rates"));
+    }
+}
+
+struct RecordingActor : public Actor {
+    // Sets up each phase's rate limiter.
+    struct PhaseConfig {
+        explicit PhaseConfig(PhaseContext&) {}
+    };
+
+    explicit RecordingActor(ActorContext& context)
+        : Actor{context},
+          name{context["Name"].to<std::string>()},
+          random{context.rng(this->id()).nextValue()},
+          ordinal{context.workload().actorOrdinal(this->id())},
+          missing{context["Phases"][0]["Missing"].maybe<std::string>().value_or("none")},
+          loop{context} {
+        context.operation("Op", this->id());
+    }
+
+    void run() override {}
+
+    std::string name;
+    uint64_t random;
+    size_t ordinal;
+    std::string missing;
+    PhaseLoop<PhaseConfig> loop;
+};
+
+struct OneRecordingActorProducer : public ActorProducer {
+    using ActorProducer::ActorProducer;
+
+    ActorVector produce(ActorContext& context) override {
+        ActorVector out;
+        out.emplace_back(std::make_unique<RecordingActor>(context));
+        return out;
+    }
+};
+
+TEST_CASE("Actors constructed in parallel are the same as those constructed serially") {
+    auto yaml = NodeSource(R"(
+    SchemaVersion: 2018-07-01
+    Metrics:
+      Format: csv
+    Actors:
+    - Name: First
+      Type: Recording
+      Threads: 20
+      Phases:
+      - GlobalRate: 5 per 1 second
+        Repeat: 10
+    - Name: Second
+      Type: One
+    - Name: Third
+      Type: Recording
+      Threads: 30
+      Phases:
+      - Duration: 1 second
+    )",
+                           "");
+
+    auto cast = Cast{
+        {"Recording", std::make_shared<DefaultActorProducer<RecordingActor>>("Recording")},
+        {"One", std::make_shared<OneRecordingActorProducer>("One")},
+    };
+
+    using Constructed = std::vector<std::tuple<ActorId, std::string, uint64_t, size_t>>;
+    auto construct = [&](size_t setupThreads) {
+        genny::Orchestrator orchestrator{};
+        WorkloadContext context{yaml.root(), orchestrator, mongoUri.data(), cast, {}, setupThreads};
+        Constructed out;
+        for (const auto& actor : context.actors()) {
+            const auto& recording = dynamic_cast<const RecordingActor&>(*actor);
+            REQUIRE(recording.missing == "none");
+            out.emplace_back(actor->id(), recording.name, recording.random, recording.ordinal);
+        }
+        REQUIRE(context.getMetrics().getWorkerCount("First", "Op") == 20);
+        return out;
+    };
+
+    const auto serial = construct(1);
+    REQUIRE(serial.size() == 51);
+    for (size_t i = 0; i < serial.size(); ++i) {
+        REQUIRE(std::get<0>(serial[i]) == i + 1);
+    }
+    REQUIRE(std::get<1>(serial[20]) == "Second");
+    // Second is the only Actor of its Type, and Third's threads follow First's.
+    REQUIRE(std::get<3>(serial[19]) == 19);
+    REQUIRE(std::get<3>(serial[20]) == 0);
+    REQUIRE(std::get<3>(serial[21]) == 20);
+
+    for (int i = 0; i < 5; ++i) {
+        REQUIRE(construct(8) == serial);
+    }
+}
+
+TEST_CASE("A worker process only constructs the Actors it runs") {
+#ifdef __linux__
+    auto yaml = NodeSource(R"(
+    SchemaVersion: 2018-07-01
+    Metrics:
+      Format: csv
+    Actors:
+    - Name: First
+      Type: Recording
+      Threads: 3
+      Phases:
+      - Repeat: 1
+    - Name: Second
+      Type: One
+    - Name: Third
+      Type: Recording
+      Threads: 2
+      Phases:
+      - Repeat: 1
+    )",
+                           "");
+
+    auto cast = Cast{
+        {"Recording", std::make_shared<DefaultActorProducer<RecordingActor>>("Recording")},
+        {"One", std::make_shared<OneRecordingActorProducer>("One")},
+    };
+
+    v1::ProcessGroup group{2};
+    genny::Orchestrator orchestrator{group};
+    if (group.fork()) {
+        // Catch2 can't assert from the workers, so they report through their exit code.
+        bool ok = false;
+        try {
+            WorkloadContext context{yaml.root(), orchestrator, mongoUri.data(), cast, {}, 1};
+            // Worker r runs the Actors at indexes r, r + 2 and r + 4, with ids one more.
+            // Ordinals count the Actors of each Type in the whole workload.
+            const auto rank = *group.rank();
+            const auto ordinals =
+                rank == 0 ? std::vector<size_t>{0, 2, 3} : std::vector<size_t>{1, 0, 4};
+            const auto& actors = context.actors();
+            ok = actors.size() == 3;
+            for (size_t i = 0; ok && i < actors.size(); ++i) {
+                const auto& recording = dynamic_cast<const RecordingActor&>(*actors[i]);
+                ok = recording.id() == ActorId(rank + 2 * i + 1) &&
+                    recording.ordinal == ordinals[i];
+            }
+            ok = ok && context.getMetrics().getWorkerCount("First", "Op") == 2 - rank;
+        } catch (...) {
+        }
+        _exit(ok ? 0 : 1);
+    }
+    REQUIRE(group.supervise() == 0);
+#endif
+}
@@ -133,9 +133,35 @@ TEST_CASE("genny::BaseRateSpec conversions") {
         REQUIRE(YAML::Load("GlobalRate: 300 per 2 nanoseconds")["GlobalRate"]
                     .as<BaseRateSpec>()
                     .per.count() == 2);
+        REQUIRE_FALSE(YAML::Load("GlobalRate: 300 per 2 nanoseconds")["GlobalRate"]
+                          .as<BaseRateSpec>()
+                          .bytes);
+    }
+
+    SECTION("Can convert byte rates") {
+        auto spec = YAML::Load("GlobalRate: 200 MB per 1 second")["GlobalRate"].as<BaseRateSpec>();
+        REQUIRE(spec.bytes);
+        REQUIRE(spec.operations == 200 * 1000 * 1000);
+        REQUIRE(spec.per.count() == 1000000000);
+
+        REQUIRE(YAML::Load("3 KiB per 1 millisecond").as<BaseRateSpec>().operations == 3 * 1024);
+        REQUIRE(YAML::Load("1e3 B per 1 millisecond").as<BaseRateSpec>().operations == 1000);
+        REQUIRE(YAML::Load("2 GB per 1 minute").as<BaseRateSpec>() ==
+                BaseRateSpec{60000000000, 2000000000, true});
+    }
+
+    SECTION("Barfs on byte rates that overflow") {
+        REQUIRE(YAML::Load("9223372036 GB per 1 second").as<BaseRateSpec>().operations ==
+                9223372036000000000);
+        REQUIRE_THROWS_AS(YAML::Load("9223372037 GB per 1 second").as<BaseRateSpec>(),
+                          InvalidConfigurationException);
+        REQUIRE_THROWS_AS(YAML::Load("8589934592 GiB per 1 second").as<BaseRateSpec>(),
+                          InvalidConfigurationException);
     }
 
     SECTION("Barfs on invalid values") {
+        REQUIRE_THROWS(YAML::Load("200 Mb per 1 second").as<BaseRateSpec>());
+        REQUIRE_THROWS(YAML::Load("MB per 1 second").as<BaseRateSpec>());
         REQUIRE_THROWS(YAML::Load("-1 per -1 nanosecond").as<BaseRateSpec>());
         REQUIRE_THROWS(YAML::Load("-1 per -1 nanosecond").as<BaseRateSpec>());
         REQUIRE_THROWS(YAML::Load("1 pe 1000 nanoseconds").as<BaseRateSpec>());
@@ -153,6 +179,9 @@ TEST_CASE("genny::BaseRateSpec conversions") {
         n["GlobalRate"] = BaseRateSpec{20, 30};
         REQUIRE(n["GlobalRate"].as<BaseRateSpec>().per.count() == 20);
         REQUIRE(n["GlobalRate"].as<BaseRateSpec>().operations == 30);
+
+        n["ByteRate"] = BaseRateSpec{20, 3000, true};
+        REQUIRE(n["ByteRate"].as<BaseRateSpec>() == BaseRateSpec{20, 3000, true});
     }
 }
 
@@ -200,6 +229,27 @@ TEST_CASE("genny::RateSpec conversions") {
                     .getPercentileSpec()
                     ->percent == 30);
         REQUIRE_FALSE(YAML::Load("GlobalRate: 30%")["GlobalRate"].as<RateSpec>().getBaseSpec());
+
+        REQUIRE(YAML::Load("GlobalRate: 5 MiB per 1 second")["GlobalRate"]
+                    .as<RateSpec>()
+                    .getBaseSpec()
+                    ->bytes);
+
+        auto latency = YAML::Load(R"(
+GlobalRate:
+  TargetLatency: {p99.9: 5 milliseconds}
+  Operation: Insert
+  StartingRate: 100 per 1 second
+)")["GlobalRate"]
+                           .as<RateSpec>()
+                           .getLatencySpec();
+        REQUIRE(latency);
+        REQUIRE(latency->percentile == Approx(99.9));
+        REQUIRE(latency->target.count() == 5000000);
+        REQUIRE(latency->operation == "Insert");
+        REQUIRE(latency->actor.empty());
+        REQUIRE(latency->startingRate == BaseRateSpec{1000000000, 100});
+        REQUIRE(latency->interval.count() == 1000000000);
     }
 
     SECTION("Barfs on invalid values") {
@@ -208,6 +258,14 @@ TEST_CASE("genny::RateSpec conversions") {
         REQUIRE_THROWS(YAML::Load("46%28").as<RateSpec>());
         REQUIRE_THROWS(YAML::Load("{499}").as<RateSpec>());
         REQUIRE_THROWS(YAML::Load("").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{TargetLatency: {p99: 5 milliseconds}}").as<RateSpec>());
+        REQUIRE_THROWS(
+            YAML::Load("{TargetLatency: {q99: 5 milliseconds}, Operation: A}").as<RateSpec>());
+        REQUIRE_THROWS(
+            YAML::Load("{TargetLatency: {p100: 5 milliseconds}, Operation: A}").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{TargetLatency: {p99: 5 milliseconds, p50: 1 millisecond}, "
+                                  "Operation: A}")
+                           .as<RateSpec>());
     }
 
     SECTION("Can encode") {
@@ -221,10 +279,117 @@ TEST_CASE("genny::RateSpec conversions") {
         YAML::Node n2;
         n2["GlobalRate"] = RateSpec{percentile};
         REQUIRE(n2["GlobalRate"].as<RateSpec>().getPercentileSpec()->percent == 75);
+
+        auto latency = LatencyRateSpec{95, TimeSpec{2000}, "Find"};
+        latency.actor = "Finder";
+        YAML::Node n3;
+        n3["GlobalRate"] = RateSpec{latency};
+        REQUIRE(*n3["GlobalRate"].as<RateSpec>().getLatencySpec() == latency);
     }
 }
 
 
+TEST_CASE("genny::SteadyStateSpec conversions") {
+    SECTION("Can convert to genny::SteadyStateSpec") {
+        auto spec = YAML::Load(R"(
+SteadyState:
+  Operation: Crud
+  Window: 30 seconds
+  MaxCoV: 0.05
+  MinDuration: 2 minutes
+  MaxDuration: 20 minutes
+)")["SteadyState"]
+                        .as<SteadyStateSpec>();
+        REQUIRE(spec.operation == "Crud");
+        REQUIRE(spec.actor.empty());
+        REQUIRE(spec.metric == SteadyStateSpec::Metric::kThroughput);
+        REQUIRE(spec.window.count() == 30 * std::pow(10, 9));
+        REQUIRE(spec.buckets == 10);
+        REQUIRE(spec.maxCoV == Approx(0.05));
+        REQUIRE(spec.minDuration->count() == 120 * std::pow(10, 9));
+        REQUIRE(spec.maxDuration.count() == 1200 * std::pow(10, 9));
+
+        spec = YAML::Load("{Operation: Find, Actor: Finder, Metric: Latency, Window: 1 second, "
+                          "Buckets: 4, MaxCoV: 0.1, MaxDuration: 1 minute}")
+                   .as<SteadyStateSpec>();
+        REQUIRE(spec.actor == "Finder");
+        REQUIRE(spec.metric == SteadyStateSpec::Metric::kLatency);
+        REQUIRE(spec.buckets == 4);
+        REQUIRE(!spec.minDuration);
+    }
+
+    SECTION("Barfs on invalid values") {
+        REQUIRE_THROWS(YAML::Load("{Window: 1 second, MaxCoV: 0.1, MaxDuration: 1 minute}")
+                           .as<SteadyStateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Operation: A, Window: 1 second, MaxCoV: 0.1}")
+                           .as<SteadyStateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Operation: A, Metric: Errors, Window: 1 second, "
+                                  "MaxCoV: 0.1, MaxDuration: 1 minute}")
+                           .as<SteadyStateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Operation: A, Window: 1 second, MaxCoV: 0, "
+                                  "MaxDuration: 1 minute}")
+                           .as<SteadyStateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Operation: A, Window: 1 second, Buckets: 1, MaxCoV: 0.1, "
+                                  "MaxDuration: 1 minute}")
+                           .as<SteadyStateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Operation: A, Window: 1 second, MaxCoV: 0.1, "
+                                  "MinDuration: 2 minutes, MaxDuration: 1 minute}")
+                           .as<SteadyStateSpec>());
+    }
+
+    SECTION("Can encode") {
+        SteadyStateSpec spec;
+        spec.operation = "Find";
+        spec.actor = "Finder";
+        spec.metric = SteadyStateSpec::Metric::kLatency;
+        spec.window = TimeSpec{std::chrono::seconds{10}};
+        spec.maxCoV = 0.02;
+        spec.minDuration = TimeSpec{std::chrono::seconds{30}};
+        spec.maxDuration = TimeSpec{std::chrono::minutes{5}};
+        YAML::Node node;
+        node["SteadyState"] = spec;
+        REQUIRE(node["SteadyState"].as<SteadyStateSpec>() == spec);
+    }
+}
+
+TEST_CASE("genny::AffinitySpec conversions") {
+    SECTION("Can convert to genny::AffinitySpec") {
+        auto spec = YAML::Load("[3, 1, 1]").as<AffinitySpec>();
+        REQUIRE(spec.policy == AffinitySpec::Policy::kCpus);
+        REQUIRE(spec.cpus == std::vector<int>{1, 3});
+
+        spec = YAML::Load("0-3,8").as<AffinitySpec>();
+        REQUIRE(spec.policy == AffinitySpec::Policy::kCpus);
+        REQUIRE(spec.cpus == std::vector<int>{0, 1, 2, 3, 8});
+
+        REQUIRE(YAML::Load("spread").as<AffinitySpec>().policy == AffinitySpec::Policy::kSpread);
+        REQUIRE(YAML::Load("compact").as<AffinitySpec>().policy ==
+                AffinitySpec::Policy::kCompact);
+
+        spec = YAML::Load("{NumaNode: 1}").as<AffinitySpec>();
+        REQUIRE(spec.policy == AffinitySpec::Policy::kNumaNode);
+        REQUIRE(spec.numaNode == 1);
+    }
+
+    SECTION("Barfs on invalid values") {
+        REQUIRE_THROWS(YAML::Load("[]").as<AffinitySpec>());
+        REQUIRE_THROWS(YAML::Load("[0, -1]").as<AffinitySpec>());
+        REQUIRE_THROWS(YAML::Load("everywhere").as<AffinitySpec>());
+        REQUIRE_THROWS(YAML::Load("3-1").as<AffinitySpec>());
+        REQUIRE_THROWS(YAML::Load("{NumaNode: -1}").as<AffinitySpec>());
+        REQUIRE_THROWS(YAML::Load("{NumaNode: 0, Cpus: [1]}").as<AffinitySpec>());
+    }
+
+    SECTION("Can encode") {
+        for (const auto* yaml : {"[0, 2]", "spread", "compact", "{NumaNode: 1}"}) {
+            const auto spec = YAML::Load(yaml).as<AffinitySpec>();
+            YAML::Node node;
+            node["Affinity"] = spec;
+            REQUIRE(node["Affinity"].as<AffinitySpec>() == spec);
+        }
+    }
+}
+
 TEST_CASE("genny::PhaseRangeSpec conversions") {
     SECTION("Can convert to genny::PhaseRangeSpec") {
         auto yaml = YAML::Load("Phase: 0..20");
@@ -238,6 +238,30 @@ TEST_CASE("Orchestrator") {
     }
 }
 
+TEST_CASE("Orchestrator records phase skew") {
+    genny::metrics::Registry metrics;
+    genny::Orchestrator o{};
+    o.addRequiredTokens(2);
+
+    auto early = std::thread([&]() {
+        o.awaitPhaseStart();
+        o.awaitPhaseEnd();
+    });
+    auto late = std::thread([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        o.awaitPhaseStart();
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        o.awaitPhaseEnd();
+    });
+    early.join();
+    late.join();
+
+    REQUIRE(o.currentPhase() == 1);
+    REQUIRE(o.lastPhaseStartSkew() >= std::chrono::milliseconds{20});
+    REQUIRE(o.lastPhaseEndSkew() >= std::chrono::milliseconds{10});
+    REQUIRE(o.lastPhaseEndSkew() < std::chrono::milliseconds{20});
+}
+
 // more easily construct v1::ActorPhase instances
 using PhaseConfig =
     std::tuple<PhaseNumber, int, std::optional<IntegerSpec>, std::optional<TimeSpec>>;
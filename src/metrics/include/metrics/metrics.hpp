@@ -16,10 +16,14 @@
 #define HEADER_058638D3_7069_42DC_809F_5DB533FCFBA3_INCLUDED
 
 #include <boost/filesystem.hpp>
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include <gennylib/Node.hpp>
 #include <gennylib/conventions.hpp>
@@ -158,7 +162,9 @@ private:
  *
  * As of now, none of the metrics classes are thread-safe, however they are all
  * thread-compatible. Two threads may not record values to the same metrics names
- * at the same time.
+ * at the same time. Creating operations, observers, and exclusion windows during
+ * setup is thread-safe, so Actors can be constructed in parallel. Operations may also
+ * be created while others are reporting.
  *
  * `metrics::Reporter` instances have read-access to the TSD data, but that should
  * only be used by workload-drivers to produce a report of the metrics at specific-points
@@ -203,19 +209,8 @@ public:
                                       ActorId actorId,
                                       std::optional<genny::PhaseNumber> phase = std::nullopt,
                                       bool internal = false) {
-        StreamPtr stream = nullptr;
-
-        auto pathPrefix = internal ? _internalPathPrefix : _pathPrefix;
-        auto& opsByType = this->_ops[actorName];
-        auto& opsByThread = opsByType[opName];
-        if (_format.useGrpc() && opsByThread.find(actorId) == opsByThread.end()) {
-            auto name = createName(actorName, opName, phase, internal);
-            stream = _grpcClient->createStream(actorId, name, phase, pathPrefix);
-        }
-        auto opIt =
-            opsByThread.try_emplace(actorId, std::move(actorName), *this, std::move(opName), stream)
-                .first;
-        return OperationT{opIt->second};
+        return this->findOrCreate(
+            std::move(actorName), std::move(opName), actorId, phase, internal, std::nullopt);
     }
 
     OperationT<ClockSource> operation(std::string actorName,
@@ -225,26 +220,86 @@ public:
                                       double_t percentage,
                                       std::optional<genny::PhaseNumber> phase = std::nullopt,
                                       bool internal = false) {
-        auto& opsByType = this->_ops[actorName];
-        auto& opsByThread = opsByType[opName];
-        auto pathPrefix = internal ? _internalPathPrefix : _pathPrefix;
-        StreamPtr stream = nullptr;
-        if (_format.useGrpc() && opsByThread.find(actorId) == opsByThread.end()) {
-            auto name = createName(actorName, opName, phase, internal);
-            stream = _grpcClient->createStream(actorId, name, phase, pathPrefix);
+        return this->findOrCreate(
+            std::move(actorName),
+            std::move(opName),
+            actorId,
+            phase,
+            internal,
+            std::make_optional<typename OperationImpl<ClockSource>::OperationThreshold>(
+                threshold, percentage));
+    }
+
+    /**
+     * Have `observer` receive the duration of every (actorName, opName) operation
+     * reported by any thread, including those of operations not yet created.
+     *
+     * Like operation(), this may only be called during setup.
+     *
+     * @param observer not owned; must outlive this registry.
+     */
+    void addObserver(const std::string& actorName,
+                     const std::string& opName,
+                     OperationObserver* observer) {
+        std::lock_guard<std::mutex> lock{*_mutex};
+        _observers[actorName][opName].push_back(observer);
+        if (auto byType = _ops.find(actorName); byType != _ops.end()) {
+            if (auto byThread = byType->second.find(opName); byThread != byType->second.end()) {
+                for (auto& [id, op] : byThread->second) {
+                    op.addObserver(observer);
+                }
+            }
+        }
+    }
+
+    /**
+     * @return the window whose warm-up and cool-down events every operation `actorName`
+     * creates from now on reports to its `[operation].Excluded` operation.
+     *
+     * Like operation(), this may only be called during setup, and before `actorName`
+     * creates any operations.
+     */
+    ExclusionWindowT<ClockSource>& exclusionWindow(const std::string& actorName) {
+        std::lock_guard<std::mutex> lock{*_mutex};
+        auto& window = _exclusionWindows[actorName];
+        if (!window) {
+            if (_ops.find(actorName) != _ops.end()) {
+                BOOST_THROW_EXCEPTION(std::logic_error(
+                    "Exclusion window created after operations of Actor " + actorName));
+            }
+            window = std::make_unique<ExclusionWindowT<ClockSource>>();
+        }
+        return *window;
+    }
+
+    /**
+     * @return how many operations have been created, counting each thread's separately.
+     */
+    std::size_t operationCount() const {
+        std::lock_guard<std::mutex> lock{*_mutex};
+        std::size_t count = 0;
+        for (const auto& [actorName, opsByType] : _ops) {
+            for (const auto& [opName, opsByThread] : opsByType) {
+                count += opsByThread.size();
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @return how many bytes each operation reserves up front for its events in this
+     * registry's format: a TimeSeries for csv, and a stream's two buffers for ftdc.
+     */
+    std::size_t reservedBytesPerOperation() const {
+        std::size_t bytes = 0;
+        if (_format.useCsv()) {
+            using Series = typename OperationImpl<ClockSource>::EventSeries;
+            bytes += Series::kReserved * sizeof(typename Series::ElementType);
+        }
+        if (_format.useGrpc()) {
+            bytes += 2 * v2::BUFFER_SIZE * sizeof(v2::MetricsArgs<ClockSource>);
         }
-        auto opIt =
-            opsByThread
-                .try_emplace(
-                    actorId,
-                    std::move(actorName),
-                    *this,
-                    std::move(opName),
-                    stream,
-                    std::make_optional<typename OperationImpl<ClockSource>::OperationThreshold>(
-                        threshold, percentage))
-                .first;
-        return OperationT{opIt->second};
+        return bytes;
     }
 
     [[nodiscard]] const OperationsMap& getOps(v1::Permission) const {
@@ -260,10 +315,25 @@ public:
      * Assumes the count is constant across phases for a given (actor, operation).
      */
     std::size_t getWorkerCount(const std::string& actorName, const std::string& opName) const {
-        return (_ops.at(actorName).at(opName)).size();
+        std::lock_guard<std::mutex> lock{*_mutex};
+        return _workerCounts.at(actorName).at(opName).load();
     }
 
 
+    /**
+     * Have ftdc metrics sent to the collector now rather than once enough have been
+     * buffered. Thread-safe. csv metrics are only written by a Reporter at the end.
+     *
+     * @return whether there was anything to flush.
+     */
+    bool flush() {
+        if (!_grpcClient) {
+            return false;
+        }
+        _grpcClient->flush();
+        return true;
+    }
+
     const MetricsFormat& getFormat() const {
         return _format;
     }
@@ -273,6 +343,101 @@ public:
     }
 
 private:
+    using OperationThreshold = typename OperationImpl<ClockSource>::OperationThreshold;
+
+    OperationT<ClockSource> findOrCreate(std::string actorName,
+                                         std::string opName,
+                                         ActorId actorId,
+                                         std::optional<genny::PhaseNumber> phase,
+                                         bool internal,
+                                         std::optional<OperationThreshold> threshold) {
+        // Events in an exclusion window go to an operation of their own, so the raw
+        // output keeps them apart in a form the collector already understands.
+        OperationImpl<ClockSource>* excluded = nullptr;
+        if (this->hasExclusionWindow(actorName)) {
+            excluded = &this->findOrCreateImpl(
+                actorName, opName + ".Excluded", actorId, phase, internal, std::nullopt, nullptr);
+        }
+        return OperationT{this->findOrCreateImpl(std::move(actorName),
+                                                 std::move(opName),
+                                                 actorId,
+                                                 phase,
+                                                 internal,
+                                                 std::move(threshold),
+                                                 excluded)};
+    }
+
+    bool hasExclusionWindow(const std::string& actorName) const {
+        std::lock_guard<std::mutex> lock{*_mutex};
+        return _exclusionWindows.find(actorName) != _exclusionWindows.end();
+    }
+
+    OperationImpl<ClockSource>& findOrCreateImpl(std::string actorName,
+                                                 std::string opName,
+                                                 ActorId actorId,
+                                                 std::optional<genny::PhaseNumber> phase,
+                                                 bool internal,
+                                                 std::optional<OperationThreshold> threshold,
+                                                 OperationImpl<ClockSource>* excluded) {
+        std::unique_lock<std::mutex> lock{*_mutex};
+        if (auto existing = this->find(actorName, opName, actorId)) {
+            return *existing;
+        }
+
+        // Creating a stream makes synchronous calls to the metrics collector, so Actors
+        // constructed in parallel mustn't wait on each other's.
+        StreamPtr stream = nullptr;
+        if (_format.useGrpc()) {
+            lock.unlock();
+            auto name = createName(actorName, opName, phase, internal);
+            stream = _grpcClient->createStream(
+                actorId, name, phase, internal ? _internalPathPrefix : _pathPrefix);
+            lock.lock();
+        }
+
+        // If another thread created this one in the meantime, its stream is kept and ours
+        // goes unused.
+        auto& opsByThread = this->_ops[actorName][opName];
+        auto [opIt, inserted] = opsByThread.try_emplace(
+            actorId, std::move(actorName), *this, std::move(opName), stream, threshold);
+        if (inserted) {
+            auto& workers = _workerCounts[opIt->second.getActorName()][opIt->second.getOpName()];
+            workers.store(opsByThread.size());
+            opIt->second.setWorkerCount(&workers);
+            this->attachObservers(opIt->second, excluded);
+        }
+        return opIt->second;
+    }
+
+    // Requires _mutex.
+    OperationImpl<ClockSource>* find(const std::string& actorName,
+                                     const std::string& opName,
+                                     ActorId actorId) {
+        if (auto byType = _ops.find(actorName); byType != _ops.end()) {
+            if (auto byThread = byType->second.find(opName); byThread != byType->second.end()) {
+                if (auto op = byThread->second.find(actorId); op != byThread->second.end()) {
+                    return &op->second;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Requires _mutex.
+    void attachObservers(OperationImpl<ClockSource>& op, OperationImpl<ClockSource>* excluded) {
+        if (auto window = _exclusionWindows.find(op.getActorName());
+            excluded && window != _exclusionWindows.end()) {
+            op.setExclusionWindow(window->second.get(), excluded);
+        }
+        if (auto byActor = _observers.find(op.getActorName()); byActor != _observers.end()) {
+            if (auto byOp = byActor->second.find(op.getOpName()); byOp != byActor->second.end()) {
+                for (auto* observer : byOp->second) {
+                    op.addObserver(observer);
+                }
+            }
+        }
+    }
+
     std::string createName(const std::string& actorName,
                            const std::string& opName,
                            const std::optional<genny::PhaseNumber>& phase,
@@ -293,7 +458,22 @@ private:
     }
 
     std::unique_ptr<GrpcClient> _grpcClient;
+    // Actors may be constructed in parallel, so setup guards everything below. Behind a
+    // pointer so the registry stays movable.
+    std::unique_ptr<std::mutex> _mutex = std::make_unique<std::mutex>();
     OperationsMap _ops;
+    // actor name -> operation name -> the size of its OperationsByThread, which the
+    // operations read when reporting. Nodes never move, so the counts can be read
+    // without _mutex while other operations are created.
+    std::unordered_map<std::string,
+                       std::unordered_map<std::string, std::atomic<std::size_t>>>
+        _workerCounts;
+    // actor name -> operation name -> observers, applied to operations as they're created.
+    std::unordered_map<std::string,
+                       std::unordered_map<std::string, std::vector<OperationObserver*>>>
+        _observers;
+    std::unordered_map<std::string, std::unique_ptr<ExclusionWindowT<ClockSource>>>
+        _exclusionWindows;
     MetricsFormat _format;
     boost::filesystem::path _pathPrefix;
     boost::filesystem::path _internalPathPrefix;
@@ -15,11 +15,17 @@
 #ifndef HEADER_3D319F23_C539_4B6B_B4E7_23D23E2DCD52_INCLUDED
 #define HEADER_3D319F23_C539_4B6B_B4E7_23D23E2DCD52_INCLUDED
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <ostream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <boost/core/noncopyable.hpp>
 #include <boost/filesystem.hpp>
@@ -40,6 +46,143 @@ using actor_count_t = size_t;
 
 enum class OutcomeType : uint8_t { kSuccess = 0, kFailure = 1, kUnknown = 2 };
 
+/**
+ * Receives the duration of each reported operation.
+ *
+ * Observers are attached through RegistryT::addObserver() and are called
+ * from the threads reporting the operation, so implementations must be thread-safe.
+ */
+class OperationObserver {
+public:
+    virtual ~OperationObserver() = default;
+
+    virtual void observe(std::chrono::nanoseconds duration) = 0;
+};
+
+/**
+ * Hears of every operation of every Actor on the thread running it, for instrumentation
+ * that lives above the metrics library, e.g. to attribute what a thread does to the
+ * operation it's running.
+ *
+ * Listeners are added with addOperationListener() and never removed. They're called on
+ * the hot path, so should return early when they have nothing to do. With none added,
+ * each operation costs a load and a branch that's never taken.
+ */
+class OperationListener {
+public:
+    virtual ~OperationListener() = default;
+
+    /**
+     * The calling thread started an operation. The names outlive the run.
+     */
+    virtual void started(const std::string& actorName, const std::string& opName) = 0;
+
+    /**
+     * The calling thread reported or discarded the operation it started last.
+     */
+    virtual void stopped(const std::string& actorName) = 0;
+
+    /**
+     * An operation was reported as running from `started` to `finished`, both since the
+     * epoch of the metrics clock.
+     */
+    virtual void reported(const std::string& actorName,
+                          const std::string& opName,
+                          std::chrono::nanoseconds started,
+                          std::chrono::nanoseconds finished) = 0;
+};
+
+namespace internals {
+
+struct OperationListeners {
+    static constexpr std::size_t kMaxListeners = 8;
+
+    // Only taken to add; readers load `count` and then read that many.
+    std::mutex adding;
+    std::array<OperationListener*, kMaxListeners> listeners{};
+    std::atomic<std::size_t> count = 0;
+
+    template <typename F>
+    void forEach(F&& f) const {
+        const auto n = count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i) {
+            f(*listeners[i]);
+        }
+    }
+};
+
+inline OperationListeners& operationListeners() {
+    static OperationListeners listeners;
+    return listeners;
+}
+
+}  // namespace internals
+
+/**
+ * Have `listener` hear of every operation from now on. Thread-safe.
+ *
+ * @param listener not owned; must outlive every Actor.
+ */
+inline void addOperationListener(OperationListener* listener) {
+    auto& all = internals::operationListeners();
+    std::lock_guard<std::mutex> lock{all.adding};
+    const auto n = all.count.load(std::memory_order_relaxed);
+    if (n == all.listeners.size()) {
+        throw std::logic_error("Too many OperationListeners");
+    }
+    all.listeners[n] = listener;
+    all.count.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * The warm-up and cool-down windows of the phase an Actor is currently running,
+ * from a phase's `Warmup:` and `Cooldown:` keys.
+ *
+ * Events that finish inside a window are reported to a separate `[operation].Excluded`
+ * operation instead, so they're kept in the raw output but left out of the operation's
+ * summaries, observers, and OperationThreshold checks. The windows are moved at the
+ * start of each phase and may be read from any thread.
+ */
+template <typename ClockSource>
+class ExclusionWindowT {
+public:
+    using time_point = typename ClockSource::time_point;
+
+    /**
+     * Begin a phase at `phaseStart`. Events finishing before `warmupEnd` or from
+     * `cooldownStart` on are excluded. Pass `phaseStart` for no warm-up and
+     * `time_point::max()` for no cool-down.
+     */
+    void set(time_point phaseStart, time_point warmupEnd, time_point cooldownStart) {
+        _phaseStart.store(phaseStart.time_since_epoch().count(), std::memory_order_relaxed);
+        _warmupEnd.store(warmupEnd.time_since_epoch().count(), std::memory_order_relaxed);
+        _cooldownStart.store(cooldownStart.time_since_epoch().count(),
+                             std::memory_order_relaxed);
+    }
+
+    /**
+     * Begin a phase that excludes nothing.
+     */
+    void clear(time_point phaseStart) {
+        this->set(phaseStart, phaseStart, time_point::max());
+    }
+
+    bool excludes(time_point finished) const {
+        const auto at = finished.time_since_epoch().count();
+        // Events from an earlier phase that are reported late aren't in its warm-up.
+        return at >= _phaseStart.load(std::memory_order_relaxed) &&
+            (at < _warmupEnd.load(std::memory_order_relaxed) ||
+             at >= _cooldownStart.load(std::memory_order_relaxed));
+    }
+
+private:
+    using rep = typename time_point::rep;
+
+    std::atomic<rep> _phaseStart{time_point::min().time_since_epoch().count()};
+    std::atomic<rep> _warmupEnd{time_point::min().time_since_epoch().count()};
+    std::atomic<rep> _cooldownStart{time_point::max().time_since_epoch().count()};
+};
+
 /**
  * The data captured at a particular time-point.
  *
@@ -227,17 +370,70 @@ public:
         return *_events;
     }
 
+    /**
+     * @param observer
+     *   called with the duration of every operation reported after this call.
+     *   Not owned; must outlive this OperationImpl.
+     */
+    void addObserver(OperationObserver* observer) {
+        _observers.push_back(observer);
+    }
+
+    /**
+     * @param window
+     *   events reported after this call that finish inside it go to `excluded` instead.
+     * @param excluded
+     *   takes the excluded events.
+     * Neither is owned; both must outlive this OperationImpl.
+     */
+    void setExclusionWindow(const ExclusionWindowT<ClockSource>* window,
+                            OperationImpl* excluded) {
+        _exclusionWindow = window;
+        _excluded = excluded;
+    }
+
+    /**
+     * @param workerCount
+     *   how many threads report this operation, read with every ftdc event. Not owned;
+     *   must outlive this OperationImpl.
+     */
+    void setWorkerCount(const std::atomic<std::size_t>* workerCount) {
+        _workerCount = workerCount;
+    }
+
     void reportAt(time_point started, time_point finished, OperationEventT<ClockSource>&& event) {
+        if (_exclusionWindow && _exclusionWindow->excludes(finished)) {
+            _excluded->reportAt(started, finished, std::move(event));
+            return;
+        }
         if (_threshold) {
             _threshold->check(started, finished);
         }
+        if (!_observers.empty()) {
+            const auto duration =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started);
+            for (auto* observer : _observers) {
+                observer->observe(duration);
+            }
+        }
         if (_stream) {
-            _stream->addAt(
-                finished, std::move(event), _registry.getWorkerCount(_actorName, _opName));
+            // Operations may still be being created for other threads, so the count is
+            // read without looking this one up in the registry.
+            const auto workers =
+                _workerCount ? _workerCount->load(std::memory_order_relaxed) : 1;
+            _stream->addAt(finished, std::move(event), workers);
         }
         if (_useCsv) {
             _events->addAt(finished, event);
         }
+        internals::operationListeners().forEach([&](OperationListener& listener) {
+            using std::chrono::duration_cast;
+            using std::chrono::nanoseconds;
+            listener.reported(_actorName,
+                              _opName,
+                              duration_cast<nanoseconds>(started.time_since_epoch()),
+                              duration_cast<nanoseconds>(finished.time_since_epoch()));
+        });
     }
 
     void reportSynthetic(time_point finished,
@@ -266,6 +462,10 @@ private:
     const std::string _opName;
     StreamPtr _stream;  // Streams are owned by the grpc client.
     OptionalOperationThreshold _threshold;
+    std::vector<OperationObserver*> _observers;
+    const ExclusionWindowT<ClockSource>* _exclusionWindow = nullptr;
+    OperationImpl* _excluded = nullptr;
+    const std::atomic<std::size_t>* _workerCount = nullptr;
     std::unique_ptr<EventSeries> _events;
 };
 
@@ -280,7 +480,11 @@ public:
     using time_point = typename ClockSource::time_point;
 
     explicit OperationContextT(internals::OperationImpl<ClockSource>* op)
-        : _op{op}, _started{ClockSource::now()} {}
+        : _op{op}, _started{ClockSource::now()} {
+        internals::operationListeners().forEach([&](OperationListener& listener) {
+            listener.started(_op->getActorName(), _op->getOpName());
+        });
+    }
 
     OperationContextT(OperationContextT<ClockSource>&& other) noexcept
         : _op{std::move(other._op)},
@@ -353,6 +557,7 @@ public:
      */
     void discard() {
         _isClosed = true;
+        this->untag();
     }
 
 private:
@@ -369,6 +574,12 @@ private:
 
         _op->reportAt(_started, finished, std::move(_event));
         _isClosed = true;
+        this->untag();
+    }
+
+    void untag() {
+        internals::operationListeners().forEach(
+            [&](OperationListener& listener) { listener.stopped(_op->getActorName()); });
     }
 
     internals::OperationImpl<ClockSource>* const _op;
@@ -43,9 +43,11 @@ public:
     using ElementType = std::pair<time_point, T>;
     using VectorType = std::vector<ElementType>;
 
+    // could make this a param passed down from Registry if needed
+    static constexpr size_t kReserved = 1000 * 1000;
+
     explicit constexpr TimeSeries() {
-        // could make 1000*1000 a param passed down from Registry if needed
-        _vals.reserve(1000 * 1000);
+        _vals.reserve(kReserved);
     }
 
     /**
@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -341,6 +342,12 @@ public:
         _cv.notify_all();
     }
 
+    // Send everything buffered so far, however little, when next awake.
+    void flush() {
+        _flushing = true;
+        wake();
+    }
+
     ~GrpcThread() {
         _thread.join();
     }
@@ -352,17 +359,17 @@ private:
             // We sleep for performance reasons, not correctness, so we don't need to
             // guard against spurious wakeups.
             _cv.wait_for(lk, std::chrono::milliseconds(GRPC_THREAD_SLEEP_MS));
-            reapActor();
+            reapActor(_flushing.exchange(false));
         }
 
         // Drain buffer and finish.
-        reapActor();
+        reapActor(true);
         _stream.finish();
     }
 
-    void reapActor() {
+    void reapActor(bool force) {
         int counter = 0;
-        while (_stream.sendOne(_finishing, _assertMetricsBuffer)) {
+        while (_stream.sendOne(force, _assertMetricsBuffer)) {
             counter++;
             // If finishing and all threads are draining, this helps
             // balance the server-side buffers.
@@ -374,6 +381,7 @@ private:
     }
 
     std::atomic<bool> _finishing = false;
+    std::atomic<bool> _flushing = false;
     std::mutex _streamsMutex;
     std::mutex _cvLock;
     std::condition_variable _cv;
@@ -395,15 +403,33 @@ public:
 
     GrpcClient(bool assertMetricsBuffer) : _assertMetricsBuffer{assertMetricsBuffer} {}
 
+    // Thread-safe. Only creating a collector holds up other callers; registering and
+    // opening streams, which each wait on the collector, happen concurrently.
     Stream* createStream(const ActorId& actorId,
                          const std::string& name,
                          const OptionalPhaseNumber& phase,
                          const boost::filesystem::path pathPrefix) {
-        _collectors.try_emplace(name, name, pathPrefix);
-        _collectors.at(name).incStreams();
-        _streams.emplace_back(actorId, name, phase);
-        _threads.emplace_back(_assertMetricsBuffer, _streams.back());
-        return &_streams.back();
+        Collector* collector;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            collector = &_collectors.try_emplace(name, name, pathPrefix).first->second;
+        }
+        collector->incStreams();
+        auto stream = std::make_unique<Stream>(actorId, name, phase);
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        _streams.push_back(std::move(stream));
+        _threads.emplace_back(_assertMetricsBuffer, *_streams.back());
+        return _streams.back().get();
+    }
+
+    // Thread-safe. Have every stream send what it has buffered without waiting for
+    // its buffer to fill.
+    void flush() {
+        std::lock_guard<std::mutex> lock{_mutex};
+        for (auto& thread : _threads) {
+            thread.flush();
+        }
     }
 
     ~GrpcClient() {
@@ -414,9 +440,9 @@ public:
 
 private:
     const bool _assertMetricsBuffer;
+    std::mutex _mutex;
     CollectorsMap _collectors;
-    // deque avoid copy-constructor calls
-    std::deque<Stream> _streams;
+    std::deque<std::unique_ptr<Stream>> _streams;
     std::deque<GrpcThread<ClockSource, StreamInterface>> _threads;
 };
 
@@ -468,6 +468,66 @@ TEST_CASE("Operation with threshold") {
     }
 }
 
+TEST_CASE("Warm-up and cool-down events are reported as their own operation") {
+    RegistryClockSourceStub::reset();
+    auto metrics = internals::RegistryT<RegistryClockSourceStub>{};
+    auto reporter = genny::metrics::internals::v1::ReporterT{metrics};
+
+    struct CountingObserver : public OperationObserver {
+        void observe(std::chrono::nanoseconds) override {
+            ++observed;
+        }
+        int observed = 0;
+    } observer;
+    metrics.addObserver("MyActor", "MyOp", &observer);
+
+    auto& window = metrics.exclusionWindow("MyActor");
+    // Any operation slower than 1ns outside the windows fails the threshold.
+    auto op = metrics.operation("MyActor", "MyOp", 0u, TimeSpec(1), 0.0);
+    auto other = metrics.operation("MyActor", "Other", 0u);
+
+    auto run = [](auto& operation, std::chrono::nanoseconds duration) {
+        auto ctx = operation.start();
+        RegistryClockSourceStub::advance(duration);
+        ctx.success();
+    };
+
+    // The phase starts at 10ns with a 10ns warm-up and a cool-down from 40ns.
+    RegistryClockSourceStub::advance(10ns);
+    const auto phaseStart = RegistryClockSourceStub::now();
+    window.set(phaseStart, phaseStart + 10ns, phaseStart + 30ns);
+    REQUIRE(!window.excludes(phaseStart - 5ns));
+
+    run(op, 5ns);  // finishes at 15ns, in the warm-up
+    RegistryClockSourceStub::advance(5ns);
+    run(op, 1ns);   // finishes at 21ns
+    run(op, 20ns);  // finishes at 41ns, in the cool-down
+    run(other, 1ns);
+
+    REQUIRE(observer.observed == 1);
+
+    SECTION("cedar-csv reporting keeps them apart") {
+        std::ostringstream out;
+        reporter.report<ReporterClockSourceStub>(out, MetricsFormat("cedar-csv"));
+        const auto csv = out.str();
+        REQUIRE(csv.find("15,MyActor,0,MyOp.Excluded,5,0,0,1,0,0\n") != std::string::npos);
+        REQUIRE(csv.find("21,MyActor,0,MyOp,1,0,0,1,0,0\n") != std::string::npos);
+        REQUIRE(csv.find("41,MyActor,0,MyOp.Excluded,20,0,0,1,0,0\n") != std::string::npos);
+        REQUIRE(csv.find("42,MyActor,0,Other.Excluded,1,0,0,1,0,0\n") != std::string::npos);
+        REQUIRE(csv.find(",MyActor,0,Other,") == std::string::npos);
+    }
+
+    SECTION("The next phase may have no windows") {
+        window.clear(RegistryClockSourceStub::now());
+        REQUIRE_THROWS_AS(run(op, 2ns), internals::OperationThresholdExceededException);
+    }
+
+    SECTION("Windows come before the Actor's operations") {
+        metrics.operation("Late", "MyOp", 1u);
+        REQUIRE_THROWS_AS(metrics.exclusionWindow("Late"), std::logic_error);
+    }
+}
+
 TEST_CASE("Phases can set metrics") {
 
     SECTION("With MetricsName") {